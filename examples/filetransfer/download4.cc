@@ -0,0 +1,107 @@
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/FileIoService.h"
+#include "muduo/net/TcpServer.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// download3 with reads off the loop thread, by FileIoService
+
+const size_t kBufSize = 64*1024;
+const char* g_file = NULL;
+FileIoService* g_fileIo = NULL;
+
+struct FileContext
+{
+  explicit FileContext(int f) : fd(f), offset(0) {}
+  ~FileContext() { ::close(fd); }
+
+  int fd;
+  off_t offset;
+};
+typedef std::shared_ptr<FileContext> FileContextPtr;
+
+void onHighWaterMark(const TcpConnectionPtr& conn, size_t len)
+{
+  LOG_INFO << "HighWaterMark " << len;
+}
+
+void sendChunk(const TcpConnectionPtr& conn)
+{
+  const FileContextPtr& ctx = boost::any_cast<const FileContextPtr&>(conn->getContext());
+  // holds ctx until the read completes, in case the connection is gone
+  g_fileIo->pread(conn->getLoop(), ctx->fd, ctx->offset, kBufSize,
+                  [conn, ctx](int err, Buffer* data) {
+    if (err == 0 && data->readableBytes() > 0)
+    {
+      ctx->offset += data->readableBytes();
+      conn->send(data);
+    }
+    else
+    {
+      conn->shutdown();
+      LOG_INFO << "FileServer - done";
+    }
+  });
+}
+
+void onConnection(const TcpConnectionPtr& conn)
+{
+  LOG_INFO << "FileServer - " << conn->peerAddress().toIpPort() << " -> "
+           << conn->localAddress().toIpPort() << " is "
+           << (conn->connected() ? "UP" : "DOWN");
+  if (conn->connected())
+  {
+    LOG_INFO << "FileServer - Sending file " << g_file
+             << " to " << conn->peerAddress().toIpPort();
+    conn->setHighWaterMarkCallback(onHighWaterMark, kBufSize+1);
+
+    int fd = ::open(g_file, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0)
+    {
+      conn->setContext(FileContextPtr(new FileContext(fd)));
+      sendChunk(conn);
+    }
+    else
+    {
+      conn->shutdown();
+      LOG_INFO << "FileServer - no such file";
+    }
+  }
+}
+
+void onWriteComplete(const TcpConnectionPtr& conn)
+{
+  sendChunk(conn);
+}
+
+int main(int argc, char* argv[])
+{
+  LOG_INFO << "pid = " << getpid();
+  if (argc > 1)
+  {
+    g_file = argv[1];
+
+    FileIoService fileIo;
+    fileIo.start(2);
+    g_fileIo = &fileIo;
+
+    EventLoop loop;
+    InetAddress listenAddr(2021);
+    TcpServer server(&loop, listenAddr, "FileServer");
+    server.setConnectionCallback(onConnection);
+    server.setWriteCompleteCallback(onWriteComplete);
+    server.start();
+    loop.loop();
+    fileIo.stop();
+  }
+  else
+  {
+    fprintf(stderr, "Usage: %s file_for_downloading\n", argv[0]);
+  }
+}
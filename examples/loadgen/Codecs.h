@@ -0,0 +1,124 @@
+#ifndef MUDUO_EXAMPLES_LOADGEN_CODECS_H
+#define MUDUO_EXAMPLES_LOADGEN_CODECS_H
+
+#include "examples/loadgen/LoadGenerator.h"
+
+#include "muduo/net/Buffer.h"
+
+#include <algorithm>
+
+#include <stdlib.h>
+#include <strings.h>
+
+namespace loadgen
+{
+
+// Sends fixed size message, expects the same number of bytes back.
+class EchoCodec : public Codec
+{
+ public:
+  explicit EchoCodec(const muduo::string& message)
+    : message_(message)
+  {
+  }
+
+  void encodeRequest(int64_t, muduo::net::Buffer* buf) override
+  {
+    buf->append(message_);
+  }
+
+  DecodeResult decodeResponse(muduo::net::Buffer* buf, int64_t*) override
+  {
+    if (buf->readableBytes() < message_.size())
+      return kIncomplete;
+    buf->retrieve(message_.size());
+    return kResponse;
+  }
+
+ private:
+  const muduo::string message_;
+};
+
+// Sends a line, expects a line back, eg. sudoku, memcached, redis inline commands.
+class LineCodec : public Codec
+{
+ public:
+  explicit LineCodec(const muduo::string& line, size_t maxLineLength = 65536)
+    : request_(line + "\r\n"),
+      maxLineLength_(maxLineLength)
+  {
+  }
+
+  void encodeRequest(int64_t, muduo::net::Buffer* buf) override
+  {
+    buf->append(request_);
+  }
+
+  DecodeResult decodeResponse(muduo::net::Buffer* buf, int64_t*) override
+  {
+    const char* crlf = buf->findCRLF();
+    if (crlf)
+    {
+      buf->retrieveUntil(crlf + 2);
+      return kResponse;
+    }
+    return buf->readableBytes() > maxLineLength_ ? kError : kIncomplete;
+  }
+
+ private:
+  const muduo::string request_;
+  const size_t maxLineLength_;
+};
+
+// HTTP/1.1 GET with keep-alive, response must have Content-Length.
+class HttpGetCodec : public Codec
+{
+ public:
+  HttpGetCodec(const muduo::string& host, const muduo::string& path)
+    : request_("GET " + path + " HTTP/1.1\r\nHost: " + host + "\r\n\r\n")
+  {
+  }
+
+  void encodeRequest(int64_t, muduo::net::Buffer* buf) override
+  {
+    buf->append(request_);
+  }
+
+  DecodeResult decodeResponse(muduo::net::Buffer* buf, int64_t*) override
+  {
+    static const char kCRLFCRLF[] = "\r\n\r\n";
+    const char* limit = buf->peek() + buf->readableBytes();
+    const char* end = std::search(buf->peek(), limit, kCRLFCRLF, kCRLFCRLF + 4);
+    if (end == limit)
+      return buf->readableBytes() > kMaxHeaderLength ? kError : kIncomplete;
+
+    const char* body = end + 4;
+    long contentLength = -1;
+    const char* line = buf->peek();
+    while (line < end)
+    {
+      const char* crlf = buf->findCRLF(line);
+      static const char kContentLength[] = "Content-Length:";
+      if (static_cast<size_t>(crlf - line) > sizeof kContentLength
+          && strncasecmp(line, kContentLength, sizeof kContentLength - 1) == 0)
+      {
+        contentLength = strtol(line + sizeof kContentLength - 1, NULL, 10);
+      }
+      line = crlf + 2;
+    }
+    if (contentLength < 0)
+      return kError;
+    if (limit - body < contentLength)
+      return kIncomplete;
+    buf->retrieveUntil(body + contentLength);
+    return kResponse;
+  }
+
+ private:
+  static const size_t kMaxHeaderLength = 64 * 1024;
+  const muduo::string request_;
+};
+
+}  // namespace loadgen
+
+#endif  // MUDUO_EXAMPLES_LOADGEN_CODECS_H
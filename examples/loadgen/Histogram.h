@@ -0,0 +1,72 @@
+#ifndef MUDUO_EXAMPLES_LOADGEN_HISTOGRAM_H
+#define MUDUO_EXAMPLES_LOADGEN_HISTOGRAM_H
+
+#include "muduo/base/Histogram.h"
+#include "muduo/base/Types.h"
+
+#include <algorithm>
+
+#include <math.h>
+#include <stdio.h>
+
+namespace loadgen
+{
+
+// Latencies in microseconds, exact to 1/128, so a client measures
+// finer than servers export with MetricsRegistry, at 1/16.  Every
+// bound of a server's bucket is a bound of these buckets.
+typedef muduo::BasicHistogramSnapshot<7> Histogram;
+
+// Taking the highest value of each bucket, within [min, max].
+inline double stddev(const Histogram& h)
+{
+  if (h.count() == 0)
+    return 0.0;
+  double m = h.mean();
+  double sq = 0;
+  for (int i = 0; i < Histogram::kNumBuckets; ++i)
+  {
+    if (h.bucketCount(i) == 0)
+      continue;
+    int64_t value = std::max(h.min(), std::min(Histogram::bucketUpperBound(i), h.max()));
+    double d = static_cast<double>(value) - m;
+    sq += d * d * static_cast<double>(h.bucketCount(i));
+  }
+  return sqrt(sq / static_cast<double>(h.count()));
+}
+
+// Percentile distribution in the format of HdrHistogram's
+// outputPercentileDistribution(), can be plotted with its tools.
+inline muduo::string percentileDistribution(const Histogram& h, double unitRatio = 1.0)
+{
+  muduo::string result = "       Value     Percentile TotalCount 1/(1-Percentile)\n\n";
+  if (h.count() == 0)
+    return result;
+  char buf[128];
+  int64_t sofar = 0;
+  for (int i = 0; i < Histogram::kNumBuckets; ++i)
+  {
+    if (h.bucketCount(i) == 0)
+      continue;
+    sofar += h.bucketCount(i);
+    double p = static_cast<double>(sofar) / static_cast<double>(h.count());
+    double value = static_cast<double>(std::min(Histogram::bucketUpperBound(i), h.max()));
+    if (p < 1.0)
+      snprintf(buf, sizeof buf, "%12.3f %2.12f %10lld %14.2f\n",
+               value / unitRatio, p, static_cast<long long>(sofar), 1.0 / (1.0 - p));
+    else
+      snprintf(buf, sizeof buf, "%12.3f %2.12f %10lld\n",
+               value / unitRatio, p, static_cast<long long>(sofar));
+    result += buf;
+  }
+  snprintf(buf, sizeof buf, "#[Mean    = %12.3f, StdDeviation   = %12.3f]\n"
+                            "#[Max     = %12.3f, Total count    = %12lld]\n",
+           h.mean() / unitRatio, stddev(h) / unitRatio,
+           static_cast<double>(h.max()) / unitRatio, static_cast<long long>(h.count()));
+  result += buf;
+  return result;
+}
+
+}  // namespace loadgen
+
+#endif  // MUDUO_EXAMPLES_LOADGEN_HISTOGRAM_H
@@ -0,0 +1,591 @@
+#include "examples/loadgen/LoadGenerator.h"
+
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/Logging.h"
+#include "muduo/base/Mutex.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TcpClient.h"
+
+#include <map>
+
+#include <inttypes.h>
+#include <stdio.h>
+
+using namespace loadgen;
+using namespace muduo;
+using namespace muduo::net;
+
+void Report::merge(const Report& rhs)
+{
+  seconds += rhs.seconds;
+  sent += rhs.sent;
+  received += rhs.received;
+  errors += rhs.errors;
+  inflight += rhs.inflight;
+  bytesSent += rhs.bytesSent;
+  bytesReceived += rhs.bytesReceived;
+  latency.merge(rhs.latency);
+}
+
+string Report::toString() const
+{
+  double rps = seconds > 0 ? static_cast<double>(received) / seconds : 0.0;
+  char buf[256];
+  snprintf(buf, sizeof buf,
+           "%.1fs sent %" PRId64 " recv %" PRId64 " err %" PRId64 " inflight %" PRId64
+           " rps %.1f p50 %" PRId64 " p99 %" PRId64 " p99.9 %" PRId64 " max %" PRId64 " us",
+           seconds, sent, received, errors, inflight, rps,
+           latency.percentile(50), latency.percentile(99),
+           latency.percentile(99.9), latency.max());
+  return buf;
+}
+
+string Report::summary() const
+{
+  double rps = seconds > 0 ? static_cast<double>(received) / seconds : 0.0;
+  double mibps = seconds > 0 ? static_cast<double>(bytesReceived) / seconds / 1024 / 1024 : 0.0;
+  char buf[512];
+  snprintf(buf, sizeof buf,
+           "%.3f seconds\n"
+           "%" PRId64 " requests sent, %" PRId64 " responses, %" PRId64 " errors, %" PRId64 " in flight\n"
+           "%.1f responses/s, %" PRId64 " bytes sent, %" PRId64 " bytes received, %.3f MiB/s\n"
+           "latency (us) min %" PRId64 " p50 %" PRId64 " p90 %" PRId64 " p99 %" PRId64
+           " p99.9 %" PRId64 " p99.99 %" PRId64 " max %" PRId64 " mean %.1f stddev %.1f\n",
+           seconds,
+           sent, received, errors, inflight,
+           rps, bytesSent, bytesReceived, mibps,
+           latency.min(), latency.percentile(50), latency.percentile(90),
+           latency.percentile(99), latency.percentile(99.9), latency.percentile(99.99),
+           latency.max(), latency.mean(), stddev(latency));
+  return buf;
+}
+
+// Sessions of one I/O loop, they share the statistics.
+struct LoadGenerator::Worker : noncopyable
+{
+  explicit Worker(EventLoop* l)
+    : loop(l)
+  {
+  }
+
+  void begin(int64_t startUs, double rate);
+  void tick();
+  void halt();
+
+  // thread safe
+  Report takeInterval()
+  {
+    Report report;
+    MutexLockGuard lock(mutex);
+    std::swap(report, interval);
+    return report;
+  }
+
+  static const double kTickInterval;  // in seconds
+
+  EventLoop* const loop;
+  std::vector<Session*> sessions;  // owned by LoadGenerator
+  TimerId ticker;
+  MutexLock mutex;
+  Report interval GUARDED_BY(mutex);
+};
+
+const double LoadGenerator::Worker::kTickInterval = 0.001;
+
+class LoadGenerator::Session : noncopyable
+{
+ public:
+  Session(LoadGenerator* owner,
+          Worker* worker,
+          const string& name,
+          CodecPtr codec,
+          int index)
+    : owner_(owner),
+      worker_(worker),
+      client_(worker->loop, owner->options_.serverAddr, name),
+      codec_(std::move(codec)),
+      nextSeq_(0),
+      nextSendUs_(0),
+      intervalUs_(0),
+      generating_(false),
+      stopping_(false),
+      done_(false),
+      index_(index)
+  {
+    const Options& options = owner_->options_;
+    if (options.rate > 0)
+    {
+      intervalUs_ = 1000.0 * 1000.0 * options.connections / options.rate;
+    }
+    client_.setConnectionCallback(
+        std::bind(&Session::onConnection, this, _1));
+    client_.setMessageCallback(
+        std::bind(&Session::onMessage, this, _1, _2, _3));
+  }
+
+  void connect()
+  {
+    client_.connect();
+  }
+
+  // thread safe
+  void stop()
+  {
+    worker_->loop->runInLoop(std::bind(&Session::stopInLoop, this));
+  }
+
+  void begin(int64_t startUs)
+  {
+    generating_ = true;
+    if (intervalUs_ > 0)
+    {
+      // spreads connections evenly over one interval
+      nextSendUs_ = static_cast<double>(startUs)
+          + intervalUs_ * index_ / owner_->options_.connections;
+    }
+    else if (conn_)
+    {
+      fillPipeline();
+      flush();
+    }
+    publish();
+  }
+
+  // open loop, sends all requests due by now
+  void tick(int64_t nowUs)
+  {
+    if (!generating_)
+      return;
+    while (nextSendUs_ <= static_cast<double>(nowUs) && generating_)
+    {
+      issue(static_cast<int64_t>(nextSendUs_));
+      nextSendUs_ += intervalUs_;
+    }
+    flush();
+    publish();
+  }
+
+  void halt()
+  {
+    generating_ = false;
+    checkDone();
+  }
+
+ private:
+  void onConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      if (owner_->options_.tcpNoDelay)
+        conn->setTcpNoDelay(true);
+      conn_ = conn;
+      owner_->onConnected();
+      if (generating_ && intervalUs_ == 0)
+      {
+        fillPipeline();
+      }
+      flush();
+      publish();
+    }
+    else
+    {
+      conn_.reset();
+      if (!stopping_ && !outstanding_.empty())
+      {
+        LOG_WARN << conn->name() << " disconnected with "
+                 << outstanding_.size() << " requests outstanding";
+      }
+      errors_ += static_cast<int64_t>(outstanding_.size());
+      outstanding_.clear();
+      generating_ = false;
+      checkDone();
+      publish();
+      // after TcpClient::removeConnection() returns
+      worker_->loop->queueInLoop(std::bind(&LoadGenerator::onDisconnected, owner_));
+    }
+  }
+
+  void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime)
+  {
+    int64_t receiveUs = receiveTime.microSecondsSinceEpoch();
+    while (buf->readableBytes() > 0)
+    {
+      size_t readable = buf->readableBytes();
+      int64_t seq = -1;
+      Codec::DecodeResult result = codec_->decodeResponse(buf, &seq);
+      if (result == Codec::kIncomplete)
+      {
+        break;
+      }
+      else if (result == Codec::kError)
+      {
+        LOG_ERROR << conn->name() << " bad response";
+        generating_ = false;
+        conn->forceClose();
+        break;
+      }
+      bytesReceived_ += static_cast<int64_t>(readable - buf->readableBytes());
+      std::map<int64_t, int64_t>::iterator it =
+          seq < 0 ? outstanding_.begin() : outstanding_.find(seq);
+      if (it != outstanding_.end())
+      {
+        latencies_.push_back(receiveUs - it->second);
+        outstanding_.erase(it);
+      }
+      else
+      {
+        LOG_ERROR << conn->name() << " unexpected response " << seq;
+      }
+    }
+
+    if (generating_ && intervalUs_ == 0)
+    {
+      fillPipeline();
+    }
+    flush();
+    checkDone();
+    publish();
+  }
+
+  void stopInLoop()
+  {
+    stopping_ = true;
+    generating_ = false;
+    client_.stop();
+    if (conn_)
+    {
+      conn_->forceClose();
+    }
+  }
+
+  void fillPipeline()
+  {
+    int64_t nowUs = Timestamp::now().microSecondsSinceEpoch();
+    while (generating_
+           && static_cast<int>(outstanding_.size()) < owner_->options_.pipeline)
+    {
+      issue(nowUs);
+    }
+  }
+
+  void issue(int64_t intendedUs)
+  {
+    const int64_t limit = owner_->options_.requestsPerConnection;
+    size_t readable = output_.readableBytes();
+    codec_->encodeRequest(nextSeq_, &output_);
+    bytesSent_ += static_cast<int64_t>(output_.readableBytes() - readable);
+    outstanding_[nextSeq_] = intendedUs;
+    ++nextSeq_;
+    ++sent_;
+    if (limit > 0 && nextSeq_ >= limit)
+    {
+      generating_ = false;
+    }
+  }
+
+  // requests are buffered before connected, and counted from intended time
+  void flush()
+  {
+    if (conn_ && output_.readableBytes() > 0)
+    {
+      conn_->send(&output_);
+    }
+  }
+
+  void checkDone()
+  {
+    if (!done_ && !generating_ && outstanding_.empty())
+    {
+      done_ = true;
+      owner_->onSessionDone();
+    }
+  }
+
+  void publish()
+  {
+    if (sent_ == 0 && latencies_.empty() && errors_ == 0)
+      return;
+
+    MutexLockGuard lock(worker_->mutex);
+    Report& interval = worker_->interval;
+    interval.sent += sent_;
+    interval.errors += errors_;
+    interval.bytesSent += bytesSent_;
+    interval.bytesReceived += bytesReceived_;
+    interval.received += static_cast<int64_t>(latencies_.size());
+    for (int64_t latency : latencies_)
+    {
+      interval.latency.record(latency);
+    }
+    sent_ = 0;
+    errors_ = 0;
+    bytesSent_ = 0;
+    bytesReceived_ = 0;
+    latencies_.clear();
+  }
+
+  LoadGenerator* const owner_;
+  Worker* const worker_;
+  TcpClient client_;
+  TcpConnectionPtr conn_;
+  CodecPtr codec_;
+  Buffer output_;
+  std::map<int64_t, int64_t> outstanding_;  // seq -> intended send time in us
+  int64_t nextSeq_;
+  double nextSendUs_;
+  double intervalUs_;  // 0 for closed loop
+  bool generating_;
+  bool stopping_;
+  bool done_;
+  const int index_;
+
+  // not published yet
+  int64_t sent_ = 0;
+  int64_t errors_ = 0;
+  int64_t bytesSent_ = 0;
+  int64_t bytesReceived_ = 0;
+  std::vector<int64_t> latencies_;
+};
+
+void LoadGenerator::Worker::begin(int64_t startUs, double rate)
+{
+  loop->assertInLoopThread();
+  for (Session* session : sessions)
+  {
+    session->begin(startUs);
+  }
+  if (rate > 0)
+  {
+    ticker = loop->runEvery(kTickInterval, std::bind(&Worker::tick, this));
+  }
+}
+
+void LoadGenerator::Worker::tick()
+{
+  int64_t nowUs = Timestamp::now().microSecondsSinceEpoch();
+  for (Session* session : sessions)
+  {
+    session->tick(nowUs);
+  }
+}
+
+void LoadGenerator::Worker::halt()
+{
+  loop->cancel(ticker);
+  for (Session* session : sessions)
+  {
+    session->halt();
+  }
+}
+
+namespace
+{
+
+void defaultIntervalCallback(const Report& report)
+{
+  LOG_WARN << report.toString();
+}
+
+}  // namespace
+
+LoadGenerator::LoadGenerator(EventLoop* loop,
+                             const Options& options,
+                             const CodecFactory& codecFactory)
+  : loop_(CHECK_NOTNULL(loop)),
+    options_(options),
+    codecFactory_(codecFactory),
+    intervalCallback_(defaultIntervalCallback),
+    threadPool_(loop, options.name),
+    state_(kIdle)
+{
+  finishCallback_ = [this] (const Report& report)
+  {
+    printf("%s", report.summary().c_str());
+    loop_->quit();
+  };
+}
+
+LoadGenerator::~LoadGenerator()
+{
+  // waits for pending functors and timers of I/O loops, which refer to sessions
+  CountDownLatch latch(static_cast<int>(workers_.size()));
+  for (const auto& worker : workers_)
+  {
+    Worker* w = worker.get();
+    w->loop->runInLoop([w, &latch]
+    {
+      w->loop->cancel(w->ticker);
+      latch.countDown();
+    });
+  }
+  latch.wait();
+}
+
+void LoadGenerator::start()
+{
+  loop_->assertInLoopThread();
+  assert(state_ == kIdle);
+  assert(options_.connections > 0);
+  state_ = kConnecting;
+  threadPool_.setThreadNum(options_.threads);
+  threadPool_.start();
+  for (EventLoop* ioLoop : threadPool_.getAllLoops())
+  {
+    workers_.emplace_back(new Worker(ioLoop));
+  }
+
+  for (int i = 0; i < options_.connections; ++i)
+  {
+    char buf[64];
+    snprintf(buf, sizeof buf, "%s-C%05d", options_.name.c_str(), i);
+    Worker* worker = workers_[i % workers_.size()].get();
+    sessions_.emplace_back(new Session(this, worker, buf, codecFactory_(i), i));
+    worker->sessions.push_back(sessions_.back().get());
+  }
+  for (const auto& session : sessions_)
+  {
+    session->connect();
+  }
+  timers_.push_back(loop_->runAfter(options_.connectTimeout,
+                                    std::bind(&LoadGenerator::begin, this)));
+}
+
+void LoadGenerator::stop()
+{
+  loop_->assertInLoopThread();
+  if (state_ != kRunning)
+    return;
+  state_ = kDraining;
+  stopTime_ = Timestamp::now();
+  for (const auto& worker : workers_)
+  {
+    worker->loop->runInLoop(std::bind(&Worker::halt, worker.get()));
+  }
+}
+
+void LoadGenerator::onConnected()
+{
+  if (numConnected_.incrementAndGet() == options_.connections)
+  {
+    loop_->queueInLoop(std::bind(&LoadGenerator::begin, this));
+  }
+}
+
+void LoadGenerator::onDisconnected()
+{
+  if (numConnected_.decrementAndGet() == 0)
+  {
+    loop_->queueInLoop(std::bind(&LoadGenerator::maybeFinished, this));
+  }
+}
+
+void LoadGenerator::onSessionDone()
+{
+  numDone_.increment();
+}
+
+void LoadGenerator::begin()
+{
+  loop_->assertInLoopThread();
+  if (state_ != kConnecting)
+    return;
+
+  if (numConnected_.get() < options_.connections)
+  {
+    LOG_WARN << numConnected_.get() << " of " << options_.connections
+             << " connections established, start anyway";
+  }
+  else
+  {
+    LOG_WARN << "all " << options_.connections << " connected";
+  }
+  state_ = kRunning;
+  startTime_ = Timestamp::now();
+  lastReport_ = startTime_;
+  for (const auto& worker : workers_)
+  {
+    worker->loop->runInLoop(std::bind(&Worker::begin, worker.get(),
+                                      startTime_.microSecondsSinceEpoch(),
+                                      options_.rate));
+  }
+  if (options_.duration > 0)
+  {
+    timers_.push_back(loop_->runAfter(options_.duration,
+                                      std::bind(&LoadGenerator::stop, this)));
+  }
+  if (options_.reportInterval > 0)
+  {
+    timers_.push_back(loop_->runEvery(options_.reportInterval,
+                                      std::bind(&LoadGenerator::intervalReport, this)));
+  }
+  timers_.push_back(loop_->runEvery(0.01, std::bind(&LoadGenerator::checkDone, this)));
+}
+
+Report LoadGenerator::collect()
+{
+  Report report;
+  for (const auto& worker : workers_)
+  {
+    report.merge(worker->takeInterval());
+  }
+  Timestamp now = Timestamp::now();
+  report.seconds = timeDifference(now, lastReport_);
+  lastReport_ = now;
+  total_.merge(report);
+  total_.inflight = total_.sent - total_.received - total_.errors;
+  report.inflight = total_.inflight;
+  return report;
+}
+
+void LoadGenerator::intervalReport()
+{
+  Report report = collect();
+  if (intervalCallback_)
+    intervalCallback_(report);
+}
+
+void LoadGenerator::checkDone()
+{
+  if (state_ != kRunning && state_ != kDraining)
+    return;
+
+  if (numDone_.get() == options_.connections)
+  {
+    if (state_ == kRunning)
+      stopTime_ = Timestamp::now();
+    finish();
+  }
+  else if (state_ == kDraining
+           && timeDifference(Timestamp::now(), stopTime_) > options_.drainTimeout)
+  {
+    LOG_WARN << "drain timeout";
+    finish();
+  }
+}
+
+void LoadGenerator::finish()
+{
+  state_ = kStopping;
+  for (const TimerId& timer : timers_)
+  {
+    loop_->cancel(timer);
+  }
+  timers_.clear();
+  collect();
+  total_.seconds = timeDifference(stopTime_, startTime_);
+  for (const auto& session : sessions_)
+  {
+    session->stop();
+  }
+  maybeFinished();
+}
+
+void LoadGenerator::maybeFinished()
+{
+  if (state_ == kStopping && numConnected_.get() == 0)
+  {
+    state_ = kFinished;
+    if (finishCallback_)
+      finishCallback_(total_);
+  }
+}
@@ -0,0 +1,191 @@
+#ifndef MUDUO_EXAMPLES_LOADGEN_LOADGENERATOR_H
+#define MUDUO_EXAMPLES_LOADGEN_LOADGENERATOR_H
+
+#include "examples/loadgen/Histogram.h"
+
+#include "muduo/base/Atomic.h"
+#include "muduo/base/Timestamp.h"
+#include "muduo/net/EventLoopThreadPool.h"
+#include "muduo/net/InetAddress.h"
+#include "muduo/net/TimerId.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+class Buffer;
+class EventLoop;
+}
+}
+
+namespace loadgen
+{
+
+// Request/response framing of one connection, a new instance is created
+// for every connection by CodecFactory, so it can keep per-connection state.
+class Codec : muduo::noncopyable
+{
+ public:
+  enum DecodeResult
+  {
+    kIncomplete,  // need more data
+    kResponse,    // one response consumed from buffer
+    kError,       // bad response, connection will be closed
+  };
+
+  virtual ~Codec() = default;
+
+  // Appends request #seq to buf, seq counts from 0 on every connection.
+  virtual void encodeRequest(int64_t seq, muduo::net::Buffer* buf) = 0;
+
+  // Consumes at most one response from buf.
+  // If the server may answer out of order, stores seq of the request
+  // in *seq, otherwise leaves it -1 and the oldest request is answered.
+  virtual DecodeResult decodeResponse(muduo::net::Buffer* buf, int64_t* seq) = 0;
+};
+
+typedef std::unique_ptr<Codec> CodecPtr;
+typedef std::function<CodecPtr (int connectionIndex)> CodecFactory;
+
+struct Options
+{
+  Options()
+    : name("loadgen"),
+      connections(1),
+      threads(0),
+      rate(0),
+      pipeline(1),
+      duration(10),
+      requestsPerConnection(0),
+      reportInterval(1.0),
+      drainTimeout(1.0),
+      connectTimeout(10.0),
+      tcpNoDelay(true)
+  {
+  }
+
+  muduo::net::InetAddress serverAddr;
+  muduo::string name;
+  int connections;
+  int threads;            // I/O threads, 0 for sending in the calling loop
+  double rate;            // total requests per second, 0 for closed loop
+  int pipeline;           // outstanding requests per connection in closed loop
+  double duration;        // seconds of sending, 0 for unlimited
+  int64_t requestsPerConnection;  // 0 for unlimited
+  double reportInterval;  // seconds, 0 for no interval report
+  double drainTimeout;    // seconds to wait for outstanding responses
+  double connectTimeout;  // start sending with whoever connected by then
+  bool tcpNoDelay;
+};
+
+struct Report
+{
+  Report()
+    : seconds(0),
+      sent(0),
+      received(0),
+      errors(0),
+      inflight(0),
+      bytesSent(0),
+      bytesReceived(0)
+  {
+  }
+
+  void merge(const Report& rhs);
+  // one line, for interval reports
+  muduo::string toString() const;
+  // multiple lines, for final report
+  muduo::string summary() const;
+
+  double seconds;
+  int64_t sent;
+  int64_t received;
+  int64_t errors;         // requests lost by bad response or disconnection
+  int64_t inflight;
+  int64_t bytesSent;
+  int64_t bytesReceived;
+  Histogram latency;      // in microseconds
+};
+
+// Generates requests on many connections, and measures latency of responses.
+//
+// In open loop (Options::rate > 0), requests are scheduled at fixed rate,
+// independent of responses.  Latency is measured from the intended send
+// time of a request, not the actual one, so a stalled server or client
+// is charged for all requests that should have been sent meanwhile,
+// i.e. free of coordinated omission.  Due requests are sent by a 1ms
+// ticker, so latency includes up to 1ms of timer granularity.
+//
+// In closed loop (Options::rate == 0), every connection keeps
+// Options::pipeline requests outstanding, latency is measured from
+// the actual send time, which is the service time of the server.
+//
+// Sending starts after all connections are established, interval reports
+// and the final report are delivered in the loop passed to ctor.
+class LoadGenerator : muduo::noncopyable
+{
+ public:
+  typedef std::function<void (const Report&)> ReportCallback;
+
+  LoadGenerator(muduo::net::EventLoop* loop,
+                const Options& options,
+                const CodecFactory& codecFactory);
+  ~LoadGenerator();  // force out-line dtor, for std::unique_ptr members.
+
+  // default logs report
+  void setIntervalCallback(const ReportCallback& cb)
+  { intervalCallback_ = cb; }
+
+  // default prints summary and quits loop
+  void setFinishCallback(const ReportCallback& cb)
+  { finishCallback_ = cb; }
+
+  void start();
+
+  // Stops sending before duration, not thread safe, but in loop
+  void stop();
+
+  const Options& options() const { return options_; }
+
+ private:
+  class Session;
+  struct Worker;
+
+  void begin();
+  void onConnected();
+  void onDisconnected();
+  void onSessionDone();
+  void intervalReport();
+  void checkDone();
+  void finish();
+  void maybeFinished();
+  Report collect();
+
+  muduo::net::EventLoop* loop_;
+  const Options options_;
+  CodecFactory codecFactory_;
+  ReportCallback intervalCallback_;
+  ReportCallback finishCallback_;
+  muduo::net::EventLoopThreadPool threadPool_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::unique_ptr<Session>> sessions_;
+  muduo::AtomicInt32 numConnected_;
+  muduo::AtomicInt32 numDone_;
+
+  // in loop_
+  enum State { kIdle, kConnecting, kRunning, kDraining, kStopping, kFinished };
+  State state_;
+  muduo::Timestamp startTime_;
+  muduo::Timestamp lastReport_;
+  muduo::Timestamp stopTime_;
+  Report total_;
+  std::vector<muduo::net::TimerId> timers_;
+};
+
+}  // namespace loadgen
+
+#endif  // MUDUO_EXAMPLES_LOADGEN_LOADGENERATOR_H
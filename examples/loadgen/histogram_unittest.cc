@@ -0,0 +1,49 @@
+#include "examples/loadgen/Histogram.h"
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using loadgen::Histogram;
+
+// buckets themselves are tested with muduo::HistogramSnapshot
+
+BOOST_AUTO_TEST_CASE(testResolution)
+{
+  Histogram h;
+  for (int64_t v = 1; v <= 100000; ++v)
+  {
+    h.record(v);
+  }
+  // 102399 at 1/16
+  BOOST_CHECK_LE(h.percentile(99), 99 * 1000 * 129 / 128);
+  BOOST_CHECK_GE(h.percentile(99), 99 * 1000);
+}
+
+BOOST_AUTO_TEST_CASE(testStddev)
+{
+  Histogram h;
+  BOOST_CHECK_EQUAL(loadgen::stddev(h), 0.0);
+  for (int i = 0; i < 100; ++i)
+  {
+    h.record(10);
+    h.record(20);
+  }
+  // exact below 256
+  BOOST_CHECK_CLOSE(loadgen::stddev(h), 5.0, 0.001);
+}
+
+BOOST_AUTO_TEST_CASE(testPercentileDistribution)
+{
+  Histogram h;
+  for (int64_t v = 1; v <= 10000; ++v)
+  {
+    h.record(v);
+  }
+  muduo::string text = loadgen::percentileDistribution(h, 1000.0);
+  BOOST_CHECK_EQUAL(text.find("       Value     Percentile"), 0);
+  // the last bucket is capped at max
+  BOOST_CHECK(text.find("      10.000 1.000000000000      10000\n") != muduo::string::npos);
+  BOOST_CHECK(text.find("#[Max     =       10.000, Total count    =        10000]\n")
+              != muduo::string::npos);
+}
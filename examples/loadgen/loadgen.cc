@@ -0,0 +1,148 @@
+// Open-loop load generator.
+//
+// ./loadgen -r 10000 -c 100 -t 4 -d 30 -p echo -s 64 127.0.0.1 2007
+// ./loadgen -r 5000 -c 50 -p http -u /hello 127.0.0.1 8000
+// ./loadgen -c 10 -q 4 -p line -m "PING" 127.0.0.1 6379    # closed loop
+
+#include "examples/loadgen/Codecs.h"
+#include "examples/loadgen/LoadGenerator.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace loadgen;
+using namespace muduo;
+using namespace muduo::net;
+
+void usage(const char* prog)
+{
+  fprintf(stderr,
+          "Usage: %s [options] <host_ip> <port>\n"
+          "  -r rate     total requests per second, 0 for closed loop (default 0)\n"
+          "  -c conns    number of connections (default 1)\n"
+          "  -t threads  number of I/O threads (default 0)\n"
+          "  -d seconds  duration of sending (default 10)\n"
+          "  -n requests requests per connection, 0 for unlimited (default 0)\n"
+          "  -q depth    outstanding requests per connection in closed loop (default 1)\n"
+          "  -i seconds  interval of reports, 0 for none (default 1)\n"
+          "  -p proto    echo, line or http (default echo)\n"
+          "  -s size     message size of echo (default 64)\n"
+          "  -m line     request line of line protocol (default PING)\n"
+          "  -u path     request path of http (default /)\n"
+          "  -H          print latency percentile distribution in milliseconds\n",
+          prog);
+}
+
+int main(int argc, char* argv[])
+{
+  Options options;
+  string protocol = "echo";
+  int size = 64;
+  string line = "PING";
+  string path = "/";
+  bool histogram = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "r:c:t:d:n:q:i:p:s:m:u:H")) != -1)
+  {
+    switch (opt)
+    {
+      case 'r':
+        options.rate = atof(optarg);
+        break;
+      case 'c':
+        options.connections = atoi(optarg);
+        break;
+      case 't':
+        options.threads = atoi(optarg);
+        break;
+      case 'd':
+        options.duration = atof(optarg);
+        break;
+      case 'n':
+        options.requestsPerConnection = atoll(optarg);
+        break;
+      case 'q':
+        options.pipeline = atoi(optarg);
+        break;
+      case 'i':
+        options.reportInterval = atof(optarg);
+        break;
+      case 'p':
+        protocol = optarg;
+        break;
+      case 's':
+        size = atoi(optarg);
+        break;
+      case 'm':
+        line = optarg;
+        break;
+      case 'u':
+        path = optarg;
+        break;
+      case 'H':
+        histogram = true;
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+
+  if (optind + 2 != argc || options.connections <= 0)
+  {
+    usage(argv[0]);
+    return 1;
+  }
+
+  const char* ip = argv[optind];
+  uint16_t port = static_cast<uint16_t>(atoi(argv[optind + 1]));
+  options.serverAddr = InetAddress(ip, port);
+
+  CodecFactory factory;
+  if (protocol == "echo")
+  {
+    string message;
+    for (int i = 0; i < size; ++i)
+    {
+      message.push_back(static_cast<char>(i % 128));
+    }
+    factory = [message] (int) { return CodecPtr(new EchoCodec(message)); };
+  }
+  else if (protocol == "line")
+  {
+    factory = [line] (int) { return CodecPtr(new LineCodec(line)); };
+  }
+  else if (protocol == "http")
+  {
+    string host = options.serverAddr.toIpPort();
+    factory = [host, path] (int) { return CodecPtr(new HttpGetCodec(host, path)); };
+  }
+  else
+  {
+    fprintf(stderr, "Unknown protocol %s\n", protocol.c_str());
+    return 1;
+  }
+
+  Logger::setLogLevel(Logger::WARN);
+  LOG_WARN << "pid = " << getpid() << ", " << (options.rate > 0 ? "open" : "closed")
+           << " loop to " << options.serverAddr.toIpPort();
+
+  EventLoop loop;
+  LoadGenerator generator(&loop, options, factory);
+  generator.setFinishCallback([&loop, histogram] (const Report& report)
+  {
+    printf("%s", report.summary().c_str());
+    if (histogram)
+    {
+      printf("\n%s", percentileDistribution(report.latency, 1000.0).c_str());
+    }
+    loop.quit();
+  });
+  generator.start();
+  loop.loop();
+}
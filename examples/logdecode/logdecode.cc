@@ -0,0 +1,73 @@
+// Formats log files written with BinaryLogger::setOutput(),
+// text lines are copied as is.
+//
+// Each file written by AsyncLogging begins with definitions of call
+// sites, so a rolled file decodes by itself.
+
+#include "muduo/base/BinaryLogging.h"
+#include "muduo/base/TimeZone.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace muduo;
+
+bool decodeFile(BinaryLogDecoder* decoder, FILE* fp)
+{
+  char buf[64 * 1024];
+  size_t pending = 0;
+  string text;
+  size_t n = 0;
+  while ((n = fread(buf + pending, 1, sizeof buf - pending, fp)) > 0)
+  {
+    size_t len = pending + n;
+    text.clear();
+    size_t consumed = decoder->decode(buf, len, &text);
+    fwrite(text.data(), 1, text.size(), stdout);
+    pending = len - consumed;
+    memmove(buf, buf + consumed, pending);
+  }
+  if (pending > 0)
+  {
+    fprintf(stderr, "%zd bytes of incomplete record at end of file\n", pending);
+  }
+  return pending == 0 && !ferror(fp);
+}
+
+int main(int argc, char* argv[])
+{
+  BinaryLogDecoder decoder;
+  decoder.setTimeZone(TimeZone());  // UTC, as Logger by default
+  int opt;
+  while ((opt = getopt(argc, argv, "z:")) != -1)
+  {
+    if (opt == 'z')
+    {
+      decoder.setTimeZone(TimeZone(optarg));
+    }
+    else
+    {
+      fprintf(stderr, "Usage: %s [-z zonefile] [file ...]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  bool ok = true;
+  if (optind == argc)
+  {
+    ok = decodeFile(&decoder, stdin);
+  }
+  for (int i = optind; i < argc; ++i)
+  {
+    FILE* fp = ::fopen(argv[i], "rb");
+    if (fp == NULL)
+    {
+      perror(argv[i]);
+      ok = false;
+      continue;
+    }
+    ok = decodeFile(&decoder, fp) && ok;
+    ::fclose(fp);
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+#include "examples/maxconnection/scale.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/base/ProcessInfo.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <sys/resource.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+int64_t residentBytes()
+{
+  // size resident shared text lib data dt
+  FILE* fp = fopen("/proc/self/statm", "r");
+  if (!fp)
+    return 0;
+  long size = 0, resident = 0;
+  if (fscanf(fp, "%ld %ld", &size, &resident) != 2)
+    resident = 0;
+  fclose(fp);
+  return static_cast<int64_t>(resident) * ProcessInfo::pageSize();
+}
+
+int64_t raiseOpenFilesLimit(int64_t n)
+{
+  struct rlimit rl;
+  if (::getrlimit(RLIMIT_NOFILE, &rl) == 0
+      && rl.rlim_cur < static_cast<rlim_t>(n))
+  {
+    rl.rlim_cur = static_cast<rlim_t>(n);
+    if (rl.rlim_max < rl.rlim_cur)
+      rl.rlim_max = rl.rlim_cur;
+    if (::setrlimit(RLIMIT_NOFILE, &rl) != 0)
+    {
+      LOG_SYSERR << "setrlimit " << n << ", check fs.nr_open or run as root";
+    }
+  }
+  ::getrlimit(RLIMIT_NOFILE, &rl);
+  return static_cast<int64_t>(rl.rlim_cur);
+}
+
+LoopProbe::LoopProbe(EventLoop* loop, double timerInterval)
+  : loop_(loop),
+    timerIntervalUs_(timerInterval * Timestamp::kMicroSecondsPerSecond),
+    expectedUs_(0),
+    lastIteration_(0)
+{
+  // runAfter() instead of runEvery(), which is rescheduled from
+  // the time of expiration handling, so would hide the lateness.
+  loop_->runInLoop(std::bind(&LoopProbe::onTimer, this));
+}
+
+void LoopProbe::probe()
+{
+  loop_->queueInLoop(std::bind(&LoopProbe::onProbe, this,
+                               Timestamp::now().microSecondsSinceEpoch()));
+}
+
+void LoopProbe::onProbe(int64_t postedUs)
+{
+  int64_t nowUs = Timestamp::now().microSecondsSinceEpoch();
+  int64_t iterationUs = nowUs - loop_->pollReturnTime().microSecondsSinceEpoch();
+  MutexLockGuard lock(mutex_);
+  stats_.wakeup.record(nowUs - postedUs);
+  stats_.iteration.record(iterationUs);
+}
+
+void LoopProbe::onTimer()
+{
+  Timestamp now = Timestamp::now();
+  if (expectedUs_ > 0)
+  {
+    MutexLockGuard lock(mutex_);
+    stats_.timerLateness.record(now.microSecondsSinceEpoch() - expectedUs_);
+  }
+  expectedUs_ = now.microSecondsSinceEpoch() + static_cast<int64_t>(timerIntervalUs_);
+  loop_->runAfter(timerIntervalUs_ / Timestamp::kMicroSecondsPerSecond,
+                  std::bind(&LoopProbe::onTimer, this));
+}
+
+LoopProbe::Stats LoopProbe::take()
+{
+  Stats stats;
+  {
+    MutexLockGuard lock(mutex_);
+    std::swap(stats, stats_);
+  }
+  // racy read, for information only
+  int64_t iteration = loop_->iteration();
+  stats.iterations = iteration - lastIteration_;
+  lastIteration_ = iteration;
+  return stats;
+}
+
+string reportLoops(const LoopProbeList& probes, double seconds)
+{
+  LoopProbe::Stats total;
+  for (const auto& probe : probes)
+  {
+    LoopProbe::Stats stats = probe->take();
+    total.iterations += stats.iterations;
+    total.iteration.merge(stats.iteration);
+    total.wakeup.merge(stats.wakeup);
+    total.timerLateness.merge(stats.timerLateness);
+  }
+  char buf[256];
+  snprintf(buf, sizeof buf,
+           "loops %zd iter/s %.0f iteration p99 %" PRId64 " max %" PRId64
+           " wakeup p99 %" PRId64 " max %" PRId64
+           " timer late p99 %" PRId64 " max %" PRId64 " us",
+           probes.size(),
+           seconds > 0 ? static_cast<double>(total.iterations) / seconds : 0.0,
+           total.iteration.percentile(99), total.iteration.max(),
+           total.wakeup.percentile(99), total.wakeup.max(),
+           total.timerLateness.percentile(99), total.timerLateness.max());
+  return buf;
+}
@@ -0,0 +1,65 @@
+#ifndef MUDUO_EXAMPLES_MAXCONNECTION_SCALE_H
+#define MUDUO_EXAMPLES_MAXCONNECTION_SCALE_H
+
+#include "examples/loadgen/Histogram.h"
+
+#include "muduo/base/Mutex.h"
+#include "muduo/net/EventLoop.h"
+
+#include <memory>
+#include <vector>
+
+// Common parts of scale_server and scale_client.
+
+// resident set size of this process, in bytes
+int64_t residentBytes();
+
+// raises RLIMIT_NOFILE to at least n, returns the new soft limit
+int64_t raiseOpenFilesLimit(int64_t n);
+
+// Measures an EventLoop from outside:
+//  - iteration: time from poll() return to pending functors, ie. how long
+//    the loop was busy handling I/O events before it could run a functor.
+//  - wakeup: delay from queueInLoop() in another thread to the functor runs.
+//  - timer lateness: delay of a periodic timer from its expiration time,
+//    this includes the overhead of all other timers in the TimerQueue.
+// All in microseconds.
+class LoopProbe : muduo::noncopyable
+{
+ public:
+  struct Stats
+  {
+    Stats() : iterations(0) { }
+
+    int64_t iterations;
+    loadgen::Histogram iteration;
+    loadgen::Histogram wakeup;
+    loadgen::Histogram timerLateness;
+  };
+
+  explicit LoopProbe(muduo::net::EventLoop* loop, double timerInterval = 0.01);
+
+  // thread safe
+  void probe();
+  // thread safe, returns stats since last call
+  Stats take();
+
+ private:
+  void onProbe(int64_t postedUs);
+  void onTimer();
+
+  muduo::net::EventLoop* loop_;
+  const double timerIntervalUs_;
+  int64_t expectedUs_;       // in loop thread
+  int64_t lastIteration_;    // in caller of take()
+  muduo::MutexLock mutex_;
+  Stats stats_ GUARDED_BY(mutex_);
+};
+
+typedef std::vector<std::unique_ptr<LoopProbe>> LoopProbeList;
+
+// one line of merged stats of all loops, eg.
+// "loops 4 iter/s 1234 iteration p99 12 max 345 wakeup p99 56 max 789 timer late p99 12 max 34"
+muduo::string reportLoops(const LoopProbeList& probes, double seconds);
+
+#endif  // MUDUO_EXAMPLES_MAXCONNECTION_SCALE_H
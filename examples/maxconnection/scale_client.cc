@@ -0,0 +1,468 @@
+// Client side of the connection scale test.
+//
+// Opens connections at a given rate, from many loopback source addresses,
+// so that the number of connections is not limited by ~28k ephemeral ports
+// of one source address.  127.0.0.0/8 is all loopback on Linux.
+// Connections are held idle, or send a heartbeat line every few seconds,
+// which scale_server echoes back.
+//
+// Reports every second:
+//  - connections, connect rate, failures and connect latency,
+//  - heartbeat round trip time,
+//  - resident memory and its increase per connection,
+//  - EventLoop iteration latency, wakeup latency and timer lateness,
+//  - cost of adding a timer, with one timer per connection (-T).
+//
+// For one million connections on one host, both sides need
+//   sysctl -w fs.nr_open=2100000 fs.file-max=4200000
+//   sysctl -w net.ipv4.ip_local_port_range="1024 65535"
+//   sysctl -w net.core.somaxconn=65535 net.ipv4.tcp_max_syn_backlog=65535
+// and run as root, or with a large enough 'ulimit -n'.
+//
+// ./scale_server -t 4
+// ./scale_client -c 1000000 -a 40 -r 20000 -t 4 -h 30 127.0.0.1 2007
+
+#include "examples/maxconnection/scale.h"
+
+#include "muduo/base/Atomic.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/Channel.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThreadPool.h"
+#include "muduo/net/SocketsOps.h"
+#include "muduo/net/TcpConnection.h"
+
+#include <map>
+
+#include <arpa/inet.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+struct Options
+{
+  InetAddress serverAddr;
+  uint32_t firstSource = 0;  // host byte order
+  int numSources = 1;
+  int connections = 10000;
+  double connectRate = 10000;
+  int threads = 0;
+  double heartbeat = 0;      // seconds, 0 for idle connections
+  bool timerPerConnection = false;
+};
+
+// Connections of one loop, all members are accessed in loop thread
+// except the statistics.
+class Dialer : noncopyable
+{
+ public:
+  Dialer(EventLoop* loop, const Options& options)
+    : loop_(loop),
+      options_(options),
+      cursor_(0)
+  {
+    if (options_.heartbeat > 0 && !options_.timerPerConnection)
+    {
+      loop_->runEvery(kHeartbeatTick, std::bind(&Dialer::onHeartbeatTick, this));
+    }
+  }
+
+  EventLoop* getLoop() const { return loop_; }
+
+  // opens a connection from source address
+  void dial(uint32_t sourceIp)
+  {
+    loop_->assertInLoopThread();
+    int sockfd = sockets::createNonblockingOrDie(AF_INET);
+#ifdef IP_BIND_ADDRESS_NO_PORT
+    // allocates source port in connect(), so the same port can be used
+    // with different source addresses.
+    int on = 1;
+    ::setsockopt(sockfd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &on, sizeof on);
+#endif
+    struct sockaddr_in local;
+    memZero(&local, sizeof local);
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(sourceIp);
+    if (::bind(sockfd, sockets::sockaddr_cast(&local), sizeof local) < 0)
+    {
+      LOG_SYSERR << "bind";
+      failed_.increment();
+      sockets::close(sockfd);
+      return;
+    }
+    int ret = sockets::connect(sockfd, options_.serverAddr.getSockAddr());
+    int savedErrno = (ret == 0) ? 0 : errno;
+    if (savedErrno != 0 && savedErrno != EINPROGRESS && savedErrno != EINTR)
+    {
+      LOG_WARN << "connect " << strerror_tl(savedErrno);
+      failed_.increment();
+      sockets::close(sockfd);
+      return;
+    }
+
+    Connecting& c = connecting_[sockfd];
+    c.startUs = Timestamp::now().microSecondsSinceEpoch();
+    c.channel.reset(new Channel(loop_, sockfd));
+    c.channel->setWriteCallback(std::bind(&Dialer::onConnected, this, sockfd));
+    c.channel->setErrorCallback(std::bind(&Dialer::onConnected, this, sockfd));
+    c.channel->setCloseCallback(std::bind(&Dialer::onConnected, this, sockfd));
+    c.channel->enableWriting();
+  }
+
+  size_t size() const { return connections_.size(); }
+
+  struct Stats
+  {
+    int64_t failed = 0;
+    loadgen::Histogram connectLatency;
+    loadgen::Histogram heartbeatRtt;
+    int64_t timerAdds = 0;
+    int64_t timerAddNanos = 0;
+  };
+
+  // thread safe
+  Stats take()
+  {
+    Stats stats;
+    {
+      MutexLockGuard lock(mutex_);
+      std::swap(stats, stats_);
+    }
+    stats.failed = failed_.getAndSet(0);
+    return stats;
+  }
+
+ private:
+  struct Connecting
+  {
+    int64_t startUs;
+    std::unique_ptr<Channel> channel;
+  };
+
+  // in TcpConnection context
+  struct Context
+  {
+    size_t index;
+    TimerId heartbeat;
+  };
+
+  void onConnected(int sockfd)
+  {
+    std::map<int, Connecting>::iterator it = connecting_.find(sockfd);
+    if (it == connecting_.end())
+      return;  // more than one callback of the same event
+
+    int64_t startUs = it->second.startUs;
+    Channel* channel = it->second.channel.release();
+    connecting_.erase(it);
+    channel->disableAll();
+    channel->remove();
+    // Can't delete channel here, because we are inside Channel::handleEvent
+    loop_->queueInLoop([channel] { delete channel; });
+
+    int err = sockets::getSocketError(sockfd);
+    if (err)
+    {
+      LOG_WARN << "connect SO_ERROR = " << err << " " << strerror_tl(err);
+      failed_.increment();
+      sockets::close(sockfd);
+      return;
+    }
+
+    char name[32];
+    snprintf(name, sizeof name, "C%zd", connections_.size());
+    TcpConnectionPtr conn(new TcpConnection(loop_,
+                                            name,
+                                            sockfd,
+                                            InetAddress(sockets::getLocalAddr(sockfd)),
+                                            InetAddress(sockets::getPeerAddr(sockfd))));
+    conn->setConnectionCallback(defaultConnectionCallback);
+    conn->setMessageCallback(std::bind(&Dialer::onMessage, this, _1, _2, _3));
+    conn->setCloseCallback(std::bind(&Dialer::onClose, this, _1));
+    Context context;
+    context.index = connections_.size();
+    if (options_.heartbeat > 0 && options_.timerPerConnection)
+    {
+      std::weak_ptr<TcpConnection> weakConn(conn);
+      Timestamp before = Timestamp::now();
+      context.heartbeat = loop_->runEvery(options_.heartbeat, [weakConn]
+      {
+        TcpConnectionPtr c = weakConn.lock();
+        if (c)
+          sendHeartbeat(c);
+      });
+      int64_t nanos = (Timestamp::now().microSecondsSinceEpoch()
+                       - before.microSecondsSinceEpoch()) * 1000;
+      MutexLockGuard lock(mutex_);
+      ++stats_.timerAdds;
+      stats_.timerAddNanos += nanos;
+    }
+    conn->setContext(context);
+    connections_.push_back(conn);
+    conn->connectEstablished();
+
+    int64_t latency = Timestamp::now().microSecondsSinceEpoch() - startUs;
+    MutexLockGuard lock(mutex_);
+    stats_.connectLatency.record(latency);
+  }
+
+  void onClose(const TcpConnectionPtr& conn)
+  {
+    const Context& context = boost::any_cast<const Context&>(conn->getContext());
+    if (options_.timerPerConnection)
+    {
+      loop_->cancel(context.heartbeat);
+    }
+    // swap with the last one
+    size_t index = context.index;
+    assert(connections_[index] == conn);
+    if (index != connections_.size() - 1)
+    {
+      connections_[index] = connections_.back();
+      boost::any_cast<Context>(connections_[index]->getMutableContext())->index = index;
+    }
+    connections_.pop_back();
+    loop_->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+  }
+
+  void onMessage(const TcpConnectionPtr&, Buffer* buf, Timestamp receiveTime)
+  {
+    const char* eol;
+    while ((eol = buf->findEOL()) != NULL)
+    {
+      int64_t sentUs = 0;
+      if (sscanf(buf->peek(), "hb %" SCNd64, &sentUs) == 1)
+      {
+        MutexLockGuard lock(mutex_);
+        stats_.heartbeatRtt.record(receiveTime.microSecondsSinceEpoch() - sentUs);
+      }
+      buf->retrieveUntil(eol + 1);
+    }
+  }
+
+  static void sendHeartbeat(const TcpConnectionPtr& conn)
+  {
+    char buf[32];
+    int n = snprintf(buf, sizeof buf, "hb %" PRId64 "\n",
+                     Timestamp::now().microSecondsSinceEpoch());
+    conn->send(buf, n);
+  }
+
+  // trickles heartbeats, every connection once per heartbeat interval
+  void onHeartbeatTick()
+  {
+    if (connections_.empty())
+      return;
+    size_t n = static_cast<size_t>(
+        static_cast<double>(connections_.size()) * kHeartbeatTick / options_.heartbeat) + 1;
+    n = std::min(n, connections_.size());
+    for (size_t i = 0; i < n; ++i)
+    {
+      if (cursor_ >= connections_.size())
+        cursor_ = 0;
+      sendHeartbeat(connections_[cursor_++]);
+    }
+  }
+
+  static const double kHeartbeatTick;
+
+  EventLoop* loop_;
+  const Options& options_;
+  std::map<int, Connecting> connecting_;
+  std::vector<TcpConnectionPtr> connections_;
+  size_t cursor_;
+  AtomicInt64 failed_;
+  MutexLock mutex_;
+  Stats stats_ GUARDED_BY(mutex_);
+};
+
+const double Dialer::kHeartbeatTick = 0.1;
+
+class ScaleClient : noncopyable
+{
+ public:
+  ScaleClient(EventLoop* loop, const Options& options)
+    : loop_(loop),
+      options_(options),
+      threadPool_(loop, "scale-client"),
+      baseResident_(residentBytes()),
+      opened_(0),
+      lastReport_(Timestamp::now())
+  {
+  }
+
+  void start()
+  {
+    threadPool_.setThreadNum(options_.threads);
+    threadPool_.start();
+    for (EventLoop* ioLoop : threadPool_.getAllLoops())
+    {
+      dialers_.emplace_back(new Dialer(ioLoop, options_));
+      probes_.emplace_back(new LoopProbe(ioLoop));
+    }
+    startTime_ = Timestamp::now();
+    lastReport_ = startTime_;
+    rampTimer_ = loop_->runEvery(0.01, std::bind(&ScaleClient::ramp, this));
+    loop_->runEvery(0.1, std::bind(&ScaleClient::probe, this));
+    loop_->runEvery(1.0, std::bind(&ScaleClient::report, this));
+  }
+
+ private:
+  void ramp()
+  {
+    double elapsed = timeDifference(Timestamp::now(), startTime_);
+    int64_t target = std::min(static_cast<int64_t>(elapsed * options_.connectRate),
+                              static_cast<int64_t>(options_.connections));
+    for (; opened_ < target; ++opened_)
+    {
+      Dialer* dialer = dialers_[opened_ % dialers_.size()].get();
+      uint32_t source = options_.firstSource
+          + static_cast<uint32_t>(opened_ % options_.numSources);
+      dialer->getLoop()->runInLoop(std::bind(&Dialer::dial, dialer, source));
+    }
+    if (opened_ == options_.connections)
+    {
+      loop_->cancel(rampTimer_);
+      LOG_WARN << "all " << opened_ << " connections opened in "
+               << timeDifference(Timestamp::now(), startTime_) << " seconds";
+    }
+  }
+
+  void probe()
+  {
+    for (const auto& p : probes_)
+    {
+      p->probe();
+    }
+  }
+
+  void report()
+  {
+    Timestamp now = Timestamp::now();
+    double seconds = timeDifference(now, lastReport_);
+    lastReport_ = now;
+
+    Dialer::Stats total;
+    size_t connections = 0;
+    for (const auto& dialer : dialers_)
+    {
+      Dialer::Stats stats = dialer->take();
+      total.failed += stats.failed;
+      total.connectLatency.merge(stats.connectLatency);
+      total.heartbeatRtt.merge(stats.heartbeatRtt);
+      total.timerAdds += stats.timerAdds;
+      total.timerAddNanos += stats.timerAddNanos;
+      connections += dialer->size();  // racy read, for information only
+    }
+    int64_t resident = residentBytes();
+    double perConnection = connections > 0
+        ? static_cast<double>(resident - baseResident_) / static_cast<double>(connections) : 0.0;
+    string ts = now.toFormattedString(false);
+    printf("%s conns %zd connect/s %.0f failed %" PRId64
+           " connect p50 %" PRId64 " p99 %" PRId64 " max %" PRId64 " us"
+           " rss %.1f MiB %.0f bytes/conn\n",
+           ts.c_str(), connections,
+           static_cast<double>(total.connectLatency.count()) / seconds, total.failed,
+           total.connectLatency.percentile(50), total.connectLatency.percentile(99),
+           total.connectLatency.max(),
+           static_cast<double>(resident) / (1024 * 1024), perConnection);
+    if (options_.heartbeat > 0)
+    {
+      printf("%s heartbeat/s %.0f rtt p50 %" PRId64 " p99 %" PRId64 " max %" PRId64 " us",
+             ts.c_str(), static_cast<double>(total.heartbeatRtt.count()) / seconds,
+             total.heartbeatRtt.percentile(50), total.heartbeatRtt.percentile(99),
+             total.heartbeatRtt.max());
+      if (total.timerAdds > 0)
+      {
+        printf(" timer add %" PRId64 " ns", total.timerAddNanos / total.timerAdds);
+      }
+      printf("\n");
+    }
+    printf("%s %s\n", ts.c_str(), reportLoops(probes_, seconds).c_str());
+    fflush(stdout);
+  }
+
+  EventLoop* loop_;
+  const Options& options_;
+  EventLoopThreadPool threadPool_;
+  std::vector<std::unique_ptr<Dialer>> dialers_;
+  LoopProbeList probes_;
+  const int64_t baseResident_;
+  int64_t opened_;
+  Timestamp startTime_;
+  Timestamp lastReport_;
+  TimerId rampTimer_;
+};
+
+int main(int argc, char* argv[])
+{
+  Options options;
+  const char* source = "127.0.0.2";
+
+  int opt;
+  while ((opt = getopt(argc, argv, "c:s:a:r:t:h:T")) != -1)
+  {
+    switch (opt)
+    {
+      case 'c':
+        options.connections = atoi(optarg);
+        break;
+      case 's':
+        source = optarg;
+        break;
+      case 'a':
+        options.numSources = atoi(optarg);
+        break;
+      case 'r':
+        options.connectRate = atof(optarg);
+        break;
+      case 't':
+        options.threads = atoi(optarg);
+        break;
+      case 'h':
+        options.heartbeat = atof(optarg);
+        break;
+      case 'T':
+        options.timerPerConnection = true;
+        break;
+      default:
+        optind = argc;  // print usage
+        break;
+    }
+  }
+
+  struct in_addr sourceAddr;
+  if (optind + 2 != argc || options.numSources <= 0
+      || ::inet_pton(AF_INET, source, &sourceAddr) != 1)
+  {
+    fprintf(stderr,
+            "Usage: %s [options] <server_ip> <port>\n"
+            "  -c connections   number of connections (default 10000)\n"
+            "  -s source_ip     first source address (default 127.0.0.2)\n"
+            "  -a count         number of source addresses (default 1)\n"
+            "  -r rate          connections opened per second (default 10000)\n"
+            "  -t threads       number of I/O threads (default 0)\n"
+            "  -h seconds       heartbeat interval, 0 for idle (default 0)\n"
+            "  -T               one timer per connection for heartbeats\n",
+            argv[0]);
+    return 1;
+  }
+  options.firstSource = ntohl(sourceAddr.s_addr);
+  options.serverAddr = InetAddress(argv[optind],
+                                   static_cast<uint16_t>(atoi(argv[optind + 1])));
+
+  Logger::setLogLevel(Logger::WARN);
+  int64_t limit = raiseOpenFilesLimit(options.connections + 100);
+  LOG_WARN << "pid = " << getpid() << ", connecting to " << options.serverAddr.toIpPort()
+           << ", open files limit = " << limit;
+
+  EventLoop loop;
+  ScaleClient client(&loop, options);
+  client.start();
+  loop.loop();
+}
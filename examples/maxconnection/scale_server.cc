@@ -0,0 +1,247 @@
+// Server side of the connection scale test, see scale_client.cc
+//
+// Accepts as many connections as allowed, echoes heartbeats, kicks
+// idle connections with a timing wheel like examples/idleconnection,
+// and reports every second:
+//  - connections, accept and close rate,
+//  - resident memory and its increase per connection,
+//  - EventLoop iteration latency, wakeup latency and timer lateness.
+//
+// ./scale_server -t 4 -p 2007 -i 60
+
+#include "examples/maxconnection/scale.h"
+
+#include "muduo/base/Atomic.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThreadPool.h"
+#include "muduo/net/TcpServer.h"
+
+#include <unordered_set>
+
+#include <boost/circular_buffer.hpp>
+
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+class ScaleServer : noncopyable
+{
+ public:
+  ScaleServer(EventLoop* loop,
+              const InetAddress& listenAddr,
+              int numThreads,
+              int maxConnections,
+              int idleSeconds)
+    : loop_(loop),
+      server_(loop, listenAddr, "ScaleServer", TcpServer::kReusePort),
+      maxConnections_(maxConnections),
+      idleSeconds_(idleSeconds),
+      baseResident_(residentBytes()),
+      lastReport_(Timestamp::now())
+  {
+    server_.setConnectionCallback(
+        std::bind(&ScaleServer::onConnection, this, _1));
+    server_.setMessageCallback(
+        std::bind(&ScaleServer::onMessage, this, _1, _2, _3));
+    server_.setThreadInitCallback(
+        std::bind(&ScaleServer::onThreadInit, this, _1));
+    server_.setThreadNum(numThreads);
+  }
+
+  void start()
+  {
+    server_.start();
+    // after threads are started
+    loop_->runAfter(0.1, std::bind(&ScaleServer::addProbes, this));
+  }
+
+ private:
+  typedef std::weak_ptr<TcpConnection> WeakTcpConnectionPtr;
+
+  // same as examples/idleconnection
+  struct Entry : public copyable
+  {
+    explicit Entry(const WeakTcpConnectionPtr& weakConn)
+      : weakConn_(weakConn)
+    {
+    }
+
+    ~Entry()
+    {
+      TcpConnectionPtr conn = weakConn_.lock();
+      if (conn)
+      {
+        conn->shutdown();
+        conn->forceCloseWithDelay(3.0);
+      }
+    }
+
+    WeakTcpConnectionPtr weakConn_;
+  };
+  typedef std::shared_ptr<Entry> EntryPtr;
+  typedef std::weak_ptr<Entry> WeakEntryPtr;
+  typedef std::unordered_set<EntryPtr> Bucket;
+  typedef boost::circular_buffer<Bucket> WeakConnectionList;
+
+  // one timing wheel per loop, in EventLoop context, so no locking
+  static WeakConnectionList* wheelOf(EventLoop* loop)
+  {
+    return boost::any_cast<WeakConnectionList*>(loop->getContext());
+  }
+
+  void onThreadInit(EventLoop* loop)
+  {
+    if (idleSeconds_ > 0)
+    {
+      WeakConnectionList* wheel = new WeakConnectionList(idleSeconds_);  // leaked on exit
+      wheel->resize(idleSeconds_);
+      loop->setContext(wheel);
+      loop->runEvery(1.0, [wheel] { wheel->push_back(Bucket()); });
+    }
+  }
+
+  void addProbes()
+  {
+    for (EventLoop* ioLoop : server_.threadPool()->getAllLoops())
+    {
+      probes_.emplace_back(new LoopProbe(ioLoop));
+    }
+    if (probes_.empty() || server_.threadPool()->getAllLoops()[0] != loop_)
+    {
+      probes_.emplace_back(new LoopProbe(loop_));  // the acceptor loop
+    }
+    loop_->runEvery(0.1, std::bind(&ScaleServer::probe, this));
+    loop_->runEvery(1.0, std::bind(&ScaleServer::report, this));
+  }
+
+  void onConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      accepted_.increment();
+      if (numConnected_.incrementAndGet() > maxConnections_)
+      {
+        conn->shutdown();
+        conn->forceCloseWithDelay(3.0);  // > round trip of the whole Internet.
+        return;
+      }
+      if (idleSeconds_ > 0)
+      {
+        EntryPtr entry(new Entry(conn));
+        wheelOf(conn->getLoop())->back().insert(entry);
+        WeakEntryPtr weakEntry(entry);
+        conn->setContext(weakEntry);
+      }
+    }
+    else
+    {
+      closed_.increment();
+      numConnected_.decrement();
+    }
+  }
+
+  // echoes heartbeats
+  void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+  {
+    messages_.increment();
+    conn->send(buf);
+    if (idleSeconds_ > 0 && !conn->getContext().empty())
+    {
+      WeakEntryPtr weakEntry(boost::any_cast<WeakEntryPtr>(conn->getContext()));
+      EntryPtr entry(weakEntry.lock());
+      if (entry)
+      {
+        wheelOf(conn->getLoop())->back().insert(entry);
+      }
+    }
+  }
+
+  void probe()
+  {
+    for (const auto& p : probes_)
+    {
+      p->probe();
+    }
+  }
+
+  void report()
+  {
+    Timestamp now = Timestamp::now();
+    double seconds = timeDifference(now, lastReport_);
+    lastReport_ = now;
+    int connections = numConnected_.get();
+    int64_t resident = residentBytes();
+    int64_t accepted = accepted_.getAndSet(0);
+    int64_t closed = closed_.getAndSet(0);
+    int64_t messages = messages_.getAndSet(0);
+    double perConnection = connections > 0
+        ? static_cast<double>(resident - baseResident_) / connections : 0.0;
+    printf("%s conns %d accept/s %.0f close/s %.0f msg/s %.0f rss %.1f MiB %.0f bytes/conn\n"
+           "%s %s\n",
+           now.toFormattedString(false).c_str(), connections,
+           static_cast<double>(accepted) / seconds,
+           static_cast<double>(closed) / seconds,
+           static_cast<double>(messages) / seconds,
+           static_cast<double>(resident) / (1024 * 1024), perConnection,
+           now.toFormattedString(false).c_str(),
+           reportLoops(probes_, seconds).c_str());
+    fflush(stdout);
+  }
+
+  EventLoop* loop_;
+  TcpServer server_;
+  const int maxConnections_;
+  const int idleSeconds_;
+  const int64_t baseResident_;
+  AtomicInt32 numConnected_;
+  AtomicInt64 accepted_;
+  AtomicInt64 closed_;
+  AtomicInt64 messages_;
+  Timestamp lastReport_;
+  LoopProbeList probes_;
+};
+
+int main(int argc, char* argv[])
+{
+  uint16_t port = 2007;
+  int threads = 0;
+  int maxConnections = 2000000;
+  int idleSeconds = 0;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "p:t:m:i:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'p':
+        port = static_cast<uint16_t>(atoi(optarg));
+        break;
+      case 't':
+        threads = atoi(optarg);
+        break;
+      case 'm':
+        maxConnections = atoi(optarg);
+        break;
+      case 'i':
+        idleSeconds = atoi(optarg);
+        break;
+      default:
+        fprintf(stderr, "Usage: %s [-p port] [-t threads] [-m max_connections] [-i idle_seconds]\n",
+                argv[0]);
+        return 1;
+    }
+  }
+
+  Logger::setLogLevel(Logger::WARN);
+  int64_t limit = raiseOpenFilesLimit(maxConnections + 100);
+  LOG_WARN << "pid = " << getpid() << ", port = " << port
+           << ", threads = " << threads << ", open files limit = " << limit;
+
+  EventLoop loop;
+  ScaleServer server(&loop, InetAddress(port), threads, maxConnections, idleSeconds);
+  server.start();
+  loop.loop();
+}
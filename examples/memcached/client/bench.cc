@@ -1,19 +1,20 @@
-#include "muduo/base/CountDownLatch.h"
+#include "examples/loadgen/LoadGenerator.h"
+
 #include "muduo/base/Logging.h"
+#include "muduo/net/Buffer.h"
 #include "muduo/net/EventLoop.h"
-#include "muduo/net/EventLoopThreadPool.h"
-#include "muduo/net/TcpClient.h"
 
 #include <boost/program_options.hpp>
 #include <iostream>
 
 #include <stdio.h>
+#include <string.h>
 
 namespace po = boost::program_options;
 using namespace muduo;
 using namespace muduo::net;
 
-class Client : noncopyable
+class MemcacheCodec : public loadgen::Codec
 {
  public:
   enum Operation
@@ -22,138 +23,67 @@ class Client : noncopyable
     kSet,
   };
 
-  Client(const string& name,
-         EventLoop* loop,
-         const InetAddress& serverAddr,
-         Operation op,
-         int requests,
-         int keys,
-         int valuelen,
-         CountDownLatch* connected,
-         CountDownLatch* finished)
+  MemcacheCodec(const string& name,
+                Operation op,
+                int keys,
+                int valuelen)
     : name_(name),
-      client_(loop, serverAddr, name),
       op_(op),
-      sent_(0),
-      acked_(0),
-      requests_(requests),
       keys_(keys),
       valuelen_(valuelen),
-      value_(valuelen_, 'a'),
-      connected_(connected),
-      finished_(finished)
+      value_(valuelen_, 'a')
   {
     value_ += "\r\n";
-    client_.setConnectionCallback(std::bind(&Client::onConnection, this, _1));
-    client_.setMessageCallback(std::bind(&Client::onMessage, this, _1, _2, _3));
-    client_.connect();
-  }
-
-  void send()
-  {
-    Buffer buf;
-    fill(&buf);
-    conn_->send(&buf);
   }
 
- private:
-
-  void onConnection(const TcpConnectionPtr& conn)
+  void encodeRequest(int64_t seq, Buffer* buf) override
   {
-    if (conn->connected())
+    char req[256];
+    int key = static_cast<int>(seq % keys_);
+    if (op_ == kSet)
     {
-      conn_ = conn;
-      connected_->countDown();
+      snprintf(req, sizeof req, "set %s%d 42 0 %d\r\n", name_.c_str(), key, valuelen_);
+      buf->append(req);
+      buf->append(value_);
     }
     else
     {
-      conn_.reset();
-      client_.getLoop()->queueInLoop(std::bind(&CountDownLatch::countDown, finished_));
+      snprintf(req, sizeof req, "get %s%d\r\n", name_.c_str(), key);
+      buf->append(req);
     }
   }
 
-  void onMessage(const TcpConnectionPtr& conn,
-                 Buffer* buffer,
-                 Timestamp receiveTime)
+  DecodeResult decodeResponse(Buffer* buffer, int64_t*) override
   {
     if (op_ == kSet)
     {
-      while (buffer->readableBytes() > 0)
+      const char* crlf = buffer->findCRLF();
+      if (crlf)
       {
-        const char* crlf = buffer->findCRLF();
-        if (crlf)
-        {
-          buffer->retrieveUntil(crlf+2);
-          ++acked_;
-          if (sent_ < requests_)
-          {
-            send();
-          }
-        }
-        else
-        {
-          break;
-        }
+        buffer->retrieveUntil(crlf+2);
+        return kResponse;
       }
     }
     else
     {
-      while (buffer->readableBytes() > 0)
+      const char* end = static_cast<const char*>(memmem(buffer->peek(),
+                                                        buffer->readableBytes(),
+                                                        "END\r\n", 5));
+      if (end)
       {
-        const char* end = static_cast<const char*>(memmem(buffer->peek(),
-                                                          buffer->readableBytes(),
-                                                          "END\r\n", 5));
-        if (end)
-        {
-          buffer->retrieveUntil(end+5);
-          ++acked_;
-          if (sent_ < requests_)
-          {
-            send();
-          }
-        }
-        else
-        {
-          break;
-        }
+        buffer->retrieveUntil(end+5);
+        return kResponse;
       }
     }
-    if (acked_ == requests_)
-    {
-      conn_->shutdown();
-    }
-  }
-
-  void fill(Buffer* buf)
-  {
-    char req[256];
-    if (op_ == kSet)
-    {
-      snprintf(req, sizeof req, "set %s%d 42 0 %d\r\n", name_.c_str(), sent_ % keys_, valuelen_);
-      ++sent_;
-      buf->append(req);
-      buf->append(value_);
-    }
-    else
-    {
-      snprintf(req, sizeof req, "get %s%d\r\n", name_.c_str(), sent_ % keys_);
-      ++sent_;
-      buf->append(req);
-    }
+    return kIncomplete;
   }
 
-  string name_;
-  TcpClient client_;
-  TcpConnectionPtr conn_;
+ private:
+  const string name_;
   const Operation op_;
-  int sent_;
-  int acked_;
-  const int requests_;
   const int keys_;
   const int valuelen_;
   string value_;
-  CountDownLatch* const connected_;
-  CountDownLatch* const finished_;
 };
 
 int main(int argc, char* argv[])
@@ -167,6 +97,8 @@ int main(int argc, char* argv[])
   int requests = 100000;
   int keys = 10000;
   bool set = false;
+  double rate = 0;
+  int pipeline = 1;
 
   po::options_description desc("Allowed options");
   desc.add_options()
@@ -178,6 +110,8 @@ int main(int argc, char* argv[])
       ("requests,r", po::value<int>(&requests), "Number of requests per clients")
       ("keys,k", po::value<int>(&keys), "Number of keys per clients")
       ("set,s", "Get or Set")
+      ("rate", po::value<double>(&rate), "Total requests per second, 0 for closed loop")
+      ("pipeline", po::value<int>(&pipeline), "Outstanding requests per client in closed loop")
       ;
 
   po::variables_map vm;
@@ -195,45 +129,45 @@ int main(int argc, char* argv[])
   LOG_WARN << "Connecting " << serverAddr.toIpPort();
 
   EventLoop loop;
-  EventLoopThreadPool pool(&loop, "bench-memcache");
 
   int valuelen = 100;
-  Client::Operation op = set ? Client::kSet : Client::kGet;
+  MemcacheCodec::Operation op = set ? MemcacheCodec::kSet : MemcacheCodec::kGet;
 
   double memoryMiB = 1.0 * clients * keys * (32+80+valuelen+8) / 1024 / 1024;
   LOG_WARN << "estimated memcached-debug memory usage " << int(memoryMiB) << " MiB";
 
-  pool.setThreadNum(threads);
-  pool.start();
-
-  char buf[32];
-  CountDownLatch connected(clients);
-  CountDownLatch finished(clients);
-  std::vector<std::unique_ptr<Client>> holder;
-  for (int i = 0; i < clients; ++i)
+  loadgen::Options options;
+  options.name = "bench-memcache";
+  options.serverAddr = serverAddr;
+  options.threads = threads;
+  options.connections = clients;
+  options.requestsPerConnection = requests;
+  options.rate = rate;
+  options.pipeline = pipeline;
+  options.duration = 0;
+  options.reportInterval = 0;
+
+  loadgen::LoadGenerator generator(&loop, options, [op, keys, valuelen] (int i)
   {
+    char buf[32];
     snprintf(buf, sizeof buf, "%d-", i+1);
-    holder.emplace_back(new Client(buf,
-                                pool.getNextLoop(),
-                                serverAddr,
-                                op,
-                                requests,
-                                keys,
-                                valuelen,
-                                &connected,
-                                &finished));
-  }
-  connected.wait();
-  LOG_WARN << clients << " clients all connected";
-  Timestamp start = Timestamp::now();
-  for (int i = 0; i < clients; ++i)
+    return loadgen::CodecPtr(new MemcacheCodec(buf, op, keys, valuelen));
+  });
+  generator.setFinishCallback([&loop, clients] (const loadgen::Report& report)
   {
-    holder[i]->send();
-  }
-  finished.wait();
-  Timestamp end = Timestamp::now();
-  LOG_WARN << "All finished";
-  double seconds = timeDifference(end, start);
-  LOG_WARN << seconds << " sec";
-  LOG_WARN << 1.0 * clients * requests / seconds << " QPS";
+    LOG_WARN << "All finished";
+    LOG_WARN << report.seconds << " sec";
+    LOG_WARN << static_cast<double>(report.received) / report.seconds << " QPS";
+    LOG_WARN << "latency (us) p50 " << report.latency.percentile(50)
+             << " p99 " << report.latency.percentile(99)
+             << " p99.9 " << report.latency.percentile(99.9)
+             << " max " << report.latency.max();
+    if (report.errors > 0)
+    {
+      LOG_WARN << report.errors << " requests failed";
+    }
+    loop.quit();
+  });
+  generator.start();
+  loop.loop();
 }
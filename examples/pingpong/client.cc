@@ -1,196 +1,27 @@
-#include "muduo/net/TcpClient.h"
+#include "examples/loadgen/Codecs.h"
+#include "examples/loadgen/LoadGenerator.h"
 
 #include "muduo/base/Logging.h"
 #include "muduo/base/Thread.h"
 #include "muduo/net/EventLoop.h"
-#include "muduo/net/EventLoopThreadPool.h"
 #include "muduo/net/InetAddress.h"
 
-#include <utility>
-
 #include <stdio.h>
 #include <unistd.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
-class Client;
-
-class Session : noncopyable
-{
- public:
-  Session(EventLoop* loop,
-          const InetAddress& serverAddr,
-          const string& name,
-          Client* owner)
-    : client_(loop, serverAddr, name),
-      owner_(owner),
-      bytesRead_(0),
-      bytesWritten_(0),
-      messagesRead_(0)
-  {
-    client_.setConnectionCallback(
-        std::bind(&Session::onConnection, this, _1));
-    client_.setMessageCallback(
-        std::bind(&Session::onMessage, this, _1, _2, _3));
-  }
-
-  void start()
-  {
-    client_.connect();
-  }
-
-  void stop()
-  {
-    client_.disconnect();
-  }
-
-  int64_t bytesRead() const
-  {
-     return bytesRead_;
-  }
-
-  int64_t messagesRead() const
-  {
-     return messagesRead_;
-  }
-
- private:
-
-  void onConnection(const TcpConnectionPtr& conn);
-
-  void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
-  {
-    ++messagesRead_;
-    bytesRead_ += buf->readableBytes();
-    bytesWritten_ += buf->readableBytes();
-    conn->send(buf);
-  }
-
-  TcpClient client_;
-  Client* owner_;
-  int64_t bytesRead_;
-  int64_t bytesWritten_;
-  int64_t messagesRead_;
-};
-
-class Client : noncopyable
-{
- public:
-  Client(EventLoop* loop,
-         const InetAddress& serverAddr,
-         int blockSize,
-         int sessionCount,
-         int timeout,
-         int threadCount)
-    : loop_(loop),
-      threadPool_(loop, "pingpong-client"),
-      sessionCount_(sessionCount),
-      timeout_(timeout)
-  {
-    loop->runAfter(timeout, std::bind(&Client::handleTimeout, this));
-    if (threadCount > 1)
-    {
-      threadPool_.setThreadNum(threadCount);
-    }
-    threadPool_.start();
-
-    for (int i = 0; i < blockSize; ++i)
-    {
-      message_.push_back(static_cast<char>(i % 128));
-    }
-
-    for (int i = 0; i < sessionCount; ++i)
-    {
-      char buf[32];
-      snprintf(buf, sizeof buf, "C%05d", i);
-      Session* session = new Session(threadPool_.getNextLoop(), serverAddr, buf, this);
-      session->start();
-      sessions_.emplace_back(session);
-    }
-  }
-
-  const string& message() const
-  {
-    return message_;
-  }
-
-  void onConnect()
-  {
-    if (numConnected_.incrementAndGet() == sessionCount_)
-    {
-      LOG_WARN << "all connected";
-    }
-  }
-
-  void onDisconnect(const TcpConnectionPtr& conn)
-  {
-    if (numConnected_.decrementAndGet() == 0)
-    {
-      LOG_WARN << "all disconnected";
-
-      int64_t totalBytesRead = 0;
-      int64_t totalMessagesRead = 0;
-      for (const auto& session : sessions_)
-      {
-        totalBytesRead += session->bytesRead();
-        totalMessagesRead += session->messagesRead();
-      }
-      LOG_WARN << totalBytesRead << " total bytes read";
-      LOG_WARN << totalMessagesRead << " total messages read";
-      LOG_WARN << static_cast<double>(totalBytesRead) / static_cast<double>(totalMessagesRead)
-               << " average message size";
-      LOG_WARN << static_cast<double>(totalBytesRead) / (timeout_ * 1024 * 1024)
-               << " MiB/s throughput";
-      conn->getLoop()->queueInLoop(std::bind(&Client::quit, this));
-    }
-  }
-
- private:
-
-  void quit()
-  {
-    loop_->queueInLoop(std::bind(&EventLoop::quit, loop_));
-  }
-
-  void handleTimeout()
-  {
-    LOG_WARN << "stop";
-    for (auto& session : sessions_)
-    {
-      session->stop();
-    }
-  }
-
-  EventLoop* loop_;
-  EventLoopThreadPool threadPool_;
-  int sessionCount_;
-  int timeout_;
-  std::vector<std::unique_ptr<Session>> sessions_;
-  string message_;
-  AtomicInt32 numConnected_;
-};
-
-void Session::onConnection(const TcpConnectionPtr& conn)
-{
-  if (conn->connected())
-  {
-    conn->setTcpNoDelay(true);
-    conn->send(owner_->message());
-    owner_->onConnect();
-  }
-  else
-  {
-    owner_->onDisconnect(conn);
-  }
-}
-
+// Every session sends one block and waits for it echoed back, ie. closed loop.
+// With the optional <rate>, blocks are sent at fixed rate (blocks per second
+// of all sessions) regardless of responses, ie. open loop, and the latency
+// percentiles are free of coordinated omission.
 int main(int argc, char* argv[])
 {
-  if (argc != 7)
+  if (argc != 7 && argc != 8)
   {
     fprintf(stderr, "Usage: client <host_ip> <port> <threads> <blocksize> ");
-    fprintf(stderr, "<sessions> <time>\n");
+    fprintf(stderr, "<sessions> <time> [rate]\n");
   }
   else
   {
@@ -204,11 +35,42 @@ int main(int argc, char* argv[])
     int sessionCount = atoi(argv[5]);
     int timeout = atoi(argv[6]);
 
-    EventLoop loop;
-    InetAddress serverAddr(ip, port);
+    string message;
+    for (int i = 0; i < blockSize; ++i)
+    {
+      message.push_back(static_cast<char>(i % 128));
+    }
+
+    loadgen::Options options;
+    options.name = "pingpong-client";
+    options.serverAddr = InetAddress(ip, port);
+    options.threads = threadCount > 1 ? threadCount : 0;
+    options.connections = sessionCount;
+    options.duration = timeout;
+    options.rate = argc == 8 ? atof(argv[7]) : 0;
+    options.reportInterval = 0;
 
-    Client client(&loop, serverAddr, blockSize, sessionCount, timeout, threadCount);
+    EventLoop loop;
+    loadgen::LoadGenerator client(&loop, options, [message] (int)
+    {
+      return loadgen::CodecPtr(new loadgen::EchoCodec(message));
+    });
+    client.setFinishCallback([&loop, timeout] (const loadgen::Report& report)
+    {
+      LOG_WARN << "all disconnected";
+      LOG_WARN << report.bytesReceived << " total bytes read";
+      LOG_WARN << report.received << " total messages read";
+      LOG_WARN << static_cast<double>(report.bytesReceived) / static_cast<double>(report.received)
+               << " average message size";
+      LOG_WARN << static_cast<double>(report.bytesReceived) / (timeout * 1024 * 1024)
+               << " MiB/s throughput";
+      LOG_WARN << "latency (us) p50 " << report.latency.percentile(50)
+               << " p99 " << report.latency.percentile(99)
+               << " p99.9 " << report.latency.percentile(99.9)
+               << " max " << report.latency.max();
+      loop.quit();
+    });
+    client.start();
     loop.loop();
   }
 }
-
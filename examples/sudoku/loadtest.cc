@@ -1,15 +1,12 @@
 #include "examples/sudoku/sudoku.h"
+#include "examples/loadgen/LoadGenerator.h"
 
 #include "muduo/base/Logging.h"
 #include "muduo/base/FileUtil.h"
+#include "muduo/net/Buffer.h"
 #include "muduo/net/EventLoop.h"
-#include "muduo/net/TcpClient.h"
 
 #include <fstream>
-#include <numeric>
-#include <unordered_map>
-
-#include "examples/sudoku/percentile.h"
 
 #include <stdio.h>
 
@@ -33,152 +30,61 @@ InputPtr readInput(std::istream& in)
   return input;
 }
 
-class SudokuClient : noncopyable
+// "c0001-00000042:puzzle\r\n", the server may answer out of order,
+// responses are matched by id.
+class SudokuCodec : public loadgen::Codec
 {
  public:
-  SudokuClient(EventLoop* loop,
-               const InetAddress& serverAddr,
-               const InputPtr& input,
-               const string& name,
-               bool nodelay)
-    : name_(name),
-      tcpNoDelay_(nodelay),
-      client_(loop, serverAddr, name_),
-      input_(input),
-      count_(0)
+  SudokuCodec(const InputPtr& input, const string& name)
+    : input_(input),
+      name_(name)
   {
-    client_.setConnectionCallback(
-        std::bind(&SudokuClient::onConnection, this, _1));
-    client_.setMessageCallback(
-        std::bind(&SudokuClient::onMessage, this, _1, _2, _3));
-  }
-
-  void connect()
-  {
-    client_.connect();
-  }
-
-  void send(int n)
-  {
-    assert(n > 0);
-    if (!conn_)
-      return;
-
-    Timestamp now(Timestamp::now());
-    for (int i = 0; i < n; ++i)
-    {
-      char buf[256];
-      const string& req = (*input_)[count_ % input_->size()];
-      int len = snprintf(buf, sizeof buf, "%s-%08d:%s\r\n",
-                         name_.c_str(), count_, req.c_str());
-      requests_.append(buf, len);
-      sendTime_[count_] = now;
-      ++count_;
-    }
-
-    conn_->send(&requests_);
   }
 
-  void report(std::vector<int>* latency, int* infly)
+  void encodeRequest(int64_t seq, Buffer* buf) override
   {
-    latency->insert(latency->end(), latencies_.begin(), latencies_.end());
-    latencies_.clear();
-    *infly += static_cast<int>(sendTime_.size());
+    char req[256];
+    const string& puzzle = (*input_)[static_cast<size_t>(seq) % input_->size()];
+    int len = snprintf(req, sizeof req, "%s-%08d:%s\r\n",
+                       name_.c_str(), static_cast<int>(seq), puzzle.c_str());
+    buf->append(req, len);
   }
 
- private:
-  void onConnection(const TcpConnectionPtr& conn)
+  DecodeResult decodeResponse(Buffer* buf, int64_t* seq) override
   {
-    if (conn->connected())
-    {
-      LOG_INFO << name_ << " connected";
-      if (tcpNoDelay_)
-        conn->setTcpNoDelay(true);
-      conn_ = conn;
-    }
-    else
-    {
-      LOG_INFO << name_ << " disconnected";
-      conn_.reset();
-      // FIXME: exit
-    }
-  }
+    if (buf->readableBytes() < kCells + 2)
+      return kIncomplete;
 
-  void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp recvTime)
-  {
-    size_t len = buf->readableBytes();
-    while (len >= kCells + 2)
+    const char* crlf = buf->findCRLF();
+    if (!crlf)
     {
-      const char* crlf = buf->findCRLF();
-      if (crlf)
-      {
-        string response(buf->peek(), crlf);
-        buf->retrieveUntil(crlf + 2);
-        len = buf->readableBytes();
-        if (!verify(response, recvTime))
-        {
-          LOG_ERROR << "Bad response:" << response;
-          conn->shutdown();
-          break;
-        }
-      }
-      else if (len > 100) // id + ":" + kCells + "\r\n"
-      {
-        LOG_ERROR << "Line is too long!";
-        conn->shutdown();
-        break;
-      }
-      else
-      {
-        break;
-      }
+      // id + ":" + kCells + "\r\n"
+      return buf->readableBytes() > 100 ? kError : kIncomplete;
     }
-  }
-
-  bool verify(const string& response, Timestamp recvTime)
-  {
+    string response(buf->peek(), crlf);
+    buf->retrieveUntil(crlf + 2);
     size_t colon = response.find(':');
-    if (colon != string::npos)
+    size_t dash = response.find('-');
+    if (colon == string::npos || dash == string::npos || dash > colon)
     {
-      size_t dash = response.find('-');
-      if (dash != string::npos && dash < colon)
-      {
-        int id = atoi(response.c_str()+dash+1);
-        std::unordered_map<int, Timestamp>::iterator sendTime = sendTime_.find(id);
-        if (sendTime != sendTime_.end())
-        {
-          int64_t latency_us = recvTime.microSecondsSinceEpoch() - sendTime->second.microSecondsSinceEpoch();
-          latencies_.push_back(static_cast<int>(latency_us));
-          sendTime_.erase(sendTime);
-        }
-        else
-        {
-          LOG_ERROR << "Unknown id " << id << " of " << name_;
-        }
-      }
+      LOG_ERROR << "Bad response:" << response;
+      return kError;
     }
-    // FIXME
-    return true;
+    *seq = atoi(response.c_str() + dash + 1);
+    return kResponse;
   }
 
-  const string name_;
-  const bool tcpNoDelay_;
-  TcpClient client_;
-  TcpConnectionPtr conn_;
-  Buffer requests_;
+ private:
   const InputPtr input_;
-  int count_;
-  std::unordered_map<int, Timestamp> sendTime_;
-  std::vector<int> latencies_;
+  const string name_;
 };
 
+// Saves latency distribution of every second to r0000, r0001, ...
 class SudokuLoadtest : noncopyable
 {
  public:
   SudokuLoadtest()
-    : count_(0),
-      ticks_(0),
-      sofar_(0)
+    : count_(0)
   {
   }
 
@@ -186,57 +92,41 @@ class SudokuLoadtest : noncopyable
   {
     EventLoop loop;
 
-    for (int i = 0; i < conn; ++i)
-    {
-      Fmt f("c%04d", i+1);
-      string name(f.data(), f.length());
-      clients_.emplace_back(new SudokuClient(&loop, serverAddr, input, name, nodelay));
-      clients_.back()->connect();
-    }
+    loadgen::Options options;
+    options.name = "sudoku-loadtest";
+    options.serverAddr = serverAddr;
+    options.connections = conn;
+    options.rate = static_cast<double>(rps) * conn;  // rps of every connection
+    options.duration = 0;
+    options.tcpNoDelay = nodelay;
 
-    loop.runEvery(1.0 / kHz, std::bind(&SudokuLoadtest::tick, this, rps));
-    loop.runEvery(1.0, std::bind(&SudokuLoadtest::tock, this));
+    loadgen::LoadGenerator generator(&loop, options, [input] (int index)
+    {
+      Fmt f("c%04d", index+1);
+      return loadgen::CodecPtr(new SudokuCodec(input, string(f.data(), f.length())));
+    });
+    generator.setIntervalCallback(std::bind(&SudokuLoadtest::tock, this, _1));
+    generator.start();
     loop.loop();
   }
 
  private:
-  void tick(int rps)
-  {
-    ++ticks_;
-    int64_t reqs = rps * ticks_ / kHz - sofar_;
-    sofar_ += reqs;
-
-    if (reqs > 0)
-    {
-      for (const auto& client : clients_)
-      {
-        client->send(static_cast<int>(reqs));
-      }
-    }
-  }
-
-  void tock()
+  void tock(const loadgen::Report& report)
   {
-    std::vector<int> latencies;
-    int infly = 0;
-    for (const auto& client : clients_)
+    LOG_INFO << report.toString();
+    if (report.latency.count() > 0)
     {
-      client->report(&latencies, &infly);
+      char name[64];
+      snprintf(name, sizeof name, "r%04d", count_);
+      FileUtil::AppendFile f(name);
+      string stat = "# " + report.toString() + "\n"
+                  + loadgen::percentileDistribution(report.latency);
+      f.append(stat.data(), stat.size());
     }
-
-    Percentile p(latencies, infly);
-    LOG_INFO << p.report();
-    char buf[64];
-    snprintf(buf, sizeof buf, "r%04d", count_);
-    p.save(latencies, buf);
     ++count_;
   }
 
-  std::vector<std::unique_ptr<SudokuClient>> clients_;
   int count_;
-  int64_t ticks_;
-  int64_t sofar_;
-  static const int kHz = 100;
 };
 
 int main(int argc, char* argv[])
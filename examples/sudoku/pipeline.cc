@@ -1,12 +1,12 @@
 #include "examples/sudoku/sudoku.h"
 
+#include "muduo/base/Histogram.h"
 #include "muduo/base/Logging.h"
 #include "muduo/base/FileUtil.h"
 #include "muduo/net/EventLoop.h"
 #include "muduo/net/TcpClient.h"
 
 #include <fstream>
-#include <numeric>
 #include <unordered_map>
 
 #include "examples/sudoku/percentile.h"
@@ -46,10 +46,10 @@ class SudokuClient : noncopyable
     client_.connect();
   }
 
-  void report(std::vector<int>* latency, int* infly)
+  void report(HistogramSnapshot* latency, int* infly)
   {
-    latency->insert(latency->end(), latencies_.begin(), latencies_.end());
-    latencies_.clear();
+    latency->merge(latencies_);
+    latencies_ = HistogramSnapshot();
     *infly += static_cast<int>(sendTime_.size());
   }
 
@@ -138,7 +138,7 @@ class SudokuClient : noncopyable
         if (sendTime != sendTime_.end())
         {
           int64_t latency_us = recvTime.microSecondsSinceEpoch() - sendTime->second.microSecondsSinceEpoch();
-          latencies_.push_back(static_cast<int>(latency_us));
+          latencies_.record(latency_us);
           sendTime_.erase(sendTime);
         }
         else
@@ -159,14 +159,14 @@ class SudokuClient : noncopyable
   const InputPtr input_;
   int count_;
   std::unordered_map<int, Timestamp> sendTime_;
-  std::vector<int> latencies_;
+  HistogramSnapshot latencies_;
 };
 
 void report(const std::vector<std::unique_ptr<SudokuClient>>& clients)
 {
   static int count = 0;
 
-  std::vector<int> latencies;
+  HistogramSnapshot latencies;
   int infly = 0;
   for (const auto& client : clients)
   {
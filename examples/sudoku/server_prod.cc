@@ -45,6 +45,9 @@ class SudokuServer : noncopyable
     server_.setMessageCallback(
         std::bind(&SudokuServer::onMessage, this, _1, _2, _3));
     server_.setThreadNum(numEventLoops);
+    // sheds requests and stops accepting when requests wait too long in threadPool_
+    threadPool_.enableCoDel();
+    server_.setOverloadCheck(std::bind(&ThreadPool::overloaded, &threadPool_));
 
     inspector_.add("sudoku", "stats", std::bind(&SudokuStat::report, &stat_),
                    "statistics of sudoku solver");
@@ -168,11 +171,7 @@ class SudokuServer : noncopyable
     if (req.puzzle.size() == implicit_cast<size_t>(kCells))
     {
       bool throttle = boost::any_cast<bool>(conn->getContext());
-      if (threadPool_.queueSize() < 1000 * 1000 && !throttle)
-      {
-        threadPool_.run(std::bind(&SudokuServer::solve, this, conn, req));
-      }
-      else
+      if (throttle || !threadPool_.tryRun(std::bind(&SudokuServer::solve, this, conn, req)))
       {
         if (req.id.empty())
         {
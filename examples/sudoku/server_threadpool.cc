@@ -29,6 +29,8 @@ class SudokuServer
         std::bind(&SudokuServer::onConnection, this, _1));
     server_.setMessageCallback(
         std::bind(&SudokuServer::onMessage, this, _1, _2, _3));
+    // rejects requests when they wait too long in the queue
+    threadPool_.enableCoDel();
   }
 
   void start()
@@ -97,7 +99,10 @@ class SudokuServer
 
     if (puzzle.size() == implicit_cast<size_t>(kCells))
     {
-      threadPool_.run(std::bind(&solve, conn, puzzle, id));
+      if (!threadPool_.tryRun(std::bind(&solve, conn, puzzle, id)))
+      {
+        conn->send(id.empty() ? string("ServerTooBusy\r\n") : id + ":ServerTooBusy\r\n");
+      }
     }
     else
     {
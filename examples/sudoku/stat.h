@@ -23,6 +23,12 @@ class SudokuStat : muduo::noncopyable
     LogStream result;
     size_t queueSize = pool_.queueSize();
     result << "task_queue_size " << queueSize << '\n';
+    if (pool_.codel())
+    {
+      result << "task_queue_overloaded " << pool_.overloaded() << '\n';
+      result << "task_queue_min_delay_us " << pool_.codel()->lastMinDelayUs() << '\n';
+      result << "task_queue_overloaded_intervals " << pool_.codel()->overloadedIntervals() << '\n';
+    }
 
     {
     MutexLockGuard lock(mutex_);
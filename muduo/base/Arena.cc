@@ -0,0 +1,117 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/base/Arena.h"
+
+#include <new>
+
+#include <assert.h>
+#include <stdlib.h>
+
+using namespace muduo;
+
+const size_t Arena::kDefaultBlockSize;
+const size_t Arena::kMaxAlign;
+
+namespace
+{
+
+// keeps data of blocks aligned
+const size_t kHeaderSize = 2 * sizeof(void*) < Arena::kMaxAlign ? Arena::kMaxAlign : 2 * sizeof(void*);
+
+}  // namespace
+
+Arena::Arena(size_t blockSize)
+  : blockSize_(blockSize),
+    blocks_(NULL),
+    ptr_(NULL),
+    end_(NULL),
+    allocated_(0),
+    blocksCreated_(0)
+{
+  static_assert(sizeof(Block) <= kHeaderSize, "header of Block");
+}
+
+Arena::~Arena()
+{
+  while (blocks_)
+  {
+    Block* next = blocks_->next;
+    ::free(blocks_);
+    blocks_ = next;
+  }
+}
+
+Arena::Block* Arena::newBlock(size_t size)
+{
+  Block* block = static_cast<Block*>(::malloc(kHeaderSize + size));
+  if (block == NULL)
+  {
+    throw std::bad_alloc();
+  }
+  block->next = NULL;
+  block->size = size;
+  ++blocksCreated_;
+  return block;
+}
+
+void* Arena::allocateSlow(size_t bytes, size_t alignment)
+{
+  assert(alignment <= kMaxAlign && (alignment & (alignment - 1)) == 0);
+  if (bytes > blockSize_ / 4)
+  {
+    // a block of its own, the current block keeps filling
+    Block* block = newBlock(bytes);
+    if (blocks_)
+    {
+      block->next = blocks_->next;
+      blocks_->next = block;
+    }
+    else
+    {
+      blocks_ = block;
+    }
+    allocated_ += bytes;
+    return reinterpret_cast<char*>(block) + kHeaderSize;
+  }
+
+  Block* block = newBlock(blockSize_);
+  block->next = blocks_;
+  blocks_ = block;
+  ptr_ = reinterpret_cast<char*>(block) + kHeaderSize;
+  end_ = ptr_ + blockSize_;
+  return allocate(bytes, alignment);
+}
+
+void Arena::reset()
+{
+  Block* keep = NULL;
+  while (blocks_)
+  {
+    Block* next = blocks_->next;
+    if (keep == NULL && blocks_->size == blockSize_)
+    {
+      keep = blocks_;
+    }
+    else
+    {
+      ::free(blocks_);
+    }
+    blocks_ = next;
+  }
+  blocks_ = keep;
+  if (keep)
+  {
+    keep->next = NULL;
+    ptr_ = reinterpret_cast<char*>(keep) + kHeaderSize;
+    end_ = ptr_ + blockSize_;
+  }
+  else
+  {
+    ptr_ = NULL;
+    end_ = NULL;
+  }
+  allocated_ = 0;
+}
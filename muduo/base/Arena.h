@@ -0,0 +1,164 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_ARENA_H
+#define MUDUO_BASE_ARENA_H
+
+#include "muduo/base/noncopyable.h"
+
+#include <cstddef>
+#include <string>
+#include <type_traits>
+
+#include <stdint.h>
+
+namespace muduo
+{
+
+///
+/// Bump allocator for objects that die together, eg. everything parsed
+/// from one request.
+///
+/// Allocations are carved from blocks of blockSize bytes, deallocation is
+/// a no-op, memory is released all at once by reset() or dtor.  reset()
+/// keeps one block, so an arena reused per request reaches a steady
+/// state without calling malloc.
+///
+/// Like std::pmr::monotonic_buffer_resource, with ArenaAllocator as
+/// std::pmr::polymorphic_allocator, for C++11.  Not thread safe.
+///
+class Arena : noncopyable
+{
+ public:
+  static const size_t kDefaultBlockSize = 4096;
+  static const size_t kMaxAlign = alignof(std::max_align_t);
+
+  explicit Arena(size_t blockSize = kDefaultBlockSize);
+  ~Arena();
+
+  void* allocate(size_t bytes, size_t alignment = kMaxAlign)
+  {
+    char* p = reinterpret_cast<char*>(
+        (reinterpret_cast<uintptr_t>(ptr_) + alignment - 1) & ~(alignment - 1));
+    if (p <= end_ && static_cast<size_t>(end_ - p) >= bytes)
+    {
+      ptr_ = p + bytes;
+      allocated_ += bytes;
+      return p;
+    }
+    return allocateSlow(bytes, alignment);
+  }
+
+  void deallocate(void*, size_t)
+  {
+  }
+
+  /// Releases all allocations, objects on arena must be destroyed already.
+  void reset();
+
+  size_t blockSize() const { return blockSize_; }
+  /// bytes allocated since last reset()
+  size_t allocatedBytes() const { return allocated_; }
+  /// number of blocks malloc()ed in the lifetime
+  int64_t blocksCreated() const { return blocksCreated_; }
+
+ private:
+  struct Block
+  {
+    Block* next;
+    size_t size;  // excluding header
+  };
+
+  void* allocateSlow(size_t bytes, size_t alignment);
+  Block* newBlock(size_t size);
+
+  const size_t blockSize_;
+  Block* blocks_;  // current one first, except for large ones
+  char* ptr_;
+  char* end_;
+  size_t allocated_;
+  int64_t blocksCreated_;
+};
+
+///
+/// Standard allocator on an Arena, on the heap if arena is NULL.
+///
+/// Copies of containers allocate on the heap, as they may outlive
+/// the arena, moving or swapping containers takes the allocator along.
+///
+template<typename T>
+class ArenaAllocator
+{
+ public:
+  typedef T value_type;
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+
+  ArenaAllocator() noexcept
+    : arena_(NULL)
+  {
+  }
+
+  // implicit, like std::pmr::polymorphic_allocator
+  ArenaAllocator(Arena* arena) noexcept
+    : arena_(arena)
+  {
+  }
+
+  template<typename U>
+  ArenaAllocator(const ArenaAllocator<U>& rhs) noexcept
+    : arena_(rhs.arena())
+  {
+  }
+
+  T* allocate(size_t n)
+  {
+    if (arena_)
+    {
+      return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+    }
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T* p, size_t n)
+  {
+    if (arena_)
+    {
+      arena_->deallocate(p, n * sizeof(T));
+    }
+    else
+    {
+      ::operator delete(p);
+    }
+  }
+
+  ArenaAllocator select_on_container_copy_construction() const
+  {
+    return ArenaAllocator();
+  }
+
+  Arena* arena() const { return arena_; }
+
+ private:
+  Arena* arena_;
+};
+
+template<typename T, typename U>
+inline bool operator==(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs)
+{
+  return lhs.arena() == rhs.arena();
+}
+
+template<typename T, typename U>
+inline bool operator!=(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs)
+{
+  return lhs.arena() != rhs.arena();
+}
+
+typedef std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>> ArenaString;
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_ARENA_H
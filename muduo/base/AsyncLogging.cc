@@ -4,17 +4,276 @@
 // Author: Shuo Chen (chenshuo at chenshuo dot com)
 
 #include "muduo/base/AsyncLogging.h"
+#include "muduo/base/BinaryLogging.h"
+#include "muduo/base/Clock.h"
 #include "muduo/base/LogFile.h"
+#include "muduo/base/MemoryTag.h"
 #include "muduo/base/Timestamp.h"
 
+#include <algorithm>
+
+#include <inttypes.h>
 #include <stdio.h>
+#include <string.h>
+
+namespace
+{
+
+// FixedBuffers and rings of thread local buffers
+muduo::MemoryTag& logBufferMemoryTag()
+{
+  static muduo::MemoryTag* tag = new muduo::MemoryTag("log_buffer");
+  return *tag;
+}
+
+// listed from the start, before the first AsyncLogging
+muduo::MemoryTag& __attribute__ ((unused)) g_logBufferMemoryTag = logBufferMemoryTag();
+
+}  // namespace
+
+namespace muduo
+{
+namespace detail
+{
+
+///
+/// Single producer single consumer ring of log lines,
+/// each line is prefixed with a Header and aligned to 16 bytes.
+/// A Header with negative length pads the end of ring.
+///
+class ThreadLogBuffer : noncopyable
+{
+ public:
+  struct Header
+  {
+    int64_t nanos;
+    int32_t len;
+    int32_t reserved;
+  };
+
+  struct Record
+  {
+    int64_t nanos;
+    const char* data;
+    int len;
+
+    bool operator<(const Record& rhs) const { return nanos < rhs.nanos; }
+  };
+
+  explicit ThreadLogBuffer(size_t size)
+    : data_(new char[size]),
+      size_(size),
+      head_(0),
+      tail_(0),
+      dropped_(0),
+      reported_(0),
+      abandoned_(false)
+  {
+    static_assert(sizeof(Header) == kAlign, "Header size");
+    assert(size >= 4096 && (size & (size - 1)) == 0);
+    logBufferMemoryTag().allocate(sizeof(ThreadLogBuffer) + size_);
+  }
+
+  ~ThreadLogBuffer()
+  {
+    logBufferMemoryTag().deallocate(sizeof(ThreadLogBuffer) + size_);
+  }
+
+  // producer, returns true if the ring becomes half full
+  bool append(const char* logline, int len, int64_t nanos)
+  {
+    const uint64_t head = head_;  // written by producer only
+    const uint64_t tail = __atomic_load_n(&tail_, __ATOMIC_ACQUIRE);
+    const size_t needed = align(sizeof(Header) + static_cast<size_t>(len));
+    size_t pos = head & (size_ - 1);
+    const size_t skip = pos + needed > size_ ? size_ - pos : 0;
+    if (head + skip + needed - tail > size_)
+    {
+      __atomic_store_n(&dropped_, dropped_ + len, __ATOMIC_RELAXED);
+      return false;
+    }
+    if (skip > 0)
+    {
+      header(pos)->len = -1;
+      pos = 0;
+    }
+    Header* h = header(pos);
+    h->nanos = nanos;
+    h->len = len;
+    memcpy(h + 1, logline, static_cast<size_t>(len));
+    const uint64_t newHead = head + skip + needed;
+    __atomic_store_n(&head_, newHead, __ATOMIC_RELEASE);
+    return head - tail <= size_ / 2 && newHead - tail > size_ / 2;
+  }
+
+  // producer thread exits
+  void abandon() { __atomic_store_n(&abandoned_, true, __ATOMIC_RELEASE); }
+
+  // consumer, returns new tail for release()
+  uint64_t harvest(std::vector<Record>* records) const
+  {
+    const uint64_t head = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+    uint64_t tail = tail_;
+    while (tail < head)
+    {
+      const size_t pos = tail & (size_ - 1);
+      const Header* h = header(pos);
+      if (h->len < 0)
+      {
+        tail += size_ - pos;
+      }
+      else
+      {
+        Record rec = { h->nanos, reinterpret_cast<const char*>(h + 1), h->len };
+        records->push_back(rec);
+        tail += align(sizeof(Header) + static_cast<size_t>(h->len));
+      }
+    }
+    return tail;
+  }
+
+  void release(uint64_t tail) { __atomic_store_n(&tail_, tail, __ATOMIC_RELEASE); }
+
+  bool abandoned() const { return __atomic_load_n(&abandoned_, __ATOMIC_ACQUIRE); }
+
+  // consumer, bytes dropped since last call
+  int64_t takeDropped()
+  {
+    int64_t dropped = __atomic_load_n(&dropped_, __ATOMIC_RELAXED);
+    int64_t delta = dropped - reported_;
+    reported_ = dropped;
+    return delta;
+  }
+
+ private:
+  static const size_t kAlign = 16;
+
+  static size_t align(size_t n) { return (n + kAlign - 1) & ~(kAlign - 1); }
+
+  Header* header(size_t pos) { return reinterpret_cast<Header*>(data_.get() + pos); }
+  const Header* header(size_t pos) const { return reinterpret_cast<const Header*>(data_.get() + pos); }
+
+  std::unique_ptr<char[]> data_;
+  const size_t size_;
+  uint64_t head_;  // __atomic
+  char pad_[64];  // keeps producer and consumer off the same cache line
+  uint64_t tail_;  // __atomic
+  int64_t dropped_;  // __atomic
+  int64_t reported_;
+  bool abandoned_;  // __atomic
+};
+
+}  // namespace detail
+}  // namespace muduo
 
 using namespace muduo;
+using muduo::detail::ThreadLogBuffer;
+
+namespace
+{
+
+// ring of current thread, owned by AsyncLogging and this thread
+struct LocalBuffer
+{
+  ~LocalBuffer()
+  {
+    if (buffer)
+    {
+      buffer->abandon();
+    }
+  }
+
+  int64_t owner = 0;  // AsyncLogging::id_
+  std::shared_ptr<ThreadLogBuffer> buffer;
+};
+
+thread_local LocalBuffer t_localBuffer;
+
+int64_t g_numCreated = 0;  // __atomic
+
+// Writes to a LogFile, formats binary records if asked.
+// Definitions of binary log call sites head each file, so a rolled
+// file decodes by itself, and precede the first record of a new site.
+class LogWriter : noncopyable
+{
+ public:
+  LogWriter(LogFile& output, bool formatBinaryLogs)
+    : output_(output),
+      decoder_(formatBinaryLogs ? new BinaryLogDecoder : NULL),
+      numFiles_(output.numFiles()),
+      sitesWritten_(0)
+  {
+  }
+
+  // call sites created since last call, before the records just taken
+  // from buffers or rings, all of them at the head of a new file
+  void writeDefinitions()
+  {
+    if (output_.numFiles() != numFiles_)
+    {
+      numFiles_ = output_.numFiles();
+      sitesWritten_ = 0;
+    }
+    string definitions;
+    sitesWritten_ = BinaryLogger::appendDefinitions(sitesWritten_, &definitions);
+    if (!definitions.empty())
+    {
+      writeFormatted(definitions.data(), static_cast<int>(definitions.size()));
+    }
+  }
+
+  void write(const char* data, int len)
+  {
+    if (output_.numFiles() != numFiles_)
+    {
+      writeDefinitions();
+    }
+    writeFormatted(data, len);
+  }
+
+  void flush() { output_.flush(); }
+
+ private:
+  void writeFormatted(const char* data, int len)
+  {
+    if (decoder_)
+    {
+      text_.clear();
+      size_t n = decoder_->decode(data, static_cast<size_t>(len), &text_);
+      // records are never split among buffers
+      assert(n == static_cast<size_t>(len)); (void)n;
+      output_.append(text_.data(), static_cast<int>(text_.size()));
+    }
+    else
+    {
+      output_.append(data, len);
+    }
+  }
+
+  LogFile& output_;
+  std::unique_ptr<BinaryLogDecoder> decoder_;
+  string text_;
+  int64_t numFiles_;
+  size_t sitesWritten_;
+};
+
+}  // namespace
+
+AsyncLogging::Buffer::Buffer()
+{
+  logBufferMemoryTag().allocate(sizeof(Buffer));
+}
+
+AsyncLogging::Buffer::~Buffer()
+{
+  logBufferMemoryTag().deallocate(sizeof(Buffer));
+}
 
 AsyncLogging::AsyncLogging(const string& basename,
                            off_t rollSize,
                            int flushInterval)
-  : flushInterval_(flushInterval),
+  : id_(__atomic_add_fetch(&g_numCreated, 1, __ATOMIC_RELAXED)),
+    flushInterval_(flushInterval),
     running_(false),
     basename_(basename),
     rollSize_(rollSize),
@@ -24,7 +283,11 @@ AsyncLogging::AsyncLogging(const string& basename,
     cond_(mutex_),
     currentBuffer_(new Buffer),
     nextBuffer_(new Buffer),
-    buffers_()
+    buffers_(),
+    formatBinaryLogs_(false),
+    threadBufferSize_(0),
+    harvestRequested_(false),
+    droppedBytes_(0)
 {
   currentBuffer_->bzero();
   nextBuffer_->bzero();
@@ -38,8 +301,26 @@ AsyncLogging::AsyncLogging(const string& basename,
   其中缓冲区默认都为FixedBuffer<4000*1000>，其内部有一个char data_[4000*1000]的缓冲区
   通过currentBuffer(unique_ptr)调用FixedBuffer::append,append底层调用memcpy向缓冲区填充数据
 */
+void AsyncLogging::enableThreadLocalBuffers(size_t bytesPerThread)
+{
+  assert(!running_);
+  // rounds up to power of 2
+  size_t size = 4096;
+  while (size < bytesPerThread)
+  {
+    size *= 2;
+  }
+  threadBufferSize_ = size;
+}
+
 void AsyncLogging::append(const char* logline, int len)
 {
+  if (threadBufferSize_ > 0)
+  {
+    appendThreadLocal(logline, len);
+    return;
+  }
+
   muduo::MutexLockGuard lock(mutex_);
   // currentBuffer_能够写入当前的logline，则直接append
   if (currentBuffer_->avail() > len)
@@ -69,11 +350,47 @@ void AsyncLogging::append(const char* logline, int len)
     threadFunc内部主要就是进行buffer buffervector的更换和写入logfile，并从中获取
 
 */
+void AsyncLogging::appendThreadLocal(const char* logline, int len)
+{
+  LocalBuffer& local = t_localBuffer;
+  // a new AsyncLogging may live at the address of a destroyed one
+  if (__builtin_expect(local.owner != id_, 0))
+  {
+    if (local.buffer)
+    {
+      local.buffer->abandon();
+    }
+    local.owner = id_;
+    local.buffer = std::make_shared<ThreadLogBuffer>(threadBufferSize_);
+    MutexLockGuard lock(mutex_);
+    threadBuffers_.push_back(local.buffer);
+  }
+  if (local.buffer->append(logline, len, Clock::monotonicNanos()))
+  {
+    requestHarvest();
+  }
+}
+
+void AsyncLogging::requestHarvest()
+{
+  // rare, once for each half of a ring
+  MutexLockGuard lock(mutex_);
+  harvestRequested_ = true;
+  cond_.notify();
+}
+
 void AsyncLogging::threadFunc()
 {
   assert(running_ == true);
+  if (threadBufferSize_ > 0)
+  {
+    threadLocalFunc();
+    return;
+  }
   latch_.countDown();
-  LogFile output(basename_, rollSize_, false);
+  LogFile file(basename_, rollSize_, false, flushInterval_, 1024, writerFactory_);
+  file.setRollCallback(rollCallback_);
+  LogWriter output(file, formatBinaryLogs_);
   // 两块备用buffer，缓冲区写满后用其替代
   BufferPtr newBuffer1(new Buffer);
   BufferPtr newBuffer2(new Buffer);
@@ -110,22 +427,29 @@ void AsyncLogging::threadFunc()
     }
 
     assert(!buffersToWrite.empty());
+    output.writeDefinitions();
     //如果vector中要写的buffer超过25个，则只留前两个，剩余的丢弃
     if (buffersToWrite.size() > 25)
     {
+      int64_t dropped = 0;
+      for (size_t i = 2; i < buffersToWrite.size(); ++i)
+      {
+        dropped += buffersToWrite[i]->length();
+      }
+      __atomic_store_n(&droppedBytes_, droppedBytes_ + dropped, __ATOMIC_RELAXED);
       char buf[256];
       snprintf(buf, sizeof buf, "Dropped log messages at %s, %zd larger buffers\n",
                Timestamp::now().toFormattedString().c_str(),
                buffersToWrite.size()-2);
       fputs(buf, stderr);
-      output.append(buf, static_cast<int>(strlen(buf)));
+      output.write(buf, static_cast<int>(strlen(buf)));
       buffersToWrite.erase(buffersToWrite.begin()+2, buffersToWrite.end());
     }
     //遍历并append
     for (const auto& buffer : buffersToWrite)
     {
       // FIXME: use unbuffered stdio FILE ? or use ::writev ?
-      output.append(buffer->data(), buffer->length());
+      output.write(buffer->data(), buffer->length());
     }
     
     if (buffersToWrite.size() > 2)
@@ -153,8 +477,98 @@ void AsyncLogging::threadFunc()
     buffersToWrite.clear();
     output.flush();
   } //end while
-  
+
+  // lines appended after the last round, or stop() before the first round
+  {
+    muduo::MutexLockGuard lock(mutex_);
+    buffers_.push_back(std::move(currentBuffer_));
+    currentBuffer_ = std::move(newBuffer1);
+    buffersToWrite.swap(buffers_);
+  }
+  // not under mutex_, appendDefinitions() locks call sites
+  output.writeDefinitions();
+  for (const auto& buffer : buffersToWrite)
+  {
+    output.write(buffer->data(), buffer->length());
+  }
+
   //Logfile::flush -> AppendFile::flush -> fflush()
   output.flush();
 }
 
+void AsyncLogging::threadLocalFunc()
+{
+  latch_.countDown();
+  LogFile file(basename_, rollSize_, false, flushInterval_, 1024, writerFactory_);
+  file.setRollCallback(rollCallback_);
+  LogWriter output(file, formatBinaryLogs_);
+  std::vector<std::shared_ptr<ThreadLogBuffer>> buffers;
+  std::vector<ThreadLogBuffer::Record> records;
+  std::vector<uint64_t> tails;
+  bool more = true;
+  while (more)
+  {
+    // harvests once more after stop()
+    more = running_;
+    {
+      muduo::MutexLockGuard lock(mutex_);
+      if (more && !harvestRequested_)
+      {
+        cond_.waitForSeconds(flushInterval_);
+      }
+      harvestRequested_ = false;
+      buffers = threadBuffers_;
+    }
+
+    // abandoned before harvest, so nothing will be appended after it
+    std::vector<bool> abandoned(buffers.size());
+    int64_t dropped = 0;
+    records.clear();
+    tails.clear();
+    for (size_t i = 0; i < buffers.size(); ++i)
+    {
+      abandoned[i] = buffers[i]->abandoned();
+      tails.push_back(buffers[i]->harvest(&records));
+      dropped += buffers[i]->takeDropped();
+    }
+
+    if (dropped > 0)
+    {
+      __atomic_store_n(&droppedBytes_, droppedBytes_ + dropped, __ATOMIC_RELAXED);
+      char buf[256];
+      snprintf(buf, sizeof buf, "Dropped log messages at %s, %" PRId64 " bytes\n",
+               Timestamp::now().toFormattedString().c_str(), dropped);
+      fputs(buf, stderr);
+      output.write(buf, static_cast<int>(strlen(buf)));
+    }
+
+    output.writeDefinitions();
+    // lines of one thread are in order already
+    std::stable_sort(records.begin(), records.end());
+    for (const auto& rec : records)
+    {
+      output.write(rec.data, rec.len);
+    }
+
+    std::vector<std::shared_ptr<ThreadLogBuffer>> drained;
+    for (size_t i = 0; i < buffers.size(); ++i)
+    {
+      buffers[i]->release(tails[i]);
+      if (abandoned[i])
+      {
+        drained.push_back(buffers[i]);
+      }
+    }
+    if (!drained.empty())
+    {
+      muduo::MutexLockGuard lock(mutex_);
+      threadBuffers_.erase(
+          std::remove_if(threadBuffers_.begin(), threadBuffers_.end(),
+                         [&drained](const std::shared_ptr<ThreadLogBuffer>& buffer)
+                         { return std::find(drained.begin(), drained.end(), buffer) != drained.end(); }),
+          threadBuffers_.end());
+    }
+    buffers.clear();
+    output.flush();
+  }
+}
@@ -9,16 +9,23 @@
 #include "muduo/base/BlockingQueue.h"
 #include "muduo/base/BoundedBlockingQueue.h"
 #include "muduo/base/CountDownLatch.h"
+#include "muduo/base/LogFile.h"
 #include "muduo/base/Mutex.h"
 #include "muduo/base/Thread.h"
 #include "muduo/base/LogStream.h"       // FixedBuffer
 
 #include <atomic>
+#include <memory>
 #include <vector>
 
 namespace muduo
 {
 
+namespace detail
+{
+class ThreadLogBuffer;
+}  // namespace detail
+
 class AsyncLogging : noncopyable
 {
  public:
@@ -37,6 +44,28 @@ class AsyncLogging : noncopyable
 
   void append(const char* logline, int len);
 
+  ///
+  /// Each producer thread appends to a ring buffer of its own, without
+  /// taking the global lock.  The backend harvests all rings and merges
+  /// lines by the time of append, so lines of one thread keep their order.
+  /// A line is dropped if the ring of its thread is full.
+  ///
+  /// Must be called before start().
+  void enableThreadLocalBuffers(size_t bytesPerThread = 4 * 1024 * 1024);
+
+  /// Formats records of LOG_BINARY_* in the backend thread,
+  /// see BinaryLogger::setOutput().  Otherwise they are written as is.
+  /// Must be called before start().
+  void setFormatBinaryLogs(bool on) { formatBinaryLogs_ = on; }
+
+  /// See LogFile, eg. LogCompressor::rollCallback().
+  /// Must be called before start().
+  void setRollCallback(const LogFile::RollCallback& cb) { rollCallback_ = cb; }
+  void setWriterFactory(const LogFile::WriterFactory& factory) { writerFactory_ = factory; }
+
+  /// bytes of log messages dropped so far, thread safe.
+  int64_t droppedBytes() const { return __atomic_load_n(&droppedBytes_, __ATOMIC_RELAXED); }
+
   void start()
   {
     running_ = true;
@@ -54,11 +83,20 @@ class AsyncLogging : noncopyable
  private:
 
   void threadFunc();
+  void threadLocalFunc();
+  void appendThreadLocal(const char* logline, int len);
+  void requestHarvest();
 
-  typedef muduo::detail::FixedBuffer<muduo::detail::kLargeBuffer> Buffer;
+  // counted in MemoryTag "log_buffer"
+  struct Buffer : muduo::detail::FixedBuffer<muduo::detail::kLargeBuffer>
+  {
+    Buffer();
+    ~Buffer();
+  };
   typedef std::vector<std::unique_ptr<Buffer>> BufferVector;
   typedef BufferVector::value_type BufferPtr;
 
+  const int64_t id_;  // owner of thread rings, not reused like addresses
   const int flushInterval_;
   std::atomic<bool> running_;
   const string basename_;
@@ -70,6 +108,13 @@ class AsyncLogging : noncopyable
   BufferPtr currentBuffer_ GUARDED_BY(mutex_);
   BufferPtr nextBuffer_ GUARDED_BY(mutex_);
   BufferVector buffers_ GUARDED_BY(mutex_);
+  bool formatBinaryLogs_;
+  LogFile::RollCallback rollCallback_;
+  LogFile::WriterFactory writerFactory_;
+  size_t threadBufferSize_;  // 0 for the global buffers
+  std::vector<std::shared_ptr<detail::ThreadLogBuffer>> threadBuffers_ GUARDED_BY(mutex_);
+  bool harvestRequested_ GUARDED_BY(mutex_);
+  int64_t droppedBytes_;  // __atomic
 };
 
 }  // namespace muduo
@@ -0,0 +1,421 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/base/BinaryLogging.h"
+
+#include "muduo/base/Atomic.h"
+#include "muduo/base/CurrentThread.h"
+#include "muduo/base/Mutex.h"
+
+#include <vector>
+
+#include <stdio.h>
+#include <time.h>
+
+namespace muduo
+{
+
+// in Logging.cc
+extern Logger::OutputFunc g_output;
+extern Logger::ClockFunc g_clock;
+extern TimeZone g_logTimeZone;
+extern const char* LogLevelName[Logger::NUM_LOG_LEVELS];
+
+}  // namespace muduo
+
+using namespace muduo;
+using namespace muduo::detail;
+
+namespace
+{
+
+// Every record begins with a Header, its marker is '\0' which
+// text lines don't have.
+//
+// kDefinition: Header, uint32 id, int32 level, int32 line, file '\0' format '\0'
+// kRecord: Header, uint32 id, int32 tid, int64 microseconds, arguments
+//
+// An argument is a type tag followed by its value:
+// 'i' int64, 'u' uint64, 'd' double, 'p' uint64, 'b' bool, 'c' char,
+// 's' uint32 length and bytes.
+struct Header
+{
+  char marker;
+  char type;
+  uint16_t reserved;
+  uint32_t length;  // including header
+};
+
+const char kDefinition = 'D';
+const char kRecord = 'R';
+const size_t kRecordPrefix = sizeof(Header) + sizeof(uint32_t) + sizeof(int32_t) + sizeof(int64_t);
+
+struct SiteRegistry
+{
+  MutexLock mutex;
+  std::vector<const BinaryLogSite*> sites GUARDED_BY(mutex);
+  // records may still be in backends after setOutput(NULL)
+  bool hadOutput GUARDED_BY(mutex) = false;
+};
+
+SiteRegistry& registry()
+{
+  static SiteRegistry instance;
+  return instance;
+}
+
+// written by setOutput() before logging, read without lock
+Logger::OutputFunc g_binaryOutput = NULL;
+
+AtomicInt32 g_numSites;
+
+template<typename T>
+T load(const char* p)
+{
+  T v;
+  memcpy(&v, p, sizeof v);
+  return v;
+}
+
+// returns length, buf has kMaxRecordSize bytes
+size_t encodeDefinition(const BinaryLogSite& site, char* buf)
+{
+  const size_t fileLen = static_cast<size_t>(site.file().size_);
+  size_t formatLen = strlen(site.format());
+  const size_t fixed = sizeof(Header) + 3 * sizeof(int32_t) + fileLen + 2;
+  if (fixed + formatLen > BinaryLogger::kMaxRecordSize)
+  {
+    formatLen = BinaryLogger::kMaxRecordSize - fixed;
+  }
+  Header header = { '\0', kDefinition, 0, static_cast<uint32_t>(fixed + formatLen) };
+  uint32_t id = site.id();
+  int32_t level = site.level();
+  int32_t line = site.line();
+  char* p = buf;
+  memcpy(p, &header, sizeof header);
+  p += sizeof header;
+  memcpy(p, &id, sizeof id);
+  p += sizeof id;
+  memcpy(p, &level, sizeof level);
+  p += sizeof level;
+  memcpy(p, &line, sizeof line);
+  p += sizeof line;
+  memcpy(p, site.file().data_, fileLen);
+  p += fileLen;
+  *p++ = '\0';
+  memcpy(p, site.format(), formatLen);
+  p += formatLen;
+  *p++ = '\0';
+  return static_cast<size_t>(p - buf);
+}
+
+// same as Logger::Impl::formatTime(), with a cache of its own
+class TimeFormatter
+{
+ public:
+  TimeFormatter() : lastSecond_(-1) { }
+
+  void format(LogStream& stream, const TimeZone& tz, int64_t microSecondsSinceEpoch)
+  {
+    time_t seconds = static_cast<time_t>(microSecondsSinceEpoch / Timestamp::kMicroSecondsPerSecond);
+    int microseconds = static_cast<int>(microSecondsSinceEpoch % Timestamp::kMicroSecondsPerSecond);
+    if (seconds != lastSecond_)
+    {
+      lastSecond_ = seconds;
+      struct tm tm_time;
+      if (tz.valid())
+      {
+        tm_time = tz.toLocalTime(seconds);
+      }
+      else
+      {
+        ::gmtime_r(&seconds, &tm_time);
+      }
+      snprintf(time_, sizeof time_, "%4d%02d%02d %02d:%02d:%02d",
+               tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
+               tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
+    }
+    stream.append(time_, 17);
+    if (tz.valid())
+    {
+      Fmt us(".%06d ", microseconds);
+      stream.append(us.data(), us.length());
+    }
+    else
+    {
+      Fmt us(".%06dZ ", microseconds);
+      stream.append(us.data(), us.length());
+    }
+  }
+
+ private:
+  time_t lastSecond_;
+  char time_[64];
+};
+
+// formats next argument, returns false if malformed
+bool formatArg(LogStream& stream, const char*& p, const char* end)
+{
+  char tag = *p++;
+  size_t size = tag == 'b' || tag == 'c' ? 1 : tag == 's' ? sizeof(uint32_t) : sizeof(int64_t);
+  if (static_cast<size_t>(end - p) < size)
+  {
+    return false;
+  }
+  switch (tag)
+  {
+    case 'i':
+      stream << load<int64_t>(p);
+      break;
+    case 'u':
+      stream << load<uint64_t>(p);
+      break;
+    case 'd':
+      stream << load<double>(p);
+      break;
+    case 'p':
+      stream << reinterpret_cast<const void*>(static_cast<uintptr_t>(load<uint64_t>(p)));
+      break;
+    case 'b':
+      stream << (*p != 0);
+      break;
+    case 'c':
+      stream << *p;
+      break;
+    case 's':
+      {
+        uint32_t len = load<uint32_t>(p);
+        if (static_cast<size_t>(end - p - size) < len)
+        {
+          return false;
+        }
+        stream.append(p + size, static_cast<int>(len));
+        size += len;
+      }
+      break;
+    default:
+      return false;
+  }
+  p += size;
+  return true;
+}
+
+// formats a line as Logger does
+void formatLine(LogStream& stream, TimeFormatter& timeFormatter, const TimeZone& tz,
+                int64_t microSecondsSinceEpoch, int tid, Logger::LogLevel level,
+                const char* format, const char* file, int fileLen, int line,
+                const char* args, const char* end)
+{
+  timeFormatter.format(stream, tz, microSecondsSinceEpoch);
+  char tidString[32];
+  int tidLen = snprintf(tidString, sizeof tidString, "%5d ", tid);
+  stream.append(tidString, tidLen);
+  stream.append(LogLevelName[level], 6);
+  bool more = true;
+  const char* prev = format;
+  const char* brace = NULL;
+  while ((brace = strstr(prev, "{}")) != NULL)
+  {
+    stream.append(prev, static_cast<int>(brace - prev));
+    if (more && args < end)
+    {
+      more = formatArg(stream, args, end);
+    }
+    else
+    {
+      stream.append("{?}", 3);
+    }
+    prev = brace + 2;
+  }
+  stream << prev << " - ";
+  stream.append(file, fileLen);
+  stream << ':' << line << '\n';
+}
+
+}  // namespace
+
+BinaryLogSite::BinaryLogSite(Logger::LogLevel level, Logger::SourceFile file, int line, const char* format)
+  : id_(static_cast<uint32_t>(g_numSites.incrementAndGet())),
+    level_(level),
+    file_(file),
+    line_(line),
+    format_(format)
+{
+  SiteRegistry& reg = registry();
+  MutexLockGuard lock(reg.mutex);
+  reg.sites.push_back(this);
+}
+
+void BinaryLogger::setOutput(Logger::OutputFunc out)
+{
+  SiteRegistry& reg = registry();
+  MutexLockGuard lock(reg.mutex);
+  if (out)
+  {
+    reg.hadOutput = true;
+  }
+  g_binaryOutput = out;
+}
+
+size_t BinaryLogger::appendDefinitions(size_t from, string* out)
+{
+  SiteRegistry& reg = registry();
+  MutexLockGuard lock(reg.mutex);
+  if (!reg.hadOutput)
+  {
+    return from;
+  }
+  char buf[kMaxRecordSize];
+  for (size_t i = from; i < reg.sites.size(); ++i)
+  {
+    out->append(buf, encodeDefinition(*reg.sites[i], buf));
+  }
+  return reg.sites.size();
+}
+
+BinaryRecordBuilder::BinaryRecordBuilder(const BinaryLogSite& site)
+  : site_(site),
+    cur_(buf_ + kRecordPrefix),
+    full_(false)
+{
+}
+
+void BinaryRecordBuilder::addString(const char* str, size_t len)
+{
+  const size_t avail = static_cast<size_t>(end() - cur_);
+  if (full_ || avail <= 1 + sizeof(uint32_t))
+  {
+    full_ = true;
+    return;
+  }
+  if (len > avail - 1 - sizeof(uint32_t))
+  {
+    len = avail - 1 - sizeof(uint32_t);
+    full_ = true;
+  }
+  *cur_++ = 's';
+  uint32_t len32 = static_cast<uint32_t>(len);
+  memcpy(cur_, &len32, sizeof len32);
+  memcpy(cur_ + sizeof len32, str, len);
+  cur_ += sizeof len32 + len;
+}
+
+void BinaryRecordBuilder::finish()
+{
+  int64_t microSecondsSinceEpoch = g_clock().microSecondsSinceEpoch();
+  int32_t tid = CurrentThread::tid();
+  Logger::OutputFunc out = g_binaryOutput;
+  if (out)
+  {
+    Header header = { '\0', kRecord, 0, static_cast<uint32_t>(cur_ - buf_) };
+    uint32_t id = site_.id();
+    char* p = buf_;
+    memcpy(p, &header, sizeof header);
+    p += sizeof header;
+    memcpy(p, &id, sizeof id);
+    p += sizeof id;
+    memcpy(p, &tid, sizeof tid);
+    p += sizeof tid;
+    memcpy(p, &microSecondsSinceEpoch, sizeof microSecondsSinceEpoch);
+    out(buf_, static_cast<int>(cur_ - buf_));
+  }
+  else
+  {
+    static __thread TimeFormatter* t_timeFormatter = NULL;
+    if (t_timeFormatter == NULL)
+    {
+      // leaks one per thread, as Logging.cc keeps t_time
+      t_timeFormatter = new TimeFormatter;
+    }
+    LogStream stream;
+    formatLine(stream, *t_timeFormatter, g_logTimeZone, microSecondsSinceEpoch, tid,
+               site_.level(), site_.format(), site_.file().data_, site_.file().size_,
+               site_.line(), buf_ + kRecordPrefix, cur_);
+    g_output(stream.buffer().data(), stream.buffer().length());
+  }
+}
+
+BinaryLogDecoder::BinaryLogDecoder()
+  : loggerTimeZone_(true)
+{
+}
+
+void BinaryLogDecoder::setTimeZone(const TimeZone& tz)
+{
+  timeZone_ = tz;
+  loggerTimeZone_ = false;
+}
+
+size_t BinaryLogDecoder::decode(const char* data, size_t len, string* out)
+{
+  TimeFormatter timeFormatter;
+  const TimeZone& tz = loggerTimeZone_ ? g_logTimeZone : timeZone_;
+  const char* p = data;
+  const char* const end = data + len;
+  while (p < end)
+  {
+    if (*p != '\0')
+    {
+      // text lines
+      const char* nul = static_cast<const char*>(memchr(p, '\0', static_cast<size_t>(end - p)));
+      const char* textEnd = nul ? nul : end;
+      out->append(p, textEnd);
+      p = textEnd;
+      continue;
+    }
+
+    if (static_cast<size_t>(end - p) < sizeof(Header))
+    {
+      break;
+    }
+    Header header = load<Header>(p);
+    if (header.length < sizeof(Header))
+    {
+      // not a record, skips the marker
+      ++p;
+      continue;
+    }
+    if (static_cast<size_t>(end - p) < header.length)
+    {
+      break;
+    }
+    const char* recordEnd = p + header.length;
+    const char* body = p + sizeof(Header);
+    if (header.type == kDefinition && header.length > sizeof(Header) + 3 * sizeof(int32_t))
+    {
+      uint32_t id = load<uint32_t>(body);
+      Site& site = sites_[id];
+      site.level = static_cast<Logger::LogLevel>(load<int32_t>(body + 4));
+      site.line = load<int32_t>(body + 8);
+      const char* file = body + 12;
+      site.file.assign(file, strnlen(file, static_cast<size_t>(recordEnd - file)));
+      const char* format = file + site.file.size() + 1;
+      site.format = format < recordEnd ? string(format, strnlen(format, static_cast<size_t>(recordEnd - format))) : string();
+    }
+    else if (header.type == kRecord && header.length >= kRecordPrefix)
+    {
+      uint32_t id = load<uint32_t>(body);
+      int32_t tid = load<int32_t>(body + 4);
+      int64_t microSecondsSinceEpoch = load<int64_t>(body + 8);
+      auto it = sites_.find(id);
+      LogStream stream;
+      if (it != sites_.end() && it->second.level >= 0 && it->second.level < Logger::NUM_LOG_LEVELS)
+      {
+        const Site& site = it->second;
+        formatLine(stream, timeFormatter, tz, microSecondsSinceEpoch, tid,
+                   site.level, site.format.c_str(), site.file.data(),
+                   static_cast<int>(site.file.size()), site.line,
+                   p + kRecordPrefix, recordEnd);
+      }
+      else
+      {
+        stream << "binary log record of unknown site " << id << '\n';
+      }
+      out->append(stream.buffer().data(), stream.buffer().length());
+    }
+    p = recordEnd;
+  }
+  return static_cast<size_t>(p - data);
+}
@@ -0,0 +1,212 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_BINARYLOGGING_H
+#define MUDUO_BASE_BINARYLOGGING_H
+
+#include "muduo/base/Logging.h"
+#include "muduo/base/TimeZone.h"
+
+#include <unordered_map>
+
+namespace muduo
+{
+
+///
+/// Deferred logging, formats in the backend instead of the caller.
+///
+///   LOG_BINARY_INFO("conn {} read {} bytes", conn->id(), n);
+///
+/// records the id of call site, time, tid and raw bytes of arguments.
+/// Each {} is replaced by next argument, formatted as LogStream does,
+/// so the text is the same as LOG_INFO << "conn " << id << ...
+///
+/// Records are formatted in the calling thread and written to Logger
+/// output by default.  With BinaryLogger::setOutput(), they are passed
+/// as is, to be formatted by AsyncLogging::setFormatBinaryLogs() or
+/// offline by BinaryLogDecoder (examples/logdecode), with definitions
+/// of call sites written by the backend.
+///
+/// Arguments are integers, floating points, bool, char, pointers and
+/// strings (const char*, string, StringPiece).  A record takes at most
+/// kMaxRecordSize bytes, longer strings are truncated.
+///
+
+///
+/// A call site of LOG_BINARY_*, a function local static.
+///
+class BinaryLogSite : noncopyable
+{
+ public:
+  BinaryLogSite(Logger::LogLevel level, Logger::SourceFile file, int line, const char* format);
+
+  uint32_t id() const { return id_; }
+  Logger::LogLevel level() const { return level_; }
+  const Logger::SourceFile& file() const { return file_; }
+  int line() const { return line_; }
+  const char* format() const { return format_; }
+
+ private:
+  const uint32_t id_;
+  const Logger::LogLevel level_;
+  const Logger::SourceFile file_;
+  const int line_;
+  const char* const format_;
+};
+
+class BinaryLogger
+{
+ public:
+  static const int kMaxRecordSize = 1024;
+
+  /// Passes records to @c out unformatted,
+  /// NULL to format in calling thread, the default.
+  /// Definitions of call sites are not passed, the backend writes them
+  /// with appendDefinitions(), eg. AsyncLogging at the head of each file.
+  /// @c out is never called under a lock of BinaryLogger.
+  /// Not thread safe, call it before logging.
+  static void setOutput(Logger::OutputFunc out);
+
+  /// Appends definitions of call sites after the first @c from sites,
+  /// in the order of creation, returns the number of sites.
+  /// A backend calls it after taking records from where @c out puts
+  /// them, so definitions precede records of new sites, and with
+  /// @c from of 0 at the head of each file.  Nothing is appended and
+  /// @c from is returned until the first output is set, so logs of
+  /// processes without binary output stay text.  Thread safe.
+  static size_t appendDefinitions(size_t from, string* out);
+};
+
+///
+/// Formats records in a stream of binary records and text lines,
+/// text is copied as is, it must not contain '\0'.
+///
+/// Not thread safe.
+///
+class BinaryLogDecoder : noncopyable
+{
+ public:
+  /// uses time zone of Logger
+  BinaryLogDecoder();
+
+  void setTimeZone(const TimeZone& tz);
+
+  /// Appends text of [data, data+len) to @c out.
+  /// Returns bytes consumed, the rest is an incomplete record.
+  size_t decode(const char* data, size_t len, string* out);
+
+  size_t numSites() const { return sites_.size(); }
+
+ private:
+  struct Site
+  {
+    Logger::LogLevel level;
+    int line;
+    string file;
+    string format;
+  };
+
+  std::unordered_map<uint32_t, Site> sites_;
+  TimeZone timeZone_;
+  bool loggerTimeZone_;
+};
+
+namespace detail
+{
+
+// packs a record on stack
+class BinaryRecordBuilder : noncopyable
+{
+ public:
+  explicit BinaryRecordBuilder(const BinaryLogSite& site);
+  // writes out
+  void finish();
+
+  void add(bool v) { addTag('b'); addRaw(&v, 1); }
+  void add(char v) { addTag('c'); addRaw(&v, 1); }
+  void add(short v) { addSigned(v); }
+  void add(int v) { addSigned(v); }
+  void add(long v) { addSigned(v); }
+  void add(long long v) { addSigned(v); }
+  void add(unsigned short v) { addUnsigned(v); }
+  void add(unsigned int v) { addUnsigned(v); }
+  void add(unsigned long v) { addUnsigned(v); }
+  void add(unsigned long long v) { addUnsigned(v); }
+  void add(float v) { add(static_cast<double>(v)); }
+  void add(double v) { addTag('d'); addRaw(&v, sizeof v); }
+  void add(const void* p)
+  {
+    uint64_t v = reinterpret_cast<uintptr_t>(p);
+    addTag('p');
+    addRaw(&v, sizeof v);
+  }
+  void add(const char* str) { addString(str, strlen(str)); }
+  void add(const string& str) { addString(str.data(), str.size()); }
+  void add(const StringPiece& str) { addString(str.data(), static_cast<size_t>(str.size())); }
+
+ private:
+  void addSigned(int64_t v) { addTag('i'); addRaw(&v, sizeof v); }
+  void addUnsigned(uint64_t v) { addTag('u'); addRaw(&v, sizeof v); }
+  void addString(const char* str, size_t len);
+
+  void addTag(char tag)
+  {
+    if (!full_ && cur_ < end() - 9)
+      *cur_++ = tag;
+    else
+      full_ = true;
+  }
+
+  void addRaw(const void* data, size_t len)
+  {
+    if (!full_)
+    {
+      memcpy(cur_, data, len);
+      cur_ += len;
+    }
+  }
+
+  const char* end() const { return buf_ + sizeof buf_; }
+
+  const BinaryLogSite& site_;
+  char* cur_;
+  bool full_;
+  char buf_[BinaryLogger::kMaxRecordSize];
+};
+
+inline void addBinaryLogArgs(BinaryRecordBuilder&)
+{
+}
+
+template<typename T, typename... Args>
+void addBinaryLogArgs(BinaryRecordBuilder& record, const T& v, const Args&... args)
+{
+  record.add(v);
+  addBinaryLogArgs(record, args...);
+}
+
+}  // namespace detail
+
+#define LOG_BINARY(level, format, ...) \
+  do \
+  { \
+    if (muduo::Logger::logLevel() <= (level)) \
+    { \
+      static const muduo::BinaryLogSite muduoBinaryLogSite((level), __FILE__, __LINE__, (format)); \
+      muduo::detail::BinaryRecordBuilder muduoBinaryRecord(muduoBinaryLogSite); \
+      muduo::detail::addBinaryLogArgs(muduoBinaryRecord, ##__VA_ARGS__); \
+      muduoBinaryRecord.finish(); \
+    } \
+  } while (0)
+
+#define LOG_BINARY_TRACE(format, ...) LOG_BINARY(muduo::Logger::TRACE, format, ##__VA_ARGS__)
+#define LOG_BINARY_DEBUG(format, ...) LOG_BINARY(muduo::Logger::DEBUG, format, ##__VA_ARGS__)
+#define LOG_BINARY_INFO(format, ...) LOG_BINARY(muduo::Logger::INFO, format, ##__VA_ARGS__)
+#define LOG_BINARY_WARN(format, ...) LOG_BINARY(muduo::Logger::WARN, format, ##__VA_ARGS__)
+#define LOG_BINARY_ERROR(format, ...) LOG_BINARY(muduo::Logger::ERROR, format, ##__VA_ARGS__)
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_BINARYLOGGING_H
@@ -0,0 +1,163 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/base/Clock.h"
+
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define MUDUO_HAVE_TSC 1
+#endif
+
+using namespace muduo;
+
+namespace muduo
+{
+namespace Clock
+{
+  __thread int64_t t_cachedNow = 0;
+}  // namespace Clock
+}  // namespace muduo
+
+namespace
+{
+
+const int kShift = 32;
+
+int64_t toNanos(const struct timespec& ts)
+{
+  return static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 * 1000 + ts.tv_nsec;
+}
+
+int64_t realtimeNanos()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_REALTIME, &ts);
+  return toNanos(ts);
+}
+
+bool hasInvariantTsc()
+{
+#ifdef MUDUO_HAVE_TSC
+  unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+  if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+  {
+    return (edx & (1u << 8)) != 0;
+  }
+#endif
+  return false;
+}
+
+// reads TSC and CLOCK_MONOTONIC as close as possible
+void readPair(uint64_t* tsc, int64_t* nanos)
+{
+  int64_t best = INT64_MAX;
+  for (int i = 0; i < 5; ++i)
+  {
+    int64_t before = Clock::monotonicNanos();
+    uint64_t t = TscClock::readTsc();
+    int64_t after = Clock::monotonicNanos();
+    if (after - before < best)
+    {
+      best = after - before;
+      *tsc = t;
+      *nanos = before + (after - before) / 2;
+    }
+  }
+}
+
+}  // namespace
+
+Timestamp Clock::coarseNow()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+  return Timestamp(static_cast<int64_t>(ts.tv_sec) * Timestamp::kMicroSecondsPerSecond
+                   + ts.tv_nsec / 1000);
+}
+
+int64_t Clock::monotonicNanos()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return toNanos(ts);
+}
+
+TscClock& TscClock::instance()
+{
+  static TscClock clock;
+  return clock;
+}
+
+TscClock::TscClock(double calibrateSeconds)
+  : usingTsc_(hasInvariantTsc()),
+    baseTsc_(0),
+    baseNanos_(0),
+    mult_(0),
+    realtimeOffsetNanos_(0)
+{
+  recalibrate(calibrateSeconds);
+}
+
+uint64_t TscClock::readTsc()
+{
+#ifdef MUDUO_HAVE_TSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+void TscClock::recalibrate(double calibrateSeconds)
+{
+  if (usingTsc_)
+  {
+    uint64_t tsc0 = 0, tsc1 = 0;
+    int64_t nanos0 = 0, nanos1 = 0;
+    readPair(&tsc0, &nanos0);
+    ::usleep(static_cast<useconds_t>(calibrateSeconds * 1000 * 1000));
+    readPair(&tsc1, &nanos1);
+    if (tsc1 > tsc0 && nanos1 > nanos0)
+    {
+      mult_ = (static_cast<uint64_t>(nanos1 - nanos0) << kShift) / (tsc1 - tsc0);
+      baseTsc_ = tsc1;
+      baseNanos_ = nanos1;
+    }
+    else
+    {
+      usingTsc_ = false;
+    }
+  }
+  realtimeOffsetNanos_ = realtimeNanos() - nowNanos();
+}
+
+double TscClock::ticksPerNanosecond() const
+{
+  return mult_ ? static_cast<double>(uint64_t(1) << kShift) / static_cast<double>(mult_) : 0.0;
+}
+
+int64_t TscClock::nowNanos() const
+{
+  if (!usingTsc_)
+  {
+    return Clock::monotonicNanos();
+  }
+  // a core whose TSC is a little behind the calibrating one may read
+  // below baseTsc_, the unsigned difference would wrap to centuries
+  int64_t signedDelta = static_cast<int64_t>(readTsc() - baseTsc_);
+  uint64_t delta = signedDelta > 0 ? static_cast<uint64_t>(signedDelta) : 0;
+#ifdef __SIZEOF_INT128__
+  unsigned __int128 product = static_cast<unsigned __int128>(delta) * mult_;
+  return baseNanos_ + static_cast<int64_t>(product >> kShift);
+#else
+  // split to avoid overflow after a few seconds
+  uint64_t high = (delta >> kShift) * mult_;
+  uint64_t low = ((delta & 0xFFFFFFFFu) * mult_) >> kShift;
+  return baseNanos_ + static_cast<int64_t>(high + low);
+#endif
+}
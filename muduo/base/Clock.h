@@ -0,0 +1,104 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_CLOCK_H
+#define MUDUO_BASE_CLOCK_H
+
+#include "muduo/base/noncopyable.h"
+#include "muduo/base/Timestamp.h"
+
+namespace muduo
+{
+
+///
+/// Cheaper alternatives of Timestamp::now().
+///
+namespace Clock
+{
+  // internal
+  extern __thread int64_t t_cachedNow;
+
+  ///
+  /// Time cached by the EventLoop of current thread, refreshed once per
+  /// poll return, so it's the same as EventLoop::pollReturnTime().
+  /// Falls back to Timestamp::now() in threads without an EventLoop.
+  ///
+  /// It lags behind the real time by the time spent in current iteration,
+  /// good for logging and timeouts of seconds, not for measuring.
+  ///
+  inline Timestamp cachedNow()
+  {
+    if (__builtin_expect(t_cachedNow == 0, 0))
+    {
+      return Timestamp::now();
+    }
+    return Timestamp(t_cachedNow);
+  }
+
+  // for EventLoop, invalid Timestamp to stop caching
+  inline void setCachedNow(Timestamp now)
+  {
+    t_cachedNow = now.microSecondsSinceEpoch();
+  }
+
+  ///
+  /// CLOCK_REALTIME_COARSE, resolution is one jiffy (1~4ms),
+  /// but a few times cheaper than Timestamp::now().
+  ///
+  Timestamp coarseNow();
+
+  /// CLOCK_MONOTONIC in nanoseconds
+  int64_t monotonicNanos();
+}  // namespace Clock
+
+///
+/// Nanosecond monotonic clock of CPU time stamp counter,
+/// calibrated against CLOCK_MONOTONIC.
+///
+/// Reading TSC takes a few nanoseconds without entering vDSO,
+/// but it's only reliable with invariant TSC, ie. constant rate and
+/// synchronized among cores, otherwise CLOCK_MONOTONIC is used.
+///
+/// The rate is measured once in ctor, about 10ms, call recalibrate()
+/// every few minutes to correct drift for long running processes.
+/// Thread safe.
+///
+class TscClock : noncopyable
+{
+ public:
+  static TscClock& instance();
+
+  explicit TscClock(double calibrateSeconds = 0.01);
+
+  bool usingTsc() const { return usingTsc_; }
+  double ticksPerNanosecond() const;
+
+  /// monotonic, comparable with Clock::monotonicNanos()
+  int64_t nowNanos() const;
+
+  /// realtime, drifts from Timestamp::now() until recalibrate()
+  Timestamp now() const
+  {
+    return Timestamp((nowNanos() + realtimeOffsetNanos_) / 1000);
+  }
+
+  /// Not thread safe with nowNanos(), call it in the only reading thread
+  /// or before other threads start.
+  void recalibrate(double calibrateSeconds = 0.01);
+
+  static uint64_t readTsc();
+
+ private:
+  bool usingTsc_;
+  // nanos = baseNanos_ + ((tsc - baseTsc_) * mult_ >> kShift)
+  uint64_t baseTsc_;
+  int64_t baseNanos_;
+  uint64_t mult_;
+  int64_t realtimeOffsetNanos_;
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_CLOCK_H
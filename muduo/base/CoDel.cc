@@ -0,0 +1,63 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/base/CoDel.h"
+
+#include "muduo/base/Clock.h"
+
+using namespace muduo;
+
+CoDel::CoDel(double targetSeconds, double intervalSeconds)
+  : targetUs_(static_cast<int64_t>(targetSeconds * Timestamp::kMicroSecondsPerSecond)),
+    intervalUs_(static_cast<int64_t>(intervalSeconds * Timestamp::kMicroSecondsPerSecond)),
+    intervalEndUs_(0),
+    minDelayUs_(0),
+    overloadedUntilUs_(0),
+    lastMinDelayUs_(0),
+    overloadedIntervals_(0)
+{
+}
+
+void CoDel::onDequeue(int64_t sojournUs, int64_t nowUs)
+{
+  if (nowUs >= intervalEndUs_)
+  {
+    // an interval is over, judges it by its best case
+    __atomic_store_n(&lastMinDelayUs_, minDelayUs_, __ATOMIC_RELAXED);
+    if (intervalEndUs_ > 0 && minDelayUs_ > targetUs_)
+    {
+      // until one interval after the next judgement is due
+      __atomic_store_n(&overloadedUntilUs_, nowUs + 2 * intervalUs_, __ATOMIC_RELAXED);
+      __atomic_store_n(&overloadedIntervals_, overloadedIntervals_ + 1, __ATOMIC_RELAXED);
+    }
+    else
+    {
+      __atomic_store_n(&overloadedUntilUs_, 0, __ATOMIC_RELAXED);
+    }
+    intervalEndUs_ = nowUs + intervalUs_;
+    minDelayUs_ = sojournUs;
+  }
+  else if (sojournUs < minDelayUs_)
+  {
+    minDelayUs_ = sojournUs;
+  }
+}
+
+void CoDel::onEmpty()
+{
+  // no standing queue
+  minDelayUs_ = 0;
+  __atomic_store_n(&overloadedUntilUs_, 0, __ATOMIC_RELAXED);
+}
+
+bool CoDel::overloaded() const
+{
+  if (__atomic_load_n(&overloadedUntilUs_, __ATOMIC_RELAXED) == 0)
+  {
+    return false;
+  }
+  // coarse clock is good enough for an interval of 100ms
+  return overloaded(Clock::coarseNow().microSecondsSinceEpoch());
+}
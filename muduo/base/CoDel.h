@@ -0,0 +1,66 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_CODEL_H
+#define MUDUO_BASE_CODEL_H
+
+#include "muduo/base/noncopyable.h"
+
+#include <stdint.h>
+
+namespace muduo
+{
+
+///
+/// Overload detector of a task queue by queueing delay, after CoDel,
+/// Controlled Delay, RFC 8289.
+///
+/// The queue is overloaded if the minimum sojourn time of tasks
+/// stays above @c target for a whole @c interval, ie. there is a
+/// standing queue rather than a burst.  Producers check overloaded()
+/// to shed new work, instead of letting the queue and latency grow.
+///
+/// Consumer calls onDequeue() for each task, or batch of tasks, and
+/// onEmpty() when it drains the queue.  The overloaded state expires
+/// if not confirmed in two intervals, so shedding all new work
+/// can't keep it overloaded forever.
+///
+class CoDel : noncopyable
+{
+ public:
+  explicit CoDel(double targetSeconds = 0.005, double intervalSeconds = 0.1);
+
+  int64_t targetUs() const { return targetUs_; }
+  int64_t intervalUs() const { return intervalUs_; }
+
+  /// Not thread safe, called by consumer.
+  void onDequeue(int64_t sojournUs, int64_t nowUs);
+  void onEmpty();
+
+  /// Thread safe.
+  bool overloaded() const;
+  bool overloaded(int64_t nowUs) const
+  {
+    return nowUs < __atomic_load_n(&overloadedUntilUs_, __ATOMIC_RELAXED);
+  }
+
+  /// minimum sojourn time of last interval, thread safe.
+  int64_t lastMinDelayUs() const { return __atomic_load_n(&lastMinDelayUs_, __ATOMIC_RELAXED); }
+  /// number of intervals found overloaded, thread safe.
+  int64_t overloadedIntervals() const { return __atomic_load_n(&overloadedIntervals_, __ATOMIC_RELAXED); }
+
+ private:
+  const int64_t targetUs_;
+  const int64_t intervalUs_;
+  int64_t intervalEndUs_;
+  int64_t minDelayUs_;
+  int64_t overloadedUntilUs_;  // __atomic
+  int64_t lastMinDelayUs_;  // __atomic
+  int64_t overloadedIntervals_;  // __atomic
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_CODEL_H
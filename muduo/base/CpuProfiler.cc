@@ -0,0 +1,329 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/base/CpuProfiler.h"
+
+#include "muduo/base/CurrentThread.h"
+#include "muduo/base/Logging.h"
+#include "muduo/base/Timestamp.h"
+
+#include <algorithm>
+
+#include <errno.h>
+#include <inttypes.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+using namespace muduo;
+
+const int CpuProfiler::kMaxDepth;
+const int CpuProfiler::kThreadNameLength;
+const int CpuProfiler::kDefaultFrequency;
+
+namespace
+{
+
+const size_t kQueueSize = 4096;
+
+CpuProfiler* g_profiler = NULL;  // __atomic
+int g_inHandler = 0;  // __atomic
+bool g_installed = false;  // only touched by the running profiler
+
+// registers of the interrupted thread
+struct Registers
+{
+  uintptr_t pc;
+  uintptr_t fp;
+  uintptr_t sp;
+};
+
+Registers interruptedRegisters(void* context)
+{
+  const ucontext_t* uc = static_cast<const ucontext_t*>(context);
+  Registers regs = { 0, 0, 0 };
+#if defined(__x86_64__)
+  regs.pc = static_cast<uintptr_t>(uc->uc_mcontext.gregs[REG_RIP]);
+  regs.fp = static_cast<uintptr_t>(uc->uc_mcontext.gregs[REG_RBP]);
+  regs.sp = static_cast<uintptr_t>(uc->uc_mcontext.gregs[REG_RSP]);
+#elif defined(__i386__)
+  regs.pc = static_cast<uintptr_t>(uc->uc_mcontext.gregs[REG_EIP]);
+  regs.fp = static_cast<uintptr_t>(uc->uc_mcontext.gregs[REG_EBP]);
+  regs.sp = static_cast<uintptr_t>(uc->uc_mcontext.gregs[REG_ESP]);
+#elif defined(__aarch64__)
+  regs.pc = static_cast<uintptr_t>(uc->uc_mcontext.pc);
+  regs.fp = static_cast<uintptr_t>(uc->uc_mcontext.regs[29]);
+  regs.sp = static_cast<uintptr_t>(uc->uc_mcontext.sp);
+#else
+  (void)uc;
+#endif
+  return regs;
+}
+
+const uintptr_t kPageSize = 4096;
+// a frame larger than this ends the stack
+const uintptr_t kMaxFrameSize = 1024 * 1024;
+
+// async-signal-safe, as gperftools does: the kernel copies the new mask
+// before it checks how, so it fails with EFAULT only if p is not readable
+bool readable(uintptr_t p)
+{
+  return ::syscall(SYS_rt_sigprocmask, ~0, reinterpret_cast<const void*>(p), NULL, 8) == 0 ||
+         errno != EFAULT;
+}
+
+// frame pointers from the interrupted pc outwards, each frame record is
+// { saved frame pointer, return address } at the frame pointer.
+// Functions without frame pointers, eg. in libc, lose their caller or
+// end the walk, never a fault.
+int walkFrames(const Registers& regs, void** frames, int maxDepth)
+{
+  int depth = 0;
+  if (regs.pc == 0)
+  {
+    return depth;
+  }
+  frames[depth++] = reinterpret_cast<void*>(regs.pc);
+  uintptr_t fp = regs.fp;
+  uintptr_t low = regs.sp;
+  uintptr_t checkedPage = 0;
+  while (depth < maxDepth)
+  {
+    // on the stack, above the last frame, aligned, not too far away
+    if (fp < low || fp - low > kMaxFrameSize || fp % sizeof(uintptr_t) != 0)
+    {
+      break;
+    }
+    // both words of the record, one or two pages
+    const uintptr_t last = fp + 2 * sizeof(uintptr_t) - 1;
+    if ((fp & ~(kPageSize - 1)) != checkedPage && !readable(fp))
+    {
+      break;
+    }
+    if ((last & ~(kPageSize - 1)) != (fp & ~(kPageSize - 1)) && !readable(last))
+    {
+      break;
+    }
+    checkedPage = last & ~(kPageSize - 1);
+    const uintptr_t* record = reinterpret_cast<const uintptr_t*>(fp);
+    const uintptr_t next = record[0];
+    const uintptr_t returnAddress = record[1];
+    if (returnAddress == 0)
+    {
+      break;
+    }
+    frames[depth++] = reinterpret_cast<void*>(returnAddress);
+    if (next <= fp)
+    {
+      break;
+    }
+    low = fp + 2 * sizeof(uintptr_t);
+    fp = next;
+  }
+  return depth;
+}
+
+bool setTimer(int frequency)
+{
+  struct itimerval timer;
+  memZero(&timer, sizeof timer);
+  if (frequency > 0)
+  {
+    // tv_usec must be less than one second
+    const int interval = 1000 * 1000 / frequency;
+    timer.it_interval.tv_sec = interval / (1000 * 1000);
+    timer.it_interval.tv_usec = interval % (1000 * 1000);
+    timer.it_value = timer.it_interval;
+  }
+  if (::setitimer(ITIMER_PROF, &timer, NULL) < 0)
+  {
+    LOG_SYSERR << "setitimer";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+CpuProfiler::CpuProfiler(int frequency)
+  : frequency_(std::max(1, std::min(frequency, 1000))),
+    running_(false),
+    queue_(new MpmcQueue<Sample>(kQueueSize)),
+    samples_(0),
+    dropped_(0)
+{
+}
+
+CpuProfiler::~CpuProfiler()
+{
+  stop();
+}
+
+bool CpuProfiler::start()
+{
+  if (running_)
+  {
+    return true;
+  }
+  CpuProfiler* expected = NULL;
+  if (!__atomic_compare_exchange_n(&g_profiler, &expected, this, false,
+                                   __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+  {
+    return false;
+  }
+
+  if (!g_installed)
+  {
+    // stays installed, a SIGPROF pending after stop() must not kill us
+    struct sigaction sa;
+    memZero(&sa, sizeof sa);
+    sa.sa_sigaction = &CpuProfiler::handleSignal;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (::sigaction(SIGPROF, &sa, NULL) < 0)
+    {
+      LOG_SYSERR << "sigaction SIGPROF";
+      __atomic_store_n(&g_profiler, static_cast<CpuProfiler*>(NULL), __ATOMIC_SEQ_CST);
+      return false;
+    }
+    g_installed = true;
+  }
+  if (!setTimer(frequency_))
+  {
+    __atomic_store_n(&g_profiler, static_cast<CpuProfiler*>(NULL), __ATOMIC_SEQ_CST);
+    return false;
+  }
+  running_ = true;
+  return true;
+}
+
+void CpuProfiler::stop()
+{
+  if (!running_)
+  {
+    return;
+  }
+  setTimer(0);
+  __atomic_store_n(&g_profiler, static_cast<CpuProfiler*>(NULL), __ATOMIC_SEQ_CST);
+  // handlers in other threads may still be recording to us
+  while (__atomic_load_n(&g_inHandler, __ATOMIC_SEQ_CST) > 0)
+  {
+    ::sched_yield();
+  }
+  running_ = false;
+  collect();
+}
+
+void CpuProfiler::handleSignal(int, siginfo_t*, void* context)
+{
+  int savedErrno = errno;
+  __atomic_fetch_add(&g_inHandler, 1, __ATOMIC_SEQ_CST);
+  CpuProfiler* profiler = __atomic_load_n(&g_profiler, __ATOMIC_SEQ_CST);
+  if (profiler)
+  {
+    profiler->record(context);
+  }
+  __atomic_fetch_sub(&g_inHandler, 1, __ATOMIC_SEQ_CST);
+  errno = savedErrno;
+}
+
+// in signal handler, async-signal-safe only
+void CpuProfiler::record(void* context)
+{
+  void* frames[kMaxDepth];
+  const int depth = walkFrames(interruptedRegisters(context), frames, kMaxDepth);
+
+  Sample sample;
+  const char* name = CurrentThread::name();
+  int len = 0;
+  while (len < kThreadNameLength - 1 && name[len] != '\0')
+  {
+    sample.thread[len] = name[len];
+    ++len;
+  }
+  sample.thread[len] = '\0';
+  sample.depth = depth;
+  ::memcpy(sample.stack, frames, sizeof(void*) * depth);
+  if (!queue_->tryPut(sample))
+  {
+    __atomic_fetch_add(&dropped_, 1, __ATOMIC_RELAXED);
+  }
+}
+
+void CpuProfiler::collect()
+{
+  Sample sample;
+  while (queue_->tryTake(&sample))
+  {
+    Stack stack(sample.thread,
+                std::vector<void*>(sample.stack, sample.stack + sample.depth));
+    ++stacks_[stack];
+    ++samples_;
+  }
+}
+
+string CpuProfiler::folded()
+{
+  collect();
+  // stacks at different pcs of the same functions are one line
+  std::map<string, int64_t> counts;
+  for (const auto& it : stacks_)
+  {
+    const std::vector<void*>& frames = it.first.second;
+    string line = it.first.first;
+    symbolizer_.appendFolded(frames.data(), frames.size(), true, &line);
+    counts[line] += it.second;
+  }
+
+  std::vector<std::pair<int64_t, const string*>> lines;
+  lines.reserve(counts.size());
+  for (const auto& it : counts)
+  {
+    lines.push_back(std::make_pair(-it.second, &it.first));
+  }
+  std::sort(lines.begin(), lines.end(),
+            [](const std::pair<int64_t, const string*>& lhs,
+               const std::pair<int64_t, const string*>& rhs)
+            { return lhs.first < rhs.first || (lhs.first == rhs.first && *lhs.second < *rhs.second); });
+
+  string result;
+  char count[32];
+  for (const auto& line : lines)
+  {
+    snprintf(count, sizeof count, " %" PRId64 "\n", -line.first);
+    result += *line.second;
+    result += count;
+  }
+  return result;
+}
+
+string CpuProfiler::profile(double seconds, int frequency)
+{
+  CpuProfiler profiler(frequency);
+  if (!profiler.start())
+  {
+    return string();
+  }
+  Timestamp deadline = addTime(Timestamp::now(), seconds);
+  Timestamp now;
+  while ((now = Timestamp::now()) < deadline)
+  {
+    const int64_t kCollectUs = 100 * 1000;
+    int64_t remaining = deadline.microSecondsSinceEpoch() - now.microSecondsSinceEpoch();
+    CurrentThread::sleepUsec(std::min(remaining, kCollectUs));
+    profiler.collect();
+  }
+  profiler.stop();
+  if (profiler.dropped() > 0)
+  {
+    LOG_WARN << "CpuProfiler dropped " << profiler.dropped() << " of "
+             << profiler.samples() + profiler.dropped() << " samples";
+  }
+  return profiler.folded();
+}
@@ -0,0 +1,101 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_CPUPROFILER_H
+#define MUDUO_BASE_CPUPROFILER_H
+
+#include "muduo/base/MpmcQueue.h"
+#include "muduo/base/Symbolizer.h"
+#include "muduo/base/Types.h"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <signal.h>
+
+namespace muduo
+{
+
+///
+/// Sampling CPU profiler of all threads, without gperftools.
+///
+/// ITIMER_PROF sends SIGPROF for every 1/frequency second of CPU time
+/// the process uses, to the thread using it, so busy threads are
+/// sampled in proportion and idle ones not at all.  The signal handler
+/// records the thread name and the stack into a lock-free queue.
+/// collect() drains it outside of signal context, folded() names the
+/// frames with Symbolizer.
+///
+/// The stack is walked by frame pointers from the registers of the
+/// interrupted thread, checking each frame is readable and above the
+/// last one, as backtrace(3) takes locks of the unwinder and the loader
+/// and is not async-signal-safe.  muduo builds with
+/// -fno-omit-frame-pointer; a function without frame pointers, eg. of
+/// libc, loses its caller or ends the stack.
+///
+///   CpuProfiler::profile(10) returns
+///   main;...;main;muduo::net::EventLoop::loop() 42
+///
+/// one line per distinct stack, for flamegraph.pl or speedscope.
+///
+/// One CpuProfiler runs at a time in a process, and not together with
+/// gperftools' ProfilerStart(), both use ITIMER_PROF.
+///
+class CpuProfiler : noncopyable
+{
+ public:
+  static const int kMaxDepth = 64;
+  static const int kThreadNameLength = 16;
+  static const int kDefaultFrequency = 99;
+
+  explicit CpuProfiler(int frequency = kDefaultFrequency);
+  ~CpuProfiler();
+
+  /// Returns false if another CpuProfiler is running.
+  bool start();
+  void stop();
+  bool running() const { return running_; }
+
+  /// Moves samples out of the signal handler's queue, call every
+  /// 100ms or so while running, samples are dropped when it is full.
+  void collect();
+
+  /// Folded stacks of samples so far, most frequent first,
+  /// thread name then outermost frame first.
+  string folded();
+
+  int64_t samples() const { return samples_; }
+  int64_t dropped() const { return __atomic_load_n(&dropped_, __ATOMIC_RELAXED); }
+
+  /// Profiles all threads for seconds, blocking the calling thread.
+  /// Returns empty string if another CpuProfiler is running.
+  static string profile(double seconds, int frequency = kDefaultFrequency);
+
+ private:
+  struct Sample
+  {
+    char thread[kThreadNameLength];
+    int depth;
+    void* stack[kMaxDepth];
+  };
+
+  typedef std::pair<string, std::vector<void*>> Stack;
+
+  static void handleSignal(int signo, siginfo_t* info, void* context);
+  void record(void* context);
+
+  const int frequency_;
+  bool running_;
+  std::unique_ptr<MpmcQueue<Sample>> queue_;
+  std::map<Stack, int64_t> stacks_;
+  Symbolizer symbolizer_;
+  int64_t samples_;
+  int64_t dropped_;  // __atomic
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_CPUPROFILER_H
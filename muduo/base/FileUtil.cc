@@ -10,6 +10,8 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -63,6 +65,133 @@ size_t FileUtil::AppendFile::write(const char* logline, size_t len)
   return ::fwrite_unlocked(logline, 1, len, fp_);
 }
 
+FileUtil::DirectAppendFile::DirectAppendFile(StringArg filename,
+                                             size_t chunkSize,
+                                             size_t bufferSize)
+  : fd_(::open(filename.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | O_DIRECT, 0644)),
+    bufferedFd_(::open(filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)),
+    chunkSize_(chunkSize),
+    bufferSize_(bufferSize),
+    buffer_(NULL),
+    bufferLen_(0),
+    bufferOffset_(0),
+    allocated_(0),
+    writtenBytes_(0)
+{
+  assert(bufferedFd_ >= 0);
+  assert(bufferSize_ % kAlignment == 0 && bufferSize_ > 0);
+  if (fd_ < 0)
+  {
+    // tmpfs etc.
+    fd_ = ::dup(bufferedFd_);
+  }
+  void* buf = NULL;
+  int err = ::posix_memalign(&buf, kAlignment, bufferSize_);
+  assert(err == 0); (void)err;
+  buffer_ = static_cast<char*>(buf);
+
+  // appends to existing content, starting from its last block
+  struct stat st;
+  if (::fstat(bufferedFd_, &st) == 0 && st.st_size > 0)
+  {
+    bufferOffset_ = st.st_size / kAlignment * kAlignment;
+    bufferLen_ = static_cast<size_t>(st.st_size - bufferOffset_);
+    allocated_ = st.st_size;
+    if (bufferLen_ > 0 && ::pread(bufferedFd_, buffer_, bufferLen_, bufferOffset_) != static_cast<ssize_t>(bufferLen_))
+    {
+      fprintf(stderr, "DirectAppendFile::DirectAppendFile() pread failed %s\n", strerror_tl(errno));
+    }
+  }
+}
+
+FileUtil::DirectAppendFile::~DirectAppendFile()
+{
+  flush();
+  // releases preallocated blocks past the end
+  if (::ftruncate(bufferedFd_, bufferOffset_ + static_cast<off_t>(bufferLen_)) < 0)
+  {
+    fprintf(stderr, "DirectAppendFile::~DirectAppendFile() ftruncate failed %s\n", strerror_tl(errno));
+  }
+  ::close(fd_);
+  ::close(bufferedFd_);
+  ::free(buffer_);
+}
+
+void FileUtil::DirectAppendFile::append(const char* logline, size_t len)
+{
+  size_t written = 0;
+  while (written != len)
+  {
+    size_t n = std::min(len - written, bufferSize_ - bufferLen_);
+    memcpy(buffer_ + bufferLen_, logline + written, n);
+    bufferLen_ += n;
+    written += n;
+    if (bufferLen_ == bufferSize_)
+    {
+      writeBlocks(bufferSize_);
+    }
+  }
+  writtenBytes_ += written;
+}
+
+void FileUtil::DirectAppendFile::flush()
+{
+  size_t blocks = bufferLen_ / kAlignment * kAlignment;
+  if (blocks > 0)
+  {
+    writeBlocks(blocks);
+  }
+  if (bufferLen_ > 0)
+  {
+    // the partial block, written again directly once it is full
+    ssize_t n = ::pwrite(bufferedFd_, buffer_, bufferLen_, bufferOffset_);
+    if (n != static_cast<ssize_t>(bufferLen_))
+    {
+      fprintf(stderr, "DirectAppendFile::flush() failed %s\n", strerror_tl(errno));
+    }
+  }
+}
+
+// writes first len bytes of buffer, a multiple of kAlignment, keeps the rest
+void FileUtil::DirectAppendFile::writeBlocks(size_t len)
+{
+  assert(len % kAlignment == 0 && len <= bufferLen_);
+  preallocate(bufferOffset_ + static_cast<off_t>(len));
+  size_t written = 0;
+  while (written < len)
+  {
+    ssize_t n = ::pwrite(fd_, buffer_ + written, len - written, bufferOffset_ + static_cast<off_t>(written));
+    if (n <= 0)
+    {
+      if (n < 0 && errno == EINTR)
+        continue;
+      fprintf(stderr, "DirectAppendFile::writeBlocks() failed %s\n", strerror_tl(errno));
+      break;
+    }
+    written += n;
+  }
+  // drops what failed, as AppendFile does
+  bufferOffset_ += static_cast<off_t>(len);
+  bufferLen_ -= len;
+  memmove(buffer_, buffer_ + len, bufferLen_);
+}
+
+void FileUtil::DirectAppendFile::preallocate(off_t end)
+{
+  if (end <= allocated_)
+    return;
+  const off_t chunk = static_cast<off_t>(chunkSize_);
+  off_t newAllocated = (end + chunk - 1) / chunk * chunk;
+  // keeps file size, readers never see the zeros
+  if (::fallocate(fd_, FALLOC_FL_KEEP_SIZE, allocated_, newAllocated - allocated_) < 0 &&
+      errno != EOPNOTSUPP && errno != ENOSYS)
+  {
+    fprintf(stderr, "DirectAppendFile::preallocate() failed %s\n", strerror_tl(errno));
+  }
+  // not again on failure, write() reports ENOSPC
+  allocated_ = newAllocated;
+}
+
 FileUtil::ReadSmallFile::ReadSmallFile(StringArg filename)
   : fd_(::open(filename.c_str(), O_RDONLY | O_CLOEXEC)),
     err_(0)
@@ -55,7 +55,16 @@ class GzipFile : noncopyable
   off_t offset() const { return ::gzoffset(file_); }
 #endif
 
-  // int flush(int f) { return ::gzflush(file_, f); }
+  // Z_SYNC_FLUSH makes what's written so far decompressible
+  int flush(int f) { return ::gzflush(file_, f); }
+
+  // Z_OK if all is written, the destructor closes without checking
+  int close()
+  {
+    int result = ::gzclose(file_);
+    file_ = NULL;
+    return result;
+  }
 
   static GzipFile openForRead(StringArg filename)
   {
@@ -77,6 +86,14 @@ class GzipFile : noncopyable
     return GzipFile(::gzopen(filename.c_str(), "wbe"));
   }
 
+  // level 1 (fastest) to 9 (best)
+  static GzipFile openForWriteExclusive(StringArg filename, int level)
+  {
+    char mode[] = "wbxe0";
+    mode[4] = static_cast<char>('0' + level);
+    return GzipFile(::gzopen(filename.c_str(), mode));
+  }
+
  private:
   explicit GzipFile(gzFile file)
     : file_(file)
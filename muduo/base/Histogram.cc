@@ -0,0 +1,69 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/base/Histogram.h"
+
+#include <stdlib.h>
+
+using namespace muduo;
+
+namespace
+{
+
+const int64_t kNoMin = std::numeric_limits<int64_t>::max();
+const int64_t kNoMax = std::numeric_limits<int64_t>::min();
+
+}  // namespace
+
+Histogram::Histogram()
+  : mask_(detail::shardCount() - 1),
+    shards_(static_cast<Shard*>(detail::allocateShards(sizeof(Shard) * (mask_ + 1))))
+{
+  static_assert(sizeof(Shard) % kCacheLineSize == 0, "shards start at cache lines");
+  for (int i = 0; i <= mask_; ++i)
+  {
+    shards_[i].min = kNoMin;
+    shards_[i].max = kNoMax;
+  }
+}
+
+Histogram::~Histogram()
+{
+  ::free(shards_);
+}
+
+void Histogram::updateMinMax(Shard* shard, int64_t value)
+{
+  int64_t min = __atomic_load_n(&shard->min, __ATOMIC_RELAXED);
+  while (value < min
+         && !__atomic_compare_exchange_n(&shard->min, &min, value, true,
+                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+  {
+  }
+  int64_t max = __atomic_load_n(&shard->max, __ATOMIC_RELAXED);
+  while (value > max
+         && !__atomic_compare_exchange_n(&shard->max, &max, value, true,
+                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+  {
+  }
+}
+
+HistogramSnapshot Histogram::snapshot() const
+{
+  HistogramSnapshot result;
+  for (int i = 0; i <= mask_; ++i)
+  {
+    const Shard& shard = shards_[i];
+    for (int j = 0; j < HistogramSnapshot::kNumBuckets; ++j)
+    {
+      result.buckets_[j] += __atomic_load_n(&shard.buckets[j], __ATOMIC_RELAXED);
+    }
+    result.count_ += __atomic_load_n(&shard.count, __ATOMIC_RELAXED);
+    result.sum_ += __atomic_load_n(&shard.sum, __ATOMIC_RELAXED);
+    result.min_ = std::min(result.min_, __atomic_load_n(&shard.min, __ATOMIC_RELAXED));
+    result.max_ = std::max(result.max_, __atomic_load_n(&shard.max, __ATOMIC_RELAXED));
+  }
+  return result;
+}
@@ -0,0 +1,221 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_HISTOGRAM_H
+#define MUDUO_BASE_HISTOGRAM_H
+
+#include "muduo/base/ShardedCounter.h"
+#include "muduo/base/copyable.h"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include <math.h>
+
+namespace muduo
+{
+
+///
+/// Log-linear histogram of non-negative integers, eg. latency in us.
+///
+/// Each power of two is split into 2^SubBucketBits linear buckets, so
+/// bucket width is at most 1/2^SubBucketBits of its values, from 0 up
+/// to kMaxValue.  Larger values are counted in the last bucket, negative
+/// ones in the first.  Snapshots of the same layout merge by adding
+/// buckets, across threads, loops or processes.
+///
+/// HistogramSnapshot, 1/16, is what Histogram and MetricsRegistry use,
+/// a load generator may keep 1/128 with BasicHistogramSnapshot<7>, for
+/// four times the memory and more buckets to walk.
+///
+/// Not thread safe, see Histogram.
+///
+template<int SubBucketBits>
+class BasicHistogramSnapshot : public copyable
+{
+ public:
+  static const int kSubBucketBits = SubBucketBits;
+  static const int kSubBuckets = 1 << kSubBucketBits;
+  static const int kMaxValueBits = 40;
+  static const int64_t kMaxValue = (int64_t(1) << kMaxValueBits) - 1;
+  static const int kNumBuckets = (kMaxValueBits - kSubBucketBits + 1) * kSubBuckets;
+
+  BasicHistogramSnapshot()
+    : buckets_(kNumBuckets),
+      count_(0),
+      sum_(0),
+      min_(std::numeric_limits<int64_t>::max()),
+      max_(std::numeric_limits<int64_t>::min())
+  {
+  }
+
+  void record(int64_t value)
+  {
+    ++buckets_[bucketIndex(value)];
+    ++count_;
+    sum_ += value;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+  }
+
+  void merge(const BasicHistogramSnapshot& rhs)
+  {
+    for (int i = 0; i < kNumBuckets; ++i)
+    {
+      buckets_[i] += rhs.buckets_[i];
+    }
+    count_ += rhs.count_;
+    sum_ += rhs.sum_;
+    min_ = std::min(min_, rhs.min_);
+    max_ = std::max(max_, rhs.max_);
+  }
+
+  int64_t count() const { return count_; }
+  int64_t sum() const { return sum_; }
+  /// exact, 0 if empty
+  int64_t min() const { return count_ > 0 ? min_ : 0; }
+  int64_t max() const { return count_ > 0 ? max_ : 0; }
+  double mean() const { return count_ > 0 ? static_cast<double>(sum_) / static_cast<double>(count_) : 0.0; }
+
+  /// Upper bound of the bucket holding the nearest rank, within [min, max].
+  /// percent in [0, 100].
+  int64_t percentile(double percent) const
+  {
+    if (count_ == 0)
+    {
+      return 0;
+    }
+    // the nearest rank method, as examples/sudoku/percentile.h
+    int64_t rank = static_cast<int64_t>(ceil(percent / 100 * static_cast<double>(count_)));
+    rank = std::max(rank, int64_t(1));
+    int64_t seen = 0;
+    for (int i = 0; i < kNumBuckets; ++i)
+    {
+      seen += buckets_[i];
+      if (seen >= rank)
+      {
+        return std::max(min_, std::min(max_, bucketUpperBound(i)));
+      }
+    }
+    // snapshot of a Histogram being recorded
+    return max_;
+  }
+
+  int64_t bucketCount(int index) const { return buckets_[index]; }
+
+  static int bucketIndex(int64_t value)
+  {
+    if (value < 2 * kSubBuckets)
+    {
+      return value < 0 ? 0 : static_cast<int>(value);
+    }
+    if (value > kMaxValue)
+    {
+      value = kMaxValue;
+    }
+    int shift = 63 - __builtin_clzll(static_cast<uint64_t>(value)) - kSubBucketBits;
+    return (shift + 1) * kSubBuckets + static_cast<int>((value >> shift) & (kSubBuckets - 1));
+  }
+
+  static int64_t bucketLowerBound(int index)
+  {
+    if (index < 2 * kSubBuckets)
+    {
+      return index;
+    }
+    int shift = index / kSubBuckets - 1;
+    return static_cast<int64_t>(kSubBuckets + index % kSubBuckets) << shift;
+  }
+
+  /// inclusive
+  static int64_t bucketUpperBound(int index)
+  {
+    if (index < 2 * kSubBuckets)
+    {
+      return index;
+    }
+    int shift = index / kSubBuckets - 1;
+    return bucketLowerBound(index) + (int64_t(1) << shift) - 1;
+  }
+
+ private:
+  friend class Histogram;
+
+  std::vector<int64_t> buckets_;
+  int64_t count_;
+  int64_t sum_;
+  int64_t min_;
+  int64_t max_;
+};
+
+template<int SubBucketBits>
+const int BasicHistogramSnapshot<SubBucketBits>::kSubBucketBits;
+template<int SubBucketBits>
+const int BasicHistogramSnapshot<SubBucketBits>::kSubBuckets;
+template<int SubBucketBits>
+const int BasicHistogramSnapshot<SubBucketBits>::kMaxValueBits;
+template<int SubBucketBits>
+const int64_t BasicHistogramSnapshot<SubBucketBits>::kMaxValue;
+template<int SubBucketBits>
+const int BasicHistogramSnapshot<SubBucketBits>::kNumBuckets;
+
+typedef BasicHistogramSnapshot<4> HistogramSnapshot;
+
+///
+/// HistogramSnapshot that many threads record to, eg. request latency
+/// of all loops.
+///
+/// Like ShardedCounter, threads record to their own shard, snapshot()
+/// merges all shards.  A snapshot taken while threads are recording
+/// may miss some of them, or count a value but not yet its bucket.
+///
+/// Thread safe.
+///
+class Histogram : noncopyable
+{
+ public:
+  Histogram();
+  ~Histogram();
+
+  void record(int64_t value)
+  {
+    Shard& shard = shards_[detail::shardIndex() & mask_];
+    __atomic_fetch_add(&shard.buckets[HistogramSnapshot::bucketIndex(value)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&shard.count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&shard.sum, value, __ATOMIC_RELAXED);
+    if (value < __atomic_load_n(&shard.min, __ATOMIC_RELAXED)
+        || value > __atomic_load_n(&shard.max, __ATOMIC_RELAXED))
+    {
+      updateMinMax(&shard, value);
+    }
+  }
+
+  HistogramSnapshot snapshot() const;
+
+ private:
+  static const size_t kCacheLineSize = 64;
+  static const size_t kShardBytes = (4 + HistogramSnapshot::kNumBuckets) * sizeof(int64_t);
+
+  struct Shard
+  {
+    int64_t count;  // __atomic
+    int64_t sum;  // __atomic
+    int64_t min;  // __atomic
+    int64_t max;  // __atomic
+    int64_t buckets[HistogramSnapshot::kNumBuckets];  // __atomic
+    // whole cache lines, the last one is not shared with next shard
+    char pad[kCacheLineSize - kShardBytes % kCacheLineSize];
+  };
+
+  static void updateMinMax(Shard* shard, int64_t value);
+
+  const int mask_;
+  Shard* const shards_;
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_HISTOGRAM_H
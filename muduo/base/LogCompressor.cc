@@ -0,0 +1,193 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/base/LogCompressor.h"
+
+#include "muduo/base/Clock.h"
+#include "muduo/base/GzipFile.h"
+#include "muduo/base/Logging.h"
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace muduo;
+
+namespace
+{
+
+int levelOf(LogCompressor::Codec codec)
+{
+  return codec == LogCompressor::kGzipFast ? 1 : 6;
+}
+
+class GzipWriter : public LogFile::Writer
+{
+ public:
+  explicit GzipWriter(GzipFile file)
+    : file_(std::move(file))
+  {
+  }
+
+  void append(const char* logline, size_t len) override
+  {
+    int n = file_.write(StringPiece(logline, static_cast<int>(len)));
+    if (n != static_cast<int>(len))
+    {
+      fprintf(stderr, "GzipWriter::append() failed %d\n", n);
+    }
+  }
+
+  void flush() override
+  {
+    file_.flush(Z_SYNC_FLUSH);
+  }
+
+  off_t writtenBytes() const override
+  {
+    return file_.offset();
+  }
+
+ private:
+  GzipFile file_;
+};
+
+}  // namespace
+
+LogCompressor::LogCompressor(Codec codec, double cpuShare)
+  : codec_(codec),
+    cpuShare_(cpuShare),
+    running_(false),
+    thread_(std::bind(&LogCompressor::threadFunc, this), "LogCompressor"),
+    compressedFiles_(0),
+    inputBytes_(0),
+    outputBytes_(0)
+{
+  assert(0 < cpuShare && cpuShare <= 1.0);
+}
+
+LogCompressor::~LogCompressor()
+{
+  if (running_)
+  {
+    stop();
+  }
+}
+
+void LogCompressor::start()
+{
+  assert(!running_);
+  running_ = true;
+  thread_.start();
+}
+
+void LogCompressor::stop()
+{
+  assert(running_);
+  running_ = false;
+  queue_.put(string());  // quits after pending files
+  thread_.join();
+}
+
+void LogCompressor::compress(const string& filename)
+{
+  assert(!filename.empty());
+  queue_.put(filename);
+}
+
+void LogCompressor::threadFunc()
+{
+  while (true)
+  {
+    string filename(queue_.take());
+    if (filename.empty())
+    {
+      break;
+    }
+    struct stat st;
+    int64_t inputBytes = ::stat(filename.c_str(), &st) == 0 ? st.st_size : 0;
+    int64_t outputBytes = compressFile(filename, codec_, cpuShare_);
+    if (outputBytes >= 0)
+    {
+      __atomic_store_n(&compressedFiles_, compressedFiles_ + 1, __ATOMIC_RELAXED);
+      __atomic_store_n(&inputBytes_, inputBytes_ + inputBytes, __ATOMIC_RELAXED);
+      __atomic_store_n(&outputBytes_, outputBytes_ + outputBytes, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+int64_t LogCompressor::compressFile(const string& filename, Codec codec, double cpuShare)
+{
+  FILE* in = ::fopen(filename.c_str(), "rbe");
+  if (in == NULL)
+  {
+    LOG_SYSERR << "LogCompressor cannot open " << filename;
+    return -1;
+  }
+  const string gzname = filename + ".gz";
+  bool ok = true;
+  int64_t outputBytes = 0;
+  {
+    GzipFile out = GzipFile::openForWriteExclusive(gzname, levelOf(codec));
+    if (!out.valid())
+    {
+      LOG_SYSERR << "LogCompressor cannot create " << gzname;
+      ::fclose(in);
+      return -1;
+    }
+
+    const size_t kChunkSize = 256 * 1024;
+    std::unique_ptr<char[]> buf(new char[kChunkSize]);
+    size_t n = 0;
+    while (ok && (n = ::fread(buf.get(), 1, kChunkSize, in)) > 0)
+    {
+      int64_t start = Clock::monotonicNanos();
+      ok = out.write(StringPiece(buf.get(), static_cast<int>(n))) == static_cast<int>(n);
+      if (cpuShare < 1.0)
+      {
+        // works for spent, sleeps for the rest
+        int64_t spent = Clock::monotonicNanos() - start;
+        int64_t sleepNanos = static_cast<int64_t>(static_cast<double>(spent) * (1.0 - cpuShare) / cpuShare);
+        struct timespec ts = { static_cast<time_t>(sleepNanos / 1000000000),
+                               static_cast<long>(sleepNanos % 1000000000) };
+        ::nanosleep(&ts, NULL);
+      }
+    }
+    ok = ok && !::ferror(in);
+    if (ok)
+    {
+      // finishes the stream, so offset() counts the trailer
+      ok = out.flush(Z_FINISH) == Z_OK;
+      outputBytes = out.offset();
+      // the original is removed only if gzname is complete on disk
+      ok = out.close() == Z_OK && ok;
+    }
+  }
+  ::fclose(in);
+
+  if (ok)
+  {
+    ::unlink(filename.c_str());
+    return outputBytes;
+  }
+  else
+  {
+    LOG_ERROR << "LogCompressor failed to compress " << filename;
+    ::unlink(gzname.c_str());
+    return -1;
+  }
+}
+
+std::unique_ptr<LogFile::Writer> LogCompressor::newGzipFile(const string& filename, Codec codec)
+{
+  const string gzname = filename + ".gz";
+  GzipFile file = GzipFile::openForWriteExclusive(gzname, levelOf(codec));
+  if (!file.valid())
+  {
+    LOG_SYSFATAL << "LogCompressor cannot create " << gzname;
+  }
+  return std::unique_ptr<LogFile::Writer>(new GzipWriter(std::move(file)));
+}
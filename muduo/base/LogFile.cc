@@ -14,20 +14,68 @@
 
 using namespace muduo;
 
+namespace
+{
+
+template<typename File>
+class AppendFileWriter : public LogFile::Writer
+{
+ public:
+  explicit AppendFileWriter(const string& filename)
+    : file_(filename)
+  {
+  }
+
+  void append(const char* logline, size_t len) override
+  {
+    file_.append(logline, len);
+  }
+
+  void flush() override
+  {
+    file_.flush();
+  }
+
+  off_t writtenBytes() const override
+  {
+    return file_.writtenBytes();
+  }
+
+ private:
+  File file_;
+};
+
+}  // namespace
+
+LogFile::Writer::~Writer() = default;
+
+std::unique_ptr<LogFile::Writer> LogFile::newAppendFile(const string& filename)
+{
+  return std::unique_ptr<Writer>(new AppendFileWriter<FileUtil::AppendFile>(filename));
+}
+
+std::unique_ptr<LogFile::Writer> LogFile::newDirectFile(const string& filename)
+{
+  return std::unique_ptr<Writer>(new AppendFileWriter<FileUtil::DirectAppendFile>(filename));
+}
+
 LogFile::LogFile(const string& basename,
                  off_t rollSize, // 自定义rollsize大小
                  bool threadSafe,
                  int flushInterval,//LogFile::flush()调用间隔
-                 int checkEveryN)
+                 int checkEveryN,
+                 const WriterFactory& factory)
   : basename_(basename),
     rollSize_(rollSize),
     flushInterval_(flushInterval),
     checkEveryN_(checkEveryN),
     count_(0),
+    numFiles_(0),
     mutex_(threadSafe ? new MutexLock : NULL),//需要线程安全则new MutexLock
     startOfPeriod_(0),
     lastRoll_(0),
-    lastFlush_(0)
+    lastFlush_(0),
+    factory_(factory ? factory : WriterFactory(&LogFile::newAppendFile))
 {
   //确保basename没有'/'，保证basename只是当下路径的文件
   assert(basename.find('/') == string::npos);
@@ -67,7 +115,7 @@ void LogFile::flush()
 void LogFile::append_unlocked(const char* logline, int len)
 {
   // FileUtil::AppendFile::append -> FileUtil::AppendFile::write -> ::fwrite_unlocked
-  file_->append(logline, len);
+  file_->append(logline, static_cast<size_t>(len));
   // 如果AppendFile已写入的字节 > 自己定义的rollSize_,则调用rollFile
   if (file_->writtenBytes() > rollSize_)
   {
@@ -109,7 +157,15 @@ bool LogFile::rollFile()
     lastRoll_ = now;
     lastFlush_ = now;
     startOfPeriod_ = start;
-    file_.reset(new FileUtil::AppendFile(filename));
+    string rolled;
+    rolled.swap(filename_);
+    filename_ = filename;
+    file_ = factory_(filename);
+    ++numFiles_;
+    if (rollCallback_ && !rolled.empty())
+    {
+      rollCallback_(rolled);
+    }
     return true;
   }
   return false;
@@ -9,6 +9,7 @@
 #include "muduo/base/Mutex.h"
 #include "muduo/base/Types.h"
 
+#include <functional>
 #include <memory>
 
 namespace muduo
@@ -22,17 +23,48 @@ class AppendFile;
 class LogFile : noncopyable
 {
  public:
+  ///
+  /// Where lines of a log file go, FileUtil::AppendFile by default.
+  ///
+  class Writer : noncopyable
+  {
+   public:
+    virtual ~Writer();
+    virtual void append(const char* logline, size_t len) = 0;
+    virtual void flush() = 0;
+    /// bytes on disk, for rollSize
+    virtual off_t writtenBytes() const = 0;
+  };
+
+  /// Opens a new file of given name, may add a suffix, eg. ".gz".
+  typedef std::function<std::unique_ptr<Writer>(const string& filename)> WriterFactory;
+  /// Called with name of the previous file after it is rolled and closed.
+  typedef std::function<void(const string& filename)> RollCallback;
+
   LogFile(const string& basename,
           off_t rollSize,
           bool threadSafe = true,
           int flushInterval = 3,
-          int checkEveryN = 1024);
+          int checkEveryN = 1024,
+          const WriterFactory& factory = WriterFactory());
   ~LogFile();
 
   void append(const char* logline, int len);
   void flush();
   bool rollFile();
 
+  void setRollCallback(const RollCallback& cb)
+  { rollCallback_ = cb; }
+
+  /// Number of files opened, changes after the file rolls.
+  /// A file rolls only at the end of append(), so what a writer puts
+  /// before its next append() heads the new file.
+  int64_t numFiles() const { return numFiles_; }
+
+  static std::unique_ptr<Writer> newAppendFile(const string& filename);
+  /// FileUtil::DirectAppendFile, O_DIRECT to preallocated space.
+  static std::unique_ptr<Writer> newDirectFile(const string& filename);
+
  private:
   void append_unlocked(const char* logline, int len);
 
@@ -44,12 +76,16 @@ class LogFile : noncopyable
   const int checkEveryN_;
 
   int count_;
+  int64_t numFiles_;
 
   std::unique_ptr<MutexLock> mutex_;
   time_t startOfPeriod_;
   time_t lastRoll_;
   time_t lastFlush_;
-  std::unique_ptr<FileUtil::AppendFile> file_;
+  const WriterFactory factory_;
+  RollCallback rollCallback_;
+  string filename_;
+  std::unique_ptr<Writer> file_;
 
   const static int kRollPerSeconds_ = 60*60*24;
 };
@@ -6,6 +6,7 @@
 #include "muduo/base/LogStream.h"
 
 #include <algorithm>
+#include <cmath>
 #include <limits>
 #include <type_traits>
 #include <assert.h>
@@ -23,7 +24,6 @@
 using namespace muduo;
 using namespace muduo::detail;
 
-// TODO: better itoa.
 #if defined(__clang__)
 #pragma clang diagnostic ignored "-Wtautological-compare"
 #else
@@ -35,38 +35,92 @@ namespace muduo
 namespace detail
 {
 
-const char digits[] = "9876543210123456789";
-const char* zero = digits + 9;
-static_assert(sizeof(digits) == 20, "wrong number of digits");
-
 const char digitsHex[] = "0123456789ABCDEF";
 static_assert(sizeof digitsHex == 17, "wrong number of digitsHex");
 
-// Efficient Integer to String Conversions, by Matthew Wilson.
-template<typename T>
-size_t convert(char buf[], T value)
+const char digitPairs[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+static_assert(sizeof digitPairs == 201, "wrong number of digitPairs");
+
+// exactly representable powers of 10
+const double kPow10[] =
 {
-  T i = value;
-  char* p = buf;
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+  1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+  1e21, 1e22,
+};
 
-  do
+const int kMaxFastPrecision = 14;
+
+bool scaleByPow10(double a, int k, double* scaled)
+{
+  if (k > 22 || k < -22)
+    return false;
+  *scaled = k >= 0 ? a * kPow10[k] : a / kPow10[-k];
+  return true;
+}
+
+int countDigits(uint64_t v)
+{
+  int n = 1;
+  while (true)
   {
-    int lsd = static_cast<int>(i % 10);
-    i /= 10;
-    /* 
-       const char digits[] = "9876543210123456789";
-       const char* zero = digits + 9;
-    */ 
-    *p++ = zero[lsd];
-  } while (i != 0);
+    if (v < 10) return n;
+    if (v < 100) return n + 1;
+    if (v < 1000) return n + 2;
+    if (v < 10000) return n + 3;
+    v /= 10000;
+    n += 4;
+  }
+}
+
+// writes digits of v backwards from end, two at a time
+void writeDigits(char* end, uint64_t v)
+{
+  while (v >= 100)
+  {
+    size_t i = static_cast<size_t>(v % 100) * 2;
+    v /= 100;
+    end -= 2;
+    memcpy(end, digitPairs + i, 2);
+  }
+  if (v >= 10)
+  {
+    memcpy(end - 2, digitPairs + v * 2, 2);
+  }
+  else
+  {
+    end[-1] = static_cast<char>('0' + v);
+  }
+}
 
+// Efficient Integer to String Conversions, by Matthew Wilson,
+// with two digits per division as in Andrei Alexandrescu's
+// "Three Optimization Tips for C++".
+template<typename T>
+size_t convert(char buf[], T value)
+{
+  typedef typename std::make_unsigned<T>::type U;
+  U i = static_cast<U>(value);
+  char* p = buf;
   if (value < 0)
   {
     *p++ = '-';
+    i = static_cast<U>(0 - i);
   }
+  int n = countDigits(i);
+  writeDigits(p + n, i);
+  p += n;
   *p = '\0';
-  std::reverse(buf, p);
-
   return p - buf;
 }
 
@@ -88,6 +142,126 @@ size_t convertHex(char buf[], uintptr_t value)
   return p - buf;
 }
 
+//
+// Same as snprintf(buf, size, "%.<precision>g", v).
+//
+// Scales v to an integer of precision digits with one multiplication
+// or division by an exact power of 10, which is off by less than
+// 10^precision * 2^-53.  Rounds it unless it is that close to a tie,
+// falls back to snprintf() for ties, tiny, huge and non-finite numbers,
+// so the output is always the same as printf.
+//
+int formatDouble(char* buf, size_t size, double v, int precision)
+{
+  const int P = precision == 0 ? 1 : precision;
+  const double a = std::fabs(v);
+  if (P < 0 || P > kMaxFastPrecision || size < 32 || !std::isfinite(a))
+  {
+    return snprintf(buf, size, "%.*g", precision, v);
+  }
+
+  char* p = buf;
+  if (std::signbit(v))
+  {
+    *p++ = '-';
+  }
+  if (a == 0)
+  {
+    *p++ = '0';
+    *p = '\0';
+    return static_cast<int>(p - buf);
+  }
+
+  // 10^e <= a < 10^(e+1), the estimate from binary exponent may be one less
+  int binaryExp = 0;
+  std::frexp(a, &binaryExp);
+  int e = static_cast<int>(std::floor((binaryExp - 1) * 0.30102999566398114));
+  double scaled = 0;
+  if (!scaleByPow10(a, P - 1 - e, &scaled))
+  {
+    return snprintf(buf, size, "%.*g", precision, v);
+  }
+  if (scaled >= kPow10[P])
+  {
+    ++e;
+    if (!scaleByPow10(a, P - 1 - e, &scaled))
+    {
+      return snprintf(buf, size, "%.*g", precision, v);
+    }
+  }
+
+  const double margin = kPow10[P] * 1e-15;
+  const double integral = std::floor(scaled);
+  const double frac = scaled - integral;
+  if (std::fabs(frac - 0.5) < margin)
+  {
+    return snprintf(buf, size, "%.*g", precision, v);
+  }
+  uint64_t r = static_cast<uint64_t>(integral) + (frac > 0.5 ? 1 : 0);
+  if (r >= static_cast<uint64_t>(kPow10[P]))
+  {
+    r /= 10;
+    ++e;
+  }
+
+  char digits[kMaxFastPrecision];
+  writeDigits(digits + P, r);
+  int n = P;  // without trailing zeros
+  while (n > 1 && digits[n-1] == '0')
+  {
+    --n;
+  }
+
+  if (e < -4 || e >= P)
+  {
+    // d.ddde+XX
+    *p++ = digits[0];
+    if (n > 1)
+    {
+      *p++ = '.';
+      memcpy(p, digits + 1, n - 1);
+      p += n - 1;
+    }
+    *p++ = 'e';
+    *p++ = e < 0 ? '-' : '+';
+    int x = e < 0 ? -e : e;
+    if (x >= 100)
+    {
+      *p++ = static_cast<char>('0' + x / 100);
+      x %= 100;
+    }
+    memcpy(p, digitPairs + x * 2, 2);
+    p += 2;
+  }
+  else if (e >= 0)
+  {
+    // ddd.ddd
+    const int intDigits = e + 1;
+    memcpy(p, digits, intDigits);
+    p += intDigits;
+    if (n > intDigits)
+    {
+      *p++ = '.';
+      memcpy(p, digits + intDigits, n - intDigits);
+      p += n - intDigits;
+    }
+  }
+  else
+  {
+    // 0.000ddd
+    *p++ = '0';
+    *p++ = '.';
+    for (int i = -1; i > e; --i)
+    {
+      *p++ = '0';
+    }
+    memcpy(p, digits, n);
+    p += n;
+  }
+  *p = '\0';
+  return static_cast<int>(p - buf);
+}
+
 template class FixedBuffer<kSmallBuffer>;
 template class FixedBuffer<kLargeBuffer>;
 
@@ -239,6 +413,15 @@ void LogStream::staticCheck()
 
 template<typename T>
 void LogStream::formatInteger(T v)
+{
+  if (beginText())
+  {
+    appendInteger(v);
+  }
+}
+
+template<typename T>
+void LogStream::appendInteger(T v)
 {
   if (buffer_.avail() >= kMaxNumericSize)
   {
@@ -248,6 +431,217 @@ void LogStream::formatInteger(T v)
   }
 }
 
+void LogStream::appendDouble(double v)
+{
+  if (buffer_.avail() >= kMaxNumericSize)
+  {
+    int len = formatDouble(buffer_.current(), kMaxNumericSize, v, 12);
+    buffer_.add(len);
+  }
+}
+
+namespace
+{
+
+// escapes as JSON strings do, needs 6 * len bytes
+char* escape(char* p, const char* data, size_t len)
+{
+  for (size_t i = 0; i < len; ++i)
+  {
+    unsigned char c = static_cast<unsigned char>(data[i]);
+    if (c >= 0x20 && c != '"' && c != '\\')
+    {
+      *p++ = static_cast<char>(c);
+      continue;
+    }
+    *p++ = '\\';
+    switch (c)
+    {
+      case '"': *p++ = '"'; break;
+      case '\\': *p++ = '\\'; break;
+      case '\n': *p++ = 'n'; break;
+      case '\r': *p++ = 'r'; break;
+      case '\t': *p++ = 't'; break;
+      case '\b': *p++ = 'b'; break;
+      case '\f': *p++ = 'f'; break;
+      default:
+        memcpy(p, "u00", 3);
+        p[3] = digitsHex[c >> 4];
+        p[4] = digitsHex[c & 0xf];
+        p += 5;
+        break;
+    }
+  }
+  return p;
+}
+
+// escapes a prefix of data into [p, end), a character of UTF-8 or an
+// escape sequence is never split, returns end of output
+char* escapePrefix(char* p, const char* end, const char* data, size_t len)
+{
+  size_t i = 0;
+  for (; i < len; ++i)
+  {
+    char escaped[6];
+    size_t n = static_cast<size_t>(escape(escaped, data + i, 1) - escaped);
+    if (n > static_cast<size_t>(end - p))
+      break;
+    memcpy(p, escaped, n);
+    p += n;
+  }
+  // bytes of UTF-8 are not escaped, one byte each in output
+  if (i < len && (static_cast<unsigned char>(data[i]) & 0xC0) == 0x80)
+  {
+    while (i > 0 && (static_cast<unsigned char>(data[i - 1]) & 0xC0) == 0x80)
+    {
+      --i;
+      --p;
+    }
+    if (i > 0 && (static_cast<unsigned char>(data[i - 1]) & 0xC0) == 0xC0)
+    {
+      --i;
+      --p;
+    }
+  }
+  return p;
+}
+
+// logfmt quotes values with spaces, quotes, '=' and control characters
+bool needsQuote(StringPiece s)
+{
+  if (s.empty())
+    return true;
+  for (int i = 0; i < s.size(); ++i)
+  {
+    unsigned char c = static_cast<unsigned char>(s[i]);
+    if (c <= ' ' || c == '"' || c == '=' || c == 0x7f)
+      return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+void LogStream::appendEscaped(const char* data, size_t len)
+{
+  const size_t avail = implicit_cast<size_t>(buffer_.avail());
+  char* start = buffer_.current();
+  if (avail > 6 * len + kJsonReserve)
+  {
+    buffer_.add(escape(start, data, len) - start);
+  }
+  else if (avail > kJsonReserve)
+  {
+    // truncates, keeps room to close the record
+    buffer_.add(escapePrefix(start, start + avail - kJsonReserve - 1, data, len) - start);
+  }
+}
+
+const int LogStream::kJsonReserve;
+
+void LogStream::beginJsonText()
+{
+  // keys are unique, a second "msg" is not valid for many parsers
+  char member[32];
+  int len = textMembers_ == 0
+      ? snprintf(member, sizeof member, ",\"msg\":\"")
+      : snprintf(member, sizeof member, ",\"msg%d\":\"", textMembers_ + 1);
+  if (buffer_.avail() > len + kJsonReserve)
+  {
+    buffer_.append(member, len);
+    inText_ = true;
+    ++textMembers_;
+  }
+}
+
+LogStream& LogStream::operator<<(const LogField& field)
+{
+  const StringPiece key = field.key();
+  const StringPiece str = field.type() == LogField::kString ? field.stringValue() : StringPiece();
+  // closes "msg" even if the field is dropped
+  endText();
+  // drops the field if it may not fit, as FixedBuffer::append() does
+  const size_t maxLen = 6 * static_cast<size_t>(key.size() + str.size()) + kMaxNumericSize + 8
+                        + (format_ == kJson ? kJsonReserve : 0);
+  if (implicit_cast<size_t>(buffer_.avail()) <= maxLen)
+  {
+    return *this;
+  }
+
+  char* const start = buffer_.current();
+  char* p = start;
+  const char last = buffer_.length() > 0 ? start[-1] : '\0';
+  if (format_ == kText)
+  {
+    if (last != ' ' && last != '\0')
+    {
+      *p++ = ' ';
+    }
+    memcpy(p, key.data(), key.size());
+    p += key.size();
+    *p++ = '=';
+  }
+  else
+  {
+    if (last != '{')
+    {
+      *p++ = ',';
+    }
+    *p++ = '"';
+    p = escape(p, key.data(), key.size());
+    *p++ = '"';
+    *p++ = ':';
+  }
+
+  switch (field.type())
+  {
+    case LogField::kInt:
+      p += convert(p, field.intValue());
+      break;
+    case LogField::kUint:
+      p += convert(p, field.uintValue());
+      break;
+    case LogField::kDouble:
+      if (format_ == kJson && !std::isfinite(field.doubleValue()))
+      {
+        memcpy(p, "null", 4);
+        p += 4;
+      }
+      else
+      {
+        p += formatDouble(p, kMaxNumericSize, field.doubleValue(), 12);
+      }
+      break;
+    case LogField::kBool:
+      if (field.boolValue())
+      {
+        memcpy(p, "true", 4);
+        p += 4;
+      }
+      else
+      {
+        memcpy(p, "false", 5);
+        p += 5;
+      }
+      break;
+    case LogField::kString:
+      if (format_ == kJson || needsQuote(str))
+      {
+        *p++ = '"';
+        p = escape(p, str.data(), str.size());
+        *p++ = '"';
+      }
+      else
+      {
+        memcpy(p, str.data(), str.size());
+        p += str.size();
+      }
+      break;
+  }
+  buffer_.add(p - start);
+  return *this;
+}
+
 LogStream& LogStream::operator<<(short v)
 {
   *this << static_cast<int>(v);
@@ -298,6 +692,10 @@ LogStream& LogStream::operator<<(unsigned long long v)
 
 LogStream& LogStream::operator<<(const void* p)
 {
+  if (!beginText())
+  {
+    return *this;
+  }
   uintptr_t v = reinterpret_cast<uintptr_t>(p);
   if (buffer_.avail() >= kMaxNumericSize)
   {
@@ -310,24 +708,137 @@ LogStream& LogStream::operator<<(const void* p)
   return *this;
 }
 
-// FIXME: replace this with Grisu3 by Florian Loitsch.
 LogStream& LogStream::operator<<(double v)
 {
-  if (buffer_.avail() >= kMaxNumericSize)
+  if (beginText())
   {
-    int len = snprintf(buffer_.current(), kMaxNumericSize, "%.12g", v);
-    buffer_.add(len);
+    appendDouble(v);
   }
   return *this;
 }
 
+namespace
+{
+
+// "prefix%[0][width][.precision][l|ll|j|z|t]conv suffix"
+struct FormatSpec
+{
+  const char* prefix;
+  int prefixLen;
+  bool zeroPad;
+  int width;
+  int precision;  // -1 if not given
+  char conv;
+  const char* suffix;
+  int suffixLen;
+};
+
+int parseNumber(const char** fmt)
+{
+  int n = 0;
+  while (**fmt >= '0' && **fmt <= '9' && n < 1000)
+  {
+    n = n * 10 + (*(*fmt)++ - '0');
+  }
+  return n;
+}
+
+// false for anything else, which goes to snprintf()
+bool parseFormat(const char* fmt, FormatSpec* spec)
+{
+  const char* percent = strchr(fmt, '%');
+  if (percent == NULL)
+    return false;
+  spec->prefix = fmt;
+  spec->prefixLen = static_cast<int>(percent - fmt);
+
+  const char* p = percent + 1;
+  spec->zeroPad = *p == '0';
+  if (spec->zeroPad)
+    ++p;
+  spec->width = parseNumber(&p);
+  spec->precision = -1;
+  if (*p == '.')
+  {
+    ++p;
+    spec->precision = parseNumber(&p);
+  }
+  while (*p == 'l' || *p == 'j' || *p == 'z' || *p == 't')
+  {
+    ++p;
+  }
+  spec->conv = *p++;
+  spec->suffix = p;
+  spec->suffixLen = static_cast<int>(strlen(p));
+  return strchr(p, '%') == NULL;
+}
+
+int assemble(char* buf, size_t size, const FormatSpec& spec, const char* num, int len)
+{
+  int pad = std::max(spec.width - len, 0);
+  if (static_cast<size_t>(spec.prefixLen + pad + len + spec.suffixLen) >= size)
+    return -1;
+
+  char* p = buf;
+  memcpy(p, spec.prefix, spec.prefixLen);
+  p += spec.prefixLen;
+  if (spec.zeroPad && num[0] == '-')
+  {
+    *p++ = *num++;
+    --len;
+  }
+  memset(p, spec.zeroPad ? '0' : ' ', pad);
+  p += pad;
+  memcpy(p, num, len);
+  p += len;
+  memcpy(p, spec.suffix, spec.suffixLen);
+  p += spec.suffixLen;
+  *p = '\0';
+  return static_cast<int>(p - buf);
+}
+
+// plain %d %u %g with width and zero padding, -1 for others
+template<typename T>
+int formatFast(char* buf, size_t size, const char* fmt, T val, std::true_type /* integral */)
+{
+  FormatSpec spec;
+  if (!parseFormat(fmt, &spec) || spec.precision >= 0)
+    return -1;
+  bool isSigned = std::is_signed<T>::value;
+  if (!(((spec.conv == 'd' || spec.conv == 'i') && isSigned) || (spec.conv == 'u' && !isSigned)))
+    return -1;
+  char num[32];
+  int len = static_cast<int>(convert(num, val));
+  return assemble(buf, size, spec, num, len);
+}
+
+template<typename T>
+int formatFast(char* buf, size_t size, const char* fmt, T val, std::false_type /* floating */)
+{
+  FormatSpec spec;
+  if (!parseFormat(fmt, &spec) || spec.conv != 'g' || !std::isfinite(val))
+    return -1;
+  char num[48];
+  int len = formatDouble(num, sizeof num, val, spec.precision < 0 ? 6 : spec.precision);
+  if (len < 0 || static_cast<size_t>(len) >= sizeof num)
+    return -1;
+  return assemble(buf, size, spec, num, len);
+}
+
+}  // namespace
+
 template<typename T>
 Fmt::Fmt(const char* fmt, T val)
 {
   static_assert(std::is_arithmetic<T>::value == true, "Must be arithmetic type");
 
-  length_ = snprintf(buf_, sizeof buf_, fmt, val);
-  assert(static_cast<size_t>(length_) < sizeof buf_);
+  length_ = formatFast(buf_, sizeof buf_, fmt, val, std::is_integral<T>());
+  if (length_ < 0)
+  {
+    length_ = snprintf(buf_, sizeof buf_, fmt, val);
+    // truncated
+    length_ = std::min(length_, static_cast<int>(sizeof buf_) - 1);
+  }
 }
 
 // Explicit instantiations
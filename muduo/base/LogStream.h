@@ -77,15 +77,89 @@ class FixedBuffer : noncopyable
 
 }  // namespace detail
 
+///
+/// A typed field of a structured log record.
+///
+///   LOG_INFO << "request done" << LogField("status", 200) << LogField("path", path);
+///
+/// writes "request done status=200 path=/index.html", a string value is
+/// quoted and escaped if it has spaces, quotes, '=' or control characters.
+/// In LogStream::kJson, see Logger::setFormat(), fields are members of
+/// the JSON object of the record.
+///
+/// Refers to key and string value without copying, for temporaries
+/// in the same statement.
+///
+class LogField
+{
+ public:
+  enum Type { kInt, kUint, kDouble, kBool, kString };
+
+  LogField(StringPiece key, int v) : key_(key), type_(kInt) { value_.i = v; }
+  LogField(StringPiece key, long v) : key_(key), type_(kInt) { value_.i = v; }
+  LogField(StringPiece key, long long v) : key_(key), type_(kInt) { value_.i = v; }
+  LogField(StringPiece key, unsigned v) : key_(key), type_(kUint) { value_.u = v; }
+  LogField(StringPiece key, unsigned long v) : key_(key), type_(kUint) { value_.u = v; }
+  LogField(StringPiece key, unsigned long long v) : key_(key), type_(kUint) { value_.u = v; }
+  LogField(StringPiece key, double v) : key_(key), type_(kDouble) { value_.d = v; }
+  LogField(StringPiece key, bool v) : key_(key), type_(kBool) { value_.b = v; }
+  LogField(StringPiece key, const char* v) : key_(key), type_(kString), str_(v ? v : "(null)") {}
+  LogField(StringPiece key, const string& v) : key_(key), type_(kString), str_(v) {}
+  LogField(StringPiece key, StringPiece v) : key_(key), type_(kString), str_(v) {}
+
+  StringPiece key() const { return key_; }
+  Type type() const { return type_; }
+  int64_t intValue() const { return value_.i; }
+  uint64_t uintValue() const { return value_.u; }
+  double doubleValue() const { return value_.d; }
+  bool boolValue() const { return value_.b; }
+  StringPiece stringValue() const { return str_; }
+
+ private:
+  StringPiece key_;
+  Type type_;
+  union
+  {
+    int64_t i;
+    uint64_t u;
+    double d;
+    bool b;
+  } value_;
+  StringPiece str_;
+};
+
+class Fmt;
+
 class LogStream : noncopyable
 {
   typedef LogStream self;
  public:
   typedef detail::FixedBuffer<detail::kSmallBuffer> Buffer;
 
+  ///
+  /// kText: free text and "key=value" fields.
+  /// kJson: one JSON object, free text goes to the "msg" member,
+  /// escaped, fields are members, text after a field goes to "msg2",
+  /// "msg3" and so on.  append() is raw in both.
+  ///
+  /// In kJson, room for closing the text and the object is kept,
+  /// what doesn't fit is dropped, so the record is always valid JSON.
+  ///
+  enum Format { kText, kJson };
+
+  LogStream()
+    : format_(kText),
+      inText_(false),
+      textMembers_(0)
+  {
+  }
+
+  void setFormat(Format format) { format_ = format; inText_ = false; textMembers_ = 0; }
+  Format format() const { return format_; }
+
   self& operator<<(bool v)
   {
-    buffer_.append(v ? "1" : "0", 1);
+    appendText(v ? "1" : "0", 1);
     return *this;
   }
 
@@ -110,7 +184,7 @@ class LogStream : noncopyable
 
   self& operator<<(char v)
   {
-    buffer_.append(&v, 1);
+    appendText(&v, 1);
     return *this;
   }
 
@@ -121,11 +195,11 @@ class LogStream : noncopyable
   {
     if (str)
     {
-      buffer_.append(str, strlen(str));
+      appendText(str, strlen(str));
     }
     else
     {
-      buffer_.append("(null)", 6);
+      appendText("(null)", 6);
     }
     return *this;
   }
@@ -137,13 +211,13 @@ class LogStream : noncopyable
 
   self& operator<<(const string& v)
   {
-    buffer_.append(v.c_str(), v.size());
+    appendText(v.c_str(), v.size());
     return *this;
   }
 
   self& operator<<(const StringPiece& v)
   {
-    buffer_.append(v.data(), v.size());
+    appendText(v.data(), v.size());
     return *this;
   }
 
@@ -153,17 +227,65 @@ class LogStream : noncopyable
     return *this;
   }
 
+  self& operator<<(const LogField& field);
+  self& operator<<(const Fmt& fmt);
+
+  /// ends "msg" of kJson, so a raw append() is outside of it.
+  void endText()
+  {
+    if (inText_)
+    {
+      buffer_.append("\"", 1);
+      inText_ = false;
+    }
+  }
+
   void append(const char* data, int len) { buffer_.append(data, len); }
   const Buffer& buffer() const { return buffer_; }
-  void resetBuffer() { buffer_.reset(); }
+  void resetBuffer() { buffer_.reset(); inText_ = false; textMembers_ = 0; }
+
+  /// bytes kept for closing quote of text and "}\n" in kJson
+  static const int kJsonReserve = 4;
 
  private:
   void staticCheck();
 
   template<typename T>
   void formatInteger(T);
+  template<typename T>
+  void appendInteger(T);
+  void appendDouble(double);
+  void appendEscaped(const char* data, size_t len);
+
+  // false if there is no room for text in kJson
+  bool beginText()
+  {
+    if (format_ == kJson && !inText_)
+    {
+      beginJsonText();
+      return inText_;
+    }
+    return true;
+  }
+
+  void appendText(const char* data, size_t len)
+  {
+    if (format_ == kText)
+    {
+      buffer_.append(data, len);
+    }
+    else if (beginText())
+    {
+      appendEscaped(data, len);
+    }
+  }
+
+  void beginJsonText();
 
   Buffer buffer_;
+  Format format_;
+  bool inText_;  // in "msg" of kJson
+  int textMembers_;  // "msg", "msg2"...
 
   static const int kMaxNumericSize = 48;
 };
@@ -182,10 +304,10 @@ class Fmt // : noncopyable
   int length_;
 };
 
-inline LogStream& operator<<(LogStream& s, const Fmt& fmt)
+inline LogStream& LogStream::operator<<(const Fmt& fmt)
 {
-  s.append(fmt.data(), fmt.length());
-  return s;
+  appendText(fmt.data(), fmt.length());
+  return *this;
 }
 
 // Format quantity n in SI units (k, M, G, T, P, E).
@@ -13,6 +13,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <algorithm>
 #include <sstream>
 
 namespace muduo
@@ -84,13 +85,13 @@ class T
 
 inline LogStream& operator<<(LogStream& s, T v)
 {
-  s.append(v.str_, v.len_);
+  s << StringPiece(v.str_, v.len_);
   return s;
 }
 
 inline LogStream& operator<<(LogStream& s, const Logger::SourceFile& v)
 {
-  s.append(v.data_, v.size_);
+  s << StringPiece(v.data_, v.size_);
   return s;
 }
 
@@ -108,34 +109,21 @@ void defaultFlush()
 
 Logger::OutputFunc g_output = defaultOutput;
 Logger::FlushFunc g_flush = defaultFlush;
+Logger::ClockFunc g_clock = Timestamp::now;
 TimeZone g_logTimeZone;
+int64_t g_suppressedMessages;  // __atomic
+LogStream::Format g_logFormat = LogStream::kText;
 
 }  // namespace muduo
 
 using namespace muduo;
 
-Logger::Impl::Impl(LogLevel level, int savedErrno, const SourceFile& file, int line)
-  : time_(Timestamp::now()),
-    stream_(),
-    level_(level),
-    line_(line),
-    basename_(file)
+namespace
 {
-  formatTime();
-  CurrentThread::tid();
-  stream_ << T(CurrentThread::tidString(), CurrentThread::tidStringLength());
-  stream_ << T(LogLevelName[level], 6);
-  if (savedErrno != 0)
-  {
-    stream_ << strerror_tl(savedErrno) << " (errno=" << savedErrno << ") ";
-  }
-}
 
-void Logger::Impl::formatTime()
+// t_time of current second, "20261019 05:12:34"
+void formatSecond(time_t seconds)
 {
-  int64_t microSecondsSinceEpoch = time_.microSecondsSinceEpoch();
-  time_t seconds = static_cast<time_t>(microSecondsSinceEpoch / Timestamp::kMicroSecondsPerSecond);
-  int microseconds = static_cast<int>(microSecondsSinceEpoch % Timestamp::kMicroSecondsPerSecond);
   if (seconds != t_lastSecond)
   {
     t_lastSecond = seconds;
@@ -154,6 +142,38 @@ void Logger::Impl::formatTime()
         tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
     assert(len == 17); (void)len;
   }
+}
+
+}  // namespace
+
+Logger::Impl::Impl(LogLevel level, int savedErrno, const SourceFile& file, int line)
+  : time_(g_clock()),
+    stream_(),
+    level_(level),
+    line_(line),
+    basename_(file)
+{
+  if (g_logFormat == LogStream::kJson)
+  {
+    formatJsonHeader(savedErrno);
+    return;
+  }
+  formatTime();
+  CurrentThread::tid();
+  stream_ << T(CurrentThread::tidString(), CurrentThread::tidStringLength());
+  stream_ << T(LogLevelName[level], 6);
+  if (savedErrno != 0)
+  {
+    stream_ << strerror_tl(savedErrno) << " (errno=" << savedErrno << ") ";
+  }
+}
+
+void Logger::Impl::formatTime()
+{
+  int64_t microSecondsSinceEpoch = time_.microSecondsSinceEpoch();
+  time_t seconds = static_cast<time_t>(microSecondsSinceEpoch / Timestamp::kMicroSecondsPerSecond);
+  int microseconds = static_cast<int>(microSecondsSinceEpoch % Timestamp::kMicroSecondsPerSecond);
+  formatSecond(seconds);
 
   if (g_logTimeZone.valid())
   {
@@ -169,8 +189,44 @@ void Logger::Impl::formatTime()
   }
 }
 
+void Logger::Impl::formatJsonHeader(int savedErrno)
+{
+  int64_t microSecondsSinceEpoch = time_.microSecondsSinceEpoch();
+  time_t seconds = static_cast<time_t>(microSecondsSinceEpoch / Timestamp::kMicroSecondsPerSecond);
+  int microseconds = static_cast<int>(microSecondsSinceEpoch % Timestamp::kMicroSecondsPerSecond);
+  formatSecond(seconds);
+  char timeBuf[32];
+  memcpy(timeBuf, t_time, 17);
+  Fmt us(g_logTimeZone.valid() ? ".%06d" : ".%06dZ", microseconds);
+  memcpy(timeBuf + 17, us.data(), us.length());
+
+  const char* levelName = LogLevelName[level_];
+  int levelLen = 6;
+  while (levelName[levelLen - 1] == ' ')
+  {
+    --levelLen;
+  }
+
+  stream_.setFormat(LogStream::kJson);
+  stream_.append("{", 1);
+  stream_ << LogField("time", StringPiece(timeBuf, 17 + us.length()))
+          << LogField("tid", CurrentThread::tid())
+          << LogField("level", StringPiece(levelName, levelLen));
+  if (savedErrno != 0)
+  {
+    stream_ << LogField("errno", savedErrno) << LogField("error", strerror_tl(savedErrno));
+  }
+}
+
 void Logger::Impl::finish()
 {
+  if (stream_.format() == LogStream::kJson)
+  {
+    stream_ << LogField("file", StringPiece(basename_.data_, basename_.size_))
+            << LogField("line", line_);
+    stream_.append("}\n", 2);
+    return;
+  }
   stream_ << " - " << basename_ << ':' << line_ << '\n';
 }
 
@@ -182,7 +238,14 @@ Logger::Logger(SourceFile file, int line)
 Logger::Logger(SourceFile file, int line, LogLevel level, const char* func)
   : impl_(level, 0, file, line)
 {
-  impl_.stream_ << func << ' ';
+  if (impl_.stream_.format() == LogStream::kJson)
+  {
+    impl_.stream_ << LogField("func", func);
+  }
+  else
+  {
+    impl_.stream_ << func << ' ';
+  }
 }
 
 Logger::Logger(SourceFile file, int line, LogLevel level)
@@ -222,7 +285,69 @@ void Logger::setFlush(FlushFunc flush)
   g_flush = flush;
 }
 
+void Logger::setClock(ClockFunc clock)
+{
+  g_clock = clock;
+}
+
 void Logger::setTimeZone(const TimeZone& tz)
 {
   g_logTimeZone = tz;
 }
+
+void Logger::setFormat(LogStream::Format format)
+{
+  g_logFormat = format;
+}
+
+int64_t Logger::suppressedMessages()
+{
+  return __atomic_load_n(&g_suppressedMessages, __ATOMIC_RELAXED);
+}
+
+LogStream& detail::operator<<(LogStream& s, const LogGate& gate)
+{
+  if (gate.suppressed() > 0)
+  {
+    s << "(suppressed " << gate.suppressed() << ") ";
+  }
+  return s;
+}
+
+detail::LogGate detail::passLog(int64_t suppressed)
+{
+  if (suppressed > 0)
+  {
+    __atomic_fetch_add(&g_suppressedMessages, suppressed, __ATOMIC_RELAXED);
+  }
+  return LogGate(suppressed);
+}
+
+detail::LogGate detail::LogRateLimiter::checkSlow(ThreadState* local, int64_t now,
+                                                  int64_t intervalNanos, int64_t burst)
+{
+  if (local->suppressed > 0)
+  {
+    __atomic_fetch_add(&suppressed, local->suppressed, __ATOMIC_RELAXED);
+    local->suppressed = 0;
+  }
+  intervalNanos = std::max<int64_t>(intervalNanos, 1);
+  const int64_t tolerance = intervalNanos * std::max<int64_t>(burst, 1);
+  int64_t old = __atomic_load_n(&tat, __ATOMIC_RELAXED);
+  int64_t next = 0;
+  do
+  {
+    next = std::max(old, now) + intervalNanos;
+    if (next - now > tolerance)
+    {
+      // empty, no token until next - tolerance
+      local->dueNanos = next - tolerance;
+      local->suppressed = 1;
+      return LogGate(-1);
+    }
+  } while (!__atomic_compare_exchange_n(&tat, &old, next, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+  int64_t n = __atomic_exchange_n(&suppressed, 0, __ATOMIC_RELAXED);
+  return passLog(n);
+}
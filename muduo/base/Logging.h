@@ -6,6 +6,7 @@
 #ifndef MUDUO_BASE_LOGGING_H
 #define MUDUO_BASE_LOGGING_H
 
+#include "muduo/base/Clock.h"
 #include "muduo/base/LogStream.h"
 #include "muduo/base/Timestamp.h"
 
@@ -74,9 +75,24 @@ class Logger
 
   typedef void (*OutputFunc)(const char* msg, int len);
   typedef void (*FlushFunc)();
+  typedef Timestamp (*ClockFunc)();
   static void setOutput(OutputFunc);
   static void setFlush(FlushFunc);
+  /// Timestamp::now() by default, Clock::coarseNow or Clock::cachedNow
+  /// are cheaper if sub-millisecond precision is not needed.
+  static void setClock(ClockFunc);
   static void setTimeZone(const TimeZone& tz);
+  ///
+  /// LogStream::kJson writes each record as one line of JSON,
+  /// {"time":"20261019 05:12:34.123456Z","tid":1234,"level":"INFO",
+  ///  "msg":"request done","status":200,"file":"Server.cc","line":42}
+  /// LOG_BINARY_* stay in text.
+  ///
+  static void setFormat(LogStream::Format format);
+
+  /// Messages dropped by LOG_EVERY_N, LOG_EVERY_T and LOG_RATE_LIMITED,
+  /// counted when the next message of the same site is written.
+  static int64_t suppressedMessages();
 
  private:
 
@@ -86,6 +102,7 @@ class Impl
   typedef Logger::LogLevel LogLevel;
   Impl(LogLevel level, int old_errno, const SourceFile& file, int line);
   void formatTime();
+  void formatJsonHeader(int savedErrno);
   void finish();
 
   Timestamp time_;
@@ -134,6 +151,123 @@ inline Logger::LogLevel Logger::logLevel()
 #define LOG_SYSERR muduo::Logger(__FILE__, __LINE__, false).stream()
 #define LOG_SYSFATAL muduo::Logger(__FILE__, __LINE__, true).stream()
 
+namespace detail
+{
+
+///
+/// Verdict of a rate limited call site, writes "(suppressed N) "
+/// in front of the message if any were dropped since the last one.
+///
+class LogGate
+{
+ public:
+  /// -1 to drop this message
+  explicit LogGate(int64_t suppressed)
+    : suppressed_(suppressed)
+  {
+  }
+
+  explicit operator bool() const { return suppressed_ >= 0; }
+  int64_t suppressed() const { return suppressed_; }
+
+ private:
+  int64_t suppressed_;
+};
+
+LogStream& operator<<(LogStream& s, const LogGate& gate);
+
+/// Lets a message through, adds @c suppressed to Logger::suppressedMessages().
+LogGate passLog(int64_t suppressed);
+
+/// Per site state of LOG_EVERY_N, a function local static.
+struct LogEveryN
+{
+  int64_t count;  // __atomic
+
+  LogGate check(int64_t n)
+  {
+    int64_t c = __atomic_fetch_add(&count, 1, __ATOMIC_RELAXED);
+    if (n > 1 && c % n != 0)
+    {
+      return LogGate(-1);
+    }
+    return passLog(c == 0 || n <= 1 ? 0 : n - 1);
+  }
+};
+
+///
+/// Per site state of LOG_EVERY_T and LOG_RATE_LIMITED, a token bucket
+/// kept as one theoretical arrival time (GCRA), a function local static.
+///
+/// Once a thread finds the bucket empty, it remembers when the next
+/// token is due and drops messages until then without touching
+/// the shared state, so a storm costs one clock read per message.
+///
+struct LogRateLimiter
+{
+  int64_t tat;  // __atomic, monotonic nanos
+  int64_t suppressed;  // __atomic
+
+  /// per thread and per site, a function local static __thread
+  struct ThreadState
+  {
+    int64_t dueNanos;
+    int64_t suppressed;
+  };
+
+  LogGate check(ThreadState* local, int64_t intervalNanos, int64_t burst)
+  {
+    int64_t now = Clock::monotonicNanos();
+    if (now < local->dueNanos)
+    {
+      ++local->suppressed;
+      return LogGate(-1);
+    }
+    return checkSlow(local, now, intervalNanos, burst);
+  }
+
+  LogGate checkSlow(ThreadState* local, int64_t now, int64_t intervalNanos, int64_t burst);
+};
+
+}  // namespace detail
+
+//
+// Rate limited logging, for messages that may come in storms,
+// e.g. every connection failing at once.
+//
+// LOG_EVERY_N(WARN, 1000) << "accept failed";
+//   writes the 1st, 1001st, 2001st ... message of this site.
+// LOG_EVERY_T(ERROR, 1.0) << "backend down";
+//   writes at most one message per second.
+// LOG_RATE_LIMITED(ERROR, 10, 100) << "bad request from " << peer;
+//   writes 10 messages per second on average, bursts of up to 100.
+//
+// Counted per call site among all threads, suppressed messages are
+// not formatted.  The same CAUTION as LOG_INFO applies.
+//
+#define LOG_EVERY_N(severity, n) \
+  if (muduo::Logger::logLevel() <= muduo::Logger::severity) \
+    if (muduo::detail::LogGate muduoLogGate = [&] { \
+          static muduo::detail::LogEveryN muduoLogSite; \
+          return muduoLogSite.check(n); }()) \
+      muduo::Logger(__FILE__, __LINE__, muduo::Logger::severity).stream() << muduoLogGate
+
+#define LOG_RATE_LIMITED(severity, perSecond, burst) \
+  if (muduo::Logger::logLevel() <= muduo::Logger::severity) \
+    if (muduo::detail::LogGate muduoLogGate = [&] { \
+          static muduo::detail::LogRateLimiter muduoLogSite; \
+          static __thread muduo::detail::LogRateLimiter::ThreadState muduoLogState; \
+          return muduoLogSite.check(&muduoLogState, static_cast<int64_t>(1e9 / (perSecond)), (burst)); }()) \
+      muduo::Logger(__FILE__, __LINE__, muduo::Logger::severity).stream() << muduoLogGate
+
+#define LOG_EVERY_T(severity, seconds) \
+  if (muduo::Logger::logLevel() <= muduo::Logger::severity) \
+    if (muduo::detail::LogGate muduoLogGate = [&] { \
+          static muduo::detail::LogRateLimiter muduoLogSite; \
+          static __thread muduo::detail::LogRateLimiter::ThreadState muduoLogState; \
+          return muduoLogSite.check(&muduoLogState, static_cast<int64_t>(1e9 * (seconds)), 1); }()) \
+      muduo::Logger(__FILE__, __LINE__, muduo::Logger::severity).stream() << muduoLogGate
+
 const char* strerror_tl(int savedErrno);
 
 // Taken from glog/logging.h
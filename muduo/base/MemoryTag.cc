@@ -0,0 +1,154 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/base/MemoryTag.h"
+
+#include "muduo/base/Symbolizer.h"
+
+#include <algorithm>
+
+#include <execinfo.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+using namespace muduo;
+
+const int MemoryTag::kMaxDepth;
+int64_t MemoryTag::s_sampleInterval = 0;
+
+namespace
+{
+
+__thread int64_t t_untilSample = 0;
+__thread uint64_t t_random = 0;
+
+MutexLock& tagsMutex()
+{
+  static MutexLock* mutex = new MutexLock;
+  return *mutex;
+}
+
+std::vector<MemoryTag*>& allTags()
+{
+  static std::vector<MemoryTag*>* tags = new std::vector<MemoryTag*>;
+  return *tags;
+}
+
+// exponential with mean interval, so that a periodic pattern of
+// allocations is not sampled at the same place every time
+int64_t nextSample(int64_t interval)
+{
+  if (t_random == 0)
+  {
+    t_random = reinterpret_cast<uintptr_t>(&t_random) | 1;
+  }
+  // xorshift64
+  t_random ^= t_random << 13;
+  t_random ^= t_random >> 7;
+  t_random ^= t_random << 17;
+  double u = static_cast<double>((t_random >> 11) + 1) / 9007199254740993.0;  // (0, 1)
+  return static_cast<int64_t>(-log(u) * static_cast<double>(interval)) + 1;
+}
+
+}  // namespace
+
+MemoryTag::MemoryTag(const char* name)
+  : name_(name)
+{
+  MutexLockGuard lock(tagsMutex());
+  allTags().push_back(this);
+}
+
+MemoryTag::~MemoryTag()
+{
+  MutexLockGuard lock(tagsMutex());
+  std::vector<MemoryTag*>& tags = allTags();
+  tags.erase(std::remove(tags.begin(), tags.end(), this), tags.end());
+}
+
+std::vector<MemoryTag*> MemoryTag::tags()
+{
+  std::vector<MemoryTag*> result;
+  {
+  MutexLockGuard lock(tagsMutex());
+  result = allTags();
+  }
+  std::sort(result.begin(), result.end(),
+            [](const MemoryTag* lhs, const MemoryTag* rhs)
+            { return strcmp(lhs->name(), rhs->name()) < 0; });
+  return result;
+}
+
+void MemoryTag::setSampleInterval(int64_t bytes)
+{
+  __atomic_store_n(&s_sampleInterval, std::max(bytes, int64_t(0)), __ATOMIC_RELAXED);
+}
+
+void MemoryTag::sample(size_t bytes)
+{
+  const int64_t interval = sampleInterval();
+  if (interval <= 0)
+  {
+    return;
+  }
+  if (t_untilSample == 0)
+  {
+    t_untilSample = nextSample(interval);
+  }
+  t_untilSample -= static_cast<int64_t>(bytes);
+  if (t_untilSample > 0)
+  {
+    return;
+  }
+  t_untilSample = nextSample(interval);
+
+  void* frames[kMaxDepth + 1];
+  int depth = ::backtrace(frames, kMaxDepth + 1);
+  // skipping the 0-th, which is this function
+  std::vector<void*> stack(frames + std::min(depth, 1), frames + depth);
+  // an allocation of size bytes is sampled with probability
+  // 1 - exp(-size/interval), so it stands for size/probability bytes
+  double size = static_cast<double>(bytes);
+  double probability = 1 - exp(-size / static_cast<double>(interval));
+  int64_t estimate = static_cast<int64_t>(size / probability);
+
+  MutexLockGuard lock(mutex_);
+  samples_[stack] += estimate;
+}
+
+void MemoryTag::writeSamples(string* output) const
+{
+  std::map<std::vector<void*>, int64_t> samples;
+  {
+  MutexLockGuard lock(mutex_);
+  samples = samples_;
+  }
+
+  // stacks at different pcs of the same functions are one line
+  Symbolizer symbolizer;
+  std::map<string, int64_t> lines;
+  for (const auto& it : samples)
+  {
+    string line = name_;
+    symbolizer.appendFolded(it.first.data(), it.first.size(), false, &line);
+    lines[line] += it.second;
+  }
+
+  char bytes[32];
+  for (const auto& it : lines)
+  {
+    output->append(it.first);
+    snprintf(bytes, sizeof bytes, " %" PRId64 "\n", it.second);
+    output->append(bytes);
+  }
+}
+
+void MemoryTag::clearSamples()
+{
+  MutexLockGuard lock(mutex_);
+  samples_.clear();
+}
@@ -0,0 +1,150 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_MEMORYTAG_H
+#define MUDUO_BASE_MEMORYTAG_H
+
+#include "muduo/base/Config.h"
+#include "muduo/base/Mutex.h"
+#include "muduo/base/ShardedCounter.h"
+#include "muduo/base/Types.h"
+
+#include <map>
+#include <new>
+#include <vector>
+
+namespace muduo
+{
+
+///
+/// Bytes and objects alive of one subsystem, eg. all net::Buffer's,
+/// to tell what the RSS of a process is made of.
+///
+/// Counting is two ShardedCounter adds per allocation.
+/// After setSampleInterval(n), allocations are also sampled about once
+/// per n bytes, per thread, recording their stacks, see writeSamples().
+/// Building with cmake -DMUDUO_MEMORY_TAGS=OFF defines
+/// MUDUO_NO_MEMORY_TAGS in muduo/base/Config.h, allocate() and
+/// deallocate() do nothing, and all tags stay at zero.
+///
+/// Tags live as long as the process, get them from a function, so that
+/// objects of static storage are counted before and after main():
+///
+///   MemoryTag& bufferMemoryTag()
+///   {
+///     static MemoryTag* tag = new MemoryTag("buffer");
+///     return *tag;
+///   }
+///
+/// Thread safe.
+///
+class MemoryTag : noncopyable
+{
+ public:
+  static const int kMaxDepth = 32;
+
+  explicit MemoryTag(const char* name);
+  ~MemoryTag();
+
+  const char* name() const { return name_; }
+
+#ifndef MUDUO_NO_MEMORY_TAGS
+  void allocate(size_t bytes)
+  {
+    bytes_.add(static_cast<int64_t>(bytes));
+    objects_.increment();
+    if (__builtin_expect(__atomic_load_n(&s_sampleInterval, __ATOMIC_RELAXED) > 0, 0))
+    {
+      sample(bytes);
+    }
+  }
+
+  void deallocate(size_t bytes)
+  {
+    bytes_.add(-static_cast<int64_t>(bytes));
+    objects_.decrement();
+  }
+#else
+  void allocate(size_t) {}
+  void deallocate(size_t) {}
+#endif
+
+  int64_t bytes() const { return bytes_.get(); }
+  int64_t objects() const { return objects_.get(); }
+
+  /// Appends "tag;outer;...;inner bytes\n" of sampled allocations since
+  /// sampling started, bytes estimated, in folded stack format.
+  void writeSamples(string* output) const;
+  void clearSamples();
+
+  /// All tags, sorted by name.
+  static std::vector<MemoryTag*> tags();
+
+  /// Mean bytes between samples, 0 to stop sampling.
+  static void setSampleInterval(int64_t bytes);
+  static int64_t sampleInterval()
+  { return __atomic_load_n(&s_sampleInterval, __ATOMIC_RELAXED); }
+
+ private:
+  void sample(size_t bytes);
+
+  const char* const name_;
+  ShardedCounter bytes_;
+  ShardedCounter objects_;
+  mutable MutexLock mutex_;
+  std::map<std::vector<void*>, int64_t> samples_ GUARDED_BY(mutex_);  // estimated bytes
+
+  static int64_t s_sampleInterval;  // __atomic
+};
+
+///
+/// Standard allocator counting to a MemoryTag, for containers:
+///
+///   std::vector<char, TaggedAllocator<char, &bufferMemoryTag>> buffer_;
+///
+/// Stateless, so containers of the same tag swap and move buffers.
+///
+template<typename T, MemoryTag& (*Tag)()>
+class TaggedAllocator
+{
+ public:
+  typedef T value_type;
+
+  template<typename U>
+  struct rebind
+  {
+    typedef TaggedAllocator<U, Tag> other;
+  };
+
+  TaggedAllocator() {}
+  template<typename U>
+  TaggedAllocator(const TaggedAllocator<U, Tag>&) {}
+
+  T* allocate(size_t n)
+  {
+    T* p = static_cast<T*>(::operator new(n * sizeof(T)));
+#ifndef MUDUO_NO_MEMORY_TAGS
+    Tag().allocate(n * sizeof(T));
+#endif
+    return p;
+  }
+
+  void deallocate(T* p, size_t n)
+  {
+#ifndef MUDUO_NO_MEMORY_TAGS
+    Tag().deallocate(n * sizeof(T));
+#endif
+    ::operator delete(p);
+  }
+
+  template<typename U>
+  bool operator==(const TaggedAllocator<U, Tag>&) const { return true; }
+  template<typename U>
+  bool operator!=(const TaggedAllocator<U, Tag>&) const { return false; }
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_MEMORYTAG_H
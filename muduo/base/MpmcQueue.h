@@ -0,0 +1,373 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_MPMCQUEUE_H
+#define MUDUO_BASE_MPMCQUEUE_H
+
+#include "muduo/base/noncopyable.h"
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <assert.h>
+#include <linux/futex.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace muduo
+{
+
+template<typename T> class MpmcBlockingQueue;
+
+namespace detail
+{
+
+const size_t kCacheLineSize = 64;
+
+inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+// no point spinning for another thread on one CPU
+inline int spinCount()
+{
+  static const int count = ::sysconf(_SC_NPROCESSORS_ONLN) > 1 ? 128 : 0;
+  return count;
+}
+
+inline void futexWait(uint32_t* addr, uint32_t expected)
+{
+  ::syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+inline void futexWake(uint32_t* addr, int count)
+{
+  ::syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+///
+/// A futex word that threads sleep on until it changes,
+/// notify() makes no syscall if nobody is waiting.
+///
+class WaitList : noncopyable
+{
+ public:
+  WaitList()
+    : seq_(0),
+      waiters_(0)
+  {
+  }
+
+  /// Returns a ticket, call before checking the condition again.
+  uint32_t prepareWait()
+  {
+    __atomic_fetch_add(&waiters_, 1, __ATOMIC_SEQ_CST);
+    return __atomic_load_n(&seq_, __ATOMIC_SEQ_CST);
+  }
+
+  /// Sleeps unless notified since prepareWait().
+  void wait(uint32_t ticket)
+  {
+    futexWait(&seq_, ticket);
+    __atomic_fetch_sub(&waiters_, 1, __ATOMIC_RELAXED);
+  }
+
+  void cancelWait()
+  {
+    __atomic_fetch_sub(&waiters_, 1, __ATOMIC_RELAXED);
+  }
+
+  /// Call after making the condition true.
+  void notify()
+  {
+    // orders the condition before loading waiters_
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&waiters_, __ATOMIC_RELAXED) > 0)
+    {
+      __atomic_fetch_add(&seq_, 1, __ATOMIC_SEQ_CST);
+      futexWake(&seq_, 1);
+    }
+  }
+
+ private:
+  uint32_t seq_;  // __atomic
+  int waiters_;  // __atomic
+  char pad_[kCacheLineSize - sizeof(uint32_t) - sizeof(int)];
+};
+
+}  // namespace detail
+
+///
+/// Lock-free bounded multi-producer multi-consumer queue, after
+/// Dmitry Vyukov's bounded MPMC queue.
+///
+/// Each slot carries a sequence number telling whether it is ready
+/// for the producer or the consumer of a given round, so a producer
+/// and a consumer only contend on the slot and their own index, not
+/// on a lock.  Capacity is rounded up to a power of two.
+///
+/// tryPut() and tryTake() never block, see MpmcBlockingQueue.
+///
+template<typename T>
+class MpmcQueue : noncopyable
+{
+ public:
+  explicit MpmcQueue(size_t maxSize)
+    : mask_(roundUp(maxSize) - 1),
+      slots_(new Slot[mask_ + 1]),
+      enqueuePos_(0),
+      dequeuePos_(0)
+  {
+    for (size_t i = 0; i <= mask_; ++i)
+    {
+      slots_[i].sequence = i;
+    }
+  }
+
+  ~MpmcQueue()
+  {
+    while (Slot* slot = beginTake())
+    {
+      endTake(slot);
+    }
+  }
+
+  /// Returns false if full, @c x is left untouched.
+  bool tryPut(const T& x) { return put(x); }
+  bool tryPut(T&& x) { return put(std::move(x)); }
+
+  /// Returns false if empty.
+  bool tryTake(T* x)
+  {
+    Slot* slot = beginTake();
+    if (slot == NULL)
+    {
+      return false;
+    }
+    *x = std::move(*slot->value());
+    endTake(slot);
+    return true;
+  }
+
+  /// Approximate if there are concurrent producers or consumers.
+  size_t size() const
+  {
+    size_t head = __atomic_load_n(&dequeuePos_, __ATOMIC_ACQUIRE);
+    size_t tail = __atomic_load_n(&enqueuePos_, __ATOMIC_ACQUIRE);
+    ptrdiff_t n = static_cast<ptrdiff_t>(tail - head);
+    return n < 0 ? 0 : (static_cast<size_t>(n) > capacity() ? capacity() : static_cast<size_t>(n));
+  }
+
+  bool empty() const { return size() == 0; }
+  bool full() const { return size() == capacity(); }
+  size_t capacity() const { return mask_ + 1; }
+
+ private:
+  friend class MpmcBlockingQueue<T>;
+
+  struct Slot
+  {
+    size_t sequence;  // __atomic
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+    T* value() { return reinterpret_cast<T*>(&storage); }
+  };
+
+  static size_t roundUp(size_t n)
+  {
+    size_t size = 2;
+    while (size < n)
+    {
+      size *= 2;
+    }
+    return size;
+  }
+
+  template<typename U>
+  bool put(U&& x)
+  {
+    Slot* slot = NULL;
+    size_t pos = __atomic_load_n(&enqueuePos_, __ATOMIC_RELAXED);
+    while (true)
+    {
+      slot = &slots_[pos & mask_];
+      size_t seq = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+      ptrdiff_t diff = static_cast<ptrdiff_t>(seq - pos);
+      if (diff == 0)
+      {
+        if (__atomic_compare_exchange_n(&enqueuePos_, &pos, pos + 1, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        {
+          break;
+        }
+      }
+      else if (diff < 0)
+      {
+        // not yet consumed since last round
+        return false;
+      }
+      else
+      {
+        pos = __atomic_load_n(&enqueuePos_, __ATOMIC_RELAXED);
+      }
+    }
+    new (&slot->storage) T(std::forward<U>(x));
+    __atomic_store_n(&slot->sequence, pos + 1, __ATOMIC_RELEASE);
+    return true;
+  }
+
+  // claims a filled slot, call endTake() after moving the value out
+  Slot* beginTake()
+  {
+    size_t pos = __atomic_load_n(&dequeuePos_, __ATOMIC_RELAXED);
+    while (true)
+    {
+      Slot* slot = &slots_[pos & mask_];
+      size_t seq = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+      ptrdiff_t diff = static_cast<ptrdiff_t>(seq - (pos + 1));
+      if (diff == 0)
+      {
+        if (__atomic_compare_exchange_n(&dequeuePos_, &pos, pos + 1, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        {
+          return slot;
+        }
+      }
+      else if (diff < 0)
+      {
+        // not yet produced in this round
+        return NULL;
+      }
+      else
+      {
+        pos = __atomic_load_n(&dequeuePos_, __ATOMIC_RELAXED);
+      }
+    }
+  }
+
+  void endTake(Slot* slot)
+  {
+    slot->value()->~T();
+    // sequence was pos + 1, ready for the producer of next round
+    __atomic_store_n(&slot->sequence, slot->sequence + mask_, __ATOMIC_RELEASE);
+  }
+
+  const size_t mask_;
+  const std::unique_ptr<Slot[]> slots_;
+  char pad0_[detail::kCacheLineSize];
+  size_t enqueuePos_;  // __atomic
+  char pad1_[detail::kCacheLineSize - sizeof(size_t)];
+  size_t dequeuePos_;  // __atomic
+  char pad2_[detail::kCacheLineSize - sizeof(size_t)];
+};
+
+///
+/// Drop-in replacement of BoundedBlockingQueue on MpmcQueue.
+///
+/// put() and take() spin for a while when the queue is full or empty,
+/// then sleep on a futex.  The other side makes a futex syscall only
+/// if some thread is sleeping, so uncontended hand-offs take no lock
+/// and no syscall.
+///
+template<typename T>
+class MpmcBlockingQueue : noncopyable
+{
+ public:
+  explicit MpmcBlockingQueue(int maxSize)
+    : queue_(static_cast<size_t>(maxSize))
+  {
+  }
+
+  void put(const T& x)
+  {
+    putImpl(x);
+  }
+
+  void put(T&& x)
+  {
+    putImpl(std::move(x));
+  }
+
+  T take()
+  {
+    typename MpmcQueue<T>::Slot* slot = NULL;
+    for (int i = detail::spinCount(); i > 0 && slot == NULL; --i)
+    {
+      slot = queue_.beginTake();
+      if (slot == NULL)
+      {
+        detail::cpuRelax();
+      }
+    }
+    while (slot == NULL)
+    {
+      uint32_t ticket = notEmpty_.prepareWait();
+      slot = queue_.beginTake();
+      if (slot == NULL)
+      {
+        notEmpty_.wait(ticket);
+      }
+      else
+      {
+        notEmpty_.cancelWait();
+      }
+    }
+    T front(std::move(*slot->value()));
+    queue_.endTake(slot);
+    notFull_.notify();
+    return front;
+  }
+
+  bool empty() const { return queue_.empty(); }
+  bool full() const { return queue_.full(); }
+  size_t size() const { return queue_.size(); }
+  size_t capacity() const { return queue_.capacity(); }
+
+ private:
+  template<typename U>
+  void putImpl(U&& x)
+  {
+    bool done = false;
+    for (int i = detail::spinCount(); i > 0 && !done; --i)
+    {
+      done = queue_.put(std::forward<U>(x));
+      if (!done)
+      {
+        detail::cpuRelax();
+      }
+    }
+    while (!done)
+    {
+      uint32_t ticket = notFull_.prepareWait();
+      done = queue_.put(std::forward<U>(x));
+      if (!done)
+      {
+        notFull_.wait(ticket);
+      }
+      else
+      {
+        notFull_.cancelWait();
+      }
+    }
+    notEmpty_.notify();
+  }
+
+  MpmcQueue<T> queue_;
+  detail::WaitList notEmpty_;
+  detail::WaitList notFull_;
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_MPMCQUEUE_H
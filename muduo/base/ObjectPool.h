@@ -0,0 +1,295 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_OBJECTPOOL_H
+#define MUDUO_BASE_OBJECTPOOL_H
+
+#include "muduo/base/Mutex.h"
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <pthread.h>
+#include <stdlib.h>
+
+namespace muduo
+{
+
+///
+/// Process wide pool of memory for objects of type T, one per type.
+///
+/// Each thread keeps a free list, so allocate() and deallocate() touch
+/// no lock in steady state.  A thread takes a batch of free objects from
+/// the shared pool when its list is empty, and gives a batch back when
+/// it holds two, so objects allocated in one thread and freed in another,
+/// like TcpConnection, flow back in batches.  The shared pool allocates
+/// a batch at a time, and never returns memory to the system.
+///
+///   Timer* timer = ObjectPool<Timer>::create(cb, when, interval);
+///   ObjectPool<Timer>::destroy(timer);
+///
+///   std::shared_ptr<Foo> foo = ObjectPool<Foo>::makeShared(args);
+///
+/// Thread safe.
+///
+template<typename T>
+class ObjectPool : noncopyable
+{
+ public:
+  static const size_t kBatchSize = 32;
+
+  static ObjectPool& instance()
+  {
+    // never destroyed, threads may exit after main()
+    static ObjectPool* pool = new ObjectPool;
+    return *pool;
+  }
+
+  template<typename... Args>
+  static T* create(Args&&... args)
+  {
+    void* p = instance().allocate();
+    try
+    {
+      return new (p) T(std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+      instance().deallocate(p);
+      throw;
+    }
+  }
+
+  static void destroy(T* obj)
+  {
+    if (obj)
+    {
+      obj->~T();
+      instance().deallocate(obj);
+    }
+  }
+
+  /// The object and its reference counts in one object from the pool
+  /// of the control block type.
+  template<typename... Args>
+  static std::shared_ptr<T> makeShared(Args&&... args);
+
+  /// Memory for one T
+  void* allocate()
+  {
+    if (t_cache.head == NULL)
+    {
+      refill();
+    }
+    Node* node = t_cache.head;
+    t_cache.head = node->next;
+    --t_cache.count;
+    return node;
+  }
+
+  void deallocate(void* p)
+  {
+    Node* node = static_cast<Node*>(p);
+    if (t_cache.head == NULL)
+    {
+      registerThread();
+    }
+    node->next = t_cache.head;
+    t_cache.head = node;
+    if (++t_cache.count >= 2 * kBatchSize)
+    {
+      giveBack();
+    }
+  }
+
+  /// number of objects allocated from the system
+  size_t capacity() const
+  {
+    MutexLockGuard lock(mutex_);
+    return slabs_.size() * kBatchSize;
+  }
+
+  /// number of free objects in the shared pool, excluding thread caches
+  size_t sharedFree() const
+  {
+    MutexLockGuard lock(mutex_);
+    size_t n = 0;
+    for (const Batch& batch : batches_)
+    {
+      n += batch.count;
+    }
+    return n;
+  }
+
+ private:
+  union Node
+  {
+    Node* next;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+  };
+
+  struct Batch
+  {
+    Node* head;
+    size_t count;
+  };
+
+  ObjectPool()
+  {
+    pthread_key_create(&key_, &ObjectPool::flushCache);
+  }
+
+  ~ObjectPool() = delete;
+
+  void registerThread()
+  {
+    if (!t_cache.registered)
+    {
+      // calls flushCache() when the thread exits
+      pthread_setspecific(key_, this);
+      t_cache.registered = true;
+    }
+  }
+
+  void refill()
+  {
+    registerThread();
+    {
+    MutexLockGuard lock(mutex_);
+    if (!batches_.empty())
+    {
+      t_cache.head = batches_.back().head;
+      t_cache.count = batches_.back().count;
+      batches_.pop_back();
+      return;
+    }
+    }
+    Node* slab = static_cast<Node*>(::malloc(sizeof(Node) * kBatchSize));
+    if (slab == NULL)
+    {
+      throw std::bad_alloc();
+    }
+    for (size_t i = 0; i < kBatchSize - 1; ++i)
+    {
+      slab[i].next = &slab[i + 1];
+    }
+    slab[kBatchSize - 1].next = NULL;
+    t_cache.head = slab;
+    t_cache.count = kBatchSize;
+    MutexLockGuard lock(mutex_);
+    slabs_.push_back(slab);
+  }
+
+  // keeps kBatchSize in thread cache
+  void giveBack()
+  {
+    Node* last = t_cache.head;
+    for (size_t i = 1; i < kBatchSize; ++i)
+    {
+      last = last->next;
+    }
+    Batch batch = { last->next, t_cache.count - kBatchSize };
+    last->next = NULL;
+    t_cache.count = kBatchSize;
+    MutexLockGuard lock(mutex_);
+    batches_.push_back(batch);
+  }
+
+  static void flushCache(void* obj)
+  {
+    ObjectPool* pool = static_cast<ObjectPool*>(obj);
+    if (t_cache.head)
+    {
+      Batch batch = { t_cache.head, t_cache.count };
+      MutexLockGuard lock(pool->mutex_);
+      pool->batches_.push_back(batch);
+    }
+    t_cache.head = NULL;
+    t_cache.count = 0;
+    t_cache.registered = false;
+  }
+
+  struct Cache
+  {
+    Node* head;
+    size_t count;
+    bool registered;
+  };
+
+  static __thread Cache t_cache;
+
+  mutable MutexLock mutex_;
+  std::vector<Batch> batches_ GUARDED_BY(mutex_);
+  std::vector<Node*> slabs_ GUARDED_BY(mutex_);
+  pthread_key_t key_;
+};
+
+template<typename T>
+__thread typename ObjectPool<T>::Cache ObjectPool<T>::t_cache;
+
+///
+/// Standard allocator on ObjectPool, for single objects, eg.
+/// std::allocate_shared, or std::list and std::map nodes.
+///
+template<typename T>
+class PoolAllocator
+{
+ public:
+  typedef T value_type;
+
+  PoolAllocator() noexcept = default;
+
+  template<typename U>
+  PoolAllocator(const PoolAllocator<U>&) noexcept
+  {
+  }
+
+  T* allocate(size_t n)
+  {
+    if (n == 1)
+    {
+      return static_cast<T*>(ObjectPool<T>::instance().allocate());
+    }
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T* p, size_t n)
+  {
+    if (n == 1)
+    {
+      ObjectPool<T>::instance().deallocate(p);
+    }
+    else
+    {
+      ::operator delete(p);
+    }
+  }
+};
+
+template<typename T, typename U>
+inline bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&)
+{
+  return true;
+}
+
+template<typename T, typename U>
+inline bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&)
+{
+  return false;
+}
+
+template<typename T>
+template<typename... Args>
+std::shared_ptr<T> ObjectPool<T>::makeShared(Args&&... args)
+{
+  return std::allocate_shared<T>(PoolAllocator<T>(), std::forward<Args>(args)...);
+}
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_OBJECTPOOL_H
@@ -0,0 +1,86 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/base/ShardedCounter.h"
+
+#include <new>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace muduo;
+
+namespace muduo
+{
+namespace detail
+{
+
+__thread int t_shardIndex = -1;
+
+}  // namespace detail
+}  // namespace muduo
+
+namespace
+{
+
+int g_nextShard = 0;  // __atomic
+
+int computeShardCount()
+{
+  long cpus = ::sysconf(_SC_NPROCESSORS_CONF);
+  int count = 1;
+  while (count < cpus && count < detail::kMaxShards)
+  {
+    count *= 2;
+  }
+  return count;
+}
+
+}  // namespace
+
+void detail::assignShard()
+{
+  t_shardIndex = __atomic_fetch_add(&g_nextShard, 1, __ATOMIC_RELAXED) % kMaxShards;
+}
+
+int detail::shardCount()
+{
+  static const int count = computeShardCount();
+  return count;
+}
+
+void* detail::allocateShards(size_t size)
+{
+  void* p = NULL;
+  if (::posix_memalign(&p, 64, size) != 0)
+  {
+    throw std::bad_alloc();
+  }
+  ::memset(p, 0, size);
+  return p;
+}
+
+ShardedCounter::ShardedCounter()
+  : mask_(detail::shardCount() - 1),
+    shards_(static_cast<Shard*>(detail::allocateShards(sizeof(Shard) * (mask_ + 1))))
+{
+  static_assert(sizeof(Shard) == kCacheLineSize, "one shard per cache line");
+}
+
+ShardedCounter::~ShardedCounter()
+{
+  ::free(shards_);
+}
+
+int64_t ShardedCounter::get() const
+{
+  int64_t sum = 0;
+  for (int i = 0; i <= mask_; ++i)
+  {
+    sum += __atomic_load_n(&shards_[i].value, __ATOMIC_RELAXED);
+  }
+  return sum;
+}
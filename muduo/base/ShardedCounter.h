@@ -0,0 +1,89 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_SHARDEDCOUNTER_H
+#define MUDUO_BASE_SHARDEDCOUNTER_H
+
+#include "muduo/base/noncopyable.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace muduo
+{
+
+namespace detail
+{
+  // internal
+  const int kMaxShards = 64;
+  extern __thread int t_shardIndex;
+  void assignShard();
+
+  /// A small number per thread, assigned round robin, less than kMaxShards.
+  inline int shardIndex()
+  {
+    if (__builtin_expect(t_shardIndex < 0, 0))
+    {
+      assignShard();
+    }
+    return t_shardIndex;
+  }
+
+  /// Power of two, not less than number of CPUs, at most kMaxShards.
+  int shardCount();
+
+  /// Zeroed memory aligned to cache line, release with ::free().
+  void* allocateShards(size_t size);
+}  // namespace detail
+
+///
+/// Counter that many threads add to, eg. requests served by all loops.
+///
+/// Threads add to their own shard of cache line, without bouncing
+/// a shared AtomicInt64 between CPUs.  get() sums up all shards, so it
+/// is slower, and not a snapshot if other threads are adding.
+///
+/// Thread safe.
+///
+class ShardedCounter : noncopyable
+{
+ public:
+  ShardedCounter();
+  ~ShardedCounter();
+
+  void add(int64_t x)
+  {
+    Shard& shard = shards_[detail::shardIndex() & mask_];
+    __atomic_fetch_add(&shard.value, x, __ATOMIC_RELAXED);
+  }
+
+  void increment()
+  {
+    add(1);
+  }
+
+  void decrement()
+  {
+    add(-1);
+  }
+
+  int64_t get() const;
+
+ private:
+  static const size_t kCacheLineSize = 64;
+
+  struct Shard
+  {
+    int64_t value;  // __atomic
+    char pad[kCacheLineSize - sizeof(int64_t)];
+  };
+
+  const int mask_;
+  Shard* const shards_;
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_SHARDEDCOUNTER_H
@@ -0,0 +1,194 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_SPSCQUEUE_H
+#define MUDUO_BASE_SPSCQUEUE_H
+
+#include "muduo/base/noncopyable.h"
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <stddef.h>
+
+namespace muduo
+{
+
+///
+/// Wait-free bounded single-producer single-consumer ring.
+///
+/// The producer owns the tail index, the consumer owns the head index,
+/// each keeps a cached copy of the other one and reloads it only when
+/// the ring looks full or empty.  Batch operations publish the index
+/// once for many items.  Capacity is rounded up to a power of two.
+///
+/// Exactly one thread may push and one thread may pop at a time.
+///
+template<typename T>
+class SpscQueue : noncopyable
+{
+ public:
+  explicit SpscQueue(size_t maxSize)
+    : mask_(roundUp(maxSize) - 1),
+      slots_(new Slot[mask_ + 1]),
+      head_(0),
+      tailCache_(0),
+      tail_(0),
+      headCache_(0)
+  {
+  }
+
+  ~SpscQueue()
+  {
+    for (size_t i = head_; i != tail_; ++i)
+    {
+      slots_[i & mask_].value()->~T();
+    }
+  }
+
+  // producer side
+
+  /// Returns false if full, @c x is left untouched.
+  bool tryPush(const T& x) { return push(x); }
+  bool tryPush(T&& x) { return push(std::move(x)); }
+
+  /// Moves up to n items from first, returns the number pushed.
+  template<typename InputIt>
+  size_t tryPushBatch(InputIt first, size_t n)
+  {
+    size_t tail = tail_;
+    size_t room = capacity() - (tail - headCache_);
+    if (room < n)
+    {
+      headCache_ = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+      room = capacity() - (tail - headCache_);
+      if (n > room)
+      {
+        n = room;
+      }
+    }
+    for (size_t i = 0; i < n; ++i, ++first)
+    {
+      new (&slots_[(tail + i) & mask_].storage) T(std::move(*first));
+    }
+    __atomic_store_n(&tail_, tail + n, __ATOMIC_RELEASE);
+    return n;
+  }
+
+  // consumer side
+
+  /// Returns false if empty.
+  bool tryPop(T* x)
+  {
+    return consume([x](T& item) { *x = std::move(item); }, 1) == 1;
+  }
+
+  /// Moves up to maxItems items to out, returns the number popped.
+  size_t tryPopBatch(T* out, size_t maxItems)
+  {
+    return consume([&out](T& item) { *out++ = std::move(item); }, maxItems);
+  }
+
+  /// Calls f(T&) on up to maxItems items in place, then destroys them,
+  /// returns the number consumed.  f must not throw.
+  template<typename Func>
+  size_t consume(Func&& f, size_t maxItems)
+  {
+    size_t head = head_;
+    size_t n = tailCache_ - head;
+    if (n < maxItems)
+    {
+      tailCache_ = __atomic_load_n(&tail_, __ATOMIC_ACQUIRE);
+      n = tailCache_ - head;
+    }
+    if (n > maxItems)
+    {
+      n = maxItems;
+    }
+    for (size_t i = 0; i < n; ++i)
+    {
+      T* item = slots_[(head + i) & mask_].value();
+      f(*item);
+      item->~T();
+    }
+    if (n > 0)
+    {
+      __atomic_store_n(&head_, head + n, __ATOMIC_RELEASE);
+    }
+    return n;
+  }
+
+  /// Exact on the consumer side, may be stale on the producer side.
+  bool empty() const
+  {
+    return __atomic_load_n(&head_, __ATOMIC_ACQUIRE)
+        == __atomic_load_n(&tail_, __ATOMIC_ACQUIRE);
+  }
+
+  /// Approximate if called concurrently with both sides.
+  size_t size() const
+  {
+    size_t head = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+    size_t tail = __atomic_load_n(&tail_, __ATOMIC_ACQUIRE);
+    return tail - head;
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+ private:
+  static const size_t kCacheLineSize = 64;
+
+  struct Slot
+  {
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+    T* value() { return reinterpret_cast<T*>(&storage); }
+  };
+
+  static size_t roundUp(size_t n)
+  {
+    size_t size = 2;
+    while (size < n)
+    {
+      size *= 2;
+    }
+    return size;
+  }
+
+  template<typename U>
+  bool push(U&& x)
+  {
+    size_t tail = tail_;
+    if (tail - headCache_ == capacity())
+    {
+      headCache_ = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+      if (tail - headCache_ == capacity())
+      {
+        return false;
+      }
+    }
+    new (&slots_[tail & mask_].storage) T(std::forward<U>(x));
+    __atomic_store_n(&tail_, tail + 1, __ATOMIC_RELEASE);
+    return true;
+  }
+
+  const size_t mask_;
+  const std::unique_ptr<Slot[]> slots_;
+  char pad0_[kCacheLineSize];
+  // consumer
+  size_t head_;  // __atomic
+  size_t tailCache_;
+  char pad1_[kCacheLineSize - 2 * sizeof(size_t)];
+  // producer
+  size_t tail_;  // __atomic
+  size_t headCache_;
+  char pad2_[kCacheLineSize - 2 * sizeof(size_t)];
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_SPSCQUEUE_H
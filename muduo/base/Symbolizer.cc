@@ -0,0 +1,70 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/base/Symbolizer.h"
+
+#include <algorithm>
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace muduo;
+
+const string& Symbolizer::symbolize(void* pc)
+{
+  std::map<void*, string>::iterator it = symbols_.find(pc);
+  if (it != symbols_.end())
+  {
+    return it->second;
+  }
+
+  string name;
+  Dl_info info;
+  memZero(&info, sizeof info);
+  if (::dladdr(pc, &info) && info.dli_sname)
+  {
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(info.dli_sname, NULL, NULL, &status);
+    name = status == 0 ? demangled : info.dli_sname;
+    ::free(demangled);
+  }
+  else
+  {
+    char buf[64];
+    if (info.dli_fname)
+    {
+      const char* slash = ::strrchr(info.dli_fname, '/');
+      snprintf(buf, sizeof buf, "%.32s+%#zx",
+               slash ? slash + 1 : info.dli_fname,
+               static_cast<size_t>(static_cast<char*>(pc) - static_cast<char*>(info.dli_fbase)));
+    }
+    else
+    {
+      snprintf(buf, sizeof buf, "%p", pc);
+    }
+    name = buf;
+  }
+  // ';' separates frames in folded stacks
+  std::replace(name.begin(), name.end(), ';', ':');
+  return symbols_[pc] = name;
+}
+
+void Symbolizer::appendFolded(void* const* frames, size_t depth, bool exactLeaf, string* line)
+{
+  for (size_t i = depth; i > 0; --i)
+  {
+    void* pc = frames[i-1];
+    if (i > 1 || !exactLeaf)
+    {
+      // look up the call instruction, not the one after it
+      pc = static_cast<char*>(pc) - 1;
+    }
+    line->push_back(';');
+    line->append(symbolize(pc));
+  }
+}
@@ -0,0 +1,40 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_SYMBOLIZER_H
+#define MUDUO_BASE_SYMBOLIZER_H
+
+#include "muduo/base/Types.h"
+#include "muduo/base/noncopyable.h"
+
+#include <map>
+
+namespace muduo
+{
+
+///
+/// Demangled names of code addresses from dladdr(3), cached, for
+/// stacks from backtrace(3).  Build with -rdynamic to see names of
+/// functions of the executable, others are "module+0xoffset".
+///
+/// Not thread safe.
+///
+class Symbolizer : noncopyable
+{
+ public:
+  const string& symbolize(void* pc);
+
+  /// Appends ";outer;...;inner" in folded stack format, frames are
+  /// innermost first, return addresses except frames[0] if exactLeaf,
+  /// eg. an interrupted pc.
+  void appendFolded(void* const* frames, size_t depth, bool exactLeaf, string* line);
+
+ private:
+  std::map<void*, string> symbols_;
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_SYMBOLIZER_H
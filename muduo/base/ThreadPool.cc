@@ -6,6 +6,7 @@
 #include "muduo/base/ThreadPool.h"
 
 #include "muduo/base/Exception.h"
+#include "muduo/base/Timestamp.h"
 
 #include <assert.h>
 #include <stdio.h>
@@ -77,6 +78,7 @@ void ThreadPool::run(Task task)
   }
   else
   {
+    int64_t now = codel_ ? Timestamp::now().microSecondsSinceEpoch() : 0;
     MutexLockGuard lock(mutex_);
     while (isFull() && running_)
     {
@@ -85,11 +87,33 @@ void ThreadPool::run(Task task)
     if (!running_) return;
     assert(!isFull());
 
-    queue_.push_back(std::move(task));
+    queue_.push_back(QueuedTask { std::move(task), now });
     notEmpty_.notify();
   }
 }
 
+bool ThreadPool::tryRun(Task task)
+{
+  if (threads_.empty())
+  {
+    task();
+    return true;
+  }
+  if (overloaded())
+  {
+    return false;
+  }
+  int64_t now = codel_ ? Timestamp::now().microSecondsSinceEpoch() : 0;
+  MutexLockGuard lock(mutex_);
+  if (isFull() || !running_)
+  {
+    return false;
+  }
+  queue_.push_back(QueuedTask { std::move(task), now });
+  notEmpty_.notify();
+  return true;
+}
+
 ThreadPool::Task ThreadPool::take()
 {
   MutexLockGuard lock(mutex_);
@@ -101,8 +125,17 @@ ThreadPool::Task ThreadPool::take()
   Task task;
   if (!queue_.empty())
   {
-    task = queue_.front();
+    task.swap(queue_.front().task);
+    if (codel_)
+    {
+      int64_t now = Timestamp::now().microSecondsSinceEpoch();
+      codel_->onDequeue(now - queue_.front().enqueuedUs, now);
+    }
     queue_.pop_front();
+    if (codel_ && queue_.empty())
+    {
+      codel_->onEmpty();
+    }
     if (maxQueueSize_ > 0)
     {
       notFull_.notify();
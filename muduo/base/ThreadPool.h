@@ -6,6 +6,7 @@
 #ifndef MUDUO_BASE_THREADPOOL_H
 #define MUDUO_BASE_THREADPOOL_H
 
+#include "muduo/base/CoDel.h"
 #include "muduo/base/Condition.h"
 #include "muduo/base/Mutex.h"
 #include "muduo/base/Thread.h"
@@ -27,6 +28,10 @@ class ThreadPool : noncopyable
 
   // Must be called before start().
   void setMaxQueueSize(int maxSize) { maxQueueSize_ = maxSize; }
+  // Must be called before start().
+  // Measures queueing delay of tasks, see overloaded() and tryRun().
+  void enableCoDel(double targetSeconds = 0.005, double intervalSeconds = 0.1)
+  { codel_.reset(new CoDel(targetSeconds, intervalSeconds)); }
   void setThreadInitCallback(const Task& cb)
   { threadInitCallback_ = cb; }
 
@@ -46,6 +51,15 @@ class ThreadPool : noncopyable
   // https://stackoverflow.com/a/25408989
   void run(Task f);
 
+  // Never blocks, returns false if the task is not queued because
+  // the pool is overloaded, full or stopped.
+  bool tryRun(Task f);
+
+  // Queueing delay stays above target, false if CoDel is not enabled.
+  // Thread safe.
+  bool overloaded() const { return codel_ && codel_->overloaded(); }
+  const CoDel* codel() const { return codel_.get(); }
+
  private:
   bool isFull() const REQUIRES(mutex_);
   void runInThread();
@@ -57,9 +71,16 @@ class ThreadPool : noncopyable
   string name_;
   Task threadInitCallback_;
   std::vector<std::unique_ptr<muduo::Thread>> threads_;
-  std::deque<Task> queue_ GUARDED_BY(mutex_);
+  struct QueuedTask
+  {
+    Task task;
+    int64_t enqueuedUs;  // 0 without CoDel
+  };
+
+  std::deque<QueuedTask> queue_ GUARDED_BY(mutex_);
   size_t maxQueueSize_;
   bool running_;
+  std::unique_ptr<CoDel> codel_;  // accessed in take() GUARDED_BY(mutex_)
 };
 
 }  // namespace muduo
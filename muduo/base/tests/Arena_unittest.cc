@@ -0,0 +1,134 @@
+#include "muduo/base/Arena.h"
+
+#include <map>
+#include <new>
+#include <vector>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//#define BOOST_TEST_MODULE ArenaTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using namespace muduo;
+
+int64_t g_allocations = 0;
+
+void* operator new(size_t size)
+{
+  ++g_allocations;
+  void* p = ::malloc(size);
+  if (p == NULL)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept
+{
+  ::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+  ::free(p);
+}
+
+typedef std::map<ArenaString, ArenaString, std::less<ArenaString>,
+                 ArenaAllocator<std::pair<const ArenaString, ArenaString>>> StringMap;
+
+bool aligned(void* p, size_t alignment)
+{
+  return reinterpret_cast<uintptr_t>(p) % alignment == 0;
+}
+
+BOOST_AUTO_TEST_CASE(testAllocate)
+{
+  Arena arena(1024);
+  BOOST_CHECK_EQUAL(arena.blocksCreated(), 0);
+  char* p1 = static_cast<char*>(arena.allocate(1, 1));
+  char* p2 = static_cast<char*>(arena.allocate(1, 1));
+  BOOST_CHECK(p2 == p1 + 1);
+  BOOST_CHECK(aligned(arena.allocate(8), Arena::kMaxAlign));
+  BOOST_CHECK(aligned(arena.allocate(3, 4), 4));
+  BOOST_CHECK_EQUAL(arena.blocksCreated(), 1);
+
+  // larger than a quarter of block
+  void* large = arena.allocate(10000);
+  BOOST_CHECK_EQUAL(arena.blocksCreated(), 2);
+  char* p3 = static_cast<char*>(arena.allocate(1, 1));
+  BOOST_CHECK(p3 > p1);
+  BOOST_CHECK(p3 < p1 + 1024);
+  memset(large, 0, 10000);
+
+  for (int i = 0; i < 100; ++i)
+  {
+    memset(arena.allocate(100), 0, 100);
+  }
+  BOOST_CHECK(arena.allocatedBytes() >= 10000 + 100 * 100);
+
+  // keeps one block
+  int64_t blocks = arena.blocksCreated();
+  arena.reset();
+  BOOST_CHECK_EQUAL(arena.allocatedBytes(), 0);
+  for (int round = 0; round < 10; ++round)
+  {
+    for (int i = 0; i < 8; ++i)
+    {
+      arena.allocate(100);
+    }
+    arena.reset();
+  }
+  BOOST_CHECK_EQUAL(arena.blocksCreated(), blocks);
+}
+
+BOOST_AUTO_TEST_CASE(testContainers)
+{
+  Arena arena;
+  int64_t before = g_allocations;
+  {
+    StringMap headers(std::less<ArenaString>(), &arena);
+    for (int i = 0; i < 10; ++i)
+    {
+      char key[32];
+      snprintf(key, sizeof key, "X-Header-Number-%d", i);
+      headers[ArenaString(key, &arena)] =
+          ArenaString("a value longer than the small string buffer", &arena);
+    }
+    std::vector<int, ArenaAllocator<int>> v(&arena);
+    for (int i = 0; i < 1000; ++i)
+    {
+      v.push_back(i);
+    }
+    BOOST_CHECK_EQUAL(headers.size(), 10);
+    BOOST_CHECK_EQUAL(headers.begin()->second.size(), 43);
+    BOOST_CHECK_EQUAL(g_allocations, before);
+
+    // copies allocate on heap, so they may outlive the arena
+    StringMap copy(headers);
+    BOOST_CHECK(copy.get_allocator().arena() == NULL);
+    BOOST_CHECK(g_allocations > before);
+    arena.reset();
+    BOOST_CHECK_EQUAL(copy.rbegin()->first, "X-Header-Number-9");
+  }
+
+  // heap if no arena
+  before = g_allocations;
+  ArenaString s("a string longer than the small string buffer");
+  BOOST_CHECK_EQUAL(g_allocations, before + 1);
+}
+
+BOOST_AUTO_TEST_CASE(testSwap)
+{
+  Arena arena1, arena2;
+  StringMap m1(std::less<ArenaString>(), &arena1);
+  StringMap m2(std::less<ArenaString>(), &arena2);
+  m1[ArenaString("key", &arena1)] = ArenaString("value of map one on arena one", &arena1);
+  m1.swap(m2);
+  BOOST_CHECK_EQUAL(m2.get_allocator().arena(), &arena1);
+  BOOST_CHECK(m1.empty());
+  BOOST_CHECK_EQUAL(m2.size(), 1);
+}
@@ -1,8 +1,16 @@
 #include "muduo/base/AsyncLogging.h"
+#include "muduo/base/CountDownLatch.h"
 #include "muduo/base/Logging.h"
+#include "muduo/base/Thread.h"
 #include "muduo/base/Timestamp.h"
 
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <inttypes.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <sys/resource.h>
 #include <unistd.h>
 
@@ -15,7 +23,8 @@ void asyncOutput(const char* msg, int len)
   g_asyncLog->append(msg, len);
 }
 
-void bench(bool longLog)
+// returns average microseconds per message
+double bench(bool longLog, bool verbose, muduo::CountDownLatch* startLatch)
 {
   muduo::Logger::setOutput(asyncOutput);
 
@@ -25,7 +34,11 @@ void bench(bool longLog)
   muduo::string longStr(3000, 'X');
   longStr += " ";
 
-  for (int t = 0; t < 30; ++t)
+  startLatch->countDown();
+  startLatch->wait();
+  double total = 0;
+  const int kRounds = 30;
+  for (int t = 0; t < kRounds; ++t)
   {
     muduo::Timestamp start = muduo::Timestamp::now();
     for (int i = 0; i < kBatch; ++i)
@@ -36,12 +49,19 @@ void bench(bool longLog)
       ++cnt;
     }
     muduo::Timestamp end = muduo::Timestamp::now();
-    printf("%f\n", timeDifference(end, start)*1000000/kBatch);
+    double usPerMessage = timeDifference(end, start)*1000000/kBatch;
+    total += usPerMessage;
+    if (verbose)
+    {
+      printf("%f\n", usPerMessage);
+    }
     struct timespec ts = { 0, 500*1000*1000 };
     nanosleep(&ts, NULL);
   }
+  return total / kRounds;
 }
 
+// usage: asynclogging_test [-l] [-d] [-t threads] [-r ring_bytes_per_thread]
 int main(int argc, char* argv[])
 {
   {
@@ -51,14 +71,74 @@ int main(int argc, char* argv[])
     setrlimit(RLIMIT_AS, &rl);
   }
 
+  bool longLog = false;
+  bool directFile = false;
+  int numThreads = 1;
+  size_t ringBytes = 0;
+  int opt;
+  while ((opt = getopt(argc, argv, "ldt:r:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'l':
+        longLog = true;
+        break;
+      case 'd':
+        directFile = true;
+        break;
+      case 't':
+        numThreads = atoi(optarg);
+        break;
+      case 'r':
+        ringBytes = static_cast<size_t>(atol(optarg));
+        break;
+      default:
+        fprintf(stderr, "Usage: %s [-l] [-d] [-t threads] [-r ring_bytes_per_thread]\n", argv[0]);
+        return 1;
+    }
+  }
+
   printf("pid = %d\n", getpid());
 
   char name[256] = { '\0' };
   strncpy(name, argv[0], sizeof name - 1);
   muduo::AsyncLogging log(::basename(name), kRollSize);
+  if (ringBytes > 0)
+  {
+    log.enableThreadLocalBuffers(ringBytes);
+  }
+  if (directFile)
+  {
+    log.setWriterFactory(muduo::LogFile::newDirectFile);
+  }
   log.start();
   g_asyncLog = &log;
 
-  bool longLog = argc > 1;
-  bench(longLog);
+  muduo::CountDownLatch startLatch(numThreads);
+  std::vector<double> results(numThreads);
+  std::vector<std::unique_ptr<muduo::Thread>> threads;
+  for (int i = 0; i < numThreads; ++i)
+  {
+    double* result = &results[i];
+    threads.emplace_back(new muduo::Thread([=, &startLatch] {
+      *result = bench(longLog, numThreads == 1, &startLatch);
+    }));
+    threads.back()->start();
+  }
+  for (const auto& thr : threads)
+  {
+    thr->join();
+  }
+  log.stop();
+
+  double sum = 0;
+  for (double r : results)
+  {
+    sum += r;
+  }
+  printf("%s buffers, %d threads, %s log: avg %.3f us, max %.3f us per message, "
+         "dropped %" PRId64 " bytes\n",
+         ringBytes > 0 ? "thread-local" : "global", numThreads, longLog ? "long" : "short",
+         sum / numThreads, *std::max_element(results.begin(), results.end()),
+         log.droppedBytes());
 }
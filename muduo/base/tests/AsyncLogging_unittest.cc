@@ -0,0 +1,157 @@
+#include "muduo/base/AsyncLogging.h"
+#include "muduo/base/FileUtil.h"
+#include "muduo/base/Thread.h"
+
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+//#define BOOST_TEST_MODULE AsyncLoggingTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using namespace muduo;
+
+// runs in a directory of its own, removed at exit
+struct TemporaryDirectory
+{
+  char dir[64];
+
+  TemporaryDirectory()
+  {
+    snprintf(dir, sizeof dir, "/tmp/asynclogging_unittest.XXXXXX");
+    if (::mkdtemp(dir) == NULL || ::chdir(dir) != 0)
+    {
+      perror("mkdtemp");
+      abort();
+    }
+  }
+
+  ~TemporaryDirectory()
+  {
+    ::rmdir(dir);
+  }
+};
+
+BOOST_GLOBAL_FIXTURE(TemporaryDirectory);
+
+// contents of all log files of basename in current directory
+string readLogs(const string& basename)
+{
+  string content;
+  DIR* dir = ::opendir(".");
+  while (struct dirent* ent = ::readdir(dir))
+  {
+    if (strncmp(ent->d_name, basename.c_str(), basename.size()) == 0)
+    {
+      string file;
+      FileUtil::readFile(ent->d_name, 256 * 1024 * 1024, &file);
+      content += file;
+      ::unlink(ent->d_name);
+    }
+  }
+  ::closedir(dir);
+  return content;
+}
+
+// appends kLines of "thread seq\n" in each thread, checks per-thread order
+void checkThreadLocal(const string& basename, size_t ringBytes, int numThreads, bool expectDrops)
+{
+  const int kLines = 50000;
+  int64_t totalBytes = 0;
+  {
+    AsyncLogging log(basename, 1024 * 1024 * 1024);
+    log.enableThreadLocalBuffers(ringBytes);
+    log.start();
+
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int t = 0; t < numThreads; ++t)
+    {
+      threads.emplace_back(new Thread([&log, t] {
+        for (int i = 0; i < kLines; ++i)
+        {
+          char line[64];
+          int len = snprintf(line, sizeof line, "%d %d\n", t, i);
+          log.append(line, len);
+        }
+      }));
+      threads.back()->start();
+    }
+    for (int t = 0; t < numThreads; ++t)
+    {
+      threads[t]->join();
+      for (int i = 0; i < kLines; ++i)
+      {
+        char line[64];
+        totalBytes += snprintf(line, sizeof line, "%d %d\n", t, i);
+      }
+    }
+    log.stop();
+
+    string content = readLogs(basename);
+    std::vector<int> last(numThreads, -1);
+    int64_t logged = 0;
+    bool ordered = true;
+    for (const char* p = content.c_str(); *p; )
+    {
+      if (strncmp(p, "Dropped", 7) == 0)
+      {
+        p = strchr(p, '\n') + 1;
+        continue;
+      }
+      const char* eol = strchr(p, '\n');
+      int t = -1, i = -1;
+      sscanf(p, "%d %d", &t, &i);
+      if (t < 0 || t >= numThreads || i <= last[t])
+      {
+        ordered = false;
+        break;
+      }
+      last[t] = i;
+      logged += eol + 1 - p;
+      p = eol + 1;
+    }
+    printf("ring %zd, %d threads: logged %lld bytes, dropped %lld bytes\n",
+           ringBytes, numThreads, static_cast<long long>(logged),
+           static_cast<long long>(log.droppedBytes()));
+    BOOST_CHECK(ordered);
+    BOOST_CHECK_EQUAL(logged + log.droppedBytes(), totalBytes);
+    BOOST_CHECK_EQUAL(expectDrops, (log.droppedBytes() > 0));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testThreadLocal)
+{
+  // large enough for all lines
+  checkThreadLocal("nodrop", 4 * 1024 * 1024, 4, false);
+  // a small ring overflows
+  checkThreadLocal("drop", 4096, 4, true);
+}
+
+// a thread keeps its ring of a destroyed AsyncLogging,
+// it must not be taken for the one of a new AsyncLogging at the same address
+BOOST_AUTO_TEST_CASE(testSameAddress)
+{
+  std::aligned_storage<sizeof(AsyncLogging), alignof(AsyncLogging)>::type storage;
+  for (int round = 0; round < 2; ++round)
+  {
+    char basename[32];
+    snprintf(basename, sizeof basename, "reuse%d", round);
+    AsyncLogging* log = new (&storage) AsyncLogging(basename, 1024 * 1024 * 1024);
+    log->enableThreadLocalBuffers(4096);
+    log->start();
+    char line[32];
+    int len = snprintf(line, sizeof line, "round %d\n", round);
+    log->append(line, len);
+    log->stop();
+    log->~AsyncLogging();
+    BOOST_CHECK_EQUAL(readLogs(basename), line);
+  }
+}
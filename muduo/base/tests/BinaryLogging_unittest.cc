@@ -0,0 +1,360 @@
+#include "muduo/base/BinaryLogging.h"
+#include "muduo/base/AsyncLogging.h"
+#include "muduo/base/FileUtil.h"
+#include "muduo/base/Thread.h"
+
+#include <memory>
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+//#define BOOST_TEST_MODULE BinaryLoggingTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using namespace muduo;
+
+// runs in a directory of its own, removed at exit
+struct TemporaryDirectory
+{
+  char dir[64];
+
+  TemporaryDirectory()
+  {
+    snprintf(dir, sizeof dir, "/tmp/binarylogging_unittest.XXXXXX");
+    if (::mkdtemp(dir) == NULL || ::chdir(dir) != 0)
+    {
+      perror("mkdtemp");
+      abort();
+    }
+  }
+
+  ~TemporaryDirectory()
+  {
+    ::rmdir(dir);
+  }
+};
+
+BOOST_GLOBAL_FIXTURE(TemporaryDirectory);
+
+string g_captured;
+
+void capture(const char* msg, int len)
+{
+  g_captured.append(msg, len);
+}
+
+void stdoutOutput(const char* msg, int len)
+{
+  fwrite(msg, 1, len, stdout);
+}
+
+AsyncLogging* g_asyncLog = NULL;
+
+void asyncOutput(const char* msg, int len)
+{
+  g_asyncLog->append(msg, len);
+}
+
+// strips time and source file, "20261019 03:51:15.123456Z "
+string message(const string& line)
+{
+  const size_t kTimeLen = 26;
+  size_t end = line.rfind(" - ");
+  if (line.size() < kTimeLen || end == string::npos)
+    return "malformed: " + line;
+  return line.substr(kTimeLen, end - kTimeLen);
+}
+
+const string kLongString(2000, 'x');
+
+void logText()
+{
+  LOG_INFO << "conn " << 42 << " read " << -3.5 << " bytes " << true << ' ' << 'x'
+           << " " << string("abc") << " " << 123456789012345LL << " " << 7u;
+  LOG_WARN << "pointer " << reinterpret_cast<const void*>(0x1234) << " ";
+}
+
+void logBinary()
+{
+  LOG_BINARY_INFO("conn {} read {} bytes {} {} {} {} {}",
+                  42, -3.5, true, 'x', string("abc"), 123456789012345LL, 7u);
+  LOG_BINARY_WARN("pointer {} {}", reinterpret_cast<const void*>(0x1234), StringPiece(""));
+}
+
+std::vector<string> lines(const string& text)
+{
+  std::vector<string> result;
+  size_t start = 0, eol = 0;
+  while ((eol = text.find('\n', start)) != string::npos)
+  {
+    result.push_back(text.substr(start, eol + 1 - start));
+    start = eol + 1;
+  }
+  return result;
+}
+
+void checkSame(const string& text, const string& binary)
+{
+  std::vector<string> expected = lines(text);
+  std::vector<string> actual = lines(binary);
+  bool same = expected.size() == actual.size();
+  for (size_t i = 0; same && i < expected.size(); ++i)
+  {
+    same = message(expected[i]) == message(actual[i]);
+    if (!same)
+      printf("'%s' != '%s'\n", message(expected[i]).c_str(), message(actual[i]).c_str());
+  }
+  BOOST_CHECK(same);
+}
+
+BOOST_AUTO_TEST_CASE(testFormatInCaller)
+{
+  Logger::setOutput(capture);
+  g_captured.clear();
+  logText();
+  string text = g_captured;
+  g_captured.clear();
+  logBinary();
+  Logger::setOutput(stdoutOutput);
+  checkSame(text, g_captured);
+}
+
+BOOST_AUTO_TEST_CASE(testDecode)
+{
+  Logger::setOutput(capture);
+  g_captured.clear();
+  logText();
+  string text = g_captured;
+  g_captured.clear();
+
+  BinaryLogger::setOutput(capture);
+  logBinary();
+  LOG_INFO << "a text line";
+  LOG_BINARY_INFO("too long {} {}", kLongString, 1);
+  LOG_BINARY_INFO("missing {} {}", 1);
+  BinaryLogger::setOutput(NULL);
+  // as a backend, before the records
+  string binary;
+  BinaryLogger::appendDefinitions(0, &binary);
+  binary += g_captured;
+  Logger::setOutput(stdoutOutput);
+  BOOST_CHECK(binary.size() < text.size() + 2 * BinaryLogger::kMaxRecordSize + 200);
+
+  // decodes in small pieces
+  BinaryLogDecoder decoder;
+  string decoded;
+  string pending;
+  for (size_t i = 0; i < binary.size(); i += 7)
+  {
+    pending.append(binary, i, 7);
+    size_t n = decoder.decode(pending.data(), pending.size(), &decoded);
+    pending.erase(0, n);
+  }
+  BOOST_CHECK(pending.empty());
+  BOOST_CHECK(decoder.numSites() >= 4);
+
+  std::vector<string> decodedLines = lines(decoded);
+  BOOST_REQUIRE_EQUAL(decodedLines.size(), 5);
+  checkSame(text, decodedLines[0] + decodedLines[1]);
+  BOOST_CHECK(decodedLines[2].find("INFO  a text line - ") != string::npos);
+  BOOST_CHECK(decodedLines[3].find("too long xxxx") != string::npos);
+  BOOST_CHECK(decodedLines[3].size() < BinaryLogger::kMaxRecordSize + 100);
+  BOOST_CHECK(decodedLines[4].find("missing 1 {?} - ") != string::npos);
+}
+
+// contents of each log file of basename in current directory
+std::vector<string> readLogFiles(const char* basename)
+{
+  std::vector<string> files;
+  DIR* d = ::opendir(".");
+  while (struct dirent* ent = ::readdir(d))
+  {
+    if (strncmp(ent->d_name, basename, strlen(basename)) == 0)
+    {
+      files.push_back(string());
+      FileUtil::readFile(ent->d_name, 64 * 1024 * 1024, &files.back());
+      ::unlink(ent->d_name);
+    }
+  }
+  ::closedir(d);
+  return files;
+}
+
+string readLogs(const char* basename)
+{
+  string content;
+  for (const string& file : readLogFiles(basename))
+  {
+    content += file;
+  }
+  return content;
+}
+
+// a call site each
+template<int N>
+void logSite(int thread)
+{
+  LOG_BINARY_INFO("site {} thread {}", N, thread);
+}
+
+typedef void (*LogSiteFunc)(int);
+
+template<int N>
+struct SiteTable
+{
+  static void fill(LogSiteFunc* table)
+  {
+    table[N - 1] = &logSite<N - 1>;
+    SiteTable<N - 1>::fill(table);
+  }
+};
+
+template<>
+struct SiteTable<0>
+{
+  static void fill(LogSiteFunc*) {}
+};
+
+// definitions of new sites go into full rings, and are dropped
+BOOST_AUTO_TEST_CASE(testThreadLocalDrops)
+{
+  const int kSites = 64;
+  LogSiteFunc sites[kSites];
+  SiteTable<kSites>::fill(sites);
+
+  int64_t dropped = 0;
+  {
+    AsyncLogging log("drops", 1024 * 1024 * 1024);
+    log.enableThreadLocalBuffers(4096);
+    log.setFormatBinaryLogs(true);
+    log.start();
+    g_asyncLog = &log;
+    BinaryLogger::setOutput(asyncOutput);
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+      threads.emplace_back(new Thread([&log, &sites, t] {
+        for (int i = 0; i < kSites; ++i)
+        {
+          char line[64];
+          for (int j = 0; j < 100; ++j)
+          {
+            int len = snprintf(line, sizeof line, "filling the ring %d %d\n", t, j);
+            log.append(line, len);
+          }
+          sites[i](t);
+        }
+      }));
+      threads.back()->start();
+    }
+    for (auto& thr : threads)
+    {
+      thr->join();
+    }
+    // 16 records fit in the empty ring of a new thread, never dropped
+    for (int first = 0; first < kSites; first += 16)
+    {
+      Thread thread([&sites, first] {
+        for (int i = first; i < first + 16; ++i)
+        {
+          sites[i](-1);
+        }
+      });
+      thread.start();
+      thread.join();
+    }
+    BinaryLogger::setOutput(NULL);
+    log.stop();
+    dropped = log.droppedBytes();
+  }
+
+  string content = readLogs("drops");
+  int records = 0;
+  int kept = 0;
+  for (const string& line : lines(content))
+  {
+    if (line.find("INFO  site ") != string::npos)
+      ++records;
+    if (line.find(" thread -1 - ") != string::npos)
+      ++kept;
+  }
+  printf("dropped %lld bytes, %d records of sites\n", static_cast<long long>(dropped), records);
+  BOOST_CHECK_EQUAL(kept, kSites);
+  BOOST_CHECK_EQUAL(content.find("unknown site"), string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(testAsyncLogging)
+{
+  {
+    AsyncLogging log("binary", 1024 * 1024 * 1024);
+    log.setFormatBinaryLogs(true);
+    log.start();
+    g_asyncLog = &log;
+    Logger::setOutput(asyncOutput);
+    BinaryLogger::setOutput(asyncOutput);
+    for (int i = 0; i < 1000; ++i)
+    {
+      LOG_BINARY_INFO("binary {}", i);
+      LOG_INFO << "text " << i;
+    }
+    BinaryLogger::setOutput(NULL);
+    Logger::setOutput(stdoutOutput);
+    log.stop();
+  }
+
+  string content = readLogs("binary.");
+  std::vector<string> all = lines(content);
+  bool ordered = all.size() == 2000;
+  for (size_t i = 0; ordered && i < all.size(); ++i)
+  {
+    char expected[64];
+    snprintf(expected, sizeof expected, "INFO  %s %zd - ", i % 2 ? "text" : "binary", i / 2);
+    ordered = all[i].find(expected) != string::npos;
+  }
+  BOOST_CHECK_EQUAL(content.find('\0'), string::npos);
+  BOOST_CHECK(ordered);
+}
+
+// a file rolls at most once a second
+BOOST_AUTO_TEST_CASE(testRolledFiles)
+{
+  {
+    AsyncLogging log("rolled", 100, 1);
+    log.enableThreadLocalBuffers(4096);
+    log.start();
+    g_asyncLog = &log;
+    BinaryLogger::setOutput(asyncOutput);
+    for (int i = 0; i < 3; ++i)
+    {
+      if (i > 0)
+        ::usleep(1200 * 1000);
+      LOG_BINARY_INFO("rolled {}", i);
+    }
+    BinaryLogger::setOutput(NULL);
+    log.stop();
+  }
+
+  std::vector<string> files = readLogFiles("rolled.");
+  int records = 0;
+  bool decodable = true;
+  for (const string& file : files)
+  {
+    BinaryLogDecoder decoder;
+    string text;
+    decodable = decodable && decoder.decode(file.data(), file.size(), &text) == file.size() &&
+                text.find("unknown site") == string::npos;
+    for (const string& line : lines(text))
+    {
+      if (line.find("INFO  rolled ") != string::npos)
+        ++records;
+    }
+  }
+  printf("%zd files\n", files.size());
+  BOOST_CHECK(files.size() >= 2);
+  BOOST_CHECK_EQUAL(records, 3);
+  BOOST_CHECK(decodable);
+}
@@ -1,6 +1,8 @@
 #include "muduo/base/BlockingQueue.h"
+#include "muduo/base/BoundedBlockingQueue.h"
 #include "muduo/base/CountDownLatch.h"
 #include "muduo/base/Logging.h"
+#include "muduo/base/MpmcQueue.h"
 #include "muduo/base/Thread.h"
 #include "muduo/base/Timestamp.h"
 
@@ -12,7 +14,23 @@
 
 bool g_verbose = false;
 
+const int kCapacity = 1024;
+
+// bounded queues with the same constructor as BlockingQueue
+template<typename T>
+struct BoundedQueue : muduo::BoundedBlockingQueue<T>
+{
+  BoundedQueue() : muduo::BoundedBlockingQueue<T>(kCapacity) {}
+};
+
+template<typename T>
+struct MpmcQueue : muduo::MpmcBlockingQueue<T>
+{
+  MpmcQueue() : muduo::MpmcBlockingQueue<T>(kCapacity) {}
+};
+
 // Many threads, one queue.
+template<template<typename> class Queue>
 class Bench
 {
  public:
@@ -104,17 +122,31 @@ class Bench
     }
   }
 
-  muduo::BlockingQueue<muduo::Timestamp> queue_;
-  muduo::BlockingQueue<int> delay_queue_;
+  Queue<muduo::Timestamp> queue_;
+  Queue<int> delay_queue_;
   muduo::CountDownLatch latch_;
   std::vector<std::unique_ptr<muduo::Thread>> threads_;
 };
 
+template<template<typename> class Queue>
+void bench(const char* name, int threads)
+{
+  printf("%s\n", name);
+  Bench<Queue> t(threads);
+  t.run(100000);
+  t.joinAll();
+}
+
+// blockingqueue_bench [threads] [blocking|bounded|mpmc]
 int main(int argc, char* argv[])
 {
   int threads = argc > 1 ? atoi(argv[1]) : 1;
+  std::string queue = argc > 2 ? argv[2] : "";
 
-  Bench t(threads);
-  t.run(100000);
-  t.joinAll();
+  if (queue.empty() || queue == "blocking")
+    bench<muduo::BlockingQueue>("BlockingQueue", threads);
+  if (queue.empty() || queue == "bounded")
+    bench<BoundedQueue>("BoundedBlockingQueue", threads);
+  if (queue.empty() || queue == "mpmc")
+    bench<MpmcQueue>("MpmcBlockingQueue", threads);
 }
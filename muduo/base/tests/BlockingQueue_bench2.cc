@@ -1,5 +1,7 @@
 #include "muduo/base/BlockingQueue.h"
+#include "muduo/base/BoundedBlockingQueue.h"
 #include "muduo/base/CountDownLatch.h"
+#include "muduo/base/MpmcQueue.h"
 #include "muduo/base/Thread.h"
 #include "muduo/base/Timestamp.h"
 
@@ -9,8 +11,24 @@
 #include <stdio.h>
 #include <unistd.h>
 
+const int kCapacity = 16;
+
+// bounded queues with the same constructor as BlockingQueue
+template<typename T>
+struct BoundedQueue : muduo::BoundedBlockingQueue<T>
+{
+  BoundedQueue() : muduo::BoundedBlockingQueue<T>(kCapacity) {}
+};
+
+template<typename T>
+struct MpmcQueue : muduo::MpmcBlockingQueue<T>
+{
+  MpmcQueue() : muduo::MpmcBlockingQueue<T>(kCapacity) {}
+};
+
 // hot potato benchmarking https://en.wikipedia.org/wiki/Hot_potato
 // N threads, one hot potato.
+template<template<typename> class Queue>
 class Bench
 {
  public:
@@ -22,7 +40,7 @@ class Bench
     threads_.reserve(numThreads);
     for (int i = 0; i < numThreads; ++i)
     {
-      queues_.emplace_back(new muduo::BlockingQueue<int>());
+      queues_.emplace_back(new Queue<int>());
       char name[32];
       snprintf(name, sizeof name, "work thread %d", i);
       threads_.emplace_back(new muduo::Thread(
@@ -78,8 +96,8 @@ class Bench
   {
     startLatch_.countDown();
 
-    muduo::BlockingQueue<int>* input = queues_[id].get();
-    muduo::BlockingQueue<int>* output = queues_[(id+1) % queues_.size()].get();
+    Queue<int>* input = queues_[id].get();
+    Queue<int>* output = queues_[(id+1) % queues_.size()].get();
     while (true)
     {
       int value = input->take();
@@ -101,23 +119,39 @@ class Bench
     }
   }
 
-  using TimestampQueue = muduo::BlockingQueue<std::pair<int, muduo::Timestamp>>;
+  using TimestampQueue = Queue<std::pair<int, muduo::Timestamp>>;
   TimestampQueue done_;
   muduo::CountDownLatch startLatch_, stopLatch_;
-  std::vector<std::unique_ptr<muduo::BlockingQueue<int>>> queues_;
+  std::vector<std::unique_ptr<Queue<int>>> queues_;
   std::vector<std::unique_ptr<muduo::Thread>> threads_;
   const bool verbose_ = true;
 };
 
+template<template<typename> class Queue>
+void bench(const char* name, int threads)
+{
+  printf("%s\n", name);
+  Bench<Queue> t(threads);
+  t.Start();
+  t.Run();
+  t.Stop();
+}
+
+// blockingqueue_bench2 [threads] [blocking|bounded|mpmc]
 int main(int argc, char* argv[])
 {
   int threads = argc > 1 ? atoi(argv[1]) : 1;
+  std::string queue = argc > 2 ? argv[2] : "";
 
   printf("sizeof BlockingQueue = %zd\n", sizeof(muduo::BlockingQueue<int>));
+  printf("sizeof BoundedBlockingQueue = %zd\n", sizeof(muduo::BoundedBlockingQueue<int>));
+  printf("sizeof MpmcBlockingQueue = %zd\n", sizeof(muduo::MpmcBlockingQueue<int>));
   printf("sizeof deque<int> = %zd\n", sizeof(std::deque<int>));
-  Bench t(threads);
-  t.Start();
-  t.Run();
-  t.Stop();
+  if (queue.empty() || queue == "blocking")
+    bench<muduo::BlockingQueue>("BlockingQueue", threads);
+  if (queue.empty() || queue == "bounded")
+    bench<BoundedQueue>("BoundedBlockingQueue", threads);
+  if (queue.empty() || queue == "mpmc")
+    bench<MpmcQueue>("MpmcBlockingQueue", threads);
   // exit(0);
 }
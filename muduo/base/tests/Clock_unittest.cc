@@ -0,0 +1,101 @@
+#include "muduo/base/Clock.h"
+#include "muduo/base/Thread.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+//#define BOOST_TEST_MODULE ClockTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using namespace muduo;
+
+BOOST_AUTO_TEST_CASE(testCachedNow)
+{
+  // no EventLoop in this thread, falls back to Timestamp::now()
+  Timestamp t1 = Timestamp::now();
+  Timestamp cached = Clock::cachedNow();
+  Timestamp t2 = Timestamp::now();
+  BOOST_CHECK(t1 <= cached);
+  BOOST_CHECK(cached <= t2);
+
+  Timestamp fixed(Timestamp::now().microSecondsSinceEpoch() - 1000 * 1000);
+  Clock::setCachedNow(fixed);
+  BOOST_CHECK(Clock::cachedNow() == fixed);
+
+  // thread local
+  Timestamp other;
+  Thread thread([&other] { other = Clock::cachedNow(); });
+  thread.start();
+  thread.join();
+  BOOST_CHECK(other != fixed);
+
+  Clock::setCachedNow(Timestamp());
+  BOOST_CHECK(Clock::cachedNow() != fixed);
+}
+
+BOOST_AUTO_TEST_CASE(testCoarseNow)
+{
+  int64_t maxError = 0;
+  int64_t resolution = INT64_MAX;
+  Timestamp last = Clock::coarseNow();
+  for (int i = 0; i < 1000 * 1000; ++i)
+  {
+    Timestamp coarse = Clock::coarseNow();
+    int64_t error = Timestamp::now().microSecondsSinceEpoch() - coarse.microSecondsSinceEpoch();
+    if (error > maxError)
+      maxError = error;
+    int64_t step = coarse.microSecondsSinceEpoch() - last.microSecondsSinceEpoch();
+    if (step > 0 && step < resolution)
+      resolution = step;
+    last = coarse;
+  }
+  printf("coarseNow resolution %" PRId64 " us, max error %" PRId64 " us\n",
+         resolution, maxError);
+  // one jiffy is at most 10ms, leave room for preemption
+  BOOST_CHECK(maxError >= 0);
+  BOOST_CHECK(maxError < 100 * 1000);
+}
+
+BOOST_AUTO_TEST_CASE(testTscClock)
+{
+  TscClock& clock = TscClock::instance();
+  printf("TscClock usingTsc %d, %.3f ticks/ns\n",
+         clock.usingTsc(), clock.ticksPerNanosecond());
+
+  int64_t last = clock.nowNanos();
+  for (int i = 0; i < 1000 * 1000; ++i)
+  {
+    int64_t now = clock.nowNanos();
+    if (now < last)
+    {
+      BOOST_ERROR("TscClock goes backwards");
+      break;
+    }
+    last = now;
+  }
+
+  const int kRounds = 10;
+  int64_t maxError = 0;
+  for (int i = 0; i < kRounds; ++i)
+  {
+    ::usleep(20 * 1000);
+    int64_t mono = Clock::monotonicNanos();
+    int64_t tsc = clock.nowNanos();
+    int64_t error = llabs(tsc - mono);
+    if (error > maxError)
+      maxError = error;
+  }
+  printf("TscClock max error against CLOCK_MONOTONIC over %d ms: %" PRId64 " ns\n",
+         kRounds * 20, maxError);
+  // 10ms calibration gives ~100ppm, plus a few us of noise
+  BOOST_CHECK(maxError < 1000 * 1000);
+
+  int64_t realError = llabs(clock.now().microSecondsSinceEpoch()
+                            - Timestamp::now().microSecondsSinceEpoch());
+  printf("TscClock now() error against Timestamp::now(): %" PRId64 " us\n", realError);
+  BOOST_CHECK(realError < 10 * 1000);
+}
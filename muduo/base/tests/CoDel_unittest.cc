@@ -0,0 +1,100 @@
+#include "muduo/base/CoDel.h"
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/ThreadPool.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <unistd.h>
+
+//#define BOOST_TEST_MODULE CoDelTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using namespace muduo;
+
+BOOST_AUTO_TEST_CASE(testBurst)
+{
+  // target 5ms, interval 100ms
+  CoDel codel;
+  int64_t now = 1000 * 1000;
+  // a burst, some tasks wait long but the queue drains in 50ms
+  for (int i = 0; i < 50; ++i)
+  {
+    codel.onDequeue(20 * 1000, now);
+    now += 1000;
+  }
+  codel.onDequeue(100, now);
+  now += 100 * 1000;
+  codel.onDequeue(100, now);
+  BOOST_CHECK(!codel.overloaded(now));
+}
+
+BOOST_AUTO_TEST_CASE(testStandingQueue)
+{
+  CoDel codel;
+  int64_t now = 1000 * 1000;
+  // every task waits more than 5ms for 300ms
+  for (int i = 0; i < 300; ++i)
+  {
+    codel.onDequeue(8 * 1000 + i % 3 * 1000, now);
+    now += 1000;
+  }
+  BOOST_CHECK(codel.overloaded(now));
+  BOOST_CHECK_EQUAL(codel.lastMinDelayUs(), 8 * 1000);
+  BOOST_CHECK(codel.overloadedIntervals() >= 1);
+
+  // expires without feedback
+  BOOST_CHECK(!codel.overloaded(now + 300 * 1000));
+
+  // recovers in one interval after the queue is short again
+  for (int i = 0; i < 150; ++i)
+  {
+    codel.onDequeue(1000, now);
+    now += 1000;
+  }
+  BOOST_CHECK(!codel.overloaded(now));
+
+  for (int i = 0; i < 300; ++i)
+  {
+    codel.onDequeue(8 * 1000, now);
+    now += 1000;
+  }
+  BOOST_CHECK(codel.overloaded(now));
+  codel.onEmpty();
+  BOOST_CHECK(!codel.overloaded(now));
+}
+
+BOOST_AUTO_TEST_CASE(testThreadPool)
+{
+  ThreadPool pool("CoDelPool");
+  pool.enableCoDel(0.002, 0.05);
+  pool.start(1);
+
+  // each task takes 1ms, offers 4 tasks per ms
+  int accepted = 0, rejected = 0;
+  bool everOverloaded = false;
+  for (int i = 0; i < 2000; ++i)
+  {
+    if (pool.tryRun([] { ::usleep(1000); }))
+      ++accepted;
+    else
+      ++rejected;
+    if (pool.overloaded())
+      everOverloaded = true;
+    ::usleep(250);
+  }
+  printf("ThreadPool accepted %d rejected %d, queue %zd, min delay %" PRId64 " us\n",
+         accepted, rejected, pool.queueSize(), pool.codel()->lastMinDelayUs());
+  BOOST_CHECK(everOverloaded);
+  BOOST_CHECK(rejected > 0);
+  // without shedding, the queue would hold ~1500 tasks
+  BOOST_CHECK(pool.queueSize() < 500);
+
+  CountDownLatch latch(1);
+  pool.run([&latch] { latch.countDown(); });
+  latch.wait();
+  ::usleep(1000);
+  BOOST_CHECK(!pool.overloaded());
+  pool.stop();
+}
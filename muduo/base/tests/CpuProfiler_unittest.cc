@@ -0,0 +1,112 @@
+#include "muduo/base/CpuProfiler.h"
+#include "muduo/base/Thread.h"
+
+#include <algorithm>
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//#define BOOST_TEST_MODULE CpuProfilerTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using namespace muduo;
+
+double threadCpuSeconds()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+}
+
+// not static, so dladdr() finds it with -rdynamic
+__attribute__((noinline)) double burnCpu(double seconds)
+{
+  volatile double x = 1.0;
+  double start = threadCpuSeconds();
+  while (threadCpuSeconds() - start < seconds)
+  {
+    for (int i = 0; i < 10000; ++i)
+    {
+      x = x * 1.0000001 + 1e-9;
+    }
+  }
+  return x;
+}
+
+BOOST_AUTO_TEST_CASE(testThreads)
+{
+  CpuProfiler profiler;
+  BOOST_CHECK(!profiler.running());
+  BOOST_CHECK(profiler.start());
+  BOOST_CHECK(profiler.running());
+
+  CpuProfiler another;
+  BOOST_CHECK(!another.start());
+  BOOST_CHECK(CpuProfiler::profile(0.1).empty());
+
+  Thread thread([] { burnCpu(0.5); }, "burner");
+  thread.start();
+  burnCpu(0.5);
+  thread.join();
+  profiler.stop();
+  BOOST_CHECK(!profiler.running());
+
+  string folded = profiler.folded();
+  printf("%" PRId64 " samples, %" PRId64 " dropped, %zd stacks\n",
+         profiler.samples(), profiler.dropped(),
+         std::count(folded.begin(), folded.end(), '\n'));
+  // 99 Hz for 1s of CPU time, timer slack on loaded hosts
+  BOOST_CHECK(profiler.samples() > 20);
+  BOOST_CHECK(folded.find("burner;") != string::npos);
+  BOOST_CHECK(folded.find("main;") != string::npos);
+  BOOST_CHECK(folded.find("burnCpu(double)") != string::npos);
+
+  // every line is "frames count", in descending count
+  int64_t last = -1;
+  size_t start = 0;
+  bool wellFormed = true;
+  while (start < folded.size())
+  {
+    size_t end = folded.find('\n', start);
+    size_t space = folded.rfind(' ', end);
+    int64_t count = atoll(folded.c_str() + space + 1);
+    wellFormed = wellFormed && space > start && count > 0 && (last < 0 || count <= last);
+    last = count;
+    start = end + 1;
+  }
+  BOOST_CHECK(wellFormed);
+
+  BOOST_CHECK(another.start());
+  another.stop();
+}
+
+BOOST_AUTO_TEST_CASE(testProfile)
+{
+  bool done = false;  // __atomic
+  Thread thread([&done] {
+    while (!__atomic_load_n(&done, __ATOMIC_RELAXED))
+    {
+      burnCpu(0.01);
+    }
+  }, "burner");
+  thread.start();
+  // profile() is in wall time, the burner may hardly run on a loaded host
+  string folded;
+  for (int i = 0; i < 20 && folded.find("burnCpu(double)") == string::npos; ++i)
+  {
+    folded = CpuProfiler::profile(0.5);
+  }
+  __atomic_store_n(&done, true, __ATOMIC_RELAXED);
+  thread.join();
+  BOOST_CHECK(folded.find("burnCpu(double)") != string::npos);
+
+  // a whole second between samples
+  CpuProfiler slowest(1);
+  BOOST_CHECK(slowest.start());
+  slowest.stop();
+}
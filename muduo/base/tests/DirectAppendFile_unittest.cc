@@ -0,0 +1,191 @@
+#include "muduo/base/FileUtil.h"
+#include "muduo/base/LogFile.h"
+#include "muduo/base/Timestamp.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//#define BOOST_TEST_MODULE DirectAppendFileTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using namespace muduo;
+
+// runs in a directory of its own, removed at exit
+struct TemporaryDirectory
+{
+  char dir[64];
+
+  TemporaryDirectory()
+  {
+    snprintf(dir, sizeof dir, "/tmp/directappendfile_unittest.XXXXXX");
+    if (::mkdtemp(dir) == NULL || ::chdir(dir) != 0)
+    {
+      perror("mkdtemp");
+      abort();
+    }
+  }
+
+  ~TemporaryDirectory()
+  {
+    ::rmdir(dir);
+  }
+};
+
+BOOST_GLOBAL_FIXTURE(TemporaryDirectory);
+
+string readAll(const string& filename)
+{
+  string content;
+  int err = FileUtil::readFile(filename, 1024 * 1024 * 1024, &content);
+  BOOST_CHECK_EQUAL(err, 0);
+  return content;
+}
+
+off_t fileSize(const string& filename)
+{
+  struct stat st;
+  return ::stat(filename.c_str(), &st) == 0 ? st.st_size : -1;
+}
+
+string line(int i)
+{
+  char buf[128];
+  snprintf(buf, sizeof buf, "20261019 05:12:34.%06dZ 12345 INFO  request %d - Server.cc:42\n",
+           i % 1000000, i);
+  return buf;
+}
+
+off_t allocatedBytes(const string& filename)
+{
+  struct stat st;
+  return ::stat(filename.c_str(), &st) == 0 ? st.st_blocks * 512 : -1;
+}
+
+BOOST_AUTO_TEST_CASE(testBlocks)
+{
+  const size_t kChunk = 64 * 1024;
+  const size_t kBuffer = 8 * 1024;
+  string expected;
+  {
+    FileUtil::DirectAppendFile file("direct.log", kChunk, kBuffer);
+    for (int i = 0; i < 5000; ++i)
+    {
+      string l = line(i);
+      file.append(l.data(), l.size());
+      expected += l;
+      if (i == 2500)
+      {
+        // many buffers at once
+        string big(3 * kBuffer + 7, 'x');
+        big += '\n';
+        file.append(big.data(), big.size());
+        expected += big;
+      }
+      if (i % 1000 == 999)
+      {
+        file.flush();
+        BOOST_CHECK_EQUAL(fileSize("direct.log"), static_cast<off_t>(expected.size()));
+        BOOST_CHECK(readAll("direct.log") == expected);
+      }
+    }
+    BOOST_CHECK_EQUAL(file.writtenBytes(), static_cast<off_t>(expected.size()));
+    BOOST_CHECK(allocatedBytes("direct.log") >= static_cast<off_t>(expected.size() / kChunk * kChunk));
+  }
+  BOOST_CHECK_EQUAL(fileSize("direct.log"), static_cast<off_t>(expected.size()));
+  BOOST_CHECK(readAll("direct.log") == expected);
+  // preallocation released on close
+  BOOST_CHECK(allocatedBytes("direct.log") <
+              static_cast<off_t>(expected.size() + 2 * FileUtil::DirectAppendFile::kAlignment));
+
+  // appends to existing content, not aligned
+  {
+    FileUtil::DirectAppendFile file("direct.log", kChunk, kBuffer);
+    string l = line(5000);
+    file.append(l.data(), l.size());
+    expected += l;
+    BOOST_CHECK_EQUAL(file.writtenBytes(), static_cast<off_t>(l.size()));
+  }
+  BOOST_CHECK(readAll("direct.log") == expected);
+  ::unlink("direct.log");
+}
+
+std::vector<string> listFiles(const string& prefix)
+{
+  std::vector<string> files;
+  DIR* dir = ::opendir(".");
+  while (struct dirent* ent = ::readdir(dir))
+  {
+    if (strncmp(ent->d_name, prefix.c_str(), prefix.size()) == 0)
+      files.push_back(ent->d_name);
+  }
+  ::closedir(dir);
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+BOOST_AUTO_TEST_CASE(testLogFile)
+{
+  string expected;
+  {
+    LogFile file("roll", 256 * 1024, false, 3, 1024, LogFile::newDirectFile);
+    for (int round = 0; round < 2; ++round)
+    {
+      for (int i = 0; i < 5000; ++i)
+      {
+        string l = line(i);
+        file.append(l.data(), static_cast<int>(l.size()));
+        expected += l;
+      }
+      // rolls at most once a second
+      ::sleep(1);
+    }
+  }
+  std::vector<string> files = listFiles("roll.");
+  string content;
+  for (const string& f : files)
+  {
+    content += readAll(f);
+    ::unlink(f.c_str());
+  }
+  // a round past rollSize rolls again if it crosses a second
+  BOOST_CHECK(files.size() >= 2);
+  BOOST_CHECK(content == expected);
+}
+
+template<typename File>
+double bench(const char* filename, double* maxUs)
+{
+  const string l = line(123456);
+  const int kLines = 500000;
+  *maxUs = 0;
+  Timestamp start(Timestamp::now());
+  {
+    File file(filename);
+    for (int i = 0; i < kLines; ++i)
+    {
+      Timestamp t0(Timestamp::now());
+      file.append(l.data(), l.size());
+      *maxUs = std::max(*maxUs, timeDifference(Timestamp::now(), t0) * 1e6);
+    }
+  }
+  double seconds = timeDifference(Timestamp::now(), start);
+  ::unlink(filename);
+  return seconds * 1e9 / kLines;
+}
+
+BOOST_AUTO_TEST_CASE(testBench)
+{
+  double maxUs = 0;
+  double ns = bench<FileUtil::AppendFile>("append.log", &maxUs);
+  printf("AppendFile       %.1f ns per line, max %.1f us\n", ns, maxUs);
+  ns = bench<FileUtil::DirectAppendFile>("direct.log", &maxUs);
+  printf("DirectAppendFile %.1f ns per line, max %.1f us\n", ns, maxUs);
+}
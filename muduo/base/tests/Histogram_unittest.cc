@@ -0,0 +1,121 @@
+#include "muduo/base/Histogram.h"
+#include "muduo/base/Thread.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <stdio.h>
+
+//#define BOOST_TEST_MODULE HistogramTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using namespace muduo;
+
+typedef HistogramSnapshot Snapshot;
+
+BOOST_AUTO_TEST_CASE(testBuckets)
+{
+  int last = -1;
+  for (int64_t v = 0; v < 100000; ++v)
+  {
+    int index = Snapshot::bucketIndex(v);
+    if (index != last)
+    {
+      BOOST_CHECK_EQUAL(index, last + 1);
+      BOOST_CHECK_EQUAL(Snapshot::bucketLowerBound(index), v);
+      last = index;
+    }
+    BOOST_CHECK(Snapshot::bucketUpperBound(index) >= v);
+    int64_t width = Snapshot::bucketUpperBound(index) - Snapshot::bucketLowerBound(index) + 1;
+    BOOST_CHECK(width == 1 || width * Snapshot::kSubBuckets <= v);
+  }
+  BOOST_CHECK_EQUAL(Snapshot::bucketIndex(-5), 0);
+  BOOST_CHECK_EQUAL(Snapshot::bucketIndex(Snapshot::kMaxValue), Snapshot::kNumBuckets - 1);
+  BOOST_CHECK_EQUAL(Snapshot::bucketIndex(int64_t(1) << 62), Snapshot::kNumBuckets - 1);
+  BOOST_CHECK_EQUAL(Snapshot::bucketUpperBound(Snapshot::kNumBuckets - 1), Snapshot::kMaxValue);
+}
+
+BOOST_AUTO_TEST_CASE(testPercentile)
+{
+  Snapshot s;
+  BOOST_CHECK_EQUAL(s.count(), 0);
+  BOOST_CHECK_EQUAL(s.percentile(99), 0);
+  BOOST_CHECK_EQUAL(s.min(), 0);
+
+  std::vector<int64_t> values;
+  std::mt19937 gen(42);
+  std::exponential_distribution<double> latency(1.0 / 1000);
+  for (int i = 0; i < 100000; ++i)
+  {
+    values.push_back(static_cast<int64_t>(latency(gen)));
+    s.record(values.back());
+  }
+  std::sort(values.begin(), values.end());
+  BOOST_CHECK_EQUAL(s.count(), 100000);
+  BOOST_CHECK_EQUAL(s.min(), values.front());
+  BOOST_CHECK_EQUAL(s.max(), values.back());
+  BOOST_CHECK_EQUAL(s.percentile(0), values.front());
+  BOOST_CHECK_EQUAL(s.percentile(100), values.back());
+  const double percents[] = { 50, 90, 99, 99.9 };
+  for (double p : percents)
+  {
+    int64_t exact = values[static_cast<size_t>(p / 100 * 100000) - 1];
+    int64_t estimate = s.percentile(p);
+    printf("p%g exact %lld estimate %lld\n", p, static_cast<long long>(exact),
+           static_cast<long long>(estimate));
+    BOOST_CHECK(estimate >= exact);
+    BOOST_CHECK(estimate <= exact + exact / Snapshot::kSubBuckets + 1);
+  }
+
+  // merged as if recorded in one
+  Snapshot a, b, all;
+  for (int64_t v = 0; v < 1000; ++v)
+  {
+    (v % 3 ? a : b).record(v * v);
+    all.record(v * v);
+  }
+  a.merge(b);
+  BOOST_CHECK_EQUAL(a.count(), all.count());
+  BOOST_CHECK_EQUAL(a.sum(), all.sum());
+  BOOST_CHECK_EQUAL(a.min(), 0);
+  BOOST_CHECK_EQUAL(a.max(), 999 * 999);
+  BOOST_CHECK_EQUAL(a.percentile(50), all.percentile(50));
+  BOOST_CHECK_EQUAL(a.percentile(99), all.percentile(99));
+}
+
+BOOST_AUTO_TEST_CASE(testThreads)
+{
+  const int kThreads = 4;
+  const int64_t kValues = 200000;
+  Histogram histogram;
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int i = 0; i < kThreads; ++i)
+  {
+    threads.emplace_back(new Thread([&histogram, i] {
+      for (int64_t v = 1; v <= kValues; ++v)
+      {
+        histogram.record(v + i);
+      }
+    }));
+  }
+  for (auto& thr : threads)
+  {
+    thr->start();
+  }
+  for (auto& thr : threads)
+  {
+    thr->join();
+  }
+  Snapshot s = histogram.snapshot();
+  BOOST_CHECK_EQUAL(s.count(), kThreads * kValues);
+  BOOST_CHECK_EQUAL(s.sum(), kThreads * kValues * (kValues + 1) / 2 + kValues * (0 + 1 + 2 + 3));
+  BOOST_CHECK_EQUAL(s.min(), 1);
+  BOOST_CHECK_EQUAL(s.max(), kValues + kThreads - 1);
+  int64_t median = s.percentile(50);
+  BOOST_CHECK(median >= kValues / 2);
+  BOOST_CHECK(median <= kValues / 2 + kValues / 2 / Snapshot::kSubBuckets);
+}
@@ -0,0 +1,200 @@
+#include "muduo/base/LogCompressor.h"
+#include "muduo/base/GzipFile.h"
+#include "muduo/base/Timestamp.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+//#define BOOST_TEST_MODULE LogCompressorTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using namespace muduo;
+
+// runs in a directory of its own, removed at exit
+struct TemporaryDirectory
+{
+  char dir[64];
+
+  TemporaryDirectory()
+  {
+    snprintf(dir, sizeof dir, "/tmp/logcompressor_unittest.XXXXXX");
+    if (::mkdtemp(dir) == NULL || ::chdir(dir) != 0)
+    {
+      perror("mkdtemp");
+      abort();
+    }
+  }
+
+  ~TemporaryDirectory()
+  {
+    ::rmdir(dir);
+  }
+};
+
+BOOST_GLOBAL_FIXTURE(TemporaryDirectory);
+
+string logLines(int n)
+{
+  string text;
+  for (int i = 0; i < n; ++i)
+  {
+    char line[128];
+    snprintf(line, sizeof line, "20261019 04:02:32.%06dZ %5d INFO  request %d done in %d us - Server.cc:42\n",
+             i % 1000000, 1000 + i % 7, i, i * 7 % 1000);
+    text += line;
+  }
+  return text;
+}
+
+void writeFile(const string& filename, const string& content)
+{
+  FILE* fp = ::fopen(filename.c_str(), "w");
+  ::fwrite(content.data(), 1, content.size(), fp);
+  ::fclose(fp);
+}
+
+string gunzip(const string& filename)
+{
+  string content;
+  GzipFile file = GzipFile::openForRead(filename);
+  if (file.valid())
+  {
+    char buf[64 * 1024];
+    int n = 0;
+    while ((n = file.read(buf, sizeof buf)) > 0)
+    {
+      content.append(buf, n);
+    }
+  }
+  return content;
+}
+
+bool exists(const string& filename)
+{
+  return ::access(filename.c_str(), F_OK) == 0;
+}
+
+std::vector<string> listFiles(const string& prefix)
+{
+  std::vector<string> files;
+  DIR* dir = ::opendir(".");
+  while (struct dirent* ent = ::readdir(dir))
+  {
+    if (strncmp(ent->d_name, prefix.c_str(), prefix.size()) == 0)
+      files.push_back(ent->d_name);
+  }
+  ::closedir(dir);
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+// compressFile() runs in the calling thread, unlike wall time this is
+// not inflated by other tests running in parallel
+double threadCpuSeconds()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+}
+
+BOOST_AUTO_TEST_CASE(testCompressFile)
+{
+  const string content = logLines(50000);
+  double seconds[3] = { 0 };
+  double cpuSeconds[3] = { 0 };
+  LogCompressor::Codec codecs[3] = { LogCompressor::kGzip, LogCompressor::kGzipFast, LogCompressor::kGzipFast };
+  double shares[3] = { 1.0, 1.0, 0.25 };
+  for (int i = 0; i < 3; ++i)
+  {
+    writeFile("compress.log", content);
+    Timestamp start(Timestamp::now());
+    double cpuStart = threadCpuSeconds();
+    int64_t n = LogCompressor::compressFile("compress.log", codecs[i], shares[i]);
+    cpuSeconds[i] = threadCpuSeconds() - cpuStart;
+    seconds[i] = timeDifference(Timestamp::now(), start);
+    printf("codec %d share %.2f: %zd -> %lld bytes in %.3f s, cpu %.3f s\n",
+           codecs[i], shares[i], content.size(), static_cast<long long>(n),
+           seconds[i], cpuSeconds[i]);
+    BOOST_CHECK(n > 0);
+    BOOST_CHECK(n < static_cast<int64_t>(content.size()) / 4);
+    BOOST_CHECK(!exists("compress.log"));
+    BOOST_CHECK(gunzip("compress.log.gz") == content);
+    ::unlink("compress.log.gz");
+  }
+  BOOST_CHECK(cpuSeconds[1] < cpuSeconds[0]);
+  // sleeps three times as long as it works, which a loaded host only stretches
+  BOOST_CHECK(seconds[2] > 2 * cpuSeconds[2]);
+
+  BOOST_CHECK_EQUAL(LogCompressor::compressFile("nonexistent.log", LogCompressor::kGzip), -1);
+}
+
+BOOST_AUTO_TEST_CASE(testRollCallback)
+{
+  const string content = logLines(2000);
+  LogCompressor compressor(LogCompressor::kGzipFast, 0.5);
+  compressor.start();
+  {
+    LogFile file("roll", 64 * 1024, false);
+    file.setRollCallback(compressor.rollCallback());
+    // rolls at most once a second
+    for (int i = 0; i < 3; ++i)
+    {
+      file.append(content.data(), static_cast<int>(content.size()));
+      ::sleep(1);
+    }
+  }
+  compressor.stop();
+
+  std::vector<string> files = listFiles("roll.");
+  string all;
+  int compressed = 0;
+  for (const string& f : files)
+  {
+    if (f.size() > 3 && f.compare(f.size() - 3, 3, ".gz") == 0)
+    {
+      all += gunzip(f);
+      ++compressed;
+    }
+    else
+    {
+      FILE* fp = ::fopen(f.c_str(), "r");
+      char buf[64 * 1024];
+      size_t n = 0;
+      while ((n = ::fread(buf, 1, sizeof buf, fp)) > 0)
+        all.append(buf, n);
+      ::fclose(fp);
+    }
+    ::unlink(f.c_str());
+  }
+  printf("%zd files, %d compressed, %lld -> %lld bytes\n", files.size(), compressed,
+         static_cast<long long>(compressor.inputBytes()),
+         static_cast<long long>(compressor.outputBytes()));
+  BOOST_CHECK(compressed >= 2);
+  BOOST_CHECK_EQUAL(compressor.compressedFiles(), compressed);
+  BOOST_CHECK(all == content + content + content);
+}
+
+BOOST_AUTO_TEST_CASE(testGzipWriter)
+{
+  const string content = logLines(20000);
+  {
+    LogFile file("direct", 1024 * 1024 * 1024, false, 3, 1024,
+                 std::bind(&LogCompressor::newGzipFile, std::placeholders::_1, LogCompressor::kGzip));
+    file.append(content.data(), static_cast<int>(content.size()));
+    file.flush();
+  }
+  std::vector<string> files = listFiles("direct.");
+  BOOST_REQUIRE_EQUAL(files.size(), 1);
+  BOOST_CHECK(files[0].find(".log.gz") != string::npos);
+  BOOST_CHECK(gunzip(files[0]) == content);
+  ::unlink(files[0].c_str());
+}
@@ -0,0 +1,276 @@
+#include "muduo/base/Logging.h"
+#include "muduo/base/AsyncLogging.h"
+#include "muduo/base/FileUtil.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+//#define BOOST_TEST_MODULE LogFieldTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using namespace muduo;
+
+int64_t g_allocations = 0;
+
+void* operator new(size_t size)
+{
+  ++g_allocations;
+  void* p = ::malloc(size);
+  if (p == NULL)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept
+{
+  ::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+  ::free(p);
+}
+
+char g_line[8192];
+int g_lineLen = 0;
+
+// does not allocate
+void capture(const char* msg, int len)
+{
+  memcpy(g_line, msg, len);
+  g_lineLen = len;
+}
+
+void stdoutOutput(const char* msg, int len)
+{
+  fwrite(msg, 1, len, stdout);
+}
+
+bool contains(const char* what)
+{
+  bool found = string(g_line, g_lineLen).find(what) != string::npos;
+  if (!found)
+    printf("'%s' not in %.*s", what, g_lineLen, g_line);
+  return found;
+}
+
+BOOST_AUTO_TEST_CASE(testText)
+{
+  string path("/index.html");
+  Logger::setOutput(capture);
+  LOG_INFO << "request done" << LogField("status", 200) << LogField("path", path)
+           << LogField("bytes", 12345678901LL) << LogField("latency", 0.000123)
+           << LogField("keepAlive", true) << LogField("id", 42u);
+  BOOST_CHECK(contains("INFO  request done status=200 path=/index.html bytes=12345678901 "
+                       "latency=0.000123 keepAlive=true id=42 - LogField_unittest.cc:"));
+
+  LOG_WARN << "bad request " << LogField("agent", "curl/8.0 (x86_64)")
+           << LogField("query", "a=1&b=\"2\"") << LogField("empty", "")
+           << LogField("ctrl", StringPiece("a\tb\nc\x01", 6));
+  BOOST_CHECK(contains("WARN  bad request agent=\"curl/8.0 (x86_64)\" query=\"a=1&b=\\\"2\\\"\" "
+                       "empty=\"\" ctrl=\"a\\tb\\nc\\u0001\" - "));
+
+  LOG_INFO << LogField("first", 1);
+  BOOST_CHECK(contains("INFO  first=1 - "));
+  Logger::setOutput(stdoutOutput);
+}
+
+void logTrace()
+{
+  LOG_TRACE << "trace";
+}
+
+BOOST_AUTO_TEST_CASE(testJson)
+{
+  Logger::setFormat(LogStream::kJson);
+  Logger::setOutput(capture);
+
+  LOG_INFO << "say \"hello\" " << 42 << ' ' << 0.5 << LogField("status", 200)
+           << LogField("path", "/a\\b") << LogField("ok", false) << LogField("nan", 0.0 / 0.0);
+  BOOST_CHECK_EQUAL(strncmp(g_line, "{\"time\":\"", 9), 0);
+  BOOST_CHECK(contains("\",\"tid\":"));
+  BOOST_CHECK(contains(",\"level\":\"INFO\",\"msg\":\"say \\\"hello\\\" 42 0.5\",\"status\":200,"
+                       "\"path\":\"/a\\\\b\",\"ok\":false,\"nan\":null,"
+                       "\"file\":\"LogField_unittest.cc\",\"line\":"));
+  BOOST_CHECK(g_lineLen > 2);
+  BOOST_CHECK_EQUAL(memcmp(g_line + g_lineLen - 2, "}\n", 2), 0);
+
+  LOG_WARN << LogField("only", "field");
+  BOOST_CHECK(contains("\"level\":\"WARN\",\"only\":\"field\",\"file\":"));
+
+  errno = ENOENT;
+  LOG_SYSERR << "open " << "a\nb";
+  BOOST_CHECK(contains("\"level\":\"ERROR\",\"errno\":2,\"error\":\"No such file or directory\","
+                       "\"msg\":\"open a\\nb\",\"file\":"));
+
+  Logger::setLogLevel(Logger::TRACE);
+  logTrace();
+  Logger::setLogLevel(Logger::INFO);
+  BOOST_CHECK(contains("\"level\":\"TRACE\",\"func\":\"logTrace\",\"msg\":\"trace\",\"file\":"));
+
+  Logger::setOutput(stdoutOutput);
+  Logger::setFormat(LogStream::kText);
+}
+
+// quotes not escaped are balanced, and it ends the object
+bool validJsonLine()
+{
+  int quotes = 0;
+  for (int i = 0; i < g_lineLen; ++i)
+  {
+    if (g_line[i] == '\\')
+      ++i;
+    else if (g_line[i] == '"')
+      ++quotes;
+  }
+  return quotes % 2 == 0 && g_lineLen > 3 && g_line[0] == '{' &&
+         memcmp(g_line + g_lineLen - 2, "}\n", 2) == 0;
+}
+
+BOOST_AUTO_TEST_CASE(testJsonText)
+{
+  Logger::setFormat(LogStream::kJson);
+  Logger::setOutput(capture);
+
+  LOG_INFO << Fmt("%.3f", 12.345) << " ms";
+  BOOST_CHECK(contains(",\"level\":\"INFO\",\"msg\":\"12.345 ms\",\"file\":"));
+
+  LOG_INFO << "before" << LogField("k", 1) << "after " << 2 << LogField("l", 3) << true;
+  BOOST_CHECK(contains("\"msg\":\"before\",\"k\":1,\"msg2\":\"after 2\",\"l\":3,"
+                       "\"msg3\":\"1\",\"file\":"));
+  BOOST_CHECK(validJsonLine());
+
+  const string kLong(700, 'a');
+  LOG_INFO << kLong;
+  BOOST_CHECK(contains((",\"msg\":\"" + kLong + "\",\"file\":").c_str()));
+
+  // truncated at a character
+  string longer(5000, '"');
+  LOG_INFO << longer;
+  BOOST_CHECK(validJsonLine());
+  BOOST_CHECK(contains("\"msg\":\"\\\"\\\""));
+  BOOST_CHECK(g_lineLen > 3000);
+  longer.clear();
+  for (int i = 0; i < 2000; ++i)
+  {
+    longer += "\xe4\xb8\xad";  // U+4E2D
+  }
+  LOG_INFO << longer;
+  const char* msg = static_cast<const char*>(memmem(g_line, g_lineLen, "\"msg\":\"", 7));
+  const char* quote = msg ? static_cast<const char*>(memchr(msg + 7, '"', g_line + g_lineLen - msg - 7)) : NULL;
+  BOOST_CHECK(validJsonLine());
+  BOOST_REQUIRE(quote != NULL);
+  BOOST_CHECK_EQUAL((quote - msg - 7) % 3, 0);
+  BOOST_CHECK(quote - msg > 3000);
+
+  // text more than the buffer
+  {
+    Logger logger(__FILE__, __LINE__);
+    for (int i = 0; i < 1000; ++i)
+    {
+      logger.stream() << "\"quoted\" " << i << ' ' << Fmt("%d", i) << 0.5;
+    }
+    logger.stream() << LogField("dropped", "field");
+  }
+  BOOST_CHECK(validJsonLine());
+
+  // fields more than the buffer
+  {
+    Logger logger(__FILE__, __LINE__);
+    logger.stream() << "text";
+    for (int i = 0; i < 1000; ++i)
+    {
+      logger.stream() << LogField("key", "\"value\"") << "more";
+    }
+  }
+  BOOST_CHECK(validJsonLine());
+
+  Logger::setOutput(stdoutOutput);
+  Logger::setFormat(LogStream::kText);
+}
+
+BOOST_AUTO_TEST_CASE(testNoAllocation)
+{
+  Logger::setOutput(capture);
+  int64_t before = g_allocations;
+  for (int i = 0; i < 1000; ++i)
+  {
+    LOG_INFO << "request done" << LogField("status", 200) << LogField("path", "/a b")
+             << LogField("latency", 0.001 * i);
+  }
+  Logger::setFormat(LogStream::kJson);
+  for (int i = 0; i < 1000; ++i)
+  {
+    LOG_INFO << "request done" << LogField("status", 200) << LogField("path", "/a b")
+             << LogField("latency", 0.001 * i);
+  }
+  Logger::setFormat(LogStream::kText);
+  int64_t allocations = g_allocations - before;
+  Logger::setOutput(stdoutOutput);
+  BOOST_CHECK_EQUAL(allocations, 0);
+}
+
+AsyncLogging* g_asyncLog = NULL;
+
+void asyncOutput(const char* msg, int len)
+{
+  g_asyncLog->append(msg, len);
+}
+
+BOOST_AUTO_TEST_CASE(testAsyncLogging)
+{
+  char dir[] = "/tmp/logfield_unittest.XXXXXX";
+  if (::mkdtemp(dir) == NULL || ::chdir(dir) != 0)
+  {
+    perror("mkdtemp");
+    BOOST_FAIL("mkdtemp");
+  }
+
+  {
+    AsyncLogging log("json", 1024 * 1024 * 1024);
+    log.start();
+    g_asyncLog = &log;
+    Logger::setOutput(asyncOutput);
+    Logger::setFormat(LogStream::kJson);
+    for (int i = 0; i < 1000; ++i)
+    {
+      LOG_INFO << "line" << LogField("i", i);
+    }
+    Logger::setFormat(LogStream::kText);
+    Logger::setOutput(stdoutOutput);
+    log.stop();
+  }
+
+  string content;
+  DIR* d = ::opendir(".");
+  while (struct dirent* ent = ::readdir(d))
+  {
+    if (strncmp(ent->d_name, "json.", 5) == 0)
+    {
+      FileUtil::readFile(ent->d_name, 64 * 1024 * 1024, &content);
+      ::unlink(ent->d_name);
+    }
+  }
+  ::closedir(d);
+  ::rmdir(dir);
+
+  int lines = 0;
+  bool ok = true;
+  size_t start = 0, eol = 0;
+  while ((eol = content.find('\n', start)) != string::npos)
+  {
+    char expected[64];
+    snprintf(expected, sizeof expected, "\"msg\":\"line\",\"i\":%d,", lines);
+    ok = ok && content[start] == '{' && content[eol - 1] == '}' &&
+         content.find(expected, start) < eol;
+    ++lines;
+    start = eol + 1;
+  }
+  BOOST_CHECK_EQUAL(lines, 1000);
+  BOOST_CHECK(ok);
+}
@@ -55,6 +55,40 @@ void benchLogStream()
   printf("benchLogStream %f\n", timeDifference(end, start));
 }
 
+// latencies in seconds, 0.000001 ~ 1.0
+void benchLatency()
+{
+  char buf[32];
+  Timestamp start(Timestamp::now());
+  for (size_t i = 0; i < N; ++i)
+    snprintf(buf, sizeof buf, "%.12g", (double)(i) * 1e-6);
+  Timestamp end(Timestamp::now());
+  printf("benchPrintf %f\n", timeDifference(end, start));
+
+  start = Timestamp::now();
+  LogStream os;
+  for (size_t i = 0; i < N; ++i)
+  {
+    os << (double)(i) * 1e-6;
+    os.resetBuffer();
+  }
+  end = Timestamp::now();
+  printf("benchLogStream %f\n", timeDifference(end, start));
+}
+
+template<typename T>
+void benchFmt(const char* fmt)
+{
+  Timestamp start(Timestamp::now());
+  int len = 0;
+  for (size_t i = 0; i < N; ++i)
+    len += Fmt(fmt, (T)(i)).length();
+  Timestamp end(Timestamp::now());
+
+  printf("benchFmt %s %f\n", fmt, timeDifference(end, start));
+  (void)len;
+}
+
 int main()
 {
   benchPrintf<int>("%d");
@@ -69,6 +103,9 @@ int main()
   benchStringStream<double>();
   benchLogStream<double>();
 
+  puts("latency");
+  benchLatency();
+
   puts("int64_t");
   benchPrintf<int64_t>("%" PRId64);
   benchStringStream<int64_t>();
@@ -79,4 +116,9 @@ int main()
   benchStringStream<void*>();
   benchLogStream<void*>();
 
+  puts("Fmt");
+  benchPrintf<int>(".%06dZ ");
+  benchFmt<int>(".%06dZ ");
+  benchPrintf<double>("%.3g");
+  benchFmt<double>("%.3g");
 }
@@ -1,7 +1,10 @@
 #include "muduo/base/LogStream.h"
 
+#include <cmath>
 #include <limits>
+#include <random>
 #include <stdint.h>
+#include <stdio.h>
 
 //#define BOOST_TEST_MODULE LogStreamTest
 #define BOOST_TEST_MAIN
@@ -169,6 +172,84 @@ BOOST_AUTO_TEST_CASE(testLogStreamFloats)
   os.resetBuffer();
 }
 
+string printfDouble(double v)
+{
+  char buf[64];
+  snprintf(buf, sizeof buf, "%.12g", v);
+  return buf;
+}
+
+string logStreamDouble(double v)
+{
+  muduo::LogStream os;
+  os << v;
+  return os.buffer().toString();
+}
+
+BOOST_AUTO_TEST_CASE(testLogStreamFloatsSameAsPrintf)
+{
+  std::vector<double> values = {
+    -0.0, 0.5, 1.5, 2.5, 0.125, 1e-5, 1e-4, 0.0001234, 999999999999.0, 999999999999.5,
+    999999999999.4, 9999999999995.0, 1e12, 1e15, 1e16, 1e21, 1e22, 1e23, 1e100, -1e-100,
+    1e-300, 5e-324, std::numeric_limits<double>::max(), std::numeric_limits<double>::min(),
+    std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(),
+    std::numeric_limits<double>::quiet_NaN(), 0.1 + 0.2, 1.0 / 3, 2.0 / 3, 123456789012.5,
+    0.00001234567890125,
+  };
+  for (int e = -30; e <= 30; ++e)
+  {
+    double p = std::pow(10.0, e);
+    values.push_back(p);
+    values.push_back(std::nextafter(p, 0));
+    values.push_back(std::nextafter(p, 1e300));
+    values.push_back(p * 0.5);
+    values.push_back(p * 9.999999999995);
+  }
+
+  std::mt19937_64 rng(42);
+  for (int i = 0; i < 200000; ++i)
+  {
+    // latencies and sizes
+    values.push_back(static_cast<double>(rng() % 100000000) / 1e6);
+    values.push_back(static_cast<double>(rng() % 1000000000000000) / std::pow(10.0, static_cast<int>(rng() % 20)));
+    // any bits
+    uint64_t bits = rng();
+    double v = 0;
+    memcpy(&v, &bits, sizeof v);
+    values.push_back(v);
+  }
+
+  int mismatches = 0;
+  for (double v : values)
+  {
+    string expected = printfDouble(v);
+    string actual = logStreamDouble(v);
+    if (expected != actual && ++mismatches < 10)
+    {
+      BOOST_CHECK_EQUAL(actual, expected);
+    }
+  }
+  BOOST_CHECK_EQUAL(mismatches, 0);
+}
+
+BOOST_AUTO_TEST_CASE(testLogStreamIntegersSameAsPrintf)
+{
+  std::mt19937_64 rng(42);
+  for (int i = 0; i < 100000; ++i)
+  {
+    int64_t v = static_cast<int64_t>(rng() >> (rng() % 64));
+    if (i % 2)
+      v = -v;
+    char expected[64];
+    snprintf(expected, sizeof expected, "%lld %llu %d", static_cast<long long>(v),
+             static_cast<unsigned long long>(v), static_cast<int>(v));
+    muduo::LogStream os;
+    os << static_cast<long long>(v) << ' ' << static_cast<unsigned long long>(v)
+       << ' ' << static_cast<int>(v);
+    BOOST_REQUIRE_EQUAL(os.buffer().toString(), string(expected));
+  }
+}
+
 BOOST_AUTO_TEST_CASE(testLogStreamVoid)
 {
   muduo::LogStream os;
@@ -214,6 +295,56 @@ BOOST_AUTO_TEST_CASE(testLogStreamFmts)
   os.resetBuffer();
 }
 
+template<typename T>
+void checkFmt(const char* fmt, T v)
+{
+  char expected[32];
+  snprintf(expected, sizeof expected, fmt, v);
+  muduo::Fmt actual(fmt, v);
+  BOOST_CHECK_EQUAL(string(actual.data(), actual.length()), string(expected));
+}
+
+BOOST_AUTO_TEST_CASE(testFmtSameAsPrintf)
+{
+  const int ints[] = { 0, 1, -1, 42, -42, 123456, -1234567, std::numeric_limits<int>::max(),
+                       std::numeric_limits<int>::min() };
+  for (int v : ints)
+  {
+    checkFmt("%d", v);
+    checkFmt("%i", v);
+    checkFmt("%4d", v);
+    checkFmt("%06d", v);
+    checkFmt(".%06dZ ", v);
+    checkFmt("%-6d|", v);
+    checkFmt("%+d", v);
+    checkFmt("%.3d", v);
+    checkFmt("%x", v);
+    checkFmt("%hd", v);
+    checkFmt("%u", static_cast<unsigned>(v));
+    checkFmt("%08u", static_cast<unsigned>(v));
+    checkFmt("%lld", static_cast<long long>(v) * 1000000);
+    checkFmt("%ld", static_cast<long>(v));
+    checkFmt("%zu", static_cast<size_t>(v));
+    checkFmt("%c", static_cast<char>('a' + (v & 15)));
+    checkFmt("%d%%", v);
+  }
+
+  const double doubles[] = { 0, -0.0, 1, 0.5, 1.5, -2.5, 0.1, 1e-5, 123.456, 1e100, 6.02214076e23,
+                             std::numeric_limits<double>::infinity(), std::nan("") };
+  for (double v : doubles)
+  {
+    checkFmt("%g", v);
+    checkFmt("%.3g", v);
+    checkFmt("%.0g", v);
+    checkFmt("%.12g", v);
+    checkFmt("%10.4g", v);
+    checkFmt("%010.4g", v);
+    checkFmt("%.2f", v);
+    checkFmt("%e", v);
+    checkFmt("%g ms", static_cast<float>(v));
+  }
+}
+
 BOOST_AUTO_TEST_CASE(testLogStreamLong)
 {
   muduo::LogStream os;
@@ -0,0 +1,146 @@
+#include "muduo/base/Logging.h"
+#include "muduo/base/Thread.h"
+
+#include <vector>
+
+#include <stdio.h>
+
+//#define BOOST_TEST_MODULE LoggingRateLimitTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using namespace muduo;
+
+string g_captured;
+int g_lines = 0;  // __atomic
+
+void capture(const char* msg, int len)
+{
+  g_captured.append(msg, len);
+}
+
+void countLines(const char*, int)
+{
+  __atomic_fetch_add(&g_lines, 1, __ATOMIC_RELAXED);
+}
+
+void stdoutOutput(const char* msg, int len)
+{
+  fwrite(msg, 1, len, stdout);
+}
+
+int countOf(const string& text, const char* what)
+{
+  int n = 0;
+  for (size_t pos = text.find(what); pos != string::npos; pos = text.find(what, pos + 1))
+    ++n;
+  return n;
+}
+
+// spins on one call site, returns number of calls
+int64_t spinEveryT(double seconds, double interval)
+{
+  int64_t calls = 0;
+  int64_t end = Clock::monotonicNanos() + static_cast<int64_t>(seconds * 1e9);
+  while (Clock::monotonicNanos() < end)
+  {
+    LOG_EVERY_T(WARN, interval) << "every t";
+    ++calls;
+  }
+  return calls;
+}
+
+BOOST_AUTO_TEST_CASE(testEveryN)
+{
+  g_captured.clear();
+  Logger::setOutput(capture);
+  int64_t suppressed = Logger::suppressedMessages();
+  for (int i = 0; i < 100; ++i)
+  {
+    LOG_EVERY_N(INFO, 10) << "every n " << i;
+  }
+  for (int i = 0; i < 3; ++i)
+  {
+    LOG_EVERY_N(ERROR, 1) << "every one";
+  }
+
+  Logger::setLogLevel(Logger::WARN);
+  for (int i = 0; i < 10; ++i)
+  {
+    LOG_EVERY_N(INFO, 2) << "filtered";
+  }
+  Logger::setLogLevel(Logger::INFO);
+  Logger::setOutput(stdoutOutput);
+
+  BOOST_CHECK_EQUAL(countOf(g_captured, "every n "), 10);
+  BOOST_CHECK_EQUAL(countOf(g_captured, "INFO  every n 0 "), 1);
+  BOOST_CHECK_EQUAL(countOf(g_captured, "INFO  (suppressed 9) every n 90 "), 1);
+  BOOST_CHECK_EQUAL(countOf(g_captured, "ERROR every one - "), 3);
+  BOOST_CHECK_EQUAL(countOf(g_captured, "filtered"), 0);
+  BOOST_CHECK_EQUAL(Logger::suppressedMessages() - suppressed, 81);
+}
+
+BOOST_AUTO_TEST_CASE(testEveryT)
+{
+  g_captured.clear();
+  Logger::setOutput(capture);
+  int64_t calls = spinEveryT(1.0, 0.2);
+  Logger::setOutput(stdoutOutput);
+  int lines = countOf(g_captured, "every t");
+  printf("LOG_EVERY_T 0.2s: %d lines of %lld calls\n", lines, static_cast<long long>(calls));
+  BOOST_CHECK(4 <= lines);
+  BOOST_CHECK(lines <= 6);
+  BOOST_CHECK_EQUAL(countOf(g_captured, "WARN  (suppressed "), lines - 1);
+}
+
+BOOST_AUTO_TEST_CASE(testRateLimited)
+{
+  g_captured.clear();
+  Logger::setOutput(capture);
+  int64_t end = Clock::monotonicNanos() + 500 * 1000 * 1000;
+  while (Clock::monotonicNanos() < end)
+  {
+    LOG_RATE_LIMITED(ERROR, 100, 20) << "rate limited";
+  }
+  Logger::setOutput(stdoutOutput);
+  int lines = countOf(g_captured, "rate limited");
+  printf("LOG_RATE_LIMITED 100/s burst 20: %d lines in 0.5s\n", lines);
+  // 20 at once, then 100 per second
+  BOOST_CHECK(60 <= lines);
+  BOOST_CHECK(lines <= 72);
+  BOOST_CHECK(g_captured.find("ERROR rate limited") != string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(testThreads)
+{
+  __atomic_store_n(&g_lines, 0, __ATOMIC_RELAXED);
+  Logger::setOutput(countLines);
+  int64_t suppressed = Logger::suppressedMessages();
+  const int kThreads = 4;
+  int64_t calls[kThreads] = { 0 };
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int i = 0; i < kThreads; ++i)
+  {
+    int64_t* result = &calls[i];
+    threads.emplace_back(new Thread([result] { *result = spinEveryT(1.0, 0.25); }));
+    threads.back()->start();
+  }
+  int64_t total = 0;
+  for (int i = 0; i < kThreads; ++i)
+  {
+    threads[i]->join();
+    total += calls[i];
+  }
+  Logger::setOutput(stdoutOutput);
+  int lines = __atomic_load_n(&g_lines, __ATOMIC_RELAXED);
+  suppressed = Logger::suppressedMessages() - suppressed;
+  printf("LOG_EVERY_T 0.25s in %d threads: %d lines, %lld suppressed of %lld calls\n",
+         kThreads, lines, static_cast<long long>(suppressed), static_cast<long long>(total));
+  // shared among threads
+  BOOST_CHECK(4 <= lines);
+  BOOST_CHECK(lines <= 6);
+  // dropped in the last period are not counted yet
+  BOOST_CHECK(suppressed + lines <= total);
+  BOOST_CHECK(suppressed > total / 2);
+}
@@ -0,0 +1,150 @@
+#include "muduo/base/MemoryTag.h"
+#include "muduo/base/Thread.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//#define BOOST_TEST_MODULE MemoryTagTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using namespace muduo;
+
+MemoryTag& testMemoryTag()
+{
+  static MemoryTag* tag = new MemoryTag("test");
+  return *tag;
+}
+
+typedef std::vector<char, TaggedAllocator<char, &testMemoryTag>> TaggedVector;
+
+// counts nothing if built with MUDUO_MEMORY_TAGS=OFF
+#ifndef MUDUO_NO_MEMORY_TAGS
+BOOST_AUTO_TEST_CASE(testCounting)
+{
+  MemoryTag& tag = testMemoryTag();
+  BOOST_CHECK_EQUAL(tag.bytes(), 0);
+  BOOST_CHECK_EQUAL(tag.objects(), 0);
+  tag.allocate(100);
+  tag.allocate(28);
+  BOOST_CHECK_EQUAL(tag.bytes(), 128);
+  BOOST_CHECK_EQUAL(tag.objects(), 2);
+  tag.deallocate(100);
+  tag.deallocate(28);
+  BOOST_CHECK_EQUAL(tag.bytes(), 0);
+  BOOST_CHECK_EQUAL(tag.objects(), 0);
+
+  std::vector<Thread*> threads;
+  for (int i = 0; i < 4; ++i)
+  {
+    threads.push_back(new Thread([&tag] {
+      for (int j = 0; j < 10000; ++j)
+      {
+        tag.allocate(16);
+      }
+    }));
+    threads.back()->start();
+  }
+  for (Thread* thr : threads)
+  {
+    thr->join();
+    delete thr;
+  }
+  BOOST_CHECK_EQUAL(tag.bytes(), 4 * 10000 * 16);
+  BOOST_CHECK_EQUAL(tag.objects(), 4 * 10000);
+  for (int j = 0; j < 4 * 10000; ++j)
+  {
+    tag.deallocate(16);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testAllocator)
+{
+  MemoryTag& tag = testMemoryTag();
+  {
+    TaggedVector v(1000);
+    BOOST_CHECK_EQUAL(tag.bytes(), 1000);
+    BOOST_CHECK_EQUAL(tag.objects(), 1);
+    v.resize(3000);
+    BOOST_CHECK_EQUAL(tag.bytes(), static_cast<int64_t>(v.capacity()));
+    BOOST_CHECK_EQUAL(tag.objects(), 1);
+
+    TaggedVector copy(v);
+    BOOST_CHECK_EQUAL(tag.bytes(), static_cast<int64_t>(v.capacity() + copy.capacity()));
+    BOOST_CHECK_EQUAL(tag.objects(), 2);
+    TaggedVector moved(std::move(copy));
+    BOOST_CHECK_EQUAL(tag.objects(), 2);
+    moved.swap(v);
+    TaggedVector().swap(moved);
+    BOOST_CHECK_EQUAL(tag.bytes(), static_cast<int64_t>(v.capacity()));
+    BOOST_CHECK_EQUAL(tag.objects(), 1);
+  }
+  BOOST_CHECK_EQUAL(tag.bytes(), 0);
+  BOOST_CHECK_EQUAL(tag.objects(), 0);
+}
+
+__attribute__((noinline)) void allocateAndFree(size_t bytes)
+{
+  testMemoryTag().allocate(bytes);
+  testMemoryTag().deallocate(bytes);
+}
+
+BOOST_AUTO_TEST_CASE(testSampling)
+{
+  MemoryTag& tag = testMemoryTag();
+  string samples;
+  tag.writeSamples(&samples);
+  BOOST_CHECK(samples.empty());
+
+  MemoryTag::setSampleInterval(4096);
+  BOOST_CHECK_EQUAL(MemoryTag::sampleInterval(), 4096);
+  const int64_t kTotal = 64 * 1024 * 1024;
+  for (int64_t i = 0; i < kTotal / 256; ++i)
+  {
+    allocateAndFree(256);
+  }
+  MemoryTag::setSampleInterval(0);
+
+  tag.writeSamples(&samples);
+  BOOST_CHECK_EQUAL(samples.compare(0, 5, "test;"), 0);
+  BOOST_CHECK(samples.find("allocateAndFree(unsigned long)") != string::npos);
+  // estimated bytes of all lines, within 10% of what was allocated
+  int64_t estimate = 0;
+  size_t start = 0;
+  while (start < samples.size())
+  {
+    size_t end = samples.find('\n', start);
+    size_t space = samples.rfind(' ', end);
+    estimate += atoll(samples.c_str() + space + 1);
+    start = end + 1;
+  }
+  printf("estimated %" PRId64 " of %" PRId64 " bytes\n", estimate, kTotal);
+  BOOST_CHECK(estimate > kTotal * 9 / 10);
+  BOOST_CHECK(estimate < kTotal * 11 / 10);
+
+  tag.clearSamples();
+  samples.clear();
+  tag.writeSamples(&samples);
+  BOOST_CHECK(samples.empty());
+}
+
+#endif
+
+BOOST_AUTO_TEST_CASE(testTags)
+{
+  testMemoryTag();
+  MemoryTag other("a_test");
+  std::vector<MemoryTag*> tags = MemoryTag::tags();
+  BOOST_CHECK(tags.size() >= 2);
+  for (size_t i = 1; i < tags.size(); ++i)
+  {
+    BOOST_CHECK(strcmp(tags[i-1]->name(), tags[i]->name()) < 0);
+  }
+  BOOST_CHECK(std::find(tags.begin(), tags.end(), &other) != tags.end());
+}
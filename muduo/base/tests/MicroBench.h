@@ -0,0 +1,364 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// A tiny micro-benchmark harness, header only, for muduo's own benches.
+//
+// Each benchmark body runs a given number of iterations.  The harness
+// calibrates the iteration count so that one repetition takes about
+// --min_time seconds, runs one warm-up repetition, then --repetitions
+// timed repetitions, and reports mean/median/stddev/min/max and a 95%
+// confidence interval of nanoseconds per iteration.
+//
+// Usage:
+//   MUDUO_BENCHMARK(Timestamp_now)(int64_t iters)
+//   {
+//     for (int64_t i = 0; i < iters; ++i)
+//       muduo::bench::doNotOptimize(muduo::Timestamp::now());
+//   }
+//
+//   int main(int argc, char* argv[])
+//   {
+//     return muduo::bench::runBenchmarks(argc, argv);
+//   }
+//
+// Options:
+//   --filter=SUBSTR     only run benchmarks whose name contains SUBSTR
+//   --repetitions=N     timed repetitions, default 10
+//   --min_time=SECONDS  target duration of one repetition, default 0.1
+//   --format=console|csv|json
+//   --out=FILE          write results to FILE instead of stdout
+//   --baseline=FILE     compare medians with a previous --format=csv run
+//   --list              list benchmark names and exit
+
+#ifndef MUDUO_BASE_TESTS_MICROBENCH_H
+#define MUDUO_BASE_TESTS_MICROBENCH_H
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <time.h>
+#include <vector>
+
+namespace muduo
+{
+namespace bench
+{
+
+typedef std::function<void (int64_t iters)> Body;
+
+struct Benchmark
+{
+  std::string name;
+  Body body;
+  int64_t bytesPerIteration;
+};
+
+struct Result
+{
+  std::string name;
+  int64_t iterations;       // per repetition
+  int repetitions;
+  double mean;              // all in nanoseconds per iteration
+  double median;
+  double stddev;
+  double min;
+  double max;
+  double ci95;              // half-width of 95% confidence interval of mean
+  int64_t bytesPerIteration;
+};
+
+inline std::vector<Benchmark>& registry()
+{
+  static std::vector<Benchmark> benchmarks;
+  return benchmarks;
+}
+
+inline int registerBenchmark(const std::string& name, const Body& body,
+                             int64_t bytesPerIteration = 0)
+{
+  Benchmark b = { name, body, bytesPerIteration };
+  registry().push_back(b);
+  return static_cast<int>(registry().size());
+}
+
+// Prevents the compiler from optimizing away a computed value.
+template<typename T>
+inline void doNotOptimize(const T& value)
+{
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+inline void clobberMemory()
+{
+  asm volatile("" : : : "memory");
+}
+
+inline int64_t nowNanos()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+namespace detail
+{
+
+inline double timeOnce(const Body& body, int64_t iters)
+{
+  int64_t start = nowNanos();
+  body(iters);
+  int64_t end = nowNanos();
+  return static_cast<double>(end - start);
+}
+
+// two-sided 95% quantile of Student's t distribution
+inline double studentT95(int dof)
+{
+  static const double table[] =
+  {
+    0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+    2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093,
+    2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045,
+    2.042,
+  };
+  if (dof <= 0)
+    return 0;
+  if (dof < static_cast<int>(sizeof table / sizeof table[0]))
+    return table[dof];
+  return 1.96;
+}
+
+inline Result run(const Benchmark& b, int repetitions, double minTime)
+{
+  // find iteration count for one repetition to last about minTime
+  const double target = minTime * 1e9;
+  int64_t iters = 1;
+  while (true)
+  {
+    double elapsed = timeOnce(b.body, iters);
+    if (elapsed >= target || iters >= (int64_t(1) << 40))
+      break;
+    double ratio = elapsed > 0 ? target / elapsed * 1.2 : 10.0;
+    int64_t next = static_cast<int64_t>(static_cast<double>(iters) * std::min(ratio, 10.0));
+    iters = std::max(next, iters + 1);
+  }
+
+  timeOnce(b.body, iters);  // warm up
+
+  std::vector<double> samples;
+  samples.reserve(repetitions);
+  for (int i = 0; i < repetitions; ++i)
+  {
+    samples.push_back(timeOnce(b.body, iters) / static_cast<double>(iters));
+  }
+
+  Result r;
+  r.name = b.name;
+  r.iterations = iters;
+  r.repetitions = repetitions;
+  r.bytesPerIteration = b.bytesPerIteration;
+  double sum = 0;
+  for (double x : samples)
+    sum += x;
+  r.mean = sum / repetitions;
+  double sq = 0;
+  for (double x : samples)
+    sq += (x - r.mean) * (x - r.mean);
+  r.stddev = repetitions > 1 ? sqrt(sq / (repetitions - 1)) : 0;
+  r.ci95 = repetitions > 1 ? studentT95(repetitions - 1) * r.stddev / sqrt(repetitions) : 0;
+  std::sort(samples.begin(), samples.end());
+  r.min = samples.front();
+  r.max = samples.back();
+  r.median = repetitions % 2 ? samples[repetitions / 2]
+                             : (samples[repetitions / 2 - 1] + samples[repetitions / 2]) / 2;
+  return r;
+}
+
+inline std::map<std::string, double> readBaseline(const char* filename)
+{
+  std::map<std::string, double> baseline;
+  FILE* fp = ::fopen(filename, "r");
+  if (fp == NULL)
+  {
+    fprintf(stderr, "cannot open baseline %s\n", filename);
+    return baseline;
+  }
+  char line[1024];
+  while (::fgets(line, sizeof line, fp))
+  {
+    // name,iterations,repetitions,mean_ns,median_ns,...
+    char* comma = strchr(line, ',');
+    if (comma == NULL || strncmp(line, "name,", 5) == 0)
+      continue;
+    std::string name(line, comma);
+    double mean = 0, median = 0;
+    long long iters = 0;
+    int reps = 0;
+    if (sscanf(comma + 1, "%lld,%d,%lf,%lf", &iters, &reps, &mean, &median) == 4)
+    {
+      baseline[name] = median;
+    }
+  }
+  ::fclose(fp);
+  return baseline;
+}
+
+inline void printJsonString(FILE* out, const std::string& s)
+{
+  fputc('"', out);
+  for (char c : s)
+  {
+    if (c == '"' || c == '\\')
+      fputc('\\', out);
+    fputc(c, out);
+  }
+  fputc('"', out);
+}
+
+}  // namespace detail
+
+inline int runBenchmarks(int argc, char* argv[])
+{
+  std::string filter;
+  std::string format = "console";
+  const char* outFile = NULL;
+  const char* baselineFile = NULL;
+  int repetitions = 10;
+  double minTime = 0.1;
+  bool list = false;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const char* arg = argv[i];
+    if (strncmp(arg, "--filter=", 9) == 0)
+      filter = arg + 9;
+    else if (strncmp(arg, "--repetitions=", 14) == 0)
+      repetitions = std::max(1, atoi(arg + 14));
+    else if (strncmp(arg, "--min_time=", 11) == 0)
+      minTime = atof(arg + 11);
+    else if (strncmp(arg, "--format=", 9) == 0)
+      format = arg + 9;
+    else if (strncmp(arg, "--out=", 6) == 0)
+      outFile = arg + 6;
+    else if (strncmp(arg, "--baseline=", 11) == 0)
+      baselineFile = arg + 11;
+    else if (strcmp(arg, "--list") == 0)
+      list = true;
+    else
+    {
+      fprintf(stderr, "Usage: %s [--filter=SUBSTR] [--repetitions=N] [--min_time=SECONDS]\n"
+                      "       [--format=console|csv|json] [--out=FILE] [--baseline=CSV] [--list]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  if (list)
+  {
+    for (const Benchmark& b : registry())
+      printf("%s\n", b.name.c_str());
+    return 0;
+  }
+
+  FILE* out = stdout;
+  if (outFile)
+  {
+    out = ::fopen(outFile, "w");
+    if (out == NULL)
+    {
+      perror(outFile);
+      return 1;
+    }
+  }
+
+  std::map<std::string, double> baseline;
+  if (baselineFile)
+    baseline = detail::readBaseline(baselineFile);
+
+  if (format == "csv")
+    fprintf(out, "name,iterations,repetitions,mean_ns,median_ns,stddev_ns,min_ns,max_ns,ci95_ns,bytes_per_second\n");
+  else if (format == "json")
+    fprintf(out, "{\n  \"benchmarks\": [");
+  else
+    fprintf(out, "%-44s %12s %12s %8s %10s %12s\n",
+            "benchmark", "median ns", "mean ns", "+-95%", "cv", "iterations");
+
+  int n = 0;
+  for (const Benchmark& b : registry())
+  {
+    if (!filter.empty() && b.name.find(filter) == std::string::npos)
+      continue;
+    Result r = detail::run(b, repetitions, minTime);
+    double bytesPerSecond = r.bytesPerIteration > 0 && r.median > 0
+        ? static_cast<double>(r.bytesPerIteration) * 1e9 / r.median : 0;
+    if (format == "csv")
+    {
+      fprintf(out, "%s,%lld,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.0f\n",
+              r.name.c_str(), static_cast<long long>(r.iterations), r.repetitions,
+              r.mean, r.median, r.stddev, r.min, r.max, r.ci95, bytesPerSecond);
+    }
+    else if (format == "json")
+    {
+      fprintf(out, "%s\n    {\"name\": ", n > 0 ? "," : "");
+      detail::printJsonString(out, r.name);
+      fprintf(out, ", \"iterations\": %lld, \"repetitions\": %d, "
+                   "\"mean_ns\": %.3f, \"median_ns\": %.3f, \"stddev_ns\": %.3f, "
+                   "\"min_ns\": %.3f, \"max_ns\": %.3f, \"ci95_ns\": %.3f, "
+                   "\"bytes_per_second\": %.0f}",
+              static_cast<long long>(r.iterations), r.repetitions,
+              r.mean, r.median, r.stddev, r.min, r.max, r.ci95, bytesPerSecond);
+    }
+    else
+    {
+      fprintf(out, "%-44s %12.2f %12.2f %7.1f%% %9.1f%% %12lld",
+              r.name.c_str(), r.median, r.mean,
+              r.mean > 0 ? 100 * r.ci95 / r.mean : 0,
+              r.mean > 0 ? 100 * r.stddev / r.mean : 0,
+              static_cast<long long>(r.iterations));
+      if (bytesPerSecond > 0)
+        fprintf(out, "  %.1fMiB/s", bytesPerSecond / 1024 / 1024);
+      std::map<std::string, double>::const_iterator it = baseline.find(r.name);
+      if (it != baseline.end() && it->second > 0)
+        fprintf(out, "  %+.1f%% vs baseline", 100 * (r.median - it->second) / it->second);
+      fprintf(out, "\n");
+    }
+    fflush(out);
+    ++n;
+  }
+
+  if (format == "json")
+    fprintf(out, "\n  ]\n}\n");
+  if (out != stdout)
+    ::fclose(out);
+  return 0;
+}
+
+}  // namespace bench
+}  // namespace muduo
+
+#define MUDUO_BENCH_CONCAT2(a, b) a##b
+#define MUDUO_BENCH_CONCAT(a, b) MUDUO_BENCH_CONCAT2(a, b)
+
+// Defines and registers a benchmark, the body takes 'int64_t iters'.
+#define MUDUO_BENCHMARK(name) \
+  static void MUDUO_BENCH_CONCAT(benchmark_, name)(int64_t); \
+  static int MUDUO_BENCH_CONCAT(registered_, name) __attribute__ ((unused)) = \
+      ::muduo::bench::registerBenchmark(#name, MUDUO_BENCH_CONCAT(benchmark_, name)); \
+  static void MUDUO_BENCH_CONCAT(benchmark_, name)
+
+// Same as above, also reports throughput of @c bytes per iteration.
+#define MUDUO_BENCHMARK_BYTES(name, bytes) \
+  static void MUDUO_BENCH_CONCAT(benchmark_, name)(int64_t); \
+  static int MUDUO_BENCH_CONCAT(registered_, name) __attribute__ ((unused)) = \
+      ::muduo::bench::registerBenchmark(#name, MUDUO_BENCH_CONCAT(benchmark_, name), bytes); \
+  static void MUDUO_BENCH_CONCAT(benchmark_, name)
+
+#endif  // MUDUO_BASE_TESTS_MICROBENCH_H
@@ -0,0 +1,166 @@
+#include "muduo/base/MpmcQueue.h"
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/Thread.h"
+
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+#include <unistd.h>
+
+//#define BOOST_TEST_MODULE MpmcQueueTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using namespace muduo;
+
+int g_alive = 0;  // __atomic
+
+struct Counted
+{
+  explicit Counted(int v) : value(v) { __atomic_fetch_add(&g_alive, 1, __ATOMIC_RELAXED); }
+  Counted(const Counted& rhs) : value(rhs.value) { __atomic_fetch_add(&g_alive, 1, __ATOMIC_RELAXED); }
+  ~Counted() { __atomic_fetch_sub(&g_alive, 1, __ATOMIC_RELAXED); }
+  Counted& operator=(const Counted&) = default;
+
+  int value;
+};
+
+BOOST_AUTO_TEST_CASE(testTryPutTake)
+{
+  MpmcQueue<int> queue(5);
+  BOOST_CHECK_EQUAL(queue.capacity(), 8);
+  BOOST_CHECK(queue.empty());
+  int x = 0;
+  BOOST_CHECK(!queue.tryTake(&x));
+  for (int round = 0; round < 3; ++round)
+  {
+    for (int i = 0; i < 8; ++i)
+    {
+      BOOST_CHECK(queue.tryPut(i));
+    }
+    BOOST_CHECK(queue.full());
+    BOOST_CHECK_EQUAL(queue.size(), 8);
+    BOOST_CHECK(!queue.tryPut(8));
+    for (int i = 0; i < 8; ++i)
+    {
+      BOOST_CHECK(queue.tryTake(&x));
+      BOOST_CHECK_EQUAL(x, i);
+    }
+    BOOST_CHECK(queue.empty());
+  }
+
+  std::unique_ptr<int> p(new int(42));
+  MpmcQueue<std::unique_ptr<int>> ptrs(1);
+  BOOST_CHECK(ptrs.tryPut(std::move(p)));
+  BOOST_CHECK(p == NULL);
+  p.reset(new int(43));
+  BOOST_CHECK(ptrs.tryPut(std::move(p)));
+  p.reset(new int(44));
+  BOOST_CHECK(!ptrs.tryPut(std::move(p)));
+  BOOST_REQUIRE(p);
+  BOOST_CHECK_EQUAL(*p, 44);
+  std::unique_ptr<int> q;
+  BOOST_REQUIRE(ptrs.tryTake(&q));
+  BOOST_CHECK_EQUAL(*q, 42);
+}
+
+BOOST_AUTO_TEST_CASE(testDestroy)
+{
+  {
+    MpmcQueue<Counted> queue(4);
+    queue.tryPut(Counted(1));
+    queue.tryPut(Counted(2));
+    queue.tryPut(Counted(3));
+    Counted c(0);
+    queue.tryTake(&c);
+    BOOST_CHECK_EQUAL(c.value, 1);
+    BOOST_CHECK_EQUAL(g_alive, 3);
+  }
+  BOOST_CHECK_EQUAL(g_alive, 0);
+
+  {
+    MpmcBlockingQueue<std::string> queue(2);
+    queue.put("hello");
+    std::string s("world");
+    queue.put(s);
+    BOOST_CHECK(queue.full());
+    BOOST_CHECK_EQUAL(queue.take(), "hello");
+    BOOST_CHECK_EQUAL(queue.take(), "world");
+    BOOST_CHECK(queue.empty());
+  }
+}
+
+// every consumer sees items of each producer in order,
+// and all items are taken exactly once.
+void producersConsumers(int producers, int consumers, int capacity)
+{
+  const int kItems = 200000;
+  MpmcBlockingQueue<int64_t> queue(capacity);
+  CountDownLatch latch(producers + consumers);
+  std::vector<int64_t> sums(consumers, 0);
+  std::vector<int> outOfOrder(consumers, 0);
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int p = 0; p < producers; ++p)
+  {
+    threads.emplace_back(new Thread([&queue, &latch, p] {
+      latch.countDown();
+      for (int64_t i = 1; i <= kItems; ++i)
+      {
+        queue.put(p * (int64_t(1) << 32) + i);
+      }
+    }));
+  }
+  for (int c = 0; c < consumers; ++c)
+  {
+    threads.emplace_back(new Thread([&, c] {
+      std::vector<int64_t> last(producers, 0);
+      latch.countDown();
+      while (true)
+      {
+        int64_t x = queue.take();
+        if (x < 0)
+          break;
+        int p = static_cast<int>(x >> 32);
+        int64_t i = x & 0xffffffff;
+        if (i <= last[p])
+          ++outOfOrder[c];
+        last[p] = i;
+        sums[c] += i;
+      }
+    }));
+  }
+  for (auto& thr : threads)
+  {
+    thr->start();
+  }
+  for (int p = 0; p < producers; ++p)
+  {
+    threads[p]->join();
+  }
+  for (int c = 0; c < consumers; ++c)
+  {
+    queue.put(-1);
+  }
+  int64_t total = 0;
+  int errors = 0;
+  for (int c = 0; c < consumers; ++c)
+  {
+    threads[producers + c]->join();
+    total += sums[c];
+    errors += outOfOrder[c];
+  }
+  printf("%d producers %d consumers capacity %d: sum %lld\n", producers, consumers, capacity,
+         static_cast<long long>(total));
+  BOOST_CHECK_EQUAL(total, int64_t(producers) * kItems * (kItems + 1) / 2);
+  BOOST_CHECK_EQUAL(errors, 0);
+  BOOST_CHECK(queue.empty());
+}
+
+BOOST_AUTO_TEST_CASE(testProducersConsumers)
+{
+  producersConsumers(1, 1, 16);
+  producersConsumers(4, 4, 64);
+  producersConsumers(3, 2, 2);
+}
@@ -0,0 +1,192 @@
+#include "muduo/base/ObjectPool.h"
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/Thread.h"
+
+#include <new>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+//#define BOOST_TEST_MODULE ObjectPoolTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using namespace muduo;
+
+int64_t g_allocations = 0;  // __atomic
+
+void* operator new(size_t size)
+{
+  __atomic_fetch_add(&g_allocations, 1, __ATOMIC_RELAXED);
+  void* p = ::malloc(size);
+  if (p == NULL)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept
+{
+  ::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+  ::free(p);
+}
+
+int64_t allocations()
+{
+  return __atomic_load_n(&g_allocations, __ATOMIC_RELAXED);
+}
+
+struct Foo
+{
+  Foo(int x, const char* s) : x_(x), s_(s) { ++alive; }
+  ~Foo() { --alive; }
+
+  int x_;
+  std::string s_;
+  static int alive;
+};
+
+int Foo::alive = 0;
+
+struct Throw
+{
+  Throw() { throw 1; }
+  char data[100];
+};
+
+BOOST_AUTO_TEST_CASE(testCreateDestroy)
+{
+  typedef ObjectPool<Foo> Pool;
+  Foo* foo = Pool::create(42, "hello");
+  BOOST_CHECK_EQUAL(foo->x_, 42);
+  BOOST_CHECK_EQUAL(foo->s_, "hello");
+  BOOST_CHECK_EQUAL(Foo::alive, 1);
+  Pool::destroy(foo);
+  BOOST_CHECK_EQUAL(Foo::alive, 0);
+  Pool::destroy(NULL);
+
+  std::set<Foo*> foos;
+  for (int i = 0; i < 100; ++i)
+  {
+    foos.insert(Pool::create(i, ""));
+  }
+  BOOST_CHECK_EQUAL(foos.size(), 100);
+  BOOST_CHECK(Pool::instance().capacity() >= 100);
+  for (Foo* f : foos)
+  {
+    Pool::destroy(f);
+  }
+
+  // steady state
+  std::vector<Foo*> v;
+  v.reserve(100);
+  size_t capacity = Pool::instance().capacity();
+  int64_t before = allocations();
+  for (int round = 0; round < 100; ++round)
+  {
+    for (int i = 0; i < 100; ++i)
+    {
+      v.push_back(Pool::create(i, ""));
+    }
+    for (Foo* f : v)
+    {
+      Pool::destroy(f);
+    }
+    v.clear();
+  }
+  BOOST_CHECK_EQUAL(allocations(), before);
+  BOOST_CHECK_EQUAL(Pool::instance().capacity(), capacity);
+
+  void* p = ObjectPool<Throw>::instance().allocate();
+  ObjectPool<Throw>::instance().deallocate(p);
+  bool thrown = false;
+  try
+  {
+    ObjectPool<Throw>::create();
+  }
+  catch (int)
+  {
+    thrown = true;
+  }
+  BOOST_CHECK(thrown);
+  BOOST_CHECK_EQUAL(ObjectPool<Throw>::instance().allocate(), p);
+}
+
+BOOST_AUTO_TEST_CASE(testMakeShared)
+{
+  {
+  std::shared_ptr<Foo> foo = ObjectPool<Foo>::makeShared(1, "shared");
+  BOOST_CHECK_EQUAL(foo->x_, 1);
+  BOOST_CHECK_EQUAL(foo.use_count(), 1);
+  }
+  BOOST_CHECK_EQUAL(Foo::alive, 0);
+
+  int64_t before = allocations();
+  for (int i = 0; i < 1000; ++i)
+  {
+    std::shared_ptr<Foo> foo = ObjectPool<Foo>::makeShared(i, "");
+    std::weak_ptr<Foo> weak(foo);
+    foo.reset();
+    BOOST_CHECK(weak.expired());
+  }
+  BOOST_CHECK_EQUAL(allocations(), before);
+}
+
+// allocated in one thread, freed in another
+BOOST_AUTO_TEST_CASE(testCrossThread)
+{
+  typedef ObjectPool<Foo> Pool;
+  const int kObjects = 10000;
+  std::vector<Foo*> objects;
+  CountDownLatch produced(1);
+  Thread producer([&] {
+    for (int i = 0; i < kObjects; ++i)
+    {
+      objects.push_back(Pool::create(i, ""));
+    }
+    produced.countDown();
+  });
+  producer.start();
+  produced.wait();
+  producer.join();
+  BOOST_CHECK_EQUAL(Foo::alive, kObjects);
+
+  size_t sharedFree = Pool::instance().sharedFree();
+  Thread consumer([&] {
+    for (Foo* f : objects)
+    {
+      Pool::destroy(f);
+    }
+  });
+  consumer.start();
+  consumer.join();
+  BOOST_CHECK_EQUAL(Foo::alive, 0);
+  // all back to shared pool, including cache of consumer at thread exit
+  BOOST_CHECK_EQUAL(Pool::instance().sharedFree(), sharedFree + kObjects);
+
+  size_t capacity = Pool::instance().capacity();
+  for (int i = 0; i < 4; ++i)
+  {
+    Thread t([&] {
+      for (int j = 0; j < kObjects; ++j)
+      {
+        objects[j] = Pool::create(j, "");
+      }
+      for (Foo* f : objects)
+      {
+        Pool::destroy(f);
+      }
+    });
+    t.start();
+    t.join();
+  }
+  BOOST_CHECK_EQUAL(Pool::instance().capacity(), capacity);
+}
@@ -0,0 +1,67 @@
+#include "muduo/base/ShardedCounter.h"
+#include "muduo/base/Thread.h"
+
+#include <memory>
+#include <vector>
+
+#include <stdio.h>
+
+//#define BOOST_TEST_MODULE ShardedCounterTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using namespace muduo;
+
+BOOST_AUTO_TEST_CASE(testSingleThread)
+{
+  ShardedCounter counter;
+  BOOST_CHECK_EQUAL(counter.get(), 0);
+  counter.increment();
+  counter.add(41);
+  BOOST_CHECK_EQUAL(counter.get(), 42);
+  counter.decrement();
+  counter.add(-41);
+  BOOST_CHECK_EQUAL(counter.get(), 0);
+
+  int shards = detail::shardCount();
+  BOOST_CHECK(shards >= 1);
+  BOOST_CHECK(shards <= detail::kMaxShards);
+  BOOST_CHECK_EQUAL((shards & (shards - 1)), 0);
+  int index = detail::shardIndex();
+  BOOST_CHECK(index >= 0);
+  BOOST_CHECK(index < detail::kMaxShards);
+  BOOST_CHECK_EQUAL(index, detail::shardIndex());
+}
+
+BOOST_AUTO_TEST_CASE(testThreads)
+{
+  const int kThreads = 8;
+  const int64_t kAdds = 1000000;
+  ShardedCounter counter;
+  std::vector<int> indexes(kThreads);
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int i = 0; i < kThreads; ++i)
+  {
+    threads.emplace_back(new Thread([&counter, &indexes, i] {
+      indexes[i] = detail::shardIndex();
+      for (int64_t j = 0; j < kAdds; ++j)
+      {
+        counter.increment();
+      }
+    }));
+  }
+  for (auto& thr : threads)
+  {
+    thr->start();
+  }
+  for (auto& thr : threads)
+  {
+    thr->join();
+  }
+  BOOST_CHECK_EQUAL(counter.get(), kThreads * kAdds);
+  for (int i = 1; i < kThreads; ++i)
+  {
+    BOOST_CHECK(indexes[i] != indexes[0]);
+  }
+}
@@ -0,0 +1,145 @@
+#include "muduo/base/SpscQueue.h"
+#include "muduo/base/Thread.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sched.h>
+#include <stdio.h>
+
+//#define BOOST_TEST_MODULE SpscQueueTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using namespace muduo;
+
+int g_alive = 0;
+
+struct Counted
+{
+  explicit Counted(int v) : value(v) { ++g_alive; }
+  Counted(const Counted& rhs) : value(rhs.value) { ++g_alive; }
+  ~Counted() { --g_alive; }
+  Counted& operator=(const Counted&) = default;
+
+  int value;
+};
+
+BOOST_AUTO_TEST_CASE(testPushPop)
+{
+  SpscQueue<int> queue(5);
+  BOOST_CHECK_EQUAL(queue.capacity(), 8);
+  BOOST_CHECK(queue.empty());
+  int x = 0;
+  BOOST_CHECK(!queue.tryPop(&x));
+  for (int round = 0; round < 3; ++round)
+  {
+    for (int i = 0; i < 8; ++i)
+    {
+      BOOST_CHECK(queue.tryPush(i));
+    }
+    BOOST_CHECK_EQUAL(queue.size(), 8);
+    BOOST_CHECK(!queue.tryPush(8));
+    for (int i = 0; i < 8; ++i)
+    {
+      BOOST_CHECK(queue.tryPop(&x));
+      BOOST_CHECK_EQUAL(x, i);
+    }
+    BOOST_CHECK(queue.empty());
+  }
+
+  std::unique_ptr<int> p(new int(42));
+  SpscQueue<std::unique_ptr<int>> ptrs(2);
+  BOOST_CHECK(ptrs.tryPush(std::move(p)));
+  BOOST_CHECK(p == NULL);
+  p.reset(new int(43));
+  BOOST_CHECK(ptrs.tryPush(std::move(p)));
+  p.reset(new int(44));
+  BOOST_CHECK(!ptrs.tryPush(std::move(p)));
+  BOOST_REQUIRE(p);
+  BOOST_CHECK_EQUAL(*p, 44);
+  std::unique_ptr<int> q;
+  BOOST_REQUIRE(ptrs.tryPop(&q));
+  BOOST_CHECK_EQUAL(*q, 42);
+}
+
+BOOST_AUTO_TEST_CASE(testBatch)
+{
+  SpscQueue<std::string> queue(8);
+  std::vector<std::string> in = { "a", "b", "c", "d", "e" };
+  BOOST_CHECK_EQUAL(queue.tryPushBatch(in.begin(), in.size()), 5);
+  BOOST_CHECK(in[0].empty());
+  std::string out[8];
+  BOOST_CHECK_EQUAL(queue.tryPopBatch(out, 2), 2);
+  BOOST_CHECK_EQUAL(out[0], "a");
+  BOOST_CHECK_EQUAL(out[1], "b");
+
+  // wraps around
+  std::vector<std::string> more = { "f", "g", "h", "i", "j", "k" };
+  BOOST_CHECK_EQUAL(queue.tryPushBatch(more.begin(), more.size()), 5);
+  BOOST_CHECK_EQUAL(more[5], "k");
+  std::string all;
+  BOOST_CHECK_EQUAL(queue.consume([&all](std::string& s) { all += s; }, 100), 8);
+  BOOST_CHECK_EQUAL(all, "cdefghij");
+  BOOST_CHECK_EQUAL(queue.consume([](std::string&) {}, 100), 0);
+
+  {
+    SpscQueue<Counted> counted(4);
+    std::vector<Counted> v(3, Counted(1));
+    counted.tryPushBatch(v.begin(), v.size());
+    BOOST_CHECK_EQUAL(g_alive, 6);
+    counted.consume([](Counted&) {}, 1);
+    BOOST_CHECK_EQUAL(g_alive, 5);
+  }
+  BOOST_CHECK_EQUAL(g_alive, 0);
+}
+
+void producerConsumer(size_t capacity, size_t batch)
+{
+  const int64_t kItems = 2000000;
+  SpscQueue<int64_t> queue(capacity);
+  Thread producer([&] {
+    std::vector<int64_t> items(batch);
+    int64_t next = 1;
+    while (next <= kItems)
+    {
+      size_t n = 0;
+      for (; n < batch && next + static_cast<int64_t>(n) <= kItems; ++n)
+      {
+        items[n] = next + static_cast<int64_t>(n);
+      }
+      size_t pushed = queue.tryPushBatch(items.begin(), n);
+      next += static_cast<int64_t>(pushed);
+      if (pushed < n)
+        sched_yield();
+    }
+  });
+  producer.start();
+
+  int64_t last = 0, sum = 0, errors = 0;
+  while (last < kItems)
+  {
+    size_t n = queue.consume([&](int64_t x) {
+      if (x != last + 1)
+        ++errors;
+      last = x;
+      sum += x;
+    }, batch);
+    if (n == 0)
+      sched_yield();
+  }
+  producer.join();
+  printf("capacity %zd batch %zd: sum %lld\n", capacity, batch, static_cast<long long>(sum));
+  BOOST_CHECK_EQUAL(errors, 0);
+  BOOST_CHECK_EQUAL(sum, kItems * (kItems + 1) / 2);
+  BOOST_CHECK(queue.empty());
+}
+
+BOOST_AUTO_TEST_CASE(testProducerConsumer)
+{
+  producerConsumer(2, 1);
+  producerConsumer(1024, 1);
+  producerConsumer(1024, 64);
+}
@@ -52,6 +52,24 @@ void Acceptor::listen()
   acceptChannel_.enableReading();
 }
 
+void Acceptor::pause()
+{
+  loop_->assertInLoopThread();
+  if (acceptChannel_.isReading())
+  {
+    acceptChannel_.disableReading();
+  }
+}
+
+void Acceptor::resume()
+{
+  loop_->assertInLoopThread();
+  if (listening_ && !acceptChannel_.isReading())
+  {
+    acceptChannel_.enableReading();
+  }
+}
+
 void Acceptor::handleRead()
 {
   loop_->assertInLoopThread();
@@ -42,6 +42,12 @@ class Acceptor : noncopyable
 
   bool listening() const { return listening_; }
 
+  /// Stops accepting, new connections wait in the backlog of listen(),
+  /// or get refused when it's full.
+  void pause();
+  void resume();
+  bool paused() const { return listening_ && !acceptChannel_.isReading(); }
+
   // Deprecated, use the correct spelling one above.
   // Leave the wrong spelling here in case one needs to grep it for error messages.
   // bool listenning() const { return listening(); }
@@ -17,6 +17,18 @@
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+// listed from the start, before the first Buffer
+MemoryTag& __attribute__ ((unused)) g_bufferMemoryTag = net::detail::bufferMemoryTag();
+}  // namespace
+
+MemoryTag& net::detail::bufferMemoryTag()
+{
+  static MemoryTag* tag = new MemoryTag("buffer");
+  return *tag;
+}
+
 const char Buffer::kCRLF[] = "\r\n";
 
 const size_t Buffer::kCheapPrepend;
@@ -12,6 +12,7 @@
 #define MUDUO_NET_BUFFER_H
 
 #include "muduo/base/copyable.h"
+#include "muduo/base/MemoryTag.h"
 #include "muduo/base/StringPiece.h"
 #include "muduo/base/Types.h"
 
@@ -29,6 +30,12 @@ namespace muduo
 namespace net
 {
 
+namespace detail
+{
+/// capacity of all Buffers, "buffer"
+MemoryTag& bufferMemoryTag();
+}  // namespace detail
+
 /// A buffer class modeled after org.jboss.netty.buffer.ChannelBuffer
 ///
 /// @code
@@ -422,7 +429,7 @@ class Buffer : public muduo::copyable
   }
 
  private:
-  std::vector<char> buffer_;
+  std::vector<char, TaggedAllocator<char, &detail::bufferMemoryTag>> buffer_;
   size_t readerIndex_;
   size_t writerIndex_;
 
@@ -56,7 +56,7 @@ class Channel : noncopyable
   int fd() const { return fd_; }
   int events() const { return events_; }
   void set_revents(int revt) { revents_ = revt; } // used by pollers
-  // int revents() const { return revents_; }
+  int revents() const { return revents_; }
   bool isNoneEvent() const { return events_ == kNoneEvent; }
 
   void enableReading() { events_ |= kReadEvent; update(); }
@@ -0,0 +1,113 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/net/ConnectionTable.h"
+
+#include <assert.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+const size_t kInitialCapacity = 64;
+const int kInitialShift = 64 - 6;
+}  // namespace
+
+ConnectionTable::ConnectionTable()
+  : slots_(kInitialCapacity),
+    mask_(kInitialCapacity - 1),
+    shift_(kInitialShift),
+    size_(0)
+{
+}
+
+size_t ConnectionTable::lookup(int64_t id) const
+{
+  size_t i = home(id);
+  while (slots_[i].id != 0 && slots_[i].id != id)
+  {
+    i = (i + 1) & mask_;
+  }
+  return i;
+}
+
+void ConnectionTable::insert(int64_t id, const TcpConnectionPtr& conn)
+{
+  assert(id > 0);
+  // keeps load factor under 1/2, probe sequences stay short
+  if ((size_ + 1) * 2 > slots_.size())
+  {
+    grow();
+  }
+  size_t i = lookup(id);
+  assert(slots_[i].id == 0);
+  slots_[i].id = id;
+  slots_[i].conn = conn;
+  ++size_;
+}
+
+TcpConnectionPtr* ConnectionTable::find(int64_t id)
+{
+  size_t i = lookup(id);
+  return slots_[i].id == id ? &slots_[i].conn : NULL;
+}
+
+bool ConnectionTable::erase(int64_t id)
+{
+  size_t i = lookup(id);
+  if (slots_[i].id != id)
+  {
+    return false;
+  }
+  // shifts back following entries whose home is not in (i, j],
+  // so that lookup() never stops early at the hole.
+  size_t j = i;
+  while (true)
+  {
+    j = (j + 1) & mask_;
+    if (slots_[j].id == 0)
+      break;
+    size_t k = home(slots_[j].id);
+    bool movable = (i <= j) ? (k <= i || k > j) : (k <= i && k > j);
+    if (movable)
+    {
+      slots_[i].id = slots_[j].id;
+      slots_[i].conn.swap(slots_[j].conn);
+      i = j;
+    }
+  }
+  slots_[i].id = 0;
+  slots_[i].conn.reset();
+  --size_;
+  return true;
+}
+
+void ConnectionTable::clear()
+{
+  for (Slot& slot : slots_)
+  {
+    slot.id = 0;
+    slot.conn.reset();
+  }
+  size_ = 0;
+}
+
+void ConnectionTable::grow()
+{
+  std::vector<Slot> old(slots_.size() * 2);
+  old.swap(slots_);
+  mask_ = slots_.size() - 1;
+  --shift_;
+  for (Slot& slot : old)
+  {
+    if (slot.id > 0)
+    {
+      size_t i = lookup(slot.id);
+      slots_[i].id = slot.id;
+      slots_[i].conn.swap(slot.conn);
+    }
+  }
+}
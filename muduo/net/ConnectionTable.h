@@ -0,0 +1,83 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_CONNECTIONTABLE_H
+#define MUDUO_NET_CONNECTIONTABLE_H
+
+#include "muduo/base/noncopyable.h"
+#include "muduo/net/TcpConnection.h"
+
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Connections of TcpServer keyed by connection id.
+///
+/// Open addressing with linear probing and backward shift deletion,
+/// no tombstones.  Ids are scattered with Fibonacci hashing, because
+/// sequential ids at their own slots would form one long cluster of
+/// live connections, which every erase() has to scan through.
+///
+/// Not thread safe, TcpServer uses it in its loop thread only.
+///
+class ConnectionTable : noncopyable
+{
+ public:
+  ConnectionTable();
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  size_t capacity() const { return slots_.size(); }
+
+  /// id must be positive and not in the table.
+  void insert(int64_t id, const TcpConnectionPtr& conn);
+  /// returns false if not found.
+  bool erase(int64_t id);
+  /// returns NULL if not found.
+  TcpConnectionPtr* find(int64_t id);
+
+  template<typename Func>
+  void forEach(Func func)
+  {
+    for (Slot& slot : slots_)
+    {
+      if (slot.id > 0)
+        func(slot.conn);
+    }
+  }
+
+  void clear();
+
+ private:
+  struct Slot
+  {
+    Slot() : id(0) {}
+    int64_t id;  // 0 for empty
+    TcpConnectionPtr conn;
+  };
+
+  size_t home(int64_t id) const
+  {
+    return static_cast<size_t>((static_cast<uint64_t>(id) * 0x9E3779B97F4A7C15ull) >> shift_);
+  }
+  size_t lookup(int64_t id) const;
+  void grow();
+
+  std::vector<Slot> slots_;
+  size_t mask_;
+  int shift_;  // 64 - log2(capacity)
+  size_t size_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_CONNECTIONTABLE_H
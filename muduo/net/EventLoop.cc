@@ -8,9 +8,11 @@
 
 #include "muduo/net/EventLoop.h"
 
+#include "muduo/base/Clock.h"
 #include "muduo/base/Logging.h"
 #include "muduo/base/Mutex.h"
 #include "muduo/net/Channel.h"
+#include "muduo/net/EventLoopTracer.h"
 #include "muduo/net/Poller.h"
 #include "muduo/net/SocketsOps.h"
 #include "muduo/net/TimerQueue.h"
@@ -73,13 +75,18 @@ EventLoop::EventLoop()
     quit_(false),
     eventHandling_(false),
     callingPendingFunctors_(false),
+    traced_(false),
     iteration_(0),
     threadId_(CurrentThread::tid()),
     poller_(Poller::newDefaultPoller(this)),
     timerQueue_(new TimerQueue(this)),
     wakeupFd_(createEventfd()),         // 通过创建一个eventfd在其fd write写入触发事件
     wakeupChannel_(new Channel(this, wakeupFd_)),
-    currentActiveChannel_(NULL)
+    currentActiveChannel_(NULL),
+    codel_(NULL),
+    tracer_(new EventLoopTracer),
+    pendingSinceUs_(0),
+    lowPriorityBudget_(0)
 {
   LOG_DEBUG << "EventLoop created " << this << " in thread " << threadId_;
   if (t_loopInThisThread)
@@ -104,6 +111,7 @@ EventLoop::~EventLoop()
   wakeupChannel_->disableAll();
   wakeupChannel_->remove();
   ::close(wakeupFd_);
+  delete codel_;
   t_loopInThisThread = NULL;
 }
 
@@ -118,8 +126,16 @@ void EventLoop::loop()
   while (!quit_)
   {
     activeChannels_.clear();
+    traced_ = tracer_->beginIteration();
+    int64_t pollStart = traced_ ? EventLoopTracer::now() : 0;
     pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
-    ++iteration_;
+    if (traced_)
+    {
+      tracer_->record(EventLoopTracer::kPoll, pollStart, EventLoopTracer::now(),
+                      static_cast<int64_t>(activeChannels_.size()));
+    }
+    __atomic_store_n(&iteration_, iteration_ + 1, __ATOMIC_RELAXED);
+    Clock::setCachedNow(pollReturnTime_);
     if (Logger::logLevel() <= Logger::TRACE)
     {
       printActiveChannels();
@@ -129,13 +145,27 @@ void EventLoop::loop()
     for (Channel* channel : activeChannels_)
     {
       currentActiveChannel_ = channel;
-      currentActiveChannel_->handleEvent(pollReturnTime_);
+      if (traced_)
+      {
+        // channel may be gone after handling
+        int fd = channel->fd();
+        int revents = channel->revents();
+        int64_t start = EventLoopTracer::now();
+        currentActiveChannel_->handleEvent(pollReturnTime_);
+        tracer_->record(EventLoopTracer::kChannel, start, EventLoopTracer::now(), fd, revents);
+      }
+      else
+      {
+        currentActiveChannel_->handleEvent(pollReturnTime_);
+      }
     }
     currentActiveChannel_ = NULL;
     eventHandling_ = false;
     doPendingFunctors();
   }
+  traced_ = false;
 
+  Clock::setCachedNow(Timestamp());
   LOG_TRACE << "EventLoop " << this << " stop looping";
   looping_ = false;
 }
@@ -164,11 +194,44 @@ void EventLoop::runInLoop(Functor cb)
   }
 }
 
+void EventLoop::runInLoop(Functor cb, Priority priority)
+{
+  // a low priority callback has to wait for its turn
+  if (priority != kLowPriority && isInLoopThread())
+  {
+    cb();
+  }
+  else
+  {
+    queueInLoop(std::move(cb), priority);
+  }
+}
+
 void EventLoop::queueInLoop(Functor cb)
+{
+  queueInLoop(std::move(cb), kNormalPriority);
+}
+
+void EventLoop::queueInLoop(Functor cb, Priority priority)
 {
   {
   MutexLockGuard lock(mutex_);
-  pendingFunctors_.push_back(std::move(cb));
+  if (priority == kHighPriority)
+  {
+    highPriorityFunctors_.push_back(std::move(cb));
+  }
+  else if (priority == kLowPriority)
+  {
+    lowPriorityFunctors_.push_back(std::move(cb));
+  }
+  else
+  {
+    if (codel_ && pendingFunctors_.empty())
+    {
+      pendingSinceUs_ = Timestamp::now().microSecondsSinceEpoch();
+    }
+    pendingFunctors_.push_back(std::move(cb));
+  }
   }
 
   if (!isInLoopThread() || callingPendingFunctors_)
@@ -177,27 +240,67 @@ void EventLoop::queueInLoop(Functor cb)
   }
 }
 
+void EventLoop::setLowPriorityBudget(size_t maxFunctors)
+{
+  MutexLockGuard lock(mutex_);
+  lowPriorityBudget_ = maxFunctors;
+}
+
+size_t EventLoop::lowPriorityBudget() const
+{
+  MutexLockGuard lock(mutex_);
+  return lowPriorityBudget_;
+}
+
+void EventLoop::enableCoDel(double targetSeconds, double intervalSeconds)
+{
+  assert(!looping_ || isInLoopThread());
+  // queueInLoop() reads it with mutex_, overloaded() without
+  MutexLockGuard lock(mutex_);
+  if (codel_ != NULL)
+  {
+    LOG_WARN << "EventLoop::enableCoDel() CoDel is enabled already";
+    return;
+  }
+  __atomic_store_n(&codel_, new CoDel(targetSeconds, intervalSeconds), __ATOMIC_RELEASE);
+}
+
 size_t EventLoop::queueSize() const
 {
   MutexLockGuard lock(mutex_);
-  return pendingFunctors_.size();
+  return highPriorityFunctors_.size() + pendingFunctors_.size() + lowPriorityFunctors_.size();
 }
 
 TimerId EventLoop::runAt(Timestamp time, TimerCallback cb)
 {
-  return timerQueue_->addTimer(std::move(cb), time, 0.0);
+  return runAt(time, std::move(cb), kNormalPriority);
+}
+
+TimerId EventLoop::runAt(Timestamp time, TimerCallback cb, Priority priority)
+{
+  return timerQueue_->addTimer(std::move(cb), time, 0.0, priority);
 }
 
 TimerId EventLoop::runAfter(double delay, TimerCallback cb)
+{
+  return runAfter(delay, std::move(cb), kNormalPriority);
+}
+
+TimerId EventLoop::runAfter(double delay, TimerCallback cb, Priority priority)
 {
   Timestamp time(addTime(Timestamp::now(), delay));
-  return runAt(time, std::move(cb));
+  return runAt(time, std::move(cb), priority);
 }
 
 TimerId EventLoop::runEvery(double interval, TimerCallback cb)
+{
+  return runEvery(interval, std::move(cb), kNormalPriority);
+}
+
+TimerId EventLoop::runEvery(double interval, TimerCallback cb, Priority priority)
 {
   Timestamp time(addTime(Timestamp::now(), interval));
-  return timerQueue_->addTimer(std::move(cb), time, interval);
+  return timerQueue_->addTimer(std::move(cb), time, interval, priority);
 }
 
 void EventLoop::cancel(TimerId timerId)
@@ -261,19 +364,77 @@ void EventLoop::handleRead()
 
 void EventLoop::doPendingFunctors()
 {
+  std::vector<Functor> highPriority;
   std::vector<Functor> functors;
+  std::vector<Functor> lowPriority;
   callingPendingFunctors_ = true;
 
+  int64_t pendingSinceUs = 0;
+  bool moreLowPriority = false;
   {
   MutexLockGuard lock(mutex_);
+  highPriority.swap(highPriorityFunctors_);
   functors.swap(pendingFunctors_);
+  pendingSinceUs = pendingSinceUs_;
+  size_t n = lowPriorityFunctors_.size();
+  if (lowPriorityBudget_ > 0 && n > lowPriorityBudget_)
+  {
+    n = lowPriorityBudget_;
+    moreLowPriority = true;
+  }
+  lowPriority.reserve(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    lowPriority.push_back(std::move(lowPriorityFunctors_.front()));
+    lowPriorityFunctors_.pop_front();
+  }
   }
 
-  for (const Functor& functor : functors)
+  if (codel_)
   {
-    functor();
+    // all are taken, the oldest waited the longest
+    if (!functors.empty())
+    {
+      int64_t now = Timestamp::now().microSecondsSinceEpoch();
+      codel_->onDequeue(now - pendingSinceUs, now);
+    }
+    else
+    {
+      codel_->onEmpty();
+    }
   }
+
+  runFunctors(highPriority, kHighPriority);
+  runFunctors(functors, kNormalPriority);
+  runFunctors(lowPriority, kLowPriority);
   callingPendingFunctors_ = false;
+
+  if (moreLowPriority)
+  {
+    // polls I/O events before running the rest
+    wakeup();
+  }
+}
+
+void EventLoop::runFunctors(const std::vector<Functor>& functors, Priority priority)
+{
+  if (traced_ && !functors.empty())
+  {
+    int64_t start = EventLoopTracer::now();
+    for (const Functor& functor : functors)
+    {
+      functor();
+    }
+    tracer_->record(EventLoopTracer::kFunctors, start, EventLoopTracer::now(),
+                    static_cast<int64_t>(functors.size()), priority);
+  }
+  else
+  {
+    for (const Functor& functor : functors)
+    {
+      functor();
+    }
+  }
 }
 
 void EventLoop::printActiveChannels() const
@@ -12,11 +12,13 @@
 #define MUDUO_NET_EVENTLOOP_H
 
 #include <atomic>
+#include <deque>
 #include <functional>
 #include <vector>
 
 #include <boost/any.hpp>
 
+#include "muduo/base/CoDel.h"
 #include "muduo/base/Mutex.h"
 #include "muduo/base/CurrentThread.h"
 #include "muduo/base/Timestamp.h"
@@ -29,6 +31,7 @@ namespace net
 {
 
 class Channel;
+class EventLoopTracer;
 class Poller;
 class TimerQueue;
 
@@ -41,6 +44,16 @@ class EventLoop : noncopyable
  public:
   typedef std::function<void()> Functor;
 
+  /// Priority classes of queued callbacks and timers.
+  /// In each iteration, high priority callbacks run before normal ones,
+  /// low priority ones run last, at most lowPriorityBudget() of them.
+  enum Priority
+  {
+    kHighPriority,
+    kNormalPriority,
+    kLowPriority,
+  };
+
   EventLoop();
   ~EventLoop();  // force out-line dtor, for std::unique_ptr members.
 
@@ -59,40 +72,73 @@ class EventLoop : noncopyable
 
   ///
   /// Time when poll returns, usually means data arrival.
+  /// Also available as Clock::cachedNow() in the loop thread.
   ///
   Timestamp pollReturnTime() const { return pollReturnTime_; }
 
-  int64_t iteration() const { return iteration_; }
+  int64_t iteration() const { return __atomic_load_n(&iteration_, __ATOMIC_RELAXED); }
 
   /// Runs callback immediately in the loop thread.
   /// It wakes up the loop, and run the cb.
   /// If in the same loop thread, cb is run within the function.
   /// Safe to call from other threads.
   void runInLoop(Functor cb);
+  void runInLoop(Functor cb, Priority priority);
   /// Queues callback in the loop thread.
   /// Runs after finish pooling.
   /// Safe to call from other threads.
   void queueInLoop(Functor cb);
+  void queueInLoop(Functor cb, Priority priority);
 
+  /// Runs at most @c maxFunctors low priority callbacks per iteration,
+  /// the rest wait for next iteration, after I/O events are handled.
+  /// 0 for unlimited, the default.
+  /// Safe to call from other threads.
+  void setLowPriorityBudget(size_t maxFunctors);
+  size_t lowPriorityBudget() const;
+
+  /// callbacks of all priorities
   size_t queueSize() const;
 
+  /// Measures how long queued callbacks wait before running.
+  /// Must be called before loop() or in the loop thread, calls after
+  /// the first one are ignored.
+  void enableCoDel(double targetSeconds = 0.005, double intervalSeconds = 0.1);
+  /// Only normal priority callbacks are measured.
+  /// Callbacks wait longer than target for a whole interval,
+  /// producers should shed work, false if CoDel is not enabled.
+  /// Safe to call from other threads.
+  bool overloaded() const
+  {
+    const CoDel* c = codel();
+    return c && c->overloaded();
+  }
+  const CoDel* codel() const { return __atomic_load_n(&codel_, __ATOMIC_ACQUIRE); }
+
   // timers
 
   ///
   /// Runs callback at 'time'.
   /// Safe to call from other threads.
   ///
+  /// Timers expiring together run in priority order, a low priority
+  /// timer is queued as a low priority callback when it expires,
+  /// canceling it after that doesn't stop the queued callback.
+  ///
   TimerId runAt(Timestamp time, TimerCallback cb);
+  TimerId runAt(Timestamp time, TimerCallback cb, Priority priority);
   ///
   /// Runs callback after @c delay seconds.
   /// Safe to call from other threads.
   ///
   TimerId runAfter(double delay, TimerCallback cb);
+  TimerId runAfter(double delay, TimerCallback cb, Priority priority);
   ///
   /// Runs callback every @c interval seconds.
   /// Safe to call from other threads.
   ///
   TimerId runEvery(double interval, TimerCallback cb);
+  TimerId runEvery(double interval, TimerCallback cb, Priority priority);
   ///
   /// Cancels the timer.
   /// Safe to call from other threads.
@@ -116,6 +162,8 @@ class EventLoop : noncopyable
   bool isInLoopThread() const { return threadId_ == CurrentThread::tid(); }
   // bool callingPendingFunctors() const { return callingPendingFunctors_; }
   bool eventHandling() const { return eventHandling_; }
+  /// NULL unless this iteration is traced
+  EventLoopTracer* tracer() const { return traced_ ? tracer_.get() : NULL; }
 
   void setContext(const boost::any& context)
   { context_ = context; }
@@ -132,6 +180,7 @@ class EventLoop : noncopyable
   void abortNotInLoopThread();
   void handleRead();  // waked up
   void doPendingFunctors();
+  void runFunctors(const std::vector<Functor>& functors, Priority priority);
 
   void printActiveChannels() const; // DEBUG
 
@@ -141,7 +190,8 @@ class EventLoop : noncopyable
   std::atomic<bool> quit_;
   bool eventHandling_; /* atomic */
   bool callingPendingFunctors_; /* atomic */
-  int64_t iteration_;
+  bool traced_;
+  int64_t iteration_;  // __atomic, read by other threads
   const pid_t threadId_;
   Timestamp pollReturnTime_;
   std::unique_ptr<Poller> poller_;
@@ -156,8 +206,15 @@ class EventLoop : noncopyable
   ChannelList activeChannels_;
   Channel* currentActiveChannel_;
 
+  CoDel* codel_;  // __atomic, owned, set once by enableCoDel()
+  std::unique_ptr<EventLoopTracer> tracer_;
+
   mutable MutexLock mutex_;
   std::vector<Functor> pendingFunctors_ GUARDED_BY(mutex_);
+  std::vector<Functor> highPriorityFunctors_ GUARDED_BY(mutex_);
+  std::deque<Functor> lowPriorityFunctors_ GUARDED_BY(mutex_);
+  int64_t pendingSinceUs_ GUARDED_BY(mutex_);  // with CoDel only
+  size_t lowPriorityBudget_ GUARDED_BY(mutex_);
 };
 
 }  // namespace net
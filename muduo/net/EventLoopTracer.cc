@@ -0,0 +1,262 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/net/EventLoopTracer.h"
+
+#include "muduo/base/Clock.h"
+#include "muduo/base/CurrentThread.h"
+#include "muduo/base/Mutex.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <inttypes.h>
+#include <poll.h>
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int EventLoopTracer::kCapacity;
+int EventLoopTracer::s_sampleEvery = 0;
+int64_t EventLoopTracer::s_minDurationNanos = 0;
+
+namespace
+{
+
+MutexLock& tracersMutex()
+{
+  static MutexLock* mutex = new MutexLock;
+  return *mutex;
+}
+
+std::vector<EventLoopTracer*>& allTracers()
+{
+  static std::vector<EventLoopTracer*>* tracers = new std::vector<EventLoopTracer*>;
+  return *tracers;
+}
+
+const char* priorityName(int priority)
+{
+  // EventLoop::Priority
+  static const char* names[] = { "high", "normal", "low" };
+  return 0 <= priority && priority < 3 ? names[priority] : "unknown";
+}
+
+void appendEscaped(const string& str, string* output)
+{
+  for (char c : str)
+  {
+    if (c == '"' || c == '\\')
+    {
+      output->push_back('\\');
+      output->push_back(c);
+    }
+    else if (static_cast<unsigned char>(c) >= 0x20)
+    {
+      output->push_back(c);
+    }
+  }
+}
+
+void appendRevents(int revents, string* output)
+{
+  if (revents & POLLIN)
+    output->append("IN ");
+  if (revents & POLLPRI)
+    output->append("PRI ");
+  if (revents & POLLOUT)
+    output->append("OUT ");
+  if (revents & POLLHUP)
+    output->append("HUP ");
+  if (revents & POLLRDHUP)
+    output->append("RDHUP ");
+  if (revents & POLLERR)
+    output->append("ERR ");
+  if (revents & POLLNVAL)
+    output->append("NVAL ");
+  if (!output->empty() && output->back() == ' ')
+  {
+    output->resize(output->size() - 1);
+  }
+}
+
+}  // namespace
+
+EventLoopTracer::EventLoopTracer()
+  : tid_(CurrentThread::tid()),
+    name_(CurrentThread::name()),
+    countdown_(0),
+    ring_(NULL),
+    head_(0)
+{
+  MutexLockGuard lock(tracersMutex());
+  allTracers().push_back(this);
+}
+
+EventLoopTracer::~EventLoopTracer()
+{
+  {
+  MutexLockGuard lock(tracersMutex());
+  std::vector<EventLoopTracer*>& tracers = allTracers();
+  tracers.erase(std::remove(tracers.begin(), tracers.end(), this), tracers.end());
+  }
+  delete[] ring_;
+}
+
+int64_t EventLoopTracer::now()
+{
+  return TscClock::instance().nowNanos();
+}
+
+bool EventLoopTracer::sample(int every)
+{
+  if (++countdown_ < every)
+  {
+    return false;
+  }
+  countdown_ = 0;
+  if (ring_ == NULL)
+  {
+    // read by dump() in other threads
+    __atomic_store_n(&ring_, new Span[kCapacity], __ATOMIC_RELEASE);
+  }
+  return true;
+}
+
+void EventLoopTracer::append(SpanType type, int64_t start, int64_t duration,
+                             int64_t arg, int extra)
+{
+  // single writer, readers check head_ again after copying,
+  // to drop spans overwritten meanwhile
+  int64_t head = head_;
+  Span& span = ring_[head % kCapacity];
+  // pairs with the acquire fence in appendJson(), a reader seeing any
+  // store below sees head_ of at least head, and drops this slot
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  __atomic_store_n(&span.start, start, __ATOMIC_RELAXED);
+  __atomic_store_n(&span.duration, duration, __ATOMIC_RELAXED);
+  __atomic_store_n(&span.arg, arg, __ATOMIC_RELAXED);
+  __atomic_store_n(&span.type, static_cast<int32_t>(type), __ATOMIC_RELAXED);
+  __atomic_store_n(&span.extra, static_cast<int32_t>(extra), __ATOMIC_RELAXED);
+  __atomic_store_n(&head_, head + 1, __ATOMIC_RELEASE);
+}
+
+void EventLoopTracer::start(int sampleEvery, int64_t minDurationUs)
+{
+  // calibrates here, not in the first traced iteration
+  TscClock::instance();
+  __atomic_store_n(&s_minDurationNanos, std::max(minDurationUs, int64_t(0)) * 1000,
+                   __ATOMIC_RELAXED);
+  __atomic_store_n(&s_sampleEvery, std::max(sampleEvery, 1), __ATOMIC_RELAXED);
+}
+
+void EventLoopTracer::stop()
+{
+  __atomic_store_n(&s_sampleEvery, 0, __ATOMIC_RELAXED);
+}
+
+string EventLoopTracer::dump(double seconds)
+{
+  int64_t since = seconds > 0 ? now() - static_cast<int64_t>(seconds * 1e9) : INT64_MIN;
+  string result = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  {
+  MutexLockGuard lock(tracersMutex());
+  for (const EventLoopTracer* tracer : allTracers())
+  {
+    tracer->appendJson(since, &result);
+  }
+  }
+  if (result.back() == ',')
+  {
+    result.resize(result.size() - 1);
+  }
+  result += "]}\n";
+  return result;
+}
+
+void EventLoopTracer::appendJson(int64_t since, string* output) const
+{
+  const Span* ring = __atomic_load_n(&ring_, __ATOMIC_ACQUIRE);
+  if (ring == NULL)
+  {
+    return;
+  }
+  const int64_t head = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+  const int64_t first = std::max(head - kCapacity, int64_t(0));
+  std::vector<Span> spans(static_cast<size_t>(head - first));
+  for (int64_t i = first; i < head; ++i)
+  {
+    const Span& span = ring[i % kCapacity];
+    Span& copy = spans[static_cast<size_t>(i - first)];
+    copy.start = __atomic_load_n(&span.start, __ATOMIC_RELAXED);
+    copy.duration = __atomic_load_n(&span.duration, __ATOMIC_RELAXED);
+    copy.arg = __atomic_load_n(&span.arg, __ATOMIC_RELAXED);
+    copy.type = __atomic_load_n(&span.type, __ATOMIC_RELAXED);
+    copy.extra = __atomic_load_n(&span.extra, __ATOMIC_RELAXED);
+  }
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  // the loop thread may have lapped us while copying, the slot of
+  // headAfter - kCapacity may be the one being written
+  const int64_t headAfter = __atomic_load_n(&head_, __ATOMIC_RELAXED);
+  const int64_t overwritten = headAfter - kCapacity + 1;
+
+  const int pid = ::getpid();
+  char buf[256];
+  snprintf(buf, sizeof buf,
+           "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"",
+           pid, tid_);
+  output->append(buf);
+  appendEscaped(name_, output);
+  output->append("\"}},");
+
+  for (int64_t i = std::max(first, overwritten); i < head; ++i)
+  {
+    const Span& span = spans[static_cast<size_t>(i - first)];
+    if (span.start + span.duration < since)
+    {
+      continue;
+    }
+    const char* name = "";
+    string args;
+    switch (span.type)
+    {
+      case kPoll:
+        name = "poll";
+        snprintf(buf, sizeof buf, "\"channels\":%" PRId64, span.arg);
+        args = buf;
+        break;
+      case kChannel:
+        name = "channel";
+        snprintf(buf, sizeof buf, "\"fd\":%" PRId64 ",\"revents\":\"", span.arg);
+        args = buf;
+        appendRevents(span.extra, &args);
+        args += '"';
+        break;
+      case kFunctors:
+        name = "functors";
+        snprintf(buf, sizeof buf, "\"count\":%" PRId64 ",\"priority\":\"%s\"",
+                 span.arg, priorityName(span.extra));
+        args = buf;
+        break;
+      case kTimer:
+        name = "timer";
+        snprintf(buf, sizeof buf, "\"sequence\":%" PRId64 ",\"priority\":\"%s\"",
+                 span.arg, priorityName(span.extra));
+        args = buf;
+        break;
+    }
+    // microseconds, with nanoseconds in fraction
+    snprintf(buf, sizeof buf,
+             "\n{\"name\":\"%s\",\"cat\":\"loop\",\"ph\":\"X\",\"ts\":%" PRId64 ".%03d,"
+             "\"dur\":%" PRId64 ".%03d,\"pid\":%d,\"tid\":%d,\"args\":{",
+             name, span.start / 1000, static_cast<int>(span.start % 1000),
+             span.duration / 1000, static_cast<int>(span.duration % 1000), pid, tid_);
+    output->append(buf);
+    output->append(args);
+    output->append("}},");
+  }
+}
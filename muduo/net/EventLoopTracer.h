@@ -0,0 +1,118 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_EVENTLOOPTRACER_H
+#define MUDUO_NET_EVENTLOOPTRACER_H
+
+#include "muduo/base/noncopyable.h"
+#include "muduo/base/Types.h"
+
+#include <sys/types.h>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Timeline of EventLoop iterations, in Chrome trace-event format.
+///
+/// Each EventLoop owns one, the loop thread records spans of polling,
+/// handling each active Channel, running queued callbacks and running
+/// each expired timer into a ring of the last kCapacity spans.
+/// Nothing is recorded until start(), then it costs two TSC reads and
+/// a few stores per span, after stop() it is one relaxed load per
+/// iteration.
+///
+///   EventLoopTracer::start(10);  // one in ten iterations
+///   ...
+///   string json = EventLoopTracer::dump(5);  // spans of last 5 seconds
+///
+/// Load the json into chrome://tracing or ui.perfetto.dev, one track
+/// per loop thread.
+///
+/// Static functions are thread safe, others are for the loop thread.
+///
+class EventLoopTracer : noncopyable
+{
+ public:
+  static const int kCapacity = 16384;
+
+  enum SpanType
+  {
+    kPoll,       // arg: number of active channels
+    kChannel,    // arg: fd, extra: revents
+    kFunctors,   // arg: number of callbacks, extra: EventLoop::Priority
+    kTimer,      // arg: sequence of timer, extra: EventLoop::Priority
+  };
+
+  EventLoopTracer();
+  ~EventLoopTracer();
+
+  /// Whether to trace the iteration beginning now.
+  bool beginIteration()
+  {
+    int every = __atomic_load_n(&s_sampleEvery, __ATOMIC_RELAXED);
+    if (__builtin_expect(every <= 0, 1))
+    {
+      return false;
+    }
+    return sample(every);
+  }
+
+  static int64_t now();
+
+  void record(SpanType type, int64_t startNanos, int64_t endNanos,
+              int64_t arg, int extra = 0)
+  {
+    if (endNanos - startNanos >= __atomic_load_n(&s_minDurationNanos, __ATOMIC_RELAXED))
+    {
+      append(type, startNanos, endNanos - startNanos, arg, extra);
+    }
+  }
+
+  int64_t spans() const { return __atomic_load_n(&head_, __ATOMIC_RELAXED); }
+
+  /// Traces one in every sampleEvery iterations of all loops, keeping
+  /// spans no shorter than minDurationUs.
+  static void start(int sampleEvery = 1, int64_t minDurationUs = 0);
+  static void stop();
+  static bool started() { return __atomic_load_n(&s_sampleEvery, __ATOMIC_RELAXED) > 0; }
+
+  /// Trace-event JSON of spans of all loops ending in last seconds,
+  /// all spans in the rings if seconds <= 0.  The oldest span of a full
+  /// ring is left out, the loop thread may be overwriting it.
+  static string dump(double seconds);
+
+ private:
+  struct Span
+  {
+    int64_t start;     // TscClock nanoseconds
+    int64_t duration;
+    int64_t arg;
+    int32_t type;
+    int32_t extra;
+  };
+
+  bool sample(int every);
+  void append(SpanType type, int64_t start, int64_t duration, int64_t arg, int extra);
+  void appendJson(int64_t since, string* output) const;
+
+  const pid_t tid_;
+  const string name_;
+  int countdown_;
+  Span* ring_;  // __atomic, allocated on first traced iteration
+  int64_t head_;  // __atomic, number of spans ever recorded
+
+  static int s_sampleEvery;
+  static int64_t s_minDurationNanos;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_EVENTLOOPTRACER_H
@@ -0,0 +1,198 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/net/FileIoService.h"
+
+#include "muduo/net/EventLoop.h"
+
+#include <algorithm>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+const size_t kReadChunk = 64 * 1024;
+
+// returns errno
+int preadToBuffer(int fd, off_t offset, size_t len, Buffer* buf)
+{
+  // len is only a limit, room for a regular file and one more byte to
+  // see its end, others like those in /proc grow in chunks
+  struct stat st;
+  if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size >= offset)
+  {
+    buf->ensureWritableBytes(std::min(len, static_cast<size_t>(st.st_size - offset) + 1));
+  }
+  while (len > 0)
+  {
+    if (buf->writableBytes() == 0)
+    {
+      buf->ensureWritableBytes(std::min(len, kReadChunk));
+    }
+    size_t toRead = std::min(len, buf->writableBytes());
+    ssize_t n = ::pread(fd, buf->beginWrite(), toRead, offset);
+    if (n > 0)
+    {
+      buf->hasWritten(n);
+      offset += n;
+      len -= n;
+    }
+    else if (n == 0)
+    {
+      break;
+    }
+    else if (errno != EINTR)
+    {
+      return errno;
+    }
+  }
+  return 0;
+}
+
+// returns errno
+int writeAll(int fd, off_t offset, const string& data, ssize_t* written)
+{
+  const char* p = data.data();
+  size_t len = data.size();
+  *written = 0;
+  while (len > 0)
+  {
+    ssize_t n = offset < 0 ? ::write(fd, p, len) : ::pwrite(fd, p, len, offset + *written);
+    if (n >= 0)
+    {
+      p += n;
+      len -= n;
+      *written += n;
+    }
+    else if (errno != EINTR)
+    {
+      return errno;
+    }
+  }
+  return 0;
+}
+
+}  // namespace
+
+FileIoService::FileIoService(const string& name)
+  : pool_(name),
+    completions_(new Completions)
+{
+}
+
+FileIoService::~FileIoService()
+{
+}
+
+void FileIoService::start(int numThreads)
+{
+  assert(numThreads > 0);
+  pool_.start(numThreads);
+}
+
+void FileIoService::stop()
+{
+  pool_.stop();
+}
+
+void FileIoService::readFile(EventLoop* loop, const string& filename, size_t maxSize, ReadCallback cb)
+{
+  pool_.run([this, loop, filename, maxSize, cb] {
+    std::shared_ptr<Buffer> buf(new Buffer);
+    int err = 0;
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0)
+    {
+      err = preadToBuffer(fd, 0, maxSize, buf.get());
+      ::close(fd);
+    }
+    else
+    {
+      err = errno;
+    }
+    complete(loop, [cb, err, buf] { cb(err, buf.get()); });
+  });
+}
+
+void FileIoService::pread(EventLoop* loop, int fd, off_t offset, size_t len, ReadCallback cb)
+{
+  pool_.run([this, loop, fd, offset, len, cb] {
+    std::shared_ptr<Buffer> buf(new Buffer);
+    int err = preadToBuffer(fd, offset, len, buf.get());
+    complete(loop, [cb, err, buf] { cb(err, buf.get()); });
+  });
+}
+
+void FileIoService::appendFile(EventLoop* loop, const string& filename, const string& data, WriteCallback cb)
+{
+  pool_.run([this, loop, filename, data, cb] {
+    ssize_t written = 0;
+    int err = 0;
+    int fd = ::open(filename.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (fd >= 0)
+    {
+      err = writeAll(fd, -1, data, &written);
+      ::close(fd);
+    }
+    else
+    {
+      err = errno;
+    }
+    complete(loop, [cb, err, written] { cb(err, written); });
+  });
+}
+
+void FileIoService::pwrite(EventLoop* loop, int fd, off_t offset, const string& data, WriteCallback cb)
+{
+  assert(offset >= 0);
+  pool_.run([this, loop, fd, offset, data, cb] {
+    ssize_t written = 0;
+    int err = writeAll(fd, offset, data, &written);
+    complete(loop, [cb, err, written] { cb(err, written); });
+  });
+}
+
+void FileIoService::complete(EventLoop* loop, Functor done)
+{
+  bool wakeup = false;
+  {
+  MutexLockGuard lock(completions_->mutex);
+  std::vector<Functor>& pending = completions_->pending[loop];
+  // runCompletions() is queued already if not empty
+  wakeup = pending.empty();
+  pending.push_back(std::move(done));
+  }
+  if (wakeup)
+  {
+    __atomic_fetch_add(&completions_->wakeups, 1, __ATOMIC_RELAXED);
+    loop->queueInLoop(std::bind(&FileIoService::runCompletions, completions_, loop));
+  }
+}
+
+void FileIoService::runCompletions(const std::shared_ptr<Completions>& completions,
+                                   EventLoop* loop)
+{
+  std::vector<Functor> functors;
+  {
+  MutexLockGuard lock(completions->mutex);
+  std::map<EventLoop*, std::vector<Functor>>::iterator it = completions->pending.find(loop);
+  assert(it != completions->pending.end());
+  functors.swap(it->second);
+  // no entry for loops which are gone
+  completions->pending.erase(it);
+  }
+  __atomic_fetch_add(&completions->done, static_cast<int64_t>(functors.size()), __ATOMIC_RELAXED);
+  for (const Functor& done : functors)
+  {
+    done();
+  }
+}
@@ -0,0 +1,100 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_FILEIOSERVICE_H
+#define MUDUO_NET_FILEIOSERVICE_H
+
+#include "muduo/base/Mutex.h"
+#include "muduo/base/ThreadPool.h"
+#include "muduo/net/Buffer.h"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace muduo
+{
+namespace net
+{
+
+class EventLoop;
+
+///
+/// Runs blocking file reads and writes in its own threads, and calls back
+/// in the EventLoop that asked, so handlers touching disk don't stall
+/// their loop.
+///
+///   service.readFile(loop, "/proc/self/status", 64*1024,
+///                    [conn](int err, Buffer* data) { conn->send(data); });
+///
+/// Completions for one loop are batched: the loop is woken up once for
+/// all completions that arrive before it runs them.
+///
+/// Callbacks get errno, 0 on success.  The Buffer is owned by the service,
+/// valid only in the callback, swap or retrieve it to keep the data.
+///
+/// Requests still queued are dropped by stop(), so stop it before
+/// destroying the loops.  The service may be destroyed before loops run
+/// its completions, they still run.  Thread safe.
+///
+class FileIoService : noncopyable
+{
+ public:
+  typedef std::function<void (int savedErrno, Buffer* data)> ReadCallback;
+  typedef std::function<void (int savedErrno, ssize_t written)> WriteCallback;
+
+  explicit FileIoService(const string& name = string("FileIoService"));
+  ~FileIoService();
+
+  void start(int numThreads);
+  void stop();
+
+  /// Reads at most maxSize bytes of the file.
+  void readFile(EventLoop* loop, const string& filename, size_t maxSize, ReadCallback cb);
+
+  /// Reads at most len bytes at offset of fd, fewer at the end of file.
+  /// Caller keeps fd open until the callback.
+  void pread(EventLoop* loop, int fd, off_t offset, size_t len, ReadCallback cb);
+
+  /// Appends data to the file, creates it if not exists.
+  void appendFile(EventLoop* loop, const string& filename, const string& data, WriteCallback cb);
+
+  /// Writes data at offset of fd.
+  void pwrite(EventLoop* loop, int fd, off_t offset, const string& data, WriteCallback cb);
+
+  /// number of callbacks run, and number of times loops were woken up for them
+  int64_t completions() const { return __atomic_load_n(&completions_->done, __ATOMIC_RELAXED); }
+  int64_t wakeups() const { return __atomic_load_n(&completions_->wakeups, __ATOMIC_RELAXED); }
+
+ private:
+  typedef std::function<void ()> Functor;
+
+  // shared with runCompletions() queued in loops, which may run after
+  // the service is destroyed
+  struct Completions
+  {
+    Completions() : done(0), wakeups(0) {}
+
+    MutexLock mutex;
+    std::map<EventLoop*, std::vector<Functor>> pending GUARDED_BY(mutex);
+    int64_t done;  // __atomic
+    int64_t wakeups;  // __atomic
+  };
+
+  void complete(EventLoop* loop, Functor done);
+  static void runCompletions(const std::shared_ptr<Completions>& completions, EventLoop* loop);
+
+  ThreadPool pool_;
+  const std::shared_ptr<Completions> completions_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_FILEIOSERVICE_H
@@ -0,0 +1,157 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/net/MemoryBudget.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TcpConnection.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+MemoryBudget::MemoryBudget(const string& name, int64_t limit)
+  : name_(name),
+    limit_(limit),
+    connectionLimit_(0),
+    pauseBytes_(0),
+    resumeBytes_(0),
+    policy_(kNoEviction),
+    peak_(0),
+    numWaiting_(0)
+{
+  setPauseThresholds(0.75, 0.5);
+}
+
+void MemoryBudget::setPauseThresholds(double pauseRatio, double resumeRatio)
+{
+  assert(0 < resumeRatio && resumeRatio <= pauseRatio);
+  pauseBytes_ = static_cast<int64_t>(static_cast<double>(limit_) * pauseRatio);
+  resumeBytes_ = static_cast<int64_t>(static_cast<double>(limit_) * resumeRatio);
+}
+
+int64_t MemoryBudget::adjust(int64_t delta)
+{
+  int64_t used = used_.addAndGet(delta);
+  int64_t peak = __atomic_load_n(&peak_, __ATOMIC_RELAXED);
+  while (used > peak
+         && !__atomic_compare_exchange_n(&peak_, &peak, used, true,
+                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+  {
+  }
+  return used;
+}
+
+void MemoryBudget::add(const TcpConnectionPtr& conn)
+{
+  MutexLockGuard lock(mutex_);
+  connections_[conn->id()] = conn;
+}
+
+void MemoryBudget::remove(int64_t id, int64_t bytes)
+{
+  {
+    MutexLockGuard lock(mutex_);
+    connections_.erase(id);
+    evicting_.erase(id);
+  }
+  int64_t used = adjust(-bytes);
+  maybeResume(used);
+}
+
+void MemoryBudget::waitForResume(const TcpConnectionPtr& conn)
+{
+  MutexLockGuard lock(mutex_);
+  waiting_.push_back(conn);
+  __atomic_store_n(&numWaiting_, static_cast<int>(waiting_.size()), __ATOMIC_RELAXED);
+}
+
+void MemoryBudget::resumeAll()
+{
+  std::vector<std::weak_ptr<TcpConnection>> waiting;
+  {
+    MutexLockGuard lock(mutex_);
+    waiting.swap(waiting_);
+    __atomic_store_n(&numWaiting_, 0, __ATOMIC_RELAXED);
+  }
+  for (const auto& weakConn : waiting)
+  {
+    TcpConnectionPtr conn(weakConn.lock());
+    if (conn)
+    {
+      conn->getLoop()->runInLoop(std::bind(&TcpConnection::resumeFromBudget, conn));
+    }
+  }
+}
+
+void MemoryBudget::evict()
+{
+  TcpConnectionPtr victim;
+  {
+    MutexLockGuard lock(mutex_);
+    // wait for the previous victim to go, it holds memory until then
+    if (!evicting_.empty())
+      return;
+    if (policy_ == kEvictOldest)
+    {
+      for (auto it = connections_.begin(); it != connections_.end() && !victim; ++it)
+      {
+        victim = it->second.lock();
+      }
+    }
+    else
+    {
+      int64_t largest = -1;
+      for (const auto& item : connections_)
+      {
+        TcpConnectionPtr conn(item.second.lock());
+        if (conn && conn->bufferedBytes() > largest)
+        {
+          largest = conn->bufferedBytes();
+          victim = conn;
+        }
+      }
+    }
+    if (!victim)
+      return;
+    evicting_.insert(victim->id());
+  }
+  evictions_.increment();
+  LOG_WARN << "MemoryBudget [" << name_ << "] used " << used_.get()
+           << " exceeds " << limit_ << ", evicting " << victim->name()
+           << " of " << victim->bufferedBytes() << " bytes";
+  victim->forceClose();
+}
+
+string MemoryBudget::report()
+{
+  size_t numConnections = 0;
+  {
+    MutexLockGuard lock(mutex_);
+    numConnections = connections_.size();
+  }
+  static const char* const kPolicies[] = { "none", "largest", "oldest" };
+  char buf[512];
+  snprintf(buf, sizeof buf,
+           "name %s\n"
+           "limit %" PRId64 "\n"
+           "connection_limit %" PRId64 "\n"
+           "pause_bytes %" PRId64 "\n"
+           "resume_bytes %" PRId64 "\n"
+           "evict_policy %s\n"
+           "used %" PRId64 "\n"
+           "peak %" PRId64 "\n"
+           "connections %zd\n"
+           "waiting %d\n"
+           "pauses_total %" PRId64 "\n"
+           "evictions_total %" PRId64 "\n",
+           name_.c_str(), limit_, connectionLimit_, pauseBytes_, resumeBytes_,
+           kPolicies[policy_], used_.get(), peak(), numConnections,
+           __atomic_load_n(&numWaiting_, __ATOMIC_RELAXED), pauses_.get(), evictions_.get());
+  return buf;
+}
@@ -0,0 +1,136 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_MEMORYBUDGET_H
+#define MUDUO_NET_MEMORYBUDGET_H
+
+#include "muduo/base/Atomic.h"
+#include "muduo/base/Mutex.h"
+#include "muduo/net/Callbacks.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Limits bytes buffered in input and output buffers of connections,
+/// shared by all connections of one or more TcpServer.
+///
+/// - A connection stops reading when its output buffer exceeds
+///   the per-connection limit, ie. its peer is not draining, and
+///   resumes when the output buffer falls below half of the limit.
+/// - All connections stop reading when total bytes exceed the pause
+///   threshold, and resume when total falls below the resume threshold.
+/// - When total exceeds the limit, the largest or the oldest connection
+///   is closed, one at a time.
+///
+/// Counts readable bytes, not capacity of buffers, as Buffer never shrinks.
+/// Pausing can't help if connections hold partial messages in their
+/// input buffers, enable eviction for such protocols.
+///
+/// Thread safe.
+///
+class MemoryBudget : noncopyable
+{
+ public:
+  enum EvictPolicy
+  {
+    kNoEviction,
+    kEvictLargest,
+    kEvictOldest,
+  };
+
+  /// @param limit total bytes, 0 means unlimited, only per-connection
+  ///              limit applies
+  MemoryBudget(const string& name, int64_t limit);
+
+  const string& name() const { return name_; }
+
+  /// Not thread safe, set before connections come.
+  /// 0 means no per-connection limit, which is the default.
+  void setConnectionLimit(int64_t bytes) { connectionLimit_ = bytes; }
+  /// Fractions of limit, 0.75 and 0.5 by default.
+  /// pauseRatio > 1 leaves it to eviction.
+  void setPauseThresholds(double pauseRatio, double resumeRatio);
+  void setEvictPolicy(EvictPolicy policy) { policy_ = policy; }
+
+  int64_t limit() const { return limit_; }
+  int64_t connectionLimit() const { return connectionLimit_; }
+  int64_t used() { return used_.get(); }
+  int64_t peak() const { return __atomic_load_n(&peak_, __ATOMIC_RELAXED); }
+
+  /// for Inspector
+  string report();
+
+  /// Internal use only, called by TcpConnection in its loop.
+  void add(const TcpConnectionPtr& conn);
+  void remove(int64_t id, int64_t bytes);
+  /// returns total used bytes after change
+  int64_t adjust(int64_t delta);
+  bool shouldPause(size_t outputBytes, int64_t used) const
+  {
+    return (connectionLimit_ > 0 && static_cast<int64_t>(outputBytes) > connectionLimit_)
+        || (pauseBytes_ > 0 && used > pauseBytes_);
+  }
+  bool connectionCanResume(size_t outputBytes) const
+  {
+    return connectionLimit_ == 0 || static_cast<int64_t>(outputBytes) <= connectionLimit_ / 2;
+  }
+  bool totalCanResume(int64_t used) const
+  {
+    return resumeBytes_ == 0 || used <= resumeBytes_;
+  }
+  void countPause() { pauses_.increment(); }
+  /// calls conn->resumeFromBudget() when total falls below resume threshold
+  void waitForResume(const TcpConnectionPtr& conn);
+  void maybeResume(int64_t used)
+  {
+    if (__atomic_load_n(&numWaiting_, __ATOMIC_RELAXED) > 0 && totalCanResume(used))
+    {
+      resumeAll();
+    }
+  }
+  void maybeEvict(int64_t used)
+  {
+    if (policy_ != kNoEviction && limit_ > 0 && used > limit_)
+    {
+      evict();
+    }
+  }
+
+ private:
+  void resumeAll();
+  void evict();
+
+  const string name_;
+  const int64_t limit_;
+  int64_t connectionLimit_;
+  int64_t pauseBytes_;
+  int64_t resumeBytes_;
+  EvictPolicy policy_;
+  AtomicInt64 used_;
+  int64_t peak_;  // __atomic
+  int numWaiting_;  // __atomic, size of waiting_
+  AtomicInt64 pauses_;
+  AtomicInt64 evictions_;
+
+  MutexLock mutex_;
+  // by id, the smallest is the oldest
+  std::map<int64_t, std::weak_ptr<TcpConnection>> connections_ GUARDED_BY(mutex_);
+  std::vector<std::weak_ptr<TcpConnection>> waiting_ GUARDED_BY(mutex_);
+  std::set<int64_t> evicting_ GUARDED_BY(mutex_);
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_MEMORYBUDGET_H
@@ -0,0 +1,173 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_NET_SPSCLOOPQUEUE_H
+#define MUDUO_NET_SPSCLOOPQUEUE_H
+
+#include "muduo/base/Logging.h"
+#include "muduo/base/SpscQueue.h"
+#include "muduo/net/Channel.h"
+#include "muduo/net/EventLoop.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Streams items from one producer thread, usually another EventLoop,
+/// to a consumer EventLoop, for fixed stages of a pipeline.
+///
+///   SpscLoopQueue<Request> toWorker(workerLoop, 4096,
+///                                   [](Request& req) { process(req); });
+///   toWorker.tryPush(std::move(req));  // in io loop
+///
+/// Unlike queueInLoop(), a push takes no lock and allocates nothing.
+/// The consumer drains the ring in batches, and marks itself idle only
+/// after finding the ring empty, the producer writes to the eventfd only
+/// when it finds the consumer idle, so a busy pipeline makes no syscalls.
+///
+/// The producer decides what to do when the ring is full, eg. stop
+/// reading from its connection.  Must be created and destroyed in the
+/// consumer loop thread, which calls the callback.
+///
+template<typename T>
+class SpscLoopQueue : noncopyable
+{
+ public:
+  typedef std::function<void (T&)> ItemCallback;
+
+  SpscLoopQueue(EventLoop* loop, size_t maxSize, ItemCallback cb)
+    : loop_(loop),
+      queue_(maxSize),
+      cb_(std::move(cb)),
+      eventfd_(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      channel_(loop, eventfd_),
+      idle_(1),
+      wakeups_(0)
+  {
+    if (eventfd_ < 0)
+    {
+      LOG_SYSFATAL << "Failed in eventfd";
+    }
+    loop_->assertInLoopThread();
+    channel_.setReadCallback(std::bind(&SpscLoopQueue::handleRead, this));
+    channel_.enableReading();
+  }
+
+  ~SpscLoopQueue()
+  {
+    loop_->assertInLoopThread();
+    channel_.disableAll();
+    channel_.remove();
+    ::close(eventfd_);
+  }
+
+  // producer side
+
+  /// Returns false if full, @c x is left untouched.
+  bool tryPush(const T& x)
+  {
+    return queue_.tryPush(x) && notify();
+  }
+
+  bool tryPush(T&& x)
+  {
+    return queue_.tryPush(std::move(x)) && notify();
+  }
+
+  /// Moves up to n items from first, returns the number pushed.
+  template<typename InputIt>
+  size_t tryPushBatch(InputIt first, size_t n)
+  {
+    n = queue_.tryPushBatch(first, n);
+    if (n > 0)
+    {
+      notify();
+    }
+    return n;
+  }
+
+  size_t size() const { return queue_.size(); }
+  size_t capacity() const { return queue_.capacity(); }
+  /// number of eventfd writes by the producer
+  int64_t wakeups() const { return __atomic_load_n(&wakeups_, __ATOMIC_RELAXED); }
+
+ private:
+  bool notify()
+  {
+    // orders the push before loading idle_, pairs with fence in handleRead()
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&idle_, __ATOMIC_RELAXED)
+        && __atomic_exchange_n(&idle_, 0, __ATOMIC_ACQ_REL))
+    {
+      __atomic_fetch_add(&wakeups_, 1, __ATOMIC_RELAXED);
+      wakeup();
+    }
+    return true;
+  }
+
+  void wakeup()
+  {
+    uint64_t one = 1;
+    ssize_t n = ::write(eventfd_, &one, sizeof one);
+    if (n != sizeof one)
+    {
+      LOG_ERROR << "SpscLoopQueue::wakeup() writes " << n << " bytes instead of 8";
+    }
+  }
+
+  void handleRead()
+  {
+    uint64_t one = 1;
+    ssize_t n = ::read(eventfd_, &one, sizeof one);
+    if (n != sizeof one)
+    {
+      LOG_ERROR << "SpscLoopQueue::handleRead() reads " << n << " bytes instead of 8";
+    }
+
+    // at most one ring per wakeup, lets other channels of this loop run
+    size_t budget = queue_.capacity();
+    while (true)
+    {
+      budget -= queue_.consume(cb_, budget);
+      if (budget == 0 && !queue_.empty())
+      {
+        // still busy, producer won't wake us up
+        wakeup();
+        return;
+      }
+      __atomic_store_n(&idle_, 1, __ATOMIC_RELAXED);
+      __atomic_thread_fence(__ATOMIC_SEQ_CST);
+      if (queue_.empty()
+          || !__atomic_exchange_n(&idle_, 0, __ATOMIC_ACQ_REL))
+      {
+        // empty, or producer has seen idle_ and will write to eventfd
+        return;
+      }
+      if (budget == 0)
+      {
+        wakeup();
+        return;
+      }
+    }
+  }
+
+  EventLoop* loop_;
+  SpscQueue<T> queue_;
+  ItemCallback cb_;
+  const int eventfd_;
+  Channel channel_;
+  int idle_;  // __atomic
+  int64_t wakeups_;  // __atomic
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_SPSCLOOPQUEUE_H
@@ -12,14 +12,35 @@
 #include "muduo/base/WeakCallback.h"
 #include "muduo/net/Channel.h"
 #include "muduo/net/EventLoop.h"
+#include "muduo/net/MemoryBudget.h"
 #include "muduo/net/Socket.h"
 #include "muduo/net/SocketsOps.h"
 
 #include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+
+MemoryTag& connectionMemoryTag()
+{
+  static MemoryTag* tag = new MemoryTag("tcp_connection");
+  return *tag;
+}
+
+// listed from the start, before the first TcpConnection
+MemoryTag& __attribute__ ((unused)) g_connectionMemoryTag = connectionMemoryTag();
+
+// TcpConnection with its Socket and Channel, Buffers are counted on their own
+const size_t kConnectionBytes = sizeof(TcpConnection) + sizeof(Socket) + sizeof(Channel);
+
+}  // namespace
+
 void muduo::net::defaultConnectionCallback(const TcpConnectionPtr& conn)
 {
   LOG_TRACE << conn->localAddress().toIpPort() << " -> "
@@ -41,6 +62,7 @@ TcpConnection::TcpConnection(EventLoop* loop,
                              const InetAddress& localAddr,
                              const InetAddress& peerAddr)
   : loop_(CHECK_NOTNULL(loop)),
+    id_(0),
     name_(nameArg),
     state_(kConnecting),
     reading_(true),
@@ -48,7 +70,38 @@ TcpConnection::TcpConnection(EventLoop* loop,
     channel_(new Channel(loop, sockfd)),
     localAddr_(localAddr),
     peerAddr_(peerAddr),
-    highWaterMark_(64*1024*1024)
+    highWaterMark_(64*1024*1024),
+    budgetBytes_(0),
+    budgetPaused_(false),
+    budgetWaiting_(false)
+{
+  init(sockfd);
+}
+
+TcpConnection::TcpConnection(EventLoop* loop,
+                             int64_t id,
+                             const std::shared_ptr<const string>& namePrefix,
+                             int sockfd,
+                             const InetAddress& localAddr,
+                             const InetAddress& peerAddr)
+  : loop_(CHECK_NOTNULL(loop)),
+    id_(id),
+    namePrefix_(namePrefix),
+    state_(kConnecting),
+    reading_(true),
+    socket_(new Socket(sockfd)),
+    channel_(new Channel(loop, sockfd)),
+    localAddr_(localAddr),
+    peerAddr_(peerAddr),
+    highWaterMark_(64*1024*1024),
+    budgetBytes_(0),
+    budgetPaused_(false),
+    budgetWaiting_(false)
+{
+  init(sockfd);
+}
+
+void TcpConnection::init(int sockfd)
 {
   channel_->setReadCallback(
       std::bind(&TcpConnection::handleRead, this, _1));
@@ -58,17 +111,35 @@ TcpConnection::TcpConnection(EventLoop* loop,
       std::bind(&TcpConnection::handleClose, this));
   channel_->setErrorCallback(
       std::bind(&TcpConnection::handleError, this));
-  LOG_DEBUG << "TcpConnection::ctor[" <<  name_ << "] at " << this
+  LOG_DEBUG << "TcpConnection::ctor[" <<  name() << "] at " << this
             << " fd=" << sockfd;
   socket_->setKeepAlive(true);
+  connectionMemoryTag().allocate(kConnectionBytes);
 }
 
 TcpConnection::~TcpConnection()
 {
-  LOG_DEBUG << "TcpConnection::dtor[" <<  name_ << "] at " << this
+  LOG_DEBUG << "TcpConnection::dtor[" <<  name() << "] at " << this
             << " fd=" << channel_->fd()
             << " state=" << stateToString();
   assert(state_ == kDisconnected);
+  connectionMemoryTag().deallocate(kConnectionBytes);
+}
+
+const string& TcpConnection::name() const
+{
+  if (namePrefix_)
+  {
+    // thread safe, name() may be called from any thread
+    std::call_once(nameOnce_, [this] {
+      char buf[32];
+      snprintf(buf, sizeof buf, "%" PRId64, id_);
+      name_.reserve(namePrefix_->size() + strlen(buf));
+      name_ = *namePrefix_;
+      name_ += buf;
+    });
+  }
+  return name_;
 }
 
 bool TcpConnection::getTcpInfo(struct tcp_info* tcpi) const
@@ -192,6 +263,10 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
     {
       channel_->enableWriting();
     }
+    if (budget_)
+    {
+      updateBudget();
+    }
   }
 }
 
@@ -246,7 +321,9 @@ void TcpConnection::forceClose()
   if (state_ == kConnected || state_ == kDisconnecting)
   {
     setState(kDisconnecting);
-    loop_->queueInLoop(std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+    // don't wait behind data to be sent, it will be discarded anyway
+    loop_->queueInLoop(std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()),
+                       EventLoop::kHighPriority);
   }
 }
 
@@ -302,6 +379,7 @@ void TcpConnection::startRead()
 void TcpConnection::startReadInLoop()
 {
   loop_->assertInLoopThread();
+  budgetPaused_ = false;
   if (!reading_ || !channel_->isReading())
   {
     channel_->enableReading();
@@ -317,6 +395,7 @@ void TcpConnection::stopRead()
 void TcpConnection::stopReadInLoop()
 {
   loop_->assertInLoopThread();
+  budgetPaused_ = false;
   if (reading_ || channel_->isReading())
   {
     channel_->disableReading();
@@ -324,6 +403,79 @@ void TcpConnection::stopReadInLoop()
   }
 }
 
+// Called after buffers change, pauses reading when the peer doesn't drain
+// or the budget runs low, resumes when both recover.
+void TcpConnection::updateBudget()
+{
+  if (state_ == kDisconnected)
+  {
+    return;
+  }
+  size_t outputBytes = outputBuffer_.readableBytes();
+  int64_t bytes = static_cast<int64_t>(inputBuffer_.readableBytes() + outputBytes);
+  int64_t delta = bytes - budgetBytes_;
+  if (delta == 0)
+  {
+    return;
+  }
+  __atomic_store_n(&budgetBytes_, bytes, __ATOMIC_RELAXED);
+  int64_t used = budget_->adjust(delta);
+  if (budgetPaused_)
+  {
+    if (budget_->connectionCanResume(outputBytes))
+    {
+      if (budget_->totalCanResume(used))
+      {
+        startReadInLoop();
+      }
+      else if (!budgetWaiting_)
+      {
+        budgetWaiting_ = true;
+        budget_->waitForResume(shared_from_this());
+      }
+    }
+  }
+  else if (reading_ && budget_->shouldPause(outputBytes, used))
+  {
+    stopReadInLoop();
+    budgetPaused_ = true;
+    budget_->countPause();
+    if (budget_->connectionCanResume(outputBytes) && !budgetWaiting_)
+    {
+      budgetWaiting_ = true;
+      budget_->waitForResume(shared_from_this());
+    }
+  }
+
+  if (delta < 0)
+  {
+    budget_->maybeResume(used);
+  }
+  else
+  {
+    budget_->maybeEvict(used);
+  }
+}
+
+void TcpConnection::resumeFromBudget()
+{
+  loop_->assertInLoopThread();
+  budgetWaiting_ = false;
+  if (budgetPaused_ && state_ != kDisconnected
+      && budget_->connectionCanResume(outputBuffer_.readableBytes()))
+  {
+    if (budget_->totalCanResume(budget_->used()))
+    {
+      startReadInLoop();
+    }
+    else
+    {
+      budgetWaiting_ = true;
+      budget_->waitForResume(shared_from_this());
+    }
+  }
+}
+
 void TcpConnection::connectEstablished()
 {
   loop_->assertInLoopThread();
@@ -331,6 +483,10 @@ void TcpConnection::connectEstablished()
   setState(kConnected);
   channel_->tie(shared_from_this());
   channel_->enableReading();
+  if (budget_)
+  {
+    budget_->add(shared_from_this());
+  }
 
   connectionCallback_(shared_from_this());
 }
@@ -346,6 +502,11 @@ void TcpConnection::connectDestroyed()
     connectionCallback_(shared_from_this());
   }
   channel_->remove();
+  if (budget_)
+  {
+    budget_->remove(id_, budgetBytes_);
+    __atomic_store_n(&budgetBytes_, 0, __ATOMIC_RELAXED);
+  }
 }
 
 void TcpConnection::handleRead(Timestamp receiveTime)
@@ -356,6 +517,10 @@ void TcpConnection::handleRead(Timestamp receiveTime)
   if (n > 0)
   {
     messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+    if (budget_)
+    {
+      updateBudget();
+    }
   }
   else if (n == 0)
   {
@@ -380,6 +545,10 @@ void TcpConnection::handleWrite()
     if (n > 0)
     {
       outputBuffer_.retrieve(n);
+      if (budget_)
+      {
+        updateBudget();
+      }
       if (outputBuffer_.readableBytes() == 0)
       {
         channel_->disableWriting();
@@ -427,7 +596,7 @@ void TcpConnection::handleClose()
 void TcpConnection::handleError()
 {
   int err = sockets::getSocketError(channel_->fd());
-  LOG_ERROR << "TcpConnection::handleError [" << name_
+  LOG_ERROR << "TcpConnection::handleError [" << name()
             << "] - SO_ERROR = " << err << " " << strerror_tl(err);
 }
 
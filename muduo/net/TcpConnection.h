@@ -19,6 +19,7 @@
 #include "muduo/net/InetAddress.h"
 
 #include <memory>
+#include <mutex>
 
 #include <boost/any.hpp>
 
@@ -32,6 +33,7 @@ namespace net
 
 class Channel;
 class EventLoop;
+class MemoryBudget;
 class Socket;
 
 ///
@@ -50,10 +52,20 @@ class TcpConnection : noncopyable,
                 int sockfd,
                 const InetAddress& localAddr,
                 const InetAddress& peerAddr);
+  /// Constructs a TcpConnection with a numeric id, its name is
+  /// namePrefix followed by id, formatted on first call of name().
+  TcpConnection(EventLoop* loop,
+                int64_t id,
+                const std::shared_ptr<const string>& namePrefix,
+                int sockfd,
+                const InetAddress& localAddr,
+                const InetAddress& peerAddr);
   ~TcpConnection();
 
   EventLoop* getLoop() const { return loop_; }
-  const string& name() const { return name_; }
+  /// 0 if constructed with a name.
+  int64_t id() const { return id_; }
+  const string& name() const;
   const InetAddress& localAddress() const { return localAddr_; }
   const InetAddress& peerAddress() const { return peerAddr_; }
   bool connected() const { return state_ == kConnected; }
@@ -105,10 +117,20 @@ class TcpConnection : noncopyable,
   Buffer* outputBuffer()
   { return &outputBuffer_; }
 
+  /// Bytes in input and output buffers, last reported to MemoryBudget.
+  int64_t bufferedBytes() const
+  { return __atomic_load_n(&budgetBytes_, __ATOMIC_RELAXED); }
+
   /// Internal use only.
   void setCloseCallback(const CloseCallback& cb)
   { closeCallback_ = cb; }
 
+  /// Internal use only, set by TcpServer before connectEstablished().
+  void setMemoryBudget(const std::shared_ptr<MemoryBudget>& budget)
+  { budget_ = budget; }
+  /// Internal use only, called by MemoryBudget in loop.
+  void resumeFromBudget();
+
   // called when TcpServer accepts a new connection
   void connectEstablished();   // should be called only once
   // called when TcpServer has removed me from its map
@@ -130,9 +152,15 @@ class TcpConnection : noncopyable,
   const char* stateToString() const;
   void startReadInLoop();
   void stopReadInLoop();
+  void updateBudget();
+
+  void init(int sockfd);
 
   EventLoop* loop_;
-  const string name_;
+  const int64_t id_;
+  const std::shared_ptr<const string> namePrefix_;
+  mutable std::once_flag nameOnce_;
+  mutable string name_;
   StateE state_;  // FIXME: use atomic variable
   bool reading_;
   // we don't expose those classes to client.
@@ -149,6 +177,10 @@ class TcpConnection : noncopyable,
   Buffer inputBuffer_;
   Buffer outputBuffer_; // FIXME: use list<Buffer> as output buffer.
   boost::any context_;
+  std::shared_ptr<MemoryBudget> budget_;
+  int64_t budgetBytes_;  // __atomic, written in loop
+  bool budgetPaused_;  // reading stopped by budget_
+  bool budgetWaiting_;  // in budget_'s waiting list
   // FIXME: creationTime_, lastReceiveTime_
   //        bytesReceived_, bytesSent_
 };
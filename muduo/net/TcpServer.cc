@@ -9,13 +9,14 @@
 #include "muduo/net/TcpServer.h"
 
 #include "muduo/base/Logging.h"
+#include "muduo/base/ObjectPool.h"
 #include "muduo/net/Acceptor.h"
+#include "muduo/net/ConnectionTable.h"
 #include "muduo/net/EventLoop.h"
 #include "muduo/net/EventLoopThreadPool.h"
+#include "muduo/net/MemoryBudget.h"
 #include "muduo/net/SocketsOps.h"
 
-#include <stdio.h>  // snprintf
-
 using namespace muduo;
 using namespace muduo::net;
 
@@ -30,7 +31,11 @@ TcpServer::TcpServer(EventLoop* loop,
     threadPool_(new EventLoopThreadPool(loop, name_)),
     connectionCallback_(defaultConnectionCallback),     //TcpConnection.cc
     messageCallback_(defaultMessageCallback),           //TcpConnection.cc
-    nextConnId_(1)                                      //第一个连接为1，随着连接增加在newConnection内部递增
+    overloadCheckInterval_(0.01),
+    connNamePrefix_(std::make_shared<const string>(name_ + "-" + ipPort_ + "#")),
+    nextConnId_(1),                                     //第一个连接为1，随着连接增加在newConnection内部递增
+    activeConnections_(0),
+    connections_(new ConnectionTable)
 {
   acceptor_->setNewConnectionCallback(
       std::bind(&TcpServer::newConnection, this, _1, _2));
@@ -40,14 +45,19 @@ TcpServer::~TcpServer()
 {
   loop_->assertInLoopThread();
   LOG_TRACE << "TcpServer::~TcpServer [" << name_ << "] destructing";
+  if (overloadCheck_)
+  {
+    loop_->cancel(overloadCheckTimer_);
+  }
 
-  for (auto& item : connections_)
+  connections_->forEach([](TcpConnectionPtr& item)
   {
-    TcpConnectionPtr conn(item.second);
-    item.second.reset();
+    TcpConnectionPtr conn(item);
+    item.reset();
     conn->getLoop()->runInLoop(
       std::bind(&TcpConnection::connectDestroyed, conn));
-  }
+  });
+  connections_->clear();
 }
 
 void TcpServer::setThreadNum(int numThreads)
@@ -65,6 +75,26 @@ void TcpServer::start()
     assert(!acceptor_->listening());
     loop_->runInLoop(
         std::bind(&Acceptor::listen, get_pointer(acceptor_)));
+    if (overloadCheck_)
+    {
+      overloadCheckTimer_ = loop_->runEvery(overloadCheckInterval_,
+                                            std::bind(&TcpServer::checkOverload, this));
+    }
+  }
+}
+
+void TcpServer::checkOverload()
+{
+  bool overloaded = overloadCheck_();
+  if (overloaded && !acceptor_->paused())
+  {
+    LOG_WARN << "TcpServer [" << name_ << "] overloaded, stops accepting";
+    acceptor_->pause();
+  }
+  else if (!overloaded && acceptor_->paused())
+  {
+    LOG_WARN << "TcpServer [" << name_ << "] resumes accepting";
+    acceptor_->resume();
   }
 }
 
@@ -73,29 +103,32 @@ void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr)
   loop_->assertInLoopThread();
   //线程池获得一个EventLoop*,并将当前的创建的新TcpConnection放入这个线程中运行
   EventLoop* ioLoop = threadPool_->getNextLoop();
-  char buf[64];
-  snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_);
-  ++nextConnId_;
-  //当前TcpConnection的名字 = servername-ipPort#nextConnId_
-  string connName = name_ + buf;
-
-  LOG_INFO << "TcpServer::newConnection [" << name_
-           << "] - new connection [" << connName
-           << "] from " << peerAddr.toIpPort();
+  int64_t connId = nextConnId_;
+  __atomic_store_n(&nextConnId_, connId + 1, __ATOMIC_RELAXED);
   InetAddress localAddr(sockets::getLocalAddr(sockfd));
   // FIXME poll with zero timeout to double confirm the new connection
-  // FIXME use make_shared if necessary
-  //创建新的TcpConnection的shared_ptr
-  TcpConnectionPtr conn(new TcpConnection(ioLoop,
-                                          connName,
-                                          sockfd,
-                                          localAddr,
-                                          peerAddr));
-  connections_[connName] = conn;
+  //创建新的TcpConnection的shared_ptr，对象和引用计数在一起，内存来自ObjectPool
+  //当前TcpConnection的名字 = servername-ipPort#connId，用到时才格式化
+  TcpConnectionPtr conn = ObjectPool<TcpConnection>::makeShared(ioLoop,
+                                                                connId,
+                                                                connNamePrefix_,
+                                                                sockfd,
+                                                                localAddr,
+                                                                peerAddr);
+  // same as conn->name(), without formatting it for every connection
+  LOG_INFO << "TcpServer::newConnection [" << name_
+           << "] - new connection [" << *connNamePrefix_ << connId
+           << "] from " << peerAddr.toIpPort();
+  connections_->insert(connId, conn);
+  __atomic_store_n(&activeConnections_, static_cast<int64_t>(connections_->size()), __ATOMIC_RELAXED);
   //设置相关的回调函数
   conn->setConnectionCallback(connectionCallback_);
   conn->setMessageCallback(messageCallback_);
   conn->setWriteCompleteCallback(writeCompleteCallback_);
+  if (memoryBudget_)
+  {
+    conn->setMemoryBudget(memoryBudget_);
+  }
   conn->setCloseCallback(
       std::bind(&TcpServer::removeConnection, this, _1)); // FIXME: unsafe
   //将当前的创建的新TcpConnection的connectEstablished()放入线程中运行
@@ -105,19 +138,21 @@ void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr)
 void TcpServer::removeConnection(const TcpConnectionPtr& conn)
 {
   // FIXME: unsafe
-  loop_->runInLoop(std::bind(&TcpServer::removeConnectionInLoop, this, conn));
+  loop_->runInLoop(std::bind(&TcpServer::removeConnectionInLoop, this, conn),
+                   EventLoop::kHighPriority);
 }
 
 void TcpServer::removeConnectionInLoop(const TcpConnectionPtr& conn)
 {
   loop_->assertInLoopThread();
   LOG_INFO << "TcpServer::removeConnectionInLoop [" << name_
-           << "] - connection " << conn->name();
-  size_t n = connections_.erase(conn->name());
-  (void)n;
-  assert(n == 1);
+           << "] - connection " << *connNamePrefix_ << conn->id();
+  bool erased = connections_->erase(conn->id());
+  (void)erased;
+  assert(erased);
+  __atomic_store_n(&activeConnections_, static_cast<int64_t>(connections_->size()), __ATOMIC_RELAXED);
   EventLoop* ioLoop = conn->getLoop();
   ioLoop->queueInLoop(
-      std::bind(&TcpConnection::connectDestroyed, conn));
+      std::bind(&TcpConnection::connectDestroyed, conn), EventLoop::kHighPriority);
 }
 
@@ -14,6 +14,7 @@
 #include "muduo/base/Atomic.h"
 #include "muduo/base/Types.h"
 #include "muduo/net/TcpConnection.h"
+#include "muduo/net/TimerId.h"
 
 #include <map>
 
@@ -23,8 +24,10 @@ namespace net
 {
 
 class Acceptor;
+class ConnectionTable;
 class EventLoop;
 class EventLoopThreadPool;
+class MemoryBudget;
 
 ///
 /// TCP server, supports single-threaded and thread-pool models.
@@ -49,6 +52,13 @@ class TcpServer : noncopyable
 
   const string& ipPort() const { return ipPort_; }
   const string& name() const { return name_; }
+
+  /// connections accepted so far, thread safe.
+  int64_t acceptedConnections() const
+  { return __atomic_load_n(&nextConnId_, __ATOMIC_RELAXED) - 1; }
+  /// connections alive, thread safe.
+  int64_t activeConnections() const
+  { return __atomic_load_n(&activeConnections_, __ATOMIC_RELAXED); }
   EventLoop* getLoop() const { return loop_; }
 
   /// Set the number of threads for handling input.
@@ -89,6 +99,18 @@ class TcpServer : noncopyable
   void setWriteCompleteCallback(const WriteCompleteCallback& cb)
   { writeCompleteCallback_ = cb; }
 
+  /// Stops accepting while @c overloaded returns true, which is checked
+  /// every @c interval seconds in loop thread, eg. ThreadPool::overloaded.
+  /// Must be called before @c start
+  void setOverloadCheck(const std::function<bool()>& overloaded, double interval = 0.01)
+  { overloadCheck_ = overloaded; overloadCheckInterval_ = interval; }
+
+  /// Limits bytes buffered by connections, see MemoryBudget.
+  /// Applies to connections accepted afterwards.
+  /// Not thread safe.
+  void setMemoryBudget(const std::shared_ptr<MemoryBudget>& budget)
+  { memoryBudget_ = budget; }
+
  private:
   /// Not thread safe, but in loop
   void newConnection(int sockfd, const InetAddress& peerAddr);
@@ -96,8 +118,7 @@ class TcpServer : noncopyable
   void removeConnection(const TcpConnectionPtr& conn);
   /// Not thread safe, but in loop
   void removeConnectionInLoop(const TcpConnectionPtr& conn);
-
-  typedef std::map<string, TcpConnectionPtr> ConnectionMap;
+  void checkOverload();
 
   EventLoop* loop_;  // the acceptor loop
   const string ipPort_;
@@ -108,10 +129,17 @@ class TcpServer : noncopyable
   MessageCallback messageCallback_;
   WriteCompleteCallback writeCompleteCallback_;
   ThreadInitCallback threadInitCallback_;
+  std::shared_ptr<MemoryBudget> memoryBudget_;
+  std::function<bool()> overloadCheck_;
+  double overloadCheckInterval_;
+  TimerId overloadCheckTimer_;
   AtomicInt32 started_;
-  // always in loop thread
-  int nextConnId_;
-  ConnectionMap connections_;
+  // "name-ipPort#", shared by names of all connections
+  const std::shared_ptr<const string> connNamePrefix_;
+  // always written in loop thread
+  int64_t nextConnId_;  // __atomic
+  int64_t activeConnections_;  // __atomic
+  std::unique_ptr<ConnectionTable> connections_;
 };
 
 }  // namespace net
@@ -13,6 +13,18 @@ using namespace muduo::net;
 
 AtomicInt64 Timer::s_numCreated_;
 
+namespace
+{
+// listed from the start, before the first Timer
+MemoryTag& __attribute__ ((unused)) g_timerMemoryTag = net::detail::timerMemoryTag();
+}  // namespace
+
+MemoryTag& net::detail::timerMemoryTag()
+{
+  static MemoryTag* tag = new MemoryTag("timer");
+  return *tag;
+}
+
 void Timer::restart(Timestamp now)
 {
   if (repeat_)
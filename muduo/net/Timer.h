@@ -12,14 +12,22 @@
 #define MUDUO_NET_TIMER_H
 
 #include "muduo/base/Atomic.h"
+#include "muduo/base/MemoryTag.h"
 #include "muduo/base/Timestamp.h"
 #include "muduo/net/Callbacks.h"
+#include "muduo/net/EventLoop.h"
 
 namespace muduo
 {
 namespace net
 {
 
+namespace detail
+{
+/// Timers pending in TimerQueues, "timer"
+MemoryTag& timerMemoryTag();
+}  // namespace detail
+
 ///
 /// Internal class for timer event.
 ///
@@ -27,20 +35,31 @@ class Timer : noncopyable
 {
  public:
   // void()
-  Timer(TimerCallback cb, Timestamp when, double interval)
+  Timer(TimerCallback cb, Timestamp when, double interval,
+        EventLoop::Priority priority = EventLoop::kNormalPriority)
     : callback_(std::move(cb)),
       expiration_(when),
       interval_(interval),
       repeat_(interval > 0.0),
+      priority_(priority),
       sequence_(s_numCreated_.incrementAndGet())
-  { }
+  {
+    detail::timerMemoryTag().allocate(sizeof(Timer));
+  }
+
+  ~Timer()
+  {
+    detail::timerMemoryTag().deallocate(sizeof(Timer));
+  }
 
   void run() const
   {
     callback_();
   }
 
+  const TimerCallback& callback() const { return callback_; }
   Timestamp expiration() const  { return expiration_; }
+  EventLoop::Priority priority() const { return priority_; }
   bool repeat() const { return repeat_; }
   int64_t sequence() const { return sequence_; }
 
@@ -53,6 +72,7 @@ class Timer : noncopyable
   Timestamp expiration_;
   const double interval_;
   const bool repeat_;
+  const EventLoop::Priority priority_;
   const int64_t sequence_;
 
   static AtomicInt64 s_numCreated_;
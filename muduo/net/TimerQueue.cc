@@ -13,7 +13,9 @@
 #include "muduo/net/TimerQueue.h"
 
 #include "muduo/base/Logging.h"
+#include "muduo/base/ObjectPool.h"
 #include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopTracer.h"
 #include "muduo/net/Timer.h"
 #include "muduo/net/TimerId.h"
 
@@ -109,15 +111,16 @@ TimerQueue::~TimerQueue()
   // do not remove channel, since we're in EventLoop::dtor();
   for (const Entry& timer : timers_)
   {
-    delete timer.second;
+    ObjectPool<Timer>::destroy(timer.second);
   }
 }
 
 TimerId TimerQueue::addTimer(TimerCallback cb,
                              Timestamp when,
-                             double interval)
+                             double interval,
+                             EventLoop::Priority priority)
 {
-  Timer* timer = new Timer(std::move(cb), when, interval);
+  Timer* timer = ObjectPool<Timer>::create(std::move(cb), when, interval, priority);
   loop_->runInLoop(
       std::bind(&TimerQueue::addTimerInLoop, this, timer));
   return TimerId(timer, timer->sequence());
@@ -150,7 +153,7 @@ void TimerQueue::cancelInLoop(TimerId timerId)
   {
     size_t n = timers_.erase(Entry(it->first->expiration(), it->first));
     assert(n == 1); (void)n;
-    delete it->first; // FIXME: no delete please
+    ObjectPool<Timer>::destroy(it->first);
     activeTimers_.erase(it);
   }
   else if (callingExpiredTimers_)
@@ -173,13 +176,37 @@ void TimerQueue::handleRead()
   // safe to callback outside critical section
   for (const Entry& it : expired)
   {
-    it.second->run();
+    if (it.second->priority() == EventLoop::kHighPriority)
+      runTimer(it.second);
+  }
+  for (const Entry& it : expired)
+  {
+    if (it.second->priority() == EventLoop::kNormalPriority)
+      runTimer(it.second);
+    else if (it.second->priority() == EventLoop::kLowPriority)
+      loop_->queueInLoop(it.second->callback(), EventLoop::kLowPriority);
   }
   callingExpiredTimers_ = false;
 
   reset(expired, now);
 }
 
+void TimerQueue::runTimer(Timer* timer)
+{
+  EventLoopTracer* tracer = loop_->tracer();
+  if (tracer)
+  {
+    int64_t start = EventLoopTracer::now();
+    timer->run();
+    tracer->record(EventLoopTracer::kTimer, start, EventLoopTracer::now(),
+                   timer->sequence(), timer->priority());
+  }
+  else
+  {
+    timer->run();
+  }
+}
+
 std::vector<TimerQueue::Entry> TimerQueue::getExpired(Timestamp now)
 {
   assert(timers_.size() == activeTimers_.size());
@@ -216,8 +243,7 @@ void TimerQueue::reset(const std::vector<Entry>& expired, Timestamp now)
     }
     else
     {
-      // FIXME move to a free list
-      delete it.second; // FIXME: no delete please
+      ObjectPool<Timer>::destroy(it.second);
     }
   }
 
@@ -18,13 +18,13 @@
 #include "muduo/base/Timestamp.h"
 #include "muduo/net/Callbacks.h"
 #include "muduo/net/Channel.h"
+#include "muduo/net/EventLoop.h"
 
 namespace muduo
 {
 namespace net
 {
 
-class EventLoop;
 class Timer;
 class TimerId;
 
@@ -45,7 +45,8 @@ class TimerQueue : noncopyable
   /// Must be thread safe. Usually be called from other threads.
   TimerId addTimer(TimerCallback cb,
                    Timestamp when,
-                   double interval);
+                   double interval,
+                   EventLoop::Priority priority);
 
   void cancel(TimerId timerId);
 
@@ -63,6 +64,7 @@ class TimerQueue : noncopyable
   void cancelInLoop(TimerId timerId);
   // called when timerfd alarms
   void handleRead();
+  void runTimer(Timer* timer);
   // move out all expired timers
   std::vector<Entry> getExpired(Timestamp now);
   void reset(const std::vector<Entry>& expired, Timestamp now);
@@ -11,10 +11,13 @@
 #ifndef MUDUO_NET_HTTP_HTTPCONTEXT_H
 #define MUDUO_NET_HTTP_HTTPCONTEXT_H
 
+#include "muduo/base/Arena.h"
 #include "muduo/base/copyable.h"
 
 #include "muduo/net/http/HttpRequest.h"
 
+#include <memory>
+
 namespace muduo
 {
 namespace net
@@ -34,11 +37,33 @@ class HttpContext : public muduo::copyable
   };
 
   HttpContext()
-    : state_(kExpectRequestLine)
+    : state_(kExpectRequestLine),
+      arena_(new Arena(kArenaBlockSize)),
+      request_(arena_.get())
+  {
+  }
+
+  // the copy has its own arena, used after reset()
+  HttpContext(const HttpContext& rhs)
+    : state_(rhs.state_),
+      arena_(new Arena(kArenaBlockSize)),
+      request_(rhs.request_)
+  {
+  }
+
+  HttpContext& operator=(const HttpContext& rhs)
   {
+    HttpContext copy(rhs);
+    swap(copy);
+    return *this;
   }
 
-  // default copy-ctor, dtor and assignment are fine
+  void swap(HttpContext& that)
+  {
+    std::swap(state_, that.state_);
+    arena_.swap(that.arena_);
+    request_.swap(that.request_);
+  }
 
   // return false if any error
   bool parseRequest(Buffer* buf, Timestamp receiveTime);
@@ -46,11 +71,15 @@ class HttpContext : public muduo::copyable
   bool gotAll() const
   { return state_ == kGotAll; }
 
+  // frees headers of the last request in bulk
   void reset()
   {
     state_ = kExpectRequestLine;
-    HttpRequest dummy;
+    {
+    HttpRequest dummy(arena_.get());
     request_.swap(dummy);
+    }
+    arena_->reset();
   }
 
   const HttpRequest& request() const
@@ -62,7 +91,11 @@ class HttpContext : public muduo::copyable
  private:
   bool processRequestLine(const char* begin, const char* end);
 
+  // headers of a typical request
+  static const size_t kArenaBlockSize = 2048;
+
   HttpRequestParseState state_;
+  std::unique_ptr<Arena> arena_;
   HttpRequest request_;
 };
 
@@ -11,6 +11,7 @@
 #ifndef MUDUO_NET_HTTP_HTTPREQUEST_H
 #define MUDUO_NET_HTTP_HTTPREQUEST_H
 
+#include "muduo/base/Arena.h"
 #include "muduo/base/copyable.h"
 #include "muduo/base/Timestamp.h"
 #include "muduo/base/Types.h"
@@ -36,9 +37,15 @@ class HttpRequest : public muduo::copyable
     kUnknown, kHttp10, kHttp11
   };
 
-  HttpRequest()
+  typedef std::map<ArenaString, ArenaString, std::less<ArenaString>,
+                   ArenaAllocator<std::pair<const ArenaString, ArenaString>>> HeaderMap;
+
+  /// Headers are allocated on arena if not NULL, see HttpContext.
+  /// Copies of a request allocate on the heap.
+  explicit HttpRequest(Arena* arena = NULL)
     : method_(kInvalid),
-      version_(kUnknown)
+      version_(kUnknown),
+      headers_(std::less<ArenaString>(), HeaderMap::allocator_type(arena))
   {
   }
 
@@ -134,32 +141,48 @@ class HttpRequest : public muduo::copyable
 
   void addHeader(const char* start, const char* colon, const char* end)
   {
-    string field(start, colon);
+    ArenaString field(start, colon, headers_.get_allocator());
     ++colon;
     while (colon < end && isspace(*colon))
     {
       ++colon;
     }
-    string value(colon, end);
-    while (!value.empty() && isspace(value[value.size()-1]))
+    while (colon < end && isspace(end[-1]))
     {
-      value.resize(value.size()-1);
+      --end;
     }
-    headers_[field] = value;
+    // moves the arena along, the default constructed value holds no memory
+    headers_[std::move(field)] = ArenaString(colon, end, headers_.get_allocator());
   }
 
   string getHeader(const string& field) const
   {
     string result;
-    std::map<string, string>::const_iterator it = headers_.find(field);
+    HeaderMap::const_iterator it = headers_.find(ArenaString(field.data(), field.size()));
     if (it != headers_.end())
     {
-      result = it->second;
+      result.assign(it->second.data(), it->second.size());
+    }
+    return result;
+  }
+
+  /// Copies headers out of the arena, code written for the
+  /// std::map<string, string> of older versions still compiles, eg.
+  ///   const std::map<string, string>& headers = req.headers();
+  std::map<string, string> headers() const
+  {
+    std::map<string, string> result;
+    for (const auto& header : headers_)
+    {
+      result.emplace_hint(result.end(),
+                          string(header.first.data(), header.first.size()),
+                          string(header.second.data(), header.second.size()));
     }
     return result;
   }
 
-  const std::map<string, string>& headers() const
+  /// Headers in place, without copying.
+  const HeaderMap& arenaHeaders() const
   { return headers_; }
 
   void swap(HttpRequest& that)
@@ -178,7 +201,7 @@ class HttpRequest : public muduo::copyable
   string path_;
   string query_;
   Timestamp receiveTime_;
-  std::map<string, string> headers_;
+  HeaderMap headers_;
 };
 
 }  // namespace net
@@ -15,6 +15,13 @@
 using namespace muduo;
 using namespace muduo::net;
 
+void HttpResponse::setBody(Buffer* body)
+{
+  body_.clear();
+  bodyBuffer_ = std::make_shared<Buffer>(0);
+  bodyBuffer_->swap(*body);
+}
+
 void HttpResponse::appendToBuffer(Buffer* output) const
 {
   char buf[32];
@@ -29,7 +36,8 @@ void HttpResponse::appendToBuffer(Buffer* output) const
   }
   else
   {
-    snprintf(buf, sizeof buf, "Content-Length: %zd\r\n", body_.size());
+    size_t bodySize = bodyBuffer_ ? bodyBuffer_->readableBytes() : body_.size();
+    snprintf(buf, sizeof buf, "Content-Length: %zd\r\n", bodySize);
     output->append(buf);
     output->append("Connection: Keep-Alive\r\n");
   }
@@ -43,5 +51,12 @@ void HttpResponse::appendToBuffer(Buffer* output) const
   }
 
   output->append("\r\n");
-  output->append(body_);
+  if (bodyBuffer_)
+  {
+    output->append(bodyBuffer_->peek(), bodyBuffer_->readableBytes());
+  }
+  else
+  {
+    output->append(body_);
+  }
 }
@@ -15,6 +15,7 @@
 #include "muduo/base/Types.h"
 
 #include <map>
+#include <memory>
 
 namespace muduo
 {
@@ -60,7 +61,10 @@ class HttpResponse : public muduo::copyable
   { headers_[key] = value; }
 
   void setBody(const string& body)
-  { body_ = body; }
+  { body_ = body; bodyBuffer_.reset(); }
+
+  /// Takes readable bytes of body, for large bodies built in a Buffer.
+  void setBody(Buffer* body);
 
   void appendToBuffer(Buffer* output) const;
 
@@ -71,6 +75,7 @@ class HttpResponse : public muduo::copyable
   string statusMessage_;
   bool closeConnection_;
   string body_;
+  std::shared_ptr<Buffer> bodyBuffer_;  // NULL if body_ is used
 };
 
 }  // namespace net
@@ -6,6 +6,29 @@
 #define BOOST_TEST_DYN_LINK
 #include <boost/test/unit_test.hpp>
 
+#include <stdlib.h>
+
+int64_t g_allocations = 0;
+
+void* operator new(size_t size)
+{
+  ++g_allocations;
+  void* p = ::malloc(size);
+  if (p == NULL)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept
+{
+  ::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+  ::free(p);
+}
+
 using muduo::string;
 using muduo::Timestamp;
 using muduo::net::Buffer;
@@ -28,6 +51,11 @@ BOOST_AUTO_TEST_CASE(testParseRequestAllInOne)
   BOOST_CHECK_EQUAL(request.getVersion(), HttpRequest::kHttp11);
   BOOST_CHECK_EQUAL(request.getHeader("Host"), string("www.chenshuo.com"));
   BOOST_CHECK_EQUAL(request.getHeader("User-Agent"), string(""));
+
+  const std::map<string, string>& headers = request.headers();
+  BOOST_CHECK_EQUAL(headers.size(), 1);
+  BOOST_CHECK_EQUAL(headers.begin()->first, string("Host"));
+  BOOST_CHECK_EQUAL(headers.begin()->second, string("www.chenshuo.com"));
 }
 
 BOOST_AUTO_TEST_CASE(testParseRequestInTwoPieces)
@@ -77,3 +105,40 @@ BOOST_AUTO_TEST_CASE(testParseRequestEmptyHeaderValue)
   BOOST_CHECK_EQUAL(request.getHeader("User-Agent"), string(""));
   BOOST_CHECK_EQUAL(request.getHeader("Accept-Encoding"), string(""));
 }
+
+BOOST_AUTO_TEST_CASE(testParseRequestAllocations)
+{
+  const char* request =
+       "GET /static/js/application.min.js HTTP/1.1\r\n"
+       "Host: www.chenshuo.com\r\n"
+       "Connection: keep-alive\r\n"
+       "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko)\r\n"
+       "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+       "Accept-Encoding: gzip, deflate, br\r\n"
+       "Accept-Language: en-US,en;q=0.9\r\n"
+       "Cache-Control: max-age=0\r\n"
+       "Referer: http://www.chenshuo.com/index.html\r\n"
+       "If-Modified-Since: Mon, 19 Oct 2026 04:02:32 GMT\r\n"
+       "Cookie: session=0123456789abcdef0123456789abcdef\r\n"
+       "\r\n";
+  HttpContext context;
+  Buffer input;
+  int64_t allocations[3] = { 0 };
+  for (int i = 0; i < 3; ++i)
+  {
+    input.append(request);
+    int64_t before = g_allocations;
+    BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+    BOOST_CHECK(context.gotAll());
+    BOOST_CHECK_EQUAL(context.request().arenaHeaders().size(), 10);
+    BOOST_CHECK_EQUAL(context.request().getHeader("Accept-Encoding"), string("gzip, deflate, br"));
+    context.reset();
+    allocations[i] = g_allocations - before;
+  }
+  printf("allocations of parsing a request: %lld, %lld, %lld\n",
+         static_cast<long long>(allocations[0]),
+         static_cast<long long>(allocations[1]),
+         static_cast<long long>(allocations[2]));
+  // path, getHeader() result and the expected string, 29 before headers on arena
+  BOOST_CHECK_LE(allocations[2], 3);
+}
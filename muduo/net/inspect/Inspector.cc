@@ -11,9 +11,12 @@
 
 #include "muduo/base/Logging.h"
 #include "muduo/base/Thread.h"
+#include "muduo/net/Buffer.h"
 #include "muduo/net/EventLoop.h"
+#include "muduo/net/MemoryBudget.h"
 #include "muduo/net/http/HttpRequest.h"
 #include "muduo/net/http/HttpResponse.h"
+#include "muduo/net/inspect/MetricsRegistry.h"
 #include "muduo/net/inspect/ProcessInspector.h"
 #include "muduo/net/inspect/PerformanceInspector.h"
 #include "muduo/net/inspect/SystemInspector.h"
@@ -55,6 +58,25 @@ std::vector<string> split(const string& str)
   return result;
 }
 
+// "?seconds=10&hz=99" to "seconds=10", "hz=99"
+void splitQuery(const string& query, std::vector<string>* result)
+{
+  size_t start = query.empty() || query[0] != '?' ? 0 : 1;
+  while (start < query.size())
+  {
+    size_t end = query.find('&', start);
+    if (end == string::npos)
+    {
+      end = query.size();
+    }
+    if (end > start)
+    {
+      result->push_back(query.substr(start, end-start));
+    }
+    start = end+1;
+  }
+}
+
 }  // namespace
 
 extern char favicon[1743];
@@ -64,7 +86,8 @@ Inspector::Inspector(EventLoop* loop,
                      const string& name)
     : server_(loop, httpAddr, "Inspector:"+name),
       processInspector_(new ProcessInspector),
-      systemInspector_(new SystemInspector)
+      systemInspector_(new SystemInspector),
+      metrics_(new MetricsRegistry)
 {
   assert(CurrentThread::isMainThread());
   assert(g_globalInspector == 0);
@@ -72,10 +95,10 @@ Inspector::Inspector(EventLoop* loop,
   server_.setHttpCallback(std::bind(&Inspector::onRequest, this, _1, _2));
   processInspector_->registerCommands(this);
   systemInspector_->registerCommands(this);
-#ifdef HAVE_TCMALLOC
+  metrics_->addProcess();
+  metrics_->addMemoryTags();
   performanceInspector_.reset(new PerformanceInspector);
   performanceInspector_->registerCommands(this);
-#endif
   loop->runAfter(0, std::bind(&Inspector::start, this)); // little race condition
 }
 
@@ -106,6 +129,13 @@ void Inspector::remove(const string& module, const string& command)
   }
 }
 
+void Inspector::addMemoryBudget(const std::shared_ptr<MemoryBudget>& budget)
+{
+  add("budget", budget->name(),
+      [budget](HttpRequest::Method, const ArgList&) { return budget->report(); },
+      "memory budget " + budget->name());
+}
+
 void Inspector::start()
 {
   server_.start();
@@ -115,7 +145,7 @@ void Inspector::onRequest(const HttpRequest& req, HttpResponse* resp)
 {
   if (req.path() == "/")
   {
-    string result;
+    string result = "/metrics                  prometheus metrics\n";
     MutexLockGuard lock(mutex_);
     for (std::map<string, HelpList>::const_iterator helpListI = helps_.begin();
          helpListI != helps_.end();
@@ -162,6 +192,16 @@ void Inspector::onRequest(const HttpRequest& req, HttpResponse* resp)
 
         ok = true;
       }
+      else if (module == "metrics")
+      {
+        Buffer body;
+        metrics_->writeTo(&body);
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setStatusMessage("OK");
+        resp->setContentType("text/plain; version=0.0.4; charset=utf-8");
+        resp->setBody(&body);
+        ok = true;
+      }
       else
       {
         LOG_ERROR << "Unimplemented " << module;
@@ -180,6 +220,7 @@ void Inspector::onRequest(const HttpRequest& req, HttpResponse* resp)
         if (it != commList.end())
         {
           ArgList args(result.begin()+2, result.end());
+          splitQuery(req.query(), &args);
           if (it->second)
           {
             resp->setStatusCode(HttpResponse::k200Ok);
@@ -22,6 +22,8 @@ namespace muduo
 namespace net
 {
 
+class MemoryBudget;
+class MetricsRegistry;
 class ProcessInspector;
 class PerformanceInspector;
 class SystemInspector;
@@ -31,6 +33,7 @@ class SystemInspector;
 class Inspector : noncopyable
 {
  public:
+  /// path segments after /module/command, then key=value of the query
   typedef std::vector<string> ArgList;
   typedef std::function<string (HttpRequest::Method, const ArgList& args)> Callback;
   Inspector(EventLoop* loop,
@@ -45,6 +48,12 @@ class Inspector : noncopyable
            const string& help);
   void remove(const string& module, const string& command);
 
+  /// Adds /budget/<name> reporting usage of the MemoryBudget
+  void addMemoryBudget(const std::shared_ptr<MemoryBudget>& budget);
+
+  /// Served at /metrics in Prometheus text format, with process_* metrics.
+  MetricsRegistry* metrics() { return metrics_.get(); }
+
  private:
   typedef std::map<string, Callback> CommandList;
   typedef std::map<string, string> HelpList;
@@ -56,6 +65,7 @@ class Inspector : noncopyable
   std::unique_ptr<ProcessInspector> processInspector_;
   std::unique_ptr<PerformanceInspector> performanceInspector_;
   std::unique_ptr<SystemInspector> systemInspector_;
+  std::unique_ptr<MetricsRegistry> metrics_;
   MutexLock mutex_;
   std::map<string, CommandList> modules_ GUARDED_BY(mutex_);
   std::map<string, HelpList> helps_ GUARDED_BY(mutex_);
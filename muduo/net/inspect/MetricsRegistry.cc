@@ -0,0 +1,497 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include "muduo/net/inspect/MetricsRegistry.h"
+
+#include "muduo/base/AsyncLogging.h"
+#include "muduo/base/Histogram.h"
+#include "muduo/base/Logging.h"
+#include "muduo/base/MemoryTag.h"
+#include "muduo/base/ProcessInfo.h"
+#include "muduo/base/ShardedCounter.h"
+#include "muduo/base/ThreadPool.h"
+#include "muduo/net/Buffer.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TcpServer.h"
+
+#include <algorithm>
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+const size_t kMaxNumericSize = 32;
+
+void appendInt(Buffer* output, int64_t x)
+{
+  output->ensureWritableBytes(kMaxNumericSize);
+  int len = snprintf(output->beginWrite(), kMaxNumericSize, "%" PRId64, x);
+  output->hasWritten(len);
+}
+
+void appendDouble(Buffer* output, double x)
+{
+  if (isnan(x))
+  {
+    output->append("NaN");
+  }
+  else if (isinf(x))
+  {
+    output->append(x > 0 ? "+Inf" : "-Inf");
+  }
+  else if (x == floor(x) && fabs(x) < 1e15)
+  {
+    appendInt(output, static_cast<int64_t>(x));
+  }
+  else
+  {
+    output->ensureWritableBytes(kMaxNumericSize);
+    int len = snprintf(output->beginWrite(), kMaxNumericSize, "%.15g", x);
+    output->hasWritten(len);
+  }
+}
+
+// [a-zA-Z_:][a-zA-Z0-9_:]*
+string sanitize(const string& name, bool colon)
+{
+  string result(name);
+  for (size_t i = 0; i < result.size(); ++i)
+  {
+    char c = result[i];
+    bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'
+        || (colon && c == ':') || (i > 0 && c >= '0' && c <= '9');
+    if (!ok)
+    {
+      result[i] = '_';
+    }
+  }
+  if (result.empty())
+  {
+    result = "_";
+  }
+  return result;
+}
+
+string formatLabels(const MetricsRegistry::Labels& labels)
+{
+  string result;
+  for (const auto& label : labels)
+  {
+    if (!result.empty())
+    {
+      result += ',';
+    }
+    result += sanitize(label.first, false);
+    result += "=\"";
+    for (char c : label.second)
+    {
+      if (c == '\\' || c == '"')
+      {
+        result += '\\';
+        result += c;
+      }
+      else if (c == '\n')
+      {
+        result += "\\n";
+      }
+      else
+      {
+        result += c;
+      }
+    }
+    result += '"';
+  }
+  return result;
+}
+
+string escapeHelp(const string& help)
+{
+  string result;
+  for (char c : help)
+  {
+    if (c == '\\')
+      result += "\\\\";
+    else if (c == '\n')
+      result += "\\n";
+    else
+      result += c;
+  }
+  return result;
+}
+
+// name_suffix{labels,extra} value
+void appendSampleName(Buffer* output, const string& name, const char* suffix,
+                      const string& labels, const char* extraName = NULL,
+                      double extraValue = 0)
+{
+  output->append(name);
+  output->append(suffix);
+  if (!labels.empty() || extraName)
+  {
+    output->append("{");
+    output->append(labels);
+    if (extraName)
+    {
+      if (!labels.empty())
+      {
+        output->append(",");
+      }
+      output->append(extraName);
+      output->append("=\"");
+      appendDouble(output, extraValue);
+      output->append("\"");
+    }
+    output->append("}");
+  }
+  output->append(" ");
+}
+
+const char* typeName(int type)
+{
+  static const char* names[] = { "counter", "gauge", "histogram" };
+  return names[type];
+}
+
+// field of /proc/self/stat, 1-based as proc(5)
+int64_t statField(const string& stat, int field)
+{
+  // skips pid and (comm), which may contain spaces
+  size_t pos = stat.rfind(')');
+  if (pos == string::npos)
+  {
+    return 0;
+  }
+  const char* p = stat.c_str() + pos + 1;
+  for (int i = 3; i < field && *p; ++i)
+  {
+    p = strchr(p + 1, ' ');
+    if (p == NULL)
+    {
+      return 0;
+    }
+  }
+  return strtoll(p, NULL, 10);
+}
+
+}  // namespace
+
+MetricsRegistry::MetricsRegistry()
+{
+}
+
+MetricsRegistry::~MetricsRegistry()
+{
+}
+
+const std::vector<int64_t>& MetricsRegistry::defaultBounds()
+{
+  static const std::vector<int64_t> bounds = [] {
+    std::vector<int64_t> result;
+    for (int64_t decade = 1; decade <= 10000000; decade *= 10)
+    {
+      result.push_back(decade);
+      if (decade < 10000000)
+      {
+        result.push_back(2 * decade);
+        result.push_back(5 * decade);
+      }
+    }
+    return result;
+  }();
+  return bounds;
+}
+
+void MetricsRegistry::add(const string& name, const string& help, Type type, Series series)
+{
+  string key = sanitize(name, true);
+  std::shared_ptr<const Series> added = std::make_shared<Series>(std::move(series));
+  MutexLockGuard lock(mutex_);
+  FamilyMap::iterator it = families_.find(key);
+  if (it == families_.end())
+  {
+    std::shared_ptr<Family> family = std::make_shared<Family>();
+    family->name = key;
+    family->type = type;
+    family->help = escapeHelp(help);
+    family->series.push_back(added);
+    families_[key] = family;
+    return;
+  }
+  if (it->second->type != type)
+  {
+    LOG_ERROR << "MetricsRegistry " << key << " is a " << typeName(it->second->type)
+              << ", not a " << typeName(type);
+    return;
+  }
+  // copies pointers of series, a scrape may be reading the old family
+  std::shared_ptr<Family> family = std::make_shared<Family>(*it->second);
+  bool replaced = false;
+  for (std::shared_ptr<const Series>& s : family->series)
+  {
+    if (s->labels == added->labels)
+    {
+      s = added;
+      replaced = true;
+      break;
+    }
+  }
+  if (!replaced)
+  {
+    family->series.push_back(added);
+  }
+  it->second = family;
+}
+
+void MetricsRegistry::addCounter(const string& name, const string& help,
+                                 const ShardedCounter* counter, const Labels& labels)
+{
+  Series series = { formatLabels(labels), counter, NULL, ValueCallback(), 1.0, {} };
+  add(name, help, kCounter, std::move(series));
+}
+
+void MetricsRegistry::addCounter(const string& name, const string& help,
+                                 ValueCallback cb, const Labels& labels)
+{
+  Series series = { formatLabels(labels), NULL, NULL, std::move(cb), 1.0, {} };
+  add(name, help, kCounter, std::move(series));
+}
+
+void MetricsRegistry::addGauge(const string& name, const string& help,
+                               ValueCallback cb, const Labels& labels)
+{
+  Series series = { formatLabels(labels), NULL, NULL, std::move(cb), 1.0, {} };
+  add(name, help, kGauge, std::move(series));
+}
+
+void MetricsRegistry::addHistogram(const string& name, const string& help,
+                                   const Histogram* histogram, const Labels& labels,
+                                   double scale, const std::vector<int64_t>& bounds)
+{
+  Series series = { formatLabels(labels), NULL, histogram, ValueCallback(), scale, bounds };
+  std::sort(series.bounds.begin(), series.bounds.end());
+  add(name, help, kHistogram, std::move(series));
+}
+
+void MetricsRegistry::removeSeries(FamilyMap::iterator it, const string& labels)
+{
+  const std::vector<std::shared_ptr<const Series>>& series = it->second->series;
+  std::vector<std::shared_ptr<const Series>> kept;
+  kept.reserve(series.size());
+  for (const std::shared_ptr<const Series>& s : series)
+  {
+    if (s->labels != labels)
+    {
+      kept.push_back(s);
+    }
+  }
+  if (kept.size() != series.size())
+  {
+    std::shared_ptr<Family> family = std::make_shared<Family>();
+    family->name = it->second->name;
+    family->type = it->second->type;
+    family->help = it->second->help;
+    family->series.swap(kept);
+    it->second = family;
+  }
+}
+
+void MetricsRegistry::remove(const string& name, const Labels& labels)
+{
+  string key = sanitize(name, true);
+  string formatted = formatLabels(labels);
+  {
+  MutexLockGuard lock(mutex_);
+  FamilyMap::iterator it = families_.find(key);
+  if (it != families_.end())
+  {
+    removeSeries(it, formatted);
+    if (it->second->series.empty())
+    {
+      families_.erase(it);
+    }
+  }
+  }
+  // callbacks of removed series may be running in writeTo()
+  MutexLockGuard lock(scrapeMutex_);
+}
+
+void MetricsRegistry::removeAll(const Labels& labels)
+{
+  string formatted = formatLabels(labels);
+  {
+  MutexLockGuard lock(mutex_);
+  for (FamilyMap::iterator it = families_.begin(); it != families_.end(); )
+  {
+    removeSeries(it, formatted);
+    if (it->second->series.empty())
+    {
+      it = families_.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+  }
+  MutexLockGuard lock(scrapeMutex_);
+}
+
+void MetricsRegistry::writeTo(Buffer* output) const
+{
+  MutexLockGuard scrape(scrapeMutex_);
+  std::vector<std::shared_ptr<const Family>> families;
+  {
+  MutexLockGuard lock(mutex_);
+  families.reserve(families_.size());
+  for (const auto& it : families_)
+  {
+    families.push_back(it.second);
+  }
+  }
+  for (const std::shared_ptr<const Family>& family : families)
+  {
+    const string& name = family->name;
+    output->append("# HELP ");
+    output->append(name);
+    output->append(" ");
+    output->append(family->help);
+    output->append("\n# TYPE ");
+    output->append(name);
+    output->append(" ");
+    output->append(typeName(family->type));
+    output->append("\n");
+    for (const std::shared_ptr<const Series>& series : family->series)
+    {
+      if (series->histogram)
+      {
+        writeHistogram(output, name, *series);
+      }
+      else
+      {
+        appendSampleName(output, name, "", series->labels);
+        if (series->counter)
+        {
+          appendInt(output, series->counter->get());
+        }
+        else
+        {
+          appendDouble(output, series->value());
+        }
+        output->append("\n");
+      }
+    }
+  }
+}
+
+void MetricsRegistry::writeHistogram(Buffer* output, const string& name, const Series& series)
+{
+  HistogramSnapshot snapshot = series.histogram->snapshot();
+  int64_t cumulative = 0;
+  int index = 0;
+  for (int64_t bound : series.bounds)
+  {
+    while (index < HistogramSnapshot::kNumBuckets
+           && HistogramSnapshot::bucketUpperBound(index) <= bound)
+    {
+      cumulative += snapshot.bucketCount(index);
+      ++index;
+    }
+    appendSampleName(output, name, "_bucket", series.labels,
+                     "le", static_cast<double>(bound) * series.scale);
+    appendInt(output, cumulative);
+    output->append("\n");
+  }
+  // counts of buckets, consistent with the above if being recorded
+  for (; index < HistogramSnapshot::kNumBuckets; ++index)
+  {
+    cumulative += snapshot.bucketCount(index);
+  }
+  appendSampleName(output, name, "_bucket", series.labels, "le", INFINITY);
+  appendInt(output, cumulative);
+  output->append("\n");
+  appendSampleName(output, name, "_sum", series.labels);
+  appendDouble(output, static_cast<double>(snapshot.sum()) * series.scale);
+  output->append("\n");
+  appendSampleName(output, name, "_count", series.labels);
+  appendInt(output, cumulative);
+  output->append("\n");
+}
+
+void MetricsRegistry::addProcess()
+{
+  addCounter("process_cpu_user_seconds_total", "User CPU time spent in seconds.",
+             [] { return ProcessInfo::cpuTime().userSeconds; });
+  addCounter("process_cpu_system_seconds_total", "System CPU time spent in seconds.",
+             [] { return ProcessInfo::cpuTime().systemSeconds; });
+  addGauge("process_open_fds", "Number of open file descriptors.",
+           [] { return ProcessInfo::openedFiles(); });
+  addGauge("process_max_fds", "Maximum number of open file descriptors.",
+           [] { return ProcessInfo::maxOpenFiles(); });
+  addGauge("process_threads", "Number of OS threads in the process.",
+           [] { return ProcessInfo::numThreads(); });
+  addGauge("process_start_time_seconds", "Start time of the process since unix epoch in seconds.",
+           [] { return static_cast<double>(ProcessInfo::startTime().microSecondsSinceEpoch())
+                       / Timestamp::kMicroSecondsPerSecond; });
+  addGauge("process_virtual_memory_bytes", "Virtual memory size in bytes.",
+           [] { return static_cast<double>(statField(ProcessInfo::procStat(), 23)); });
+  addGauge("process_resident_memory_bytes", "Resident memory size in bytes.",
+           [] { return static_cast<double>(statField(ProcessInfo::procStat(), 24))
+                       * ProcessInfo::pageSize(); });
+}
+
+void MetricsRegistry::addEventLoop(EventLoop* loop, const Labels& labels)
+{
+  addCounter("muduo_eventloop_iterations_total", "Iterations of EventLoop::loop().",
+             [loop] { return static_cast<double>(loop->iteration()); }, labels);
+  addGauge("muduo_eventloop_pending_functors", "Functors queued by queueInLoop().",
+           [loop] { return static_cast<double>(loop->queueSize()); }, labels);
+  addGauge("muduo_eventloop_overloaded", "1 if queueing delay stays above CoDel target.",
+           [loop] { return loop->overloaded() ? 1 : 0; }, labels);
+}
+
+void MetricsRegistry::addTcpServer(TcpServer* server)
+{
+  Labels labels = { { "server", server->name() } };
+  addCounter("muduo_tcpserver_connections_accepted_total", "Connections accepted.",
+             [server] { return static_cast<double>(server->acceptedConnections()); }, labels);
+  addGauge("muduo_tcpserver_connections", "Connections alive.",
+           [server] { return static_cast<double>(server->activeConnections()); }, labels);
+}
+
+void MetricsRegistry::addThreadPool(ThreadPool* pool)
+{
+  Labels labels = { { "pool", pool->name() } };
+  addGauge("muduo_threadpool_queue_size", "Tasks waiting in the queue.",
+           [pool] { return static_cast<double>(pool->queueSize()); }, labels);
+  addGauge("muduo_threadpool_overloaded", "1 if queueing delay stays above CoDel target.",
+           [pool] { return pool->overloaded() ? 1 : 0; }, labels);
+}
+
+void MetricsRegistry::addAsyncLogging(AsyncLogging* log, const Labels& labels)
+{
+  addCounter("muduo_asynclogging_dropped_bytes_total", "Bytes of log messages dropped.",
+             [log] { return static_cast<double>(log->droppedBytes()); }, labels);
+}
+
+void MetricsRegistry::addMemoryTags()
+{
+  for (MemoryTag* tag : MemoryTag::tags())
+  {
+    Labels labels = { { "tag", tag->name() } };
+    addGauge("muduo_memory_bytes", "Bytes alive by subsystem.",
+             [tag] { return static_cast<double>(tag->bytes()); }, labels);
+    addGauge("muduo_memory_objects", "Objects alive by subsystem.",
+             [tag] { return static_cast<double>(tag->objects()); }, labels);
+  }
+}
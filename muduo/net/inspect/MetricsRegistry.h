@@ -0,0 +1,142 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_INSPECT_METRICSREGISTRY_H
+#define MUDUO_NET_INSPECT_METRICSREGISTRY_H
+
+#include "muduo/base/Mutex.h"
+#include "muduo/base/Types.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace muduo
+{
+
+class AsyncLogging;
+class Histogram;
+class ShardedCounter;
+class ThreadPool;
+
+namespace net
+{
+
+class Buffer;
+class EventLoop;
+class TcpServer;
+
+///
+/// Counters, gauges and histograms exported in Prometheus text format,
+/// served by Inspector at /metrics.
+///
+///   registry.addCounter("requests_total", "Requests served.", &requests,
+///                       {{"method", "get"}});
+///   registry.addHistogram("request_seconds", "Latency.", &latencyUs,
+///                         {}, 1e-6);
+///
+/// Series of the same name and different labels are one family.
+/// Metrics are read at each scrape, the registry keeps pointers, so
+/// remove them before they are destroyed.  Families are copied on
+/// write, a scrape takes only their pointers under the lock, then
+/// formats right into the Buffer, without building strings.  Callbacks
+/// run without the lock of series, they may add series but not remove,
+/// remove() waits for a scrape calling them.
+///
+/// Thread safe.
+///
+class MetricsRegistry : noncopyable
+{
+ public:
+  typedef std::vector<std::pair<string, string>> Labels;
+  typedef std::function<double ()> ValueCallback;
+
+  MetricsRegistry();
+  ~MetricsRegistry();
+
+  void addCounter(const string& name, const string& help,
+                  const ShardedCounter* counter, const Labels& labels = Labels());
+  void addCounter(const string& name, const string& help,
+                  ValueCallback cb, const Labels& labels = Labels());
+  void addGauge(const string& name, const string& help,
+                ValueCallback cb, const Labels& labels = Labels());
+
+  /// Buckets are cumulative counts at bounds, in units of recorded
+  /// values, exported as le="bound * scale", eg. scale 1e-6 for
+  /// latency recorded in microseconds.  Counts at a bound are exact
+  /// to the width of a bucket of Histogram, 1/16.
+  void addHistogram(const string& name, const string& help,
+                    const Histogram* histogram, const Labels& labels = Labels(),
+                    double scale = 1.0,
+                    const std::vector<int64_t>& bounds = defaultBounds());
+
+  /// Removes one series, and the family if it was the last one.
+  void remove(const string& name, const Labels& labels = Labels());
+  /// Removes all series with exactly these labels, eg. of a TcpServer.
+  void removeAll(const Labels& labels);
+
+  void writeTo(Buffer* output) const;
+
+  /// 1, 2, 5, 10, 20, 50, ... 10^7
+  static const std::vector<int64_t>& defaultBounds();
+
+  // Standard metrics of muduo classes, named muduo_*.
+
+  /// process_* of Prometheus client libraries.
+  void addProcess();
+  void addEventLoop(EventLoop* loop, const Labels& labels);
+  /// labeled server="name", removeAll({{"server", name}}) before destroying it.
+  void addTcpServer(TcpServer* server);
+  /// labeled pool="name".
+  void addThreadPool(ThreadPool* pool);
+  void addAsyncLogging(AsyncLogging* log, const Labels& labels = Labels());
+  /// labeled tag="name", of MemoryTags created so far.
+  void addMemoryTags();
+
+ private:
+  enum Type
+  {
+    kCounter,
+    kGauge,
+    kHistogram,
+  };
+
+  struct Series
+  {
+    string labels;  // formatted
+    const ShardedCounter* counter;
+    const Histogram* histogram;
+    ValueCallback value;
+    double scale;
+    std::vector<int64_t> bounds;
+  };
+
+  // neither is modified once added, writeTo() reads them without lock
+  struct Family
+  {
+    string name;
+    Type type;
+    string help;
+    std::vector<std::shared_ptr<const Series>> series;
+  };
+  typedef std::map<string, std::shared_ptr<const Family>> FamilyMap;
+
+  void add(const string& name, const string& help, Type type, Series series);
+  void removeSeries(FamilyMap::iterator it, const string& labels) REQUIRES(mutex_);
+  static void writeHistogram(Buffer* output, const string& name, const Series& series);
+
+  mutable MutexLock scrapeMutex_;  // held while calling callbacks
+  mutable MutexLock mutex_;
+  FamilyMap families_ GUARDED_BY(mutex_);
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_INSPECT_METRICSREGISTRY_H
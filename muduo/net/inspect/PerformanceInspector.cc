@@ -8,31 +8,211 @@
 //
 
 #include "muduo/net/inspect/PerformanceInspector.h"
+#include "muduo/base/CpuProfiler.h"
+#include "muduo/base/CurrentThread.h"
 #include "muduo/base/FileUtil.h"
 #include "muduo/base/LogStream.h"
+#include "muduo/base/MemoryTag.h"
 #include "muduo/base/ProcessInfo.h"
+#include "muduo/net/EventLoopTracer.h"
 
+#include <algorithm>
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 
 #ifdef HAVE_TCMALLOC
 #include <gperftools/malloc_extension.h>
 #include <gperftools/profiler.h>
+#endif
 
 using namespace muduo;
 using namespace muduo::net;
 
 void PerformanceInspector::registerCommands(Inspector* ins)
 {
+  ins->add("pprof", "profile", PerformanceInspector::profile,
+           "get cpu profile in folded stacks, ?seconds=5&hz=99, at most 10 seconds. CAUTION: blocking thread for seconds!");
+  ins->add("memory", "tags", PerformanceInspector::memoryTags, "get bytes and objects alive by subsystem");
+  ins->add("memory", "stacks", PerformanceInspector::memoryStacks,
+           "get sampled allocation stacks in folded format, by bytes");
+  ins->add("memory", "sampling", PerformanceInspector::memorySampling,
+           "sample allocations every ?interval=bytes, 0 to stop");
+  ins->add("trace", "start", PerformanceInspector::traceStart,
+           "trace event loops, one in ?sample=1 iterations, spans of at least ?min_us=0");
+  ins->add("trace", "stop", PerformanceInspector::traceStop, "stop tracing event loops");
+  ins->add("trace", "dump", PerformanceInspector::traceDump,
+           "get trace-event json of last ?seconds=0 (all), for ui.perfetto.dev");
+  ins->add("trace", "record", PerformanceInspector::traceRecord,
+           "trace for ?seconds=5&sample=1&min_us=0, then get json. CAUTION: blocking thread for seconds!");
+#ifdef HAVE_TCMALLOC
   ins->add("pprof", "heap", PerformanceInspector::heap, "get heap information");
   ins->add("pprof", "growth", PerformanceInspector::growth, "get heap growth information");
-  ins->add("pprof", "profile", PerformanceInspector::profile,
-           "get cpu profiling information. CAUTION: blocking thread for 30 seconds!");
+  ins->add("pprof", "cpuprofile", PerformanceInspector::cpuprofile,
+           "get gperftools cpu profile. CAUTION: blocking thread for 30 seconds!");
   ins->add("pprof", "cmdline", PerformanceInspector::cmdline, "get command line");
   ins->add("pprof", "memstats", PerformanceInspector::memstats, "get memory stats");
   ins->add("pprof", "memhistogram", PerformanceInspector::memhistogram, "get memory histogram");
   ins->add("pprof", "releasefreememory", PerformanceInspector::releaseFreeMemory, "release free memory");
+#endif  // HAVE_TCMALLOC
+}
+
+string PerformanceInspector::profile(HttpRequest::Method, const Inspector::ArgList& args)
+{
+  // blocks the loop of Inspector, other commands eg. /metrics wait,
+  // folded stacks of successive profiles add up to a longer one
+  const double kMaxSeconds = 10;
+  double seconds = 5;
+  int frequency = CpuProfiler::kDefaultFrequency;
+  for (const string& arg : args)
+  {
+    if (arg.compare(0, 8, "seconds=") == 0)
+    {
+      seconds = atof(arg.c_str() + 8);
+    }
+    else if (arg.compare(0, 3, "hz=") == 0)
+    {
+      frequency = atoi(arg.c_str() + 3);
+    }
+  }
+  if (!(seconds > 0))
+  {
+    seconds = 5;
+  }
+  return CpuProfiler::profile(std::min(seconds, kMaxSeconds), frequency);
+}
+
+string PerformanceInspector::memoryTags(HttpRequest::Method, const Inspector::ArgList&)
+{
+  string result;
+  char buf[256];
+  int64_t totalBytes = 0;
+  int64_t totalObjects = 0;
+  for (const MemoryTag* tag : MemoryTag::tags())
+  {
+    snprintf(buf, sizeof buf, "%-24s %16" PRId64 " %12" PRId64 "\n",
+             tag->name(), tag->bytes(), tag->objects());
+    result += buf;
+    totalBytes += tag->bytes();
+    totalObjects += tag->objects();
+  }
+  snprintf(buf, sizeof buf, "%-24s %16" PRId64 " %12" PRId64 "\n",
+           "total", totalBytes, totalObjects);
+  result += buf;
+  return result;
+}
+
+string PerformanceInspector::memoryStacks(HttpRequest::Method, const Inspector::ArgList&)
+{
+  string result;
+  for (const MemoryTag* tag : MemoryTag::tags())
+  {
+    tag->writeSamples(&result);
+  }
+  return result;
+}
+
+string PerformanceInspector::memorySampling(HttpRequest::Method, const Inspector::ArgList& args)
+{
+  for (const string& arg : args)
+  {
+    if (arg.compare(0, 9, "interval=") == 0)
+    {
+      int64_t interval = atoll(arg.c_str() + 9);
+      if (interval > 0 && MemoryTag::sampleInterval() == 0)
+      {
+        // a new round of sampling
+        for (MemoryTag* tag : MemoryTag::tags())
+        {
+          tag->clearSamples();
+        }
+      }
+      MemoryTag::setSampleInterval(interval);
+    }
+  }
+  char buf[64];
+  snprintf(buf, sizeof buf, "interval %" PRId64 "\n", MemoryTag::sampleInterval());
+  return buf;
+}
+
+namespace
+{
+
+struct TraceOptions
+{
+  double seconds;
+  int sample;
+  int64_t minDurationUs;
+};
+
+TraceOptions parseTraceOptions(const Inspector::ArgList& args, double defaultSeconds)
+{
+  TraceOptions options = { defaultSeconds, 1, 0 };
+  for (const string& arg : args)
+  {
+    if (arg.compare(0, 8, "seconds=") == 0)
+    {
+      options.seconds = atof(arg.c_str() + 8);
+    }
+    else if (arg.compare(0, 7, "sample=") == 0)
+    {
+      options.sample = atoi(arg.c_str() + 7);
+    }
+    else if (arg.compare(0, 7, "min_us=") == 0)
+    {
+      options.minDurationUs = atoll(arg.c_str() + 7);
+    }
+  }
+  return options;
+}
+
+}  // namespace
+
+string PerformanceInspector::traceStart(HttpRequest::Method, const Inspector::ArgList& args)
+{
+  TraceOptions options = parseTraceOptions(args, 0);
+  EventLoopTracer::start(options.sample, options.minDurationUs);
+  return "tracing\n";
+}
+
+string PerformanceInspector::traceStop(HttpRequest::Method, const Inspector::ArgList&)
+{
+  EventLoopTracer::stop();
+  return "stopped\n";
 }
 
+string PerformanceInspector::traceDump(HttpRequest::Method, const Inspector::ArgList& args)
+{
+  return EventLoopTracer::dump(parseTraceOptions(args, 0).seconds);
+}
+
+string PerformanceInspector::traceRecord(HttpRequest::Method, const Inspector::ArgList& args)
+{
+  const double kMaxSeconds = 60;
+  TraceOptions options = parseTraceOptions(args, 5);
+  if (!(options.seconds > 0))
+  {
+    options.seconds = 5;
+  }
+  options.seconds = std::min(options.seconds, kMaxSeconds);
+  bool started = EventLoopTracer::started();
+  if (!started)
+  {
+    EventLoopTracer::start(options.sample, options.minDurationUs);
+  }
+  // FIXME: async
+  CurrentThread::sleepUsec(static_cast<int64_t>(options.seconds * 1000 * 1000));
+  if (!started)
+  {
+    EventLoopTracer::stop();
+  }
+  return EventLoopTracer::dump(options.seconds);
+}
+
+#ifdef HAVE_TCMALLOC
+
 string PerformanceInspector::heap(HttpRequest::Method, const Inspector::ArgList&)
 {
   std::string result;
@@ -47,7 +227,7 @@ string PerformanceInspector::growth(HttpRequest::Method, const Inspector::ArgLis
   return string(result.data(), result.size());
 }
 
-string PerformanceInspector::profile(HttpRequest::Method, const Inspector::ArgList&)
+string PerformanceInspector::cpuprofile(HttpRequest::Method, const Inspector::ArgList&)
 {
   string filename = "/tmp/" + ProcessInfo::procname();
   filename += ".";
@@ -103,4 +283,4 @@ string PerformanceInspector::releaseFreeMemory(HttpRequest::Method, const Inspec
   return buf;
 }
 
-#endif
+#endif  // HAVE_TCMALLOC
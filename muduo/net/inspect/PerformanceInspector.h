@@ -25,8 +25,22 @@ class PerformanceInspector : noncopyable
 
   static string heap(HttpRequest::Method, const Inspector::ArgList&);
   static string growth(HttpRequest::Method, const Inspector::ArgList&);
+  /// Folded stacks of all threads, from CpuProfiler, works without tcmalloc.
+  /// Blocks the loop of Inspector for at most 10 seconds, concatenate
+  /// results of successive requests for a longer profile.
   static string profile(HttpRequest::Method, const Inspector::ArgList&);
+  /// gperftools' binary format, for pprof.
+  static string cpuprofile(HttpRequest::Method, const Inspector::ArgList&);
   static string cmdline(HttpRequest::Method, const Inspector::ArgList&);
+  /// MemoryTags of subsystems, works without tcmalloc.
+  static string memoryTags(HttpRequest::Method, const Inspector::ArgList&);
+  static string memoryStacks(HttpRequest::Method, const Inspector::ArgList&);
+  static string memorySampling(HttpRequest::Method, const Inspector::ArgList&);
+  /// Timeline of EventLoops, from EventLoopTracer, in Chrome trace-event JSON.
+  static string traceStart(HttpRequest::Method, const Inspector::ArgList&);
+  static string traceStop(HttpRequest::Method, const Inspector::ArgList&);
+  static string traceDump(HttpRequest::Method, const Inspector::ArgList&);
+  static string traceRecord(HttpRequest::Method, const Inspector::ArgList&);
   static string memstats(HttpRequest::Method, const Inspector::ArgList&);
   static string memhistogram(HttpRequest::Method, const Inspector::ArgList&);
   static string releaseFreeMemory(HttpRequest::Method, const Inspector::ArgList&);
@@ -1,4 +1,5 @@
 #include "muduo/net/inspect/Inspector.h"
+#include "muduo/net/inspect/MetricsRegistry.h"
 #include "muduo/net/EventLoop.h"
 #include "muduo/net/EventLoopThread.h"
 
@@ -10,6 +11,7 @@ int main()
   EventLoop loop;
   EventLoopThread t;
   Inspector ins(t.startLoop(), InetAddress(12345), "test");
+  ins.metrics()->addEventLoop(&loop, {{"loop", "main"}});
   loop.loop();
 }
 
@@ -0,0 +1,127 @@
+#include "muduo/net/inspect/MetricsRegistry.h"
+#include "muduo/base/Histogram.h"
+#include "muduo/base/ShardedCounter.h"
+#include "muduo/net/Buffer.h"
+#include "muduo/net/EventLoop.h"
+
+//#define BOOST_TEST_MODULE MetricsRegistryTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+string scrape(const MetricsRegistry& registry)
+{
+  Buffer buf;
+  registry.writeTo(&buf);
+  return buf.retrieveAllAsString();
+}
+
+bool contains(const string& text, const string& line)
+{
+  return text.find(line) != string::npos;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(testCounterGauge)
+{
+  MetricsRegistry registry;
+  ShardedCounter requests;
+  requests.add(42);
+  registry.addCounter("requests_total", "Requests served.", &requests, {{"method", "get"}});
+  registry.addCounter("requests_total", "Requests served.", [] { return 7; }, {{"method", "post"}});
+  registry.addGauge("temperature", "Line one\nline two.", [] { return 36.6; });
+  registry.addGauge("bad-name.x", "Sanitized.", [] { return -1; },
+                    {{"path", "a\"b\\c\nd"}});
+
+  string text = scrape(registry);
+  BOOST_CHECK(contains(text, "# HELP requests_total Requests served.\n"
+                             "# TYPE requests_total counter\n"
+                             "requests_total{method=\"get\"} 42\n"
+                             "requests_total{method=\"post\"} 7\n"));
+  BOOST_CHECK(contains(text, "# HELP temperature Line one\\nline two.\n"
+                             "# TYPE temperature gauge\n"
+                             "temperature 36.6\n"));
+  BOOST_CHECK(contains(text, "bad_name_x{path=\"a\\\"b\\\\c\\nd\"} -1\n"));
+
+  // replaced, not duplicated
+  requests.increment();
+  registry.addCounter("requests_total", "Requests served.", &requests, {{"method", "get"}});
+  text = scrape(registry);
+  BOOST_CHECK(contains(text, "requests_total{method=\"get\"} 43\n"));
+  BOOST_CHECK_EQUAL(text.find("requests_total{method=\"get\"} 42"), string::npos);
+
+  // type mismatch is ignored
+  registry.addGauge("requests_total", "Not a gauge.", [] { return 0; });
+  BOOST_CHECK(!contains(scrape(registry), "gauge\nrequests_total"));
+
+  registry.remove("requests_total", {{"method", "get"}});
+  text = scrape(registry);
+  BOOST_CHECK(!contains(text, "method=\"get\""));
+  BOOST_CHECK(contains(text, "method=\"post\""));
+  registry.removeAll({{"method", "post"}});
+  BOOST_CHECK(!contains(scrape(registry), "requests_total"));
+}
+
+BOOST_AUTO_TEST_CASE(testHistogram)
+{
+  MetricsRegistry registry;
+  Histogram latency;
+  for (int i = 0; i < 10; ++i)
+  {
+    latency.record(3);
+  }
+  latency.record(1500);
+  latency.record(2000000);
+  registry.addHistogram("request_seconds", "Latency.", &latency, {{"loop", "0"}}, 1e-6,
+                        {1, 10, 2000, 1000000});
+
+  string text = scrape(registry);
+  BOOST_CHECK(contains(text, "# TYPE request_seconds histogram\n"
+                             "request_seconds_bucket{loop=\"0\",le=\"1e-06\"} 0\n"
+                             "request_seconds_bucket{loop=\"0\",le=\"1e-05\"} 10\n"
+                             "request_seconds_bucket{loop=\"0\",le=\"0.002\"} 11\n"
+                             "request_seconds_bucket{loop=\"0\",le=\"1\"} 11\n"
+                             "request_seconds_bucket{loop=\"0\",le=\"+Inf\"} 12\n"
+                             "request_seconds_sum{loop=\"0\"} 2.00153\n"
+                             "request_seconds_count{loop=\"0\"} 12\n"));
+}
+
+BOOST_AUTO_TEST_CASE(testBuiltins)
+{
+  EventLoop loop;
+  MetricsRegistry registry;
+  registry.addProcess();
+  registry.addEventLoop(&loop, {{"loop", "main"}});
+  string text = scrape(registry);
+  BOOST_CHECK(contains(text, "\nprocess_open_fds "));
+  BOOST_CHECK(contains(text, "\nprocess_resident_memory_bytes "));
+  BOOST_CHECK(!contains(text, "\nprocess_resident_memory_bytes 0\n"));
+  BOOST_CHECK(contains(text, "muduo_eventloop_pending_functors{loop=\"main\"} 0\n"));
+}
+
+BOOST_AUTO_TEST_CASE(testCallbackAddsSeries)
+{
+  MetricsRegistry registry;
+  int calls = 0;
+  // would deadlock if callbacks ran with the lock of series
+  registry.addGauge("lazy", "Adds another series.", [&registry, &calls] {
+    if (++calls == 1)
+    {
+      registry.addGauge("added", "Added by a callback.", [] { return 2; });
+    }
+    return 1;
+  });
+  BOOST_CHECK(contains(scrape(registry), "\nlazy 1\n"));
+  string text = scrape(registry);
+  BOOST_CHECK(contains(text, "\nadded 2\n"));
+  BOOST_CHECK(contains(text, "\nlazy 1\n"));
+  registry.remove("added");
+  BOOST_CHECK(!contains(scrape(registry), "added"));
+}
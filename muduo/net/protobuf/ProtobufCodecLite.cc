@@ -10,10 +10,12 @@
 // #include <muduo/net/protobuf/BufferStream.h>
 
 #include "muduo/base/Logging.h"
+#include "muduo/base/MemoryTag.h"
 #include "muduo/net/Endian.h"
 #include "muduo/net/TcpConnection.h"
 #include "muduo/net/protorpc/google-inl.h"
 
+#include <google/protobuf/arena.h>
 #include <google/protobuf/message.h>
 #include <zlib.h>
 
@@ -28,8 +30,106 @@ namespace
     return 0;
   }
   int __attribute__ ((unused)) dummy = ProtobufVersionCheck();
+
+  // messages parsed by codecs, with their arenas
+  MemoryTag& protobufMemoryTag()
+  {
+    static MemoryTag* tag = new MemoryTag("protobuf");
+    return *tag;
+  }
+
+  // listed from the start, before the first message
+  MemoryTag& __attribute__ ((unused)) g_protobufMemoryTag = protobufMemoryTag();
+
+  // owns a message on the heap, counted by its estimated size
+  struct CountedDeleter
+  {
+    size_t bytes;
+
+    void operator()(google::protobuf::Message* message) const
+    {
+      protobufMemoryTag().deallocate(bytes);
+      delete message;
+    }
+  };
+
+  MessagePtr countedMessage(google::protobuf::Message* message, size_t bytes)
+  {
+#ifdef MUDUO_NO_MEMORY_TAGS
+    (void)bytes;
+    return MessagePtr(message);
+#else
+    CountedDeleter deleter = { bytes };
+    protobufMemoryTag().allocate(bytes);
+    return MessagePtr(message, deleter);
+#endif
+  }
+
+  size_t spaceUsed(const google::protobuf::Message& message)
+  {
+#if GOOGLE_PROTOBUF_VERSION >= 3004000
+    return message.SpaceUsedLong();
+#else
+    return static_cast<size_t>(message.SpaceUsed());
+#endif
+  }
+
+#if GOOGLE_PROTOBUF_VERSION >= 3000000
+  // arena blocks beyond the first one
+  void* allocateBlock(size_t size)
+  {
+    protobufMemoryTag().allocate(size);
+    return ::operator new(size);
+  }
+
+  void deallocateBlock(void* block, size_t size)
+  {
+    protobufMemoryTag().deallocate(size);
+    ::operator delete(block);
+  }
+
+  google::protobuf::ArenaOptions arenaOptions(char* initialBlock, size_t size)
+  {
+    google::protobuf::ArenaOptions options;
+    options.initial_block = initialBlock;
+    options.initial_block_size = size;
+    options.block_alloc = allocateBlock;
+    options.block_dealloc = deallocateBlock;
+    return options;
+  }
+
+  // arena and its first block in one allocation, counted with the wire
+  // size, as long strings are on the heap, not in arenas of protobuf 3
+  struct MessageArena
+  {
+    explicit MessageArena(size_t wireBytes)
+      : arena(arenaOptions(initialBlock, sizeof initialBlock)),
+        bytes(sizeof(MessageArena) + wireBytes)
+    {
+      protobufMemoryTag().allocate(bytes);
+    }
+
+    ~MessageArena()
+    {
+      protobufMemoryTag().deallocate(bytes);
+    }
+
+    google::protobuf::Arena arena;
+    const size_t bytes;
+    alignas(8) char initialBlock[ProtobufCodecLite::kArenaBlockSize];
+  };
+
+  MessagePtr newMessageOnArena(const google::protobuf::Message* prototype, size_t wireBytes)
+  {
+    std::shared_ptr<MessageArena> holder = std::make_shared<MessageArena>(wireBytes);
+    // shares ownership of the arena
+    return MessagePtr(holder, prototype->New(&holder->arena));
+  }
+#endif
 }
 
+const int ProtobufCodecLite::kArenaBlockSize;
+
 void ProtobufCodecLite::send(const TcpConnectionPtr& conn,
                              const ::google::protobuf::Message& message)
 {
@@ -74,9 +174,33 @@ void ProtobufCodecLite::onMessage(const TcpConnectionPtr& conn,
         buf->retrieve(kHeaderLen+len);
         continue;
       }
-      MessagePtr message(prototype_->New());
+      MessagePtr message;
+      ErrorCode errorCode = kNoError;
       // FIXME: can we move deserialization & callback to other thread?
-      ErrorCode errorCode = parse(buf->peek()+kHeaderLen, len, message.get());
+#if GOOGLE_PROTOBUF_VERSION >= 3000000
+      if (useArena_)
+      {
+        message = newMessageOnArena(prototype_, static_cast<size_t>(len));
+        errorCode = parse(buf->peek()+kHeaderLen, len, message.get());
+      }
+      else
+#endif
+      {
+        std::unique_ptr<google::protobuf::Message> parsed(prototype_->New());
+        errorCode = parse(buf->peek()+kHeaderLen, len, parsed.get());
+        if (errorCode == kNoError)
+        {
+          // SpaceUsedLong() of each message walks it by reflection, slower
+          // than parsing, an empty one plus the wire size is close enough
+          size_t bytes = __atomic_load_n(&prototypeBytes_, __ATOMIC_RELAXED);
+          if (bytes == 0)
+          {
+            bytes = spaceUsed(*prototype_);
+            __atomic_store_n(&prototypeBytes_, bytes, __ATOMIC_RELAXED);
+          }
+          message = countedMessage(parsed.release(), bytes + static_cast<size_t>(len));
+        }
+      }
       if (errorCode == kNoError)
       {
         // FIXME: try { } catch (...) { }
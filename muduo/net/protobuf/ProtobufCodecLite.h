@@ -88,7 +88,9 @@ class ProtobufCodecLite : noncopyable
       messageCallback_(messageCb),
       rawCb_(rawCb),
       errorCallback_(errorCb),
-      kMinMessageLen(tagArg.size() + kChecksumLen)
+      kMinMessageLen(tagArg.size() + kChecksumLen),
+      useArena_(false),
+      prototypeBytes_(0)
   {
   }
 
@@ -96,6 +98,14 @@ class ProtobufCodecLite : noncopyable
 
   const string& tag() const { return tag_; }
 
+  /// Parses each message on its own google::protobuf::Arena, whose first
+  /// block of kArenaBlockSize bytes comes in the same allocation, so
+  /// a message takes one malloc instead of one per string and
+  /// repeated field.  The MessagePtr owns the arena, keep it short lived.
+  /// Call before messages arrive.
+  void setUseArena(bool on) { useArena_ = on; }
+  static const int kArenaBlockSize = 4096;
+
   void send(const TcpConnectionPtr& conn,
             const ::google::protobuf::Message& message);
 
@@ -127,6 +137,8 @@ class ProtobufCodecLite : noncopyable
   RawMessageCallback rawCb_;
   ErrorCallback errorCallback_;
   const int kMinMessageLen;
+  bool useArena_;
+  size_t prototypeBytes_;  // __atomic, of an empty message, for MemoryTag "protobuf"
 };
 
 template<typename MSG, const char* TAG, typename CODEC=ProtobufCodecLite>  // TAG must be a variable with external linkage, not a string literal
@@ -155,6 +167,8 @@ class ProtobufCodecLiteT
 
   const string& tag() const { return codec_.tag(); }
 
+  void setUseArena(bool on) { codec_.setUseArena(on); }
+
   void send(const TcpConnectionPtr& conn,
             const MSG& message)
   {
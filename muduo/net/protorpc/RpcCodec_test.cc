@@ -1,10 +1,13 @@
 #undef NDEBUG
+#include "muduo/base/MemoryTag.h"
 #include "muduo/net/protorpc/RpcCodec.h"
 #include "muduo/net/protorpc/rpc.pb.h"
 #include "muduo/net/protobuf/ProtobufCodecLite.h"
 #include "muduo/net/Buffer.h"
 
+#include <inttypes.h>
 #include <stdio.h>
+#include <string.h>
 
 using namespace muduo;
 using namespace muduo::net;
@@ -36,6 +39,16 @@ void print(const Buffer& buf)
 
 char rpctag[] = "RPC0";
 
+MemoryTag* findMemoryTag(const char* name)
+{
+  for (MemoryTag* tag : MemoryTag::tags())
+  {
+    if (strcmp(tag->name(), name) == 0)
+      return tag;
+  }
+  return NULL;
+}
+
 int main()
 {
   RpcMessage message;
@@ -75,7 +88,47 @@ int main()
   codec.onMessage(TcpConnectionPtr(), &buf, Timestamp::now());
   assert(g_msgptr);
   assert(g_msgptr->DebugString() == message.DebugString());
+  g_msgptr.reset();
+  }
+
+  {
+  Buffer buf;
+  message.set_service("muduo.net.EchoService");
+  message.set_request(string(1000, 'x'));
+  ProtobufCodecLite codec(&RpcMessage::default_instance(), "RPC0", messageCallback);
+  codec.setUseArena(true);
+  codec.fillEmptyBuffer(&buf, message);
+  codec.onMessage(TcpConnectionPtr(), &buf, Timestamp::now());
+  assert(g_msgptr);
+  assert(g_msgptr->GetArena() != NULL);
+  assert(g_msgptr->DebugString() == message.DebugString());
+  // arena lives with the message
+  MessagePtr msg;
+  msg.swap(g_msgptr);
+  assert(msg->DebugString() == message.DebugString());
+  }
+
+#ifndef MUDUO_NO_MEMORY_TAGS
+  // messages are counted until the last MessagePtr is gone
+  MemoryTag* tag = findMemoryTag("protobuf");
+  assert(tag != NULL);
+  assert(tag->bytes() == 0 && tag->objects() == 0);
+  for (int useArena = 0; useArena < 2; ++useArena)
+  {
+  Buffer buf;
+  message.set_request(string(10000, 'x'));
+  ProtobufCodecLite codec(&RpcMessage::default_instance(), "RPC0", messageCallback);
+  codec.setUseArena(useArena);
+  codec.fillEmptyBuffer(&buf, message);
+  codec.onMessage(TcpConnectionPtr(), &buf, Timestamp::now());
+  assert(g_msgptr);
+  printf("%s message of %zd bytes, counted %" PRId64 " bytes %" PRId64 " objects\n",
+         useArena ? "arena" : "heap", message.ByteSizeLong(), tag->bytes(), tag->objects());
+  assert(tag->bytes() > 10000 && tag->objects() > 0);
+  g_msgptr.reset();
+  assert(tag->bytes() == 0 && tag->objects() == 0);
   }
+#endif
 
   google::protobuf::ShutdownProtobufLibrary();
 }
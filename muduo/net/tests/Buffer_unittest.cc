@@ -168,3 +168,31 @@ BOOST_AUTO_TEST_CASE(testMove)
   // printf("Buffer at %p, inner %p\n", &buf, inner);
   output(std::move(buf), inner);
 }
+
+#ifndef MUDUO_NO_MEMORY_TAGS
+BOOST_AUTO_TEST_CASE(testMemoryTag)
+{
+  muduo::MemoryTag& tag = muduo::net::detail::bufferMemoryTag();
+  const int64_t bytes = tag.bytes();
+  const int64_t objects = tag.objects();
+  {
+    Buffer buf;
+    BOOST_CHECK_EQUAL(tag.bytes(), bytes + static_cast<int64_t>(buf.internalCapacity()));
+    BOOST_CHECK_EQUAL(tag.objects(), objects + 1);
+
+    buf.append(string(4000, 'x'));
+    Buffer copy(buf);
+    BOOST_CHECK_EQUAL(tag.bytes(), bytes + static_cast<int64_t>(buf.internalCapacity()
+                                                                + copy.internalCapacity()));
+    BOOST_CHECK_EQUAL(tag.objects(), objects + 2);
+
+    buf.retrieveAll();
+    buf.shrink(0);
+    BOOST_CHECK_EQUAL(tag.bytes(), bytes + static_cast<int64_t>(buf.internalCapacity()
+                                                                + copy.internalCapacity()));
+    BOOST_CHECK_EQUAL(tag.objects(), objects + 2);
+  }
+  BOOST_CHECK_EQUAL(tag.bytes(), bytes);
+  BOOST_CHECK_EQUAL(tag.objects(), objects);
+}
+#endif
@@ -0,0 +1,116 @@
+#include "muduo/net/ConnectionTable.h"
+
+#include <map>
+#include <random>
+
+//#define BOOST_TEST_MODULE ConnectionTableTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using muduo::net::ConnectionTable;
+using muduo::net::TcpConnection;
+using muduo::net::TcpConnectionPtr;
+
+// distinct non-owning pointers, never dereferenced
+TcpConnectionPtr fakeConn(int64_t id)
+{
+  return TcpConnectionPtr(std::shared_ptr<void>(),
+                          reinterpret_cast<TcpConnection*>(id * 64));
+}
+
+void checkSame(ConnectionTable& table, const std::map<int64_t, TcpConnectionPtr>& expected)
+{
+  BOOST_REQUIRE_EQUAL(table.size(), expected.size());
+  for (const auto& item : expected)
+  {
+    TcpConnectionPtr* conn = table.find(item.first);
+    BOOST_REQUIRE(conn != NULL);
+    BOOST_CHECK(*conn == item.second);
+  }
+  size_t count = 0;
+  table.forEach([&count, &expected](TcpConnectionPtr& conn) {
+    ++count;
+    BOOST_CHECK(conn != NULL);
+  });
+  BOOST_CHECK_EQUAL(count, expected.size());
+}
+
+BOOST_AUTO_TEST_CASE(testConnectionTableBasic)
+{
+  ConnectionTable table;
+  BOOST_CHECK(table.empty());
+  BOOST_CHECK(table.find(1) == NULL);
+  BOOST_CHECK(!table.erase(1));
+
+  table.insert(1, fakeConn(1));
+  table.insert(2, fakeConn(2));
+  BOOST_CHECK_EQUAL(table.size(), 2);
+  BOOST_CHECK(*table.find(2) == fakeConn(2));
+  BOOST_CHECK(table.erase(1));
+  BOOST_CHECK(!table.erase(1));
+  BOOST_CHECK(table.find(1) == NULL);
+  BOOST_CHECK(table.find(2) != NULL);
+
+  table.clear();
+  BOOST_CHECK(table.empty());
+  BOOST_CHECK(table.find(2) == NULL);
+}
+
+BOOST_AUTO_TEST_CASE(testConnectionTableHalfFull)
+{
+  // fullest before growing, with clusters, erasing from their middle
+  ConnectionTable table;
+  const size_t cap = table.capacity();
+  std::map<int64_t, TcpConnectionPtr> expected;
+  for (int64_t id = 1; id <= static_cast<int64_t>(cap / 2); ++id)
+  {
+    table.insert(id, fakeConn(id));
+    expected[id] = fakeConn(id);
+  }
+  BOOST_CHECK_EQUAL(table.capacity(), cap);
+  checkSame(table, expected);
+
+  for (int64_t id = 2; id <= static_cast<int64_t>(cap / 2); id += 3)
+  {
+    BOOST_CHECK(table.erase(id));
+    expected.erase(id);
+    checkSame(table, expected);
+  }
+
+  table.insert(1000, fakeConn(1000));
+  expected[1000] = fakeConn(1000);
+  checkSame(table, expected);
+}
+
+BOOST_AUTO_TEST_CASE(testConnectionTableRandom)
+{
+  ConnectionTable table;
+  std::map<int64_t, TcpConnectionPtr> expected;
+  std::mt19937 gen(42);
+  int64_t nextId = 1;
+  for (int i = 0; i < 100000; ++i)
+  {
+    // grows to a few thousand, then shrinks
+    bool add = expected.empty() || gen() % 100 < (i < 50000 ? 55u : 45u);
+    if (add)
+    {
+      int64_t id = nextId++;
+      table.insert(id, fakeConn(id));
+      expected[id] = fakeConn(id);
+    }
+    else
+    {
+      auto it = expected.lower_bound(static_cast<int64_t>(gen() % static_cast<uint32_t>(nextId)));
+      if (it == expected.end())
+        it = expected.begin();
+      BOOST_REQUIRE(table.erase(it->first));
+      expected.erase(it);
+    }
+    if (i % 10000 == 0)
+    {
+      checkSame(table, expected);
+    }
+  }
+  checkSame(table, expected);
+}
@@ -0,0 +1,110 @@
+#include "muduo/net/EventLoop.h"
+
+#include <string>
+#include <vector>
+
+//#define BOOST_TEST_MODULE EventLoopPriorityTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using muduo::Timestamp;
+using muduo::net::EventLoop;
+
+namespace
+{
+
+struct Recorder
+{
+  explicit Recorder(EventLoop* loop) : loop_(loop) { }
+
+  EventLoop::Functor record(const std::string& name, bool quit = false)
+  {
+    return [this, name, quit] {
+      order.push_back(name);
+      iterations.push_back(loop_->iteration());
+      if (quit)
+        loop_->quit();
+    };
+  }
+
+  EventLoop* loop_;
+  std::vector<std::string> order;
+  std::vector<int64_t> iterations;
+};
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(testFunctorPriority)
+{
+  EventLoop loop;
+  Recorder r(&loop);
+  loop.setLowPriorityBudget(2);
+  BOOST_CHECK_EQUAL(loop.lowPriorityBudget(), 2);
+
+  loop.queueInLoop(r.record("low1"), EventLoop::kLowPriority);
+  loop.queueInLoop(r.record("low2"), EventLoop::kLowPriority);
+  loop.queueInLoop(r.record("low3"), EventLoop::kLowPriority);
+  loop.queueInLoop(r.record("normal1"));
+  loop.queueInLoop(r.record("high1"), EventLoop::kHighPriority);
+  loop.queueInLoop(r.record("low4"), EventLoop::kLowPriority);
+  loop.queueInLoop(r.record("normal2"), EventLoop::kNormalPriority);
+  loop.queueInLoop(r.record("high2"), EventLoop::kHighPriority);
+  loop.queueInLoop(r.record("low5", true), EventLoop::kLowPriority);
+  BOOST_CHECK_EQUAL(loop.queueSize(), 9);
+  loop.wakeup();
+  loop.loop();
+
+  const char* expected[] = { "high1", "high2", "normal1", "normal2",
+                             "low1", "low2", "low3", "low4", "low5" };
+  BOOST_REQUIRE_EQUAL(r.order.size(), 9);
+  for (size_t i = 0; i < r.order.size(); ++i)
+  {
+    BOOST_CHECK_EQUAL(r.order[i], expected[i]);
+  }
+  // two low priority callbacks per iteration
+  BOOST_CHECK_EQUAL(r.iterations[0], r.iterations[5]);
+  BOOST_CHECK_LT(r.iterations[5], r.iterations[6]);
+  BOOST_CHECK_EQUAL(r.iterations[6], r.iterations[7]);
+  BOOST_CHECK_LT(r.iterations[7], r.iterations[8]);
+  BOOST_CHECK_EQUAL(loop.queueSize(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testRunInLoopPriority)
+{
+  EventLoop loop;
+  Recorder r(&loop);
+
+  loop.runInLoop(r.record("high"), EventLoop::kHighPriority);
+  loop.runInLoop(r.record("normal"), EventLoop::kNormalPriority);
+  // waits for its turn even in the loop thread
+  loop.runInLoop(r.record("low", true), EventLoop::kLowPriority);
+  BOOST_REQUIRE_EQUAL(r.order.size(), 2);
+  BOOST_CHECK_EQUAL(loop.queueSize(), 1);
+  loop.wakeup();
+  loop.loop();
+  BOOST_REQUIRE_EQUAL(r.order.size(), 3);
+  BOOST_CHECK_EQUAL(r.order[2], "low");
+}
+
+BOOST_AUTO_TEST_CASE(testTimerPriority)
+{
+  EventLoop loop;
+  Recorder r(&loop);
+
+  Timestamp when = addTime(Timestamp::now(), 0.01);
+  loop.runAt(when, r.record("low", true), EventLoop::kLowPriority);
+  loop.runAt(when, [&] {
+    r.record("normal")();
+    loop.queueInLoop(r.record("queued"));
+  });
+  loop.runAt(when, r.record("high"), EventLoop::kHighPriority);
+  loop.loop();
+
+  const char* expected[] = { "high", "normal", "queued", "low" };
+  BOOST_REQUIRE_EQUAL(r.order.size(), 4);
+  for (size_t i = 0; i < r.order.size(); ++i)
+  {
+    BOOST_CHECK_EQUAL(r.order[i], expected[i]);
+  }
+}
@@ -0,0 +1,136 @@
+#include "muduo/net/EventLoopTracer.h"
+#include "muduo/net/EventLoop.h"
+
+//#define BOOST_TEST_MODULE EventLoopTracerTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using muduo::string;
+using muduo::net::EventLoop;
+using muduo::net::EventLoopTracer;
+
+namespace
+{
+
+int count(const string& str, const string& pattern)
+{
+  int n = 0;
+  for (size_t pos = str.find(pattern); pos != string::npos; pos = str.find(pattern, pos + 1))
+  {
+    ++n;
+  }
+  return n;
+}
+
+// two iterations, woken up by eventfd then timerfd
+void runLoop(EventLoop* loop, bool* traced)
+{
+  loop->wakeup();
+  loop->queueInLoop([loop, traced] { *traced = loop->tracer() != NULL; },
+                    EventLoop::kHighPriority);
+  loop->runAfter(0.01, [loop] { loop->queueInLoop([loop] { loop->quit(); }); });
+  loop->loop();
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(testNotTracedByDefault)
+{
+  BOOST_CHECK(!EventLoopTracer::started());
+  EventLoop loop;
+  bool traced = true;
+  runLoop(&loop, &traced);
+  BOOST_CHECK(!traced);
+  string json = EventLoopTracer::dump(0);
+  BOOST_CHECK_EQUAL(count(json, "\"ph\":\"X\""), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testTraceLoop)
+{
+  EventLoopTracer::start();
+  BOOST_CHECK(EventLoopTracer::started());
+  EventLoop loop;
+  bool traced = false;
+  runLoop(&loop, &traced);
+  EventLoopTracer::stop();
+  BOOST_CHECK(traced);
+  BOOST_CHECK(!EventLoopTracer::started());
+
+  string json = EventLoopTracer::dump(0);
+  BOOST_CHECK_EQUAL(json.substr(0, 18), "{\"displayTimeUnit\"");
+  BOOST_CHECK_EQUAL(json.substr(json.size() - 3), "]}\n");
+  BOOST_CHECK_EQUAL(json.find(",]"), string::npos);
+  BOOST_CHECK_EQUAL(count(json, "\"name\":\"thread_name\""), 1);
+  BOOST_CHECK_EQUAL(count(json, "\"args\":{\"name\":\"main\"}"), 1);
+  BOOST_CHECK_GE(count(json, "\"name\":\"poll\""), 1);
+  // timerfd and eventfd
+  BOOST_CHECK_EQUAL(count(json, "\"name\":\"channel\""), 2);
+  BOOST_CHECK_EQUAL(count(json, "\"revents\":\"IN\""), 2);
+  BOOST_CHECK_EQUAL(count(json, "\"name\":\"timer\""), 1);
+  BOOST_CHECK_EQUAL(count(json, "\"count\":1,\"priority\":\"high\""), 1);
+  BOOST_CHECK_EQUAL(count(json, "\"priority\":\"normal\""), 2);
+  BOOST_CHECK_EQUAL(count(json, "\"ph\":\"X\""),
+                    count(json, "\"cat\":\"loop\""));
+
+  // nothing more after stop()
+  int64_t spans = count(json, "\"ph\":\"X\"");
+  bool tracedAgain = true;
+  runLoop(&loop, &tracedAgain);
+  BOOST_CHECK(!tracedAgain);
+  BOOST_CHECK_EQUAL(count(EventLoopTracer::dump(0), "\"ph\":\"X\""), spans);
+}
+
+BOOST_AUTO_TEST_CASE(testSampling)
+{
+  // fewer iterations than one sample
+  EventLoopTracer::start(1000);
+  {
+  EventLoop loop;
+  bool traced = true;
+  runLoop(&loop, &traced);
+  BOOST_CHECK(!traced);
+  BOOST_CHECK_EQUAL(count(EventLoopTracer::dump(0), "\"ph\":\"X\""), 0);
+  }
+
+  // iterations are traced, but no span is that long
+  EventLoopTracer::start(1, 1000 * 1000);
+  {
+  EventLoop loop;
+  bool traced = false;
+  runLoop(&loop, &traced);
+  BOOST_CHECK(traced);
+  BOOST_CHECK_EQUAL(count(EventLoopTracer::dump(0), "\"ph\":\"X\""), 0);
+  }
+  EventLoopTracer::stop();
+}
+
+BOOST_AUTO_TEST_CASE(testRingAndWindow)
+{
+  EventLoopTracer::start();
+  EventLoopTracer tracer;
+  BOOST_REQUIRE(tracer.beginIteration());
+  EventLoopTracer::stop();
+
+  const int64_t now = EventLoopTracer::now();
+  const int64_t kSecond = 1000 * 1000 * 1000;
+  for (int i = 0; i < EventLoopTracer::kCapacity + 100; ++i)
+  {
+    // the first 101 are overwritten
+    int64_t start = now - 10 * kSecond;
+    tracer.record(EventLoopTracer::kChannel, start, start + 1000, i, 1);
+  }
+  tracer.record(EventLoopTracer::kPoll, now - 2000, now - 1000, 0);
+  BOOST_CHECK_EQUAL(tracer.spans(), EventLoopTracer::kCapacity + 101);
+
+  string json = EventLoopTracer::dump(0);
+  // the oldest one may be being overwritten
+  BOOST_CHECK_EQUAL(count(json, "\"ph\":\"X\""), EventLoopTracer::kCapacity - 1);
+  BOOST_CHECK_EQUAL(count(json, "\"fd\":101,"), 0);
+  BOOST_CHECK_EQUAL(count(json, "\"fd\":102,"), 1);
+
+  json = EventLoopTracer::dump(1);
+  BOOST_CHECK_EQUAL(count(json, "\"ph\":\"X\""), 1);
+  BOOST_CHECK_EQUAL(count(json, "\"name\":\"poll\""), 1);
+  BOOST_CHECK_EQUAL(count(json, "\"dur\":1.000,"), 1);
+}
@@ -0,0 +1,178 @@
+#include "muduo/net/FileIoService.h"
+#include "muduo/net/EventLoop.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+//#define BOOST_TEST_MODULE FileIoServiceTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+string tempFile(const string& content)
+{
+  char name[] = "/tmp/fileioservice_unittest.XXXXXX";
+  int fd = ::mkstemp(name);
+  BOOST_REQUIRE(fd >= 0);
+  BOOST_REQUIRE(::write(fd, content.data(), content.size()) == static_cast<ssize_t>(content.size()));
+  ::close(fd);
+  return name;
+}
+
+string digits(int n)
+{
+  string s;
+  for (int i = 0; i < n; ++i)
+  {
+    s += static_cast<char>('0' + i % 10);
+  }
+  return s;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(testReadFile)
+{
+  const string content = digits(100000);
+  const string filename = tempFile(content);
+  EventLoop loop;
+  FileIoService service;
+  service.start(2);
+
+  int done = 0;
+  service.readFile(&loop, filename, 1024 * 1024, [&](int err, Buffer* data) {
+    BOOST_CHECK(loop.isInLoopThread());
+    BOOST_CHECK_EQUAL(err, 0);
+    BOOST_CHECK(data->retrieveAllAsString() == content);
+    ++done;
+  });
+  service.readFile(&loop, filename, 10, [&](int err, Buffer* data) {
+    BOOST_CHECK_EQUAL(err, 0);
+    BOOST_CHECK_EQUAL(data->retrieveAllAsString(), "0123456789");
+    ++done;
+  });
+  service.readFile(&loop, "/nonexistent/file", 1024, [&](int err, Buffer* data) {
+    BOOST_CHECK_EQUAL(err, ENOENT);
+    BOOST_CHECK_EQUAL(data->readableBytes(), 0);
+    ++done;
+  });
+  // the limit is not allocated
+  service.readFile(&loop, filename, 1024 * 1024 * 1024, [&](int err, Buffer* data) {
+    BOOST_CHECK_EQUAL(err, 0);
+    BOOST_CHECK_LT(data->internalCapacity(), 2 * content.size());
+    BOOST_CHECK(data->retrieveAllAsString() == content);
+    ++done;
+  });
+  // size 0 in stat
+  service.readFile(&loop, "/proc/self/maps", 1024 * 1024 * 1024, [&](int err, Buffer* data) {
+    BOOST_CHECK_EQUAL(err, 0);
+    BOOST_CHECK(data->readableBytes() > 0);
+    BOOST_CHECK_LT(data->internalCapacity(), 64 * 1024 * 1024);
+    ++done;
+  });
+  loop.runEvery(0.01, [&] { if (done == 5) loop.quit(); });
+  loop.loop();
+  service.stop();
+  ::unlink(filename.c_str());
+  BOOST_CHECK_EQUAL(done, 5);
+}
+
+BOOST_AUTO_TEST_CASE(testDestroyBeforeCompletions)
+{
+  const string filename = tempFile("data");
+  EventLoop loop;
+  int done = 0;
+  {
+  FileIoService service;
+  service.start(1);
+  service.readFile(&loop, filename, 1024, [&](int err, Buffer* data) {
+    BOOST_CHECK_EQUAL(err, 0);
+    BOOST_CHECK_EQUAL(data->retrieveAllAsString(), "data");
+    ++done;
+  });
+  // the read is done, its completion is queued in the loop
+  while (loop.queueSize() == 0)
+  {
+    ::usleep(1000);
+  }
+  }
+  loop.runAfter(0.01, [&] { loop.quit(); });
+  loop.loop();
+  ::unlink(filename.c_str());
+  BOOST_CHECK_EQUAL(done, 1);
+}
+
+BOOST_AUTO_TEST_CASE(testPreadBatched)
+{
+  // the last read is short
+  const string content = digits(99950);
+  const string filename = tempFile(content);
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  EventLoop loop;
+  FileIoService service;
+  service.start(4);
+
+  const int kReads = 1000;
+  int done = 0;
+  int mismatches = 0;
+  for (int i = 0; i < kReads; ++i)
+  {
+    off_t offset = i * 100;
+    service.pread(&loop, fd, offset, 100, [&, offset](int err, Buffer* data) {
+      if (err != 0 || data->retrieveAllAsString() != content.substr(offset, 100))
+        ++mismatches;
+      if (++done == kReads)
+        loop.quit();
+    });
+  }
+  loop.loop();
+  service.stop();
+  ::close(fd);
+  ::unlink(filename.c_str());
+  printf("%lld completions in %lld wakeups\n",
+         static_cast<long long>(service.completions()),
+         static_cast<long long>(service.wakeups()));
+  BOOST_CHECK_EQUAL(mismatches, 0);
+  BOOST_CHECK_EQUAL(service.completions(), kReads);
+  BOOST_CHECK_LT(service.wakeups(), kReads / 10);
+}
+
+BOOST_AUTO_TEST_CASE(testWrite)
+{
+  const string filename = tempFile("");
+  EventLoop loop;
+  FileIoService service;
+  service.start(1);
+
+  service.appendFile(&loop, filename, "hello ", [&](int err, ssize_t written) {
+    BOOST_CHECK_EQUAL(err, 0);
+    BOOST_CHECK_EQUAL(written, 6);
+    service.appendFile(&loop, filename, "world", [&](int err2, ssize_t written2) {
+      BOOST_CHECK_EQUAL(err2, 0);
+      BOOST_CHECK_EQUAL(written2, 5);
+      int fd = ::open(filename.c_str(), O_WRONLY);
+      service.pwrite(&loop, fd, 0, "HELLO", [&, fd](int err3, ssize_t written3) {
+        ::close(fd);
+        BOOST_CHECK_EQUAL(err3, 0);
+        BOOST_CHECK_EQUAL(written3, 5);
+        service.readFile(&loop, filename, 1024, [&](int err4, Buffer* data) {
+          BOOST_CHECK_EQUAL(err4, 0);
+          BOOST_CHECK_EQUAL(data->retrieveAllAsString(), "HELLO world");
+          loop.quit();
+        });
+      });
+    });
+  });
+  loop.loop();
+  service.stop();
+  ::unlink(filename.c_str());
+}
@@ -0,0 +1,196 @@
+#include "muduo/net/MemoryBudget.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+
+#include <stdio.h>
+
+//#define BOOST_TEST_MODULE MemoryBudgetTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+const int kMessageSize = 32 * 1024 * 1024;  // more than socket buffers
+
+// echoes everything
+class EchoServer
+{
+ public:
+  EchoServer(EventLoop* loop, uint16_t port, const std::shared_ptr<MemoryBudget>& budget)
+    : server_(loop, InetAddress(port, true), "EchoServer")
+  {
+    server_.setMemoryBudget(budget);
+    server_.setMessageCallback(
+        [](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) { conn->send(buf); });
+    server_.start();
+  }
+
+ private:
+  TcpServer server_;
+};
+
+// sends kMessageSize bytes, reads nothing until resume()
+class Client
+{
+ public:
+  Client(EventLoop* loop, const InetAddress& serverAddr, bool send)
+    : client_(loop, serverAddr, "Client"),
+      received_(0),
+      disconnected_(false)
+  {
+    client_.setConnectionCallback([this, send](const TcpConnectionPtr& conn) {
+      if (conn->connected())
+      {
+        conn_ = conn;
+        conn->stopRead();
+        if (send)
+          conn->send(string(kMessageSize, 'x'));
+      }
+      else
+      {
+        disconnected_ = true;
+      }
+    });
+    client_.setMessageCallback([this](const TcpConnectionPtr&, Buffer* buf, Timestamp) {
+      received_ += static_cast<int64_t>(buf->readableBytes());
+      buf->retrieveAll();
+    });
+    client_.connect();
+  }
+
+  void resume()
+  {
+    if (conn_)
+      conn_->startRead();
+  }
+
+  // the loop must run until disconnected(), or ~EventLoop
+  // destroys a TcpConnection still connected
+  void close()
+  {
+    if (conn_)
+      conn_->forceClose();
+  }
+  int64_t received() const { return received_; }
+  bool disconnected() const { return disconnected_; }
+
+ private:
+  TcpClient client_;
+  TcpConnectionPtr conn_;
+  int64_t received_;
+  bool disconnected_;
+};
+
+// runs loop until done() or timeout
+template<typename Func>
+bool runUntil(EventLoop* loop, double seconds, Func done)
+{
+  bool ok = false;
+  TimerId check = loop->runEvery(0.01, [&] {
+    if (done())
+    {
+      ok = true;
+      loop->quit();
+    }
+  });
+  TimerId timeout = loop->runAfter(seconds, [loop] { loop->quit(); });
+  loop->loop();
+  loop->cancel(check);
+  loop->cancel(timeout);
+  return ok;
+}
+
+struct QuietLogging
+{
+  QuietLogging() { Logger::setLogLevel(Logger::WARN); }
+};
+
+BOOST_GLOBAL_FIXTURE(QuietLogging);
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(testConnectionLimit)
+{
+  EventLoop loop;
+  const int64_t kLimit = 256 * 1024;
+  std::shared_ptr<MemoryBudget> budget(new MemoryBudget("test", 0));
+  budget->setConnectionLimit(kLimit);
+  EchoServer server(&loop, 29871, budget);
+  Client client(&loop, InetAddress(29871, true), true);
+
+  // server stops reading when its output buffer exceeds the limit
+  bool paused = runUntil(&loop, 10.0, [&budget] {
+    return budget->report().find("pauses_total 1\n") != string::npos;
+  });
+  BOOST_CHECK(paused);
+  printf("%s", budget->report().c_str());
+  // one read may overshoot the limit
+  BOOST_CHECK_LE(budget->peak(), kLimit + 256 * 1024);
+
+  // resumes when the peer drains
+  client.resume();
+  bool done = runUntil(&loop, 10.0, [&client] { return client.received() == kMessageSize; });
+  BOOST_CHECK(done);
+  BOOST_CHECK_LE(budget->peak(), kLimit + 256 * 1024);
+  BOOST_CHECK(!client.disconnected());
+
+  client.close();
+  BOOST_CHECK(runUntil(&loop, 10.0, [&client] { return client.disconnected(); }));
+}
+
+BOOST_AUTO_TEST_CASE(testEvictLargest)
+{
+  EventLoop loop;
+  const int64_t kLimit = 1024 * 1024;
+  std::shared_ptr<MemoryBudget> budget(new MemoryBudget("test", kLimit));
+  budget->setPauseThresholds(100, 0.5);  // never pauses
+  budget->setEvictPolicy(MemoryBudget::kEvictLargest);
+  EchoServer server(&loop, 29872, budget);
+  Client idle(&loop, InetAddress(29872, true), false);
+  Client heavy(&loop, InetAddress(29872, true), true);
+
+  bool evicted = runUntil(&loop, 10.0, [&heavy] { return heavy.disconnected(); });
+  BOOST_CHECK(evicted);
+  printf("%s", budget->report().c_str());
+  BOOST_CHECK(!idle.disconnected());
+  BOOST_CHECK(budget->report().find("evictions_total 1\n") != string::npos);
+  BOOST_CHECK_EQUAL(budget->used(), 0);
+
+  idle.close();
+  BOOST_CHECK(runUntil(&loop, 10.0, [&idle] { return idle.disconnected(); }));
+}
+
+BOOST_AUTO_TEST_CASE(testPauseAndResumeAll)
+{
+  EventLoop loop;
+  const int64_t kLimit = 1024 * 1024;
+  std::shared_ptr<MemoryBudget> budget(new MemoryBudget("test", kLimit));
+  EchoServer server(&loop, 29873, budget);
+  Client c1(&loop, InetAddress(29873, true), true);
+  Client c2(&loop, InetAddress(29873, true), true);
+
+  // pauses both connections at 3/4 of limit
+  runUntil(&loop, 2.0, [] { return false; });
+  printf("%s", budget->report().c_str());
+  BOOST_CHECK_LE(budget->peak(), kLimit);
+  BOOST_CHECK(budget->report().find("pauses_total 2\n") != string::npos);
+
+  c1.resume();
+  c2.resume();
+  bool done = runUntil(&loop, 10.0, [&] {
+    return c1.received() == kMessageSize && c2.received() == kMessageSize;
+  });
+  BOOST_CHECK(done);
+  BOOST_CHECK_LE(budget->peak(), kLimit);
+
+  c1.close();
+  c2.close();
+  BOOST_CHECK(runUntil(&loop, 10.0, [&] { return c1.disconnected() && c2.disconnected(); }));
+}
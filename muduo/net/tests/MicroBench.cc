@@ -0,0 +1,789 @@
+// Micro-benchmarks of muduo core primitives.
+//
+// ./microbench --format=csv --out=v2.2.csv
+// ./microbench --baseline=v2.2.csv
+
+#include "muduo/base/tests/MicroBench.h"
+
+#include "muduo/base/Atomic.h"
+#include "muduo/base/BinaryLogging.h"
+#include "muduo/base/Clock.h"
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/Histogram.h"
+#include "muduo/base/Logging.h"
+#include "muduo/base/LogStream.h"
+#include "muduo/base/ShardedCounter.h"
+#include "muduo/base/Thread.h"
+#include "muduo/base/Timestamp.h"
+#include "muduo/net/Buffer.h"
+#include "muduo/net/ConnectionTable.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThread.h"
+#include "muduo/net/EventLoopTracer.h"
+#include "muduo/net/SpscLoopQueue.h"
+#include "muduo/net/http/HttpContext.h"
+
+#ifdef HAVE_PROTOBUF
+#include "muduo/net/protobuf/ProtobufCodecLite.h"
+#include "muduo/net/protorpc/rpc.pb.h"
+#endif
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <sched.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+using muduo::bench::doNotOptimize;
+
+namespace
+{
+
+// The loop of main thread, for timers and same-thread runInLoop.
+EventLoop* mainLoop()
+{
+  static EventLoop loop;
+  return &loop;
+}
+
+// An I/O loop in another thread, for cross-thread functors.
+EventLoop* ioLoop()
+{
+  static EventLoopThread thread(EventLoopThread::ThreadInitCallback(), "bench");
+  static EventLoop* loop = thread.startLoop();
+  return loop;
+}
+
+void discardOutput(const char*, int)
+{
+}
+
+void stdoutOutput(const char* msg, int len)
+{
+  fwrite(msg, 1, len, stdout);
+}
+
+}  // namespace
+
+// ---------------------------------------------------------------- Buffer
+
+MUDUO_BENCHMARK_BYTES(Buffer_append_retrieve_64B, 64)(int64_t iters)
+{
+  char data[64] = { 'x' };
+  Buffer buf;
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    buf.append(data, sizeof data);
+    if (buf.readableBytes() >= 4096)
+      buf.retrieveAll();
+  }
+  doNotOptimize(buf.peek());
+}
+
+// counted in MemoryTag, unless built with -DMUDUO_MEMORY_TAGS=OFF
+MUDUO_BENCHMARK(Buffer_construct_destroy)(int64_t iters)
+{
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    Buffer buf;
+    doNotOptimize(buf.peek());
+  }
+}
+
+MUDUO_BENCHMARK_BYTES(Buffer_append_retrieve_4KiB, 4096)(int64_t iters)
+{
+  string data(4096, 'x');
+  Buffer buf;
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    buf.append(data);
+    buf.retrieve(data.size());
+  }
+  doNotOptimize(buf.peek());
+}
+
+MUDUO_BENCHMARK(Buffer_appendInt32_peekInt32)(int64_t iters)
+{
+  Buffer buf;
+  int64_t sum = 0;
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    buf.appendInt32(static_cast<int32_t>(i));
+    sum += buf.readInt32();
+  }
+  doNotOptimize(sum);
+}
+
+MUDUO_BENCHMARK_BYTES(Buffer_readFd_socketpair_1KiB, 1024)(int64_t iters)
+{
+  int fds[2];
+  if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+  {
+    perror("socketpair");
+    abort();
+  }
+  char data[1024] = { 'x' };
+  Buffer buf;
+  int savedErrno = 0;
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    ssize_t n = ::write(fds[1], data, sizeof data);
+    (void) n;
+    buf.readFd(fds[0], &savedErrno);
+    buf.retrieveAll();
+  }
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+MUDUO_BENCHMARK_BYTES(Buffer_findCRLF_1KiB, 1024)(int64_t iters)
+{
+  Buffer buf;
+  buf.append(string(1022, 'a'));
+  buf.append("\r\n");
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    doNotOptimize(buf.findCRLF());
+  }
+}
+
+MUDUO_BENCHMARK_BYTES(Buffer_findCRLF_http_headers, 512)(int64_t iters)
+{
+  string request = "GET /index.html HTTP/1.1\r\n"
+                   "Host: www.chenshuo.com\r\n"
+                   "User-Agent: Mozilla/5.0 (X11; Linux x86_64)\r\n"
+                   "Accept: text/html,application/xhtml+xml,application/xml;q=0.9\r\n"
+                   "Accept-Language: en-US,en;q=0.5\r\n"
+                   "Accept-Encoding: gzip, deflate\r\n"
+                   "Connection: keep-alive\r\n";
+  request.resize(510, 'x');
+  request += "\r\n";
+  Buffer buf;
+  buf.append(request);
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    const char* start = buf.peek();
+    const char* crlf;
+    while ((crlf = buf.findCRLF(start)) != NULL)
+    {
+      start = crlf + 2;
+    }
+    doNotOptimize(start);
+  }
+}
+
+// ---------------------------------------------------------------- Timestamp
+
+MUDUO_BENCHMARK(Timestamp_now)(int64_t iters)
+{
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    doNotOptimize(Timestamp::now());
+  }
+}
+
+MUDUO_BENCHMARK(Timestamp_toFormattedString)(int64_t iters)
+{
+  Timestamp now(Timestamp::now());
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    doNotOptimize(now.toFormattedString());
+  }
+}
+
+// ---------------------------------------------------------------- Clock
+
+MUDUO_BENCHMARK(Clock_gettimeofday)(int64_t iters)
+{
+  struct timeval tv;
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    gettimeofday(&tv, NULL);
+    doNotOptimize(tv);
+  }
+}
+
+MUDUO_BENCHMARK(Clock_monotonicNanos)(int64_t iters)
+{
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    doNotOptimize(Clock::monotonicNanos());
+  }
+}
+
+MUDUO_BENCHMARK(Clock_coarseNow)(int64_t iters)
+{
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    doNotOptimize(Clock::coarseNow());
+  }
+}
+
+MUDUO_BENCHMARK(Clock_cachedNow_inLoop)(int64_t iters)
+{
+  EventLoop* loop = ioLoop();
+  CountDownLatch latch(1);
+  loop->runInLoop([&latch, iters] {
+    for (int64_t i = 0; i < iters; ++i)
+    {
+      doNotOptimize(Clock::cachedNow());
+    }
+    latch.countDown();
+  });
+  latch.wait();
+}
+
+MUDUO_BENCHMARK(TscClock_nowNanos)(int64_t iters)
+{
+  const TscClock& clock = TscClock::instance();
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    doNotOptimize(clock.nowNanos());
+  }
+}
+
+MUDUO_BENCHMARK(TscClock_now)(int64_t iters)
+{
+  const TscClock& clock = TscClock::instance();
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    doNotOptimize(clock.now());
+  }
+}
+
+// ---------------------------------------------------------------- Counters
+
+// kThreads threads increment a counter iters times in total
+template<typename Counter>
+void incrementInThreads(Counter* counter, int64_t iters)
+{
+  const int kThreads = 4;
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int i = 0; i < kThreads; ++i)
+  {
+    threads.emplace_back(new Thread([counter, iters] {
+      for (int64_t j = 0; j < iters / kThreads; ++j)
+      {
+        counter->increment();
+      }
+    }));
+  }
+  for (auto& thr : threads)
+  {
+    thr->start();
+  }
+  for (auto& thr : threads)
+  {
+    thr->join();
+  }
+}
+
+MUDUO_BENCHMARK(AtomicInt64_increment)(int64_t iters)
+{
+  AtomicInt64 counter;
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    counter.increment();
+  }
+  doNotOptimize(counter.get());
+}
+
+MUDUO_BENCHMARK(ShardedCounter_increment)(int64_t iters)
+{
+  ShardedCounter counter;
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    counter.increment();
+  }
+  doNotOptimize(counter.get());
+}
+
+MUDUO_BENCHMARK(AtomicInt64_increment_4threads)(int64_t iters)
+{
+  AtomicInt64 counter;
+  incrementInThreads(&counter, iters);
+  doNotOptimize(counter.get());
+}
+
+MUDUO_BENCHMARK(ShardedCounter_increment_4threads)(int64_t iters)
+{
+  ShardedCounter counter;
+  incrementInThreads(&counter, iters);
+  doNotOptimize(counter.get());
+}
+
+MUDUO_BENCHMARK(Histogram_record)(int64_t iters)
+{
+  static Histogram histogram;
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    histogram.record(i & 0xffff);
+  }
+}
+
+// ---------------------------------------------------------------- TimerQueue
+
+MUDUO_BENCHMARK(TimerQueue_add_cancel_1k_pending)(int64_t iters)
+{
+  EventLoop* loop = mainLoop();
+  std::vector<TimerId> pending;
+  for (int i = 0; i < 1000; ++i)
+  {
+    pending.push_back(loop->runAfter(3600 + i, [] {}));
+  }
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    TimerId id = loop->runAfter(1800, [] {});
+    loop->cancel(id);
+  }
+  for (const TimerId& id : pending)
+  {
+    loop->cancel(id);
+  }
+}
+
+MUDUO_BENCHMARK(TimerQueue_add_cancel_earliest)(int64_t iters)
+{
+  // changes the earliest timer, so it calls timerfd_settime() every time
+  EventLoop* loop = mainLoop();
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    TimerId id = loop->runAfter(60, [] {});
+    loop->cancel(id);
+  }
+}
+
+// ---------------------------------------------------------------- EventLoop
+
+MUDUO_BENCHMARK(EventLoop_runInLoop_sameThread)(int64_t iters)
+{
+  EventLoop* loop = mainLoop();
+  int64_t count = 0;
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    loop->runInLoop([&count] { ++count; });
+  }
+  doNotOptimize(count);
+}
+
+MUDUO_BENCHMARK(EventLoop_queueInLoop_crossThread)(int64_t iters)
+{
+  EventLoop* loop = ioLoop();
+  CountDownLatch latch(1);
+  int64_t count = 0;  // modified in loop thread only
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    loop->queueInLoop([&count, &latch, iters] {
+      if (++count == iters)
+        latch.countDown();
+    });
+  }
+  latch.wait();
+}
+
+MUDUO_BENCHMARK(EventLoop_runInLoop_crossThread_roundTrip)(int64_t iters)
+{
+  EventLoop* loop = ioLoop();
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    CountDownLatch latch(1);
+    loop->runInLoop([&latch] { latch.countDown(); });
+    latch.wait();
+  }
+}
+
+// with every iteration traced
+MUDUO_BENCHMARK(EventLoop_roundTrip_traced)(int64_t iters)
+{
+  EventLoop* loop = ioLoop();
+  EventLoopTracer::start();
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    CountDownLatch latch(1);
+    loop->runInLoop([&latch] { latch.countDown(); });
+    latch.wait();
+  }
+  EventLoopTracer::stop();
+}
+
+// same as above, on a ring
+MUDUO_BENCHMARK(SpscLoopQueue_push_crossThread)(int64_t iters)
+{
+  struct Consumer
+  {
+    int64_t count;
+    int64_t target;
+    CountDownLatch* latch;
+  };
+  static Consumer consumer;
+  static SpscLoopQueue<int64_t>* queue = NULL;
+  EventLoop* loop = ioLoop();
+  if (queue == NULL)
+  {
+    // created in the consumer loop, never destroyed
+    CountDownLatch created(1);
+    loop->runInLoop([loop, &created] {
+      queue = new SpscLoopQueue<int64_t>(loop, 4096, [](int64_t& x) {
+        consumer.count += x;
+        if (consumer.count == consumer.target)
+          consumer.latch->countDown();
+      });
+      created.countDown();
+    });
+    created.wait();
+  }
+
+  CountDownLatch latch(1);
+  consumer.count = 0;
+  consumer.target = iters;
+  consumer.latch = &latch;
+  for (int64_t i = 0; i < iters; )
+  {
+    if (queue->tryPush(1))
+      ++i;
+    else
+      sched_yield();
+  }
+  latch.wait();
+}
+
+// ---------------------------------------------------------------- TcpServer connections
+
+// bookkeeping of TcpServer::newConnection() and removeConnectionInLoop()
+// with 10k live connections, before and after ConnectionTable.
+MUDUO_BENCHMARK(TcpServer_connections_stringMap)(int64_t iters)
+{
+  const string name = "EchoServer";
+  const string ipPort = "0.0.0.0:2007";
+  std::map<string, TcpConnectionPtr> connections;
+  std::vector<string> names;
+  int nextConnId = 1;
+  for (int64_t i = 0; i < iters + 10000; ++i)
+  {
+    char buf[64];
+    snprintf(buf, sizeof buf, "-%s#%d", ipPort.c_str(), nextConnId);
+    ++nextConnId;
+    string connName = name + buf;
+    connections[connName] = TcpConnectionPtr();
+    names.push_back(std::move(connName));
+    if (i >= 10000)
+    {
+      connections.erase(names[static_cast<size_t>(i - 10000)]);
+    }
+  }
+  doNotOptimize(connections.size());
+}
+
+MUDUO_BENCHMARK(TcpServer_connections_idTable)(int64_t iters)
+{
+  ConnectionTable connections;
+  TcpConnectionPtr conn;
+  int64_t nextConnId = 1;
+  for (int64_t i = 0; i < iters + 10000; ++i)
+  {
+    int64_t connId = nextConnId++;
+    connections.insert(connId, conn);
+    if (i >= 10000)
+    {
+      connections.erase(connId - 10000);
+    }
+  }
+  doNotOptimize(connections.size());
+}
+
+// ---------------------------------------------------------------- LogStream
+
+MUDUO_BENCHMARK(LogStream_int)(int64_t iters)
+{
+  LogStream os;
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    os << static_cast<int>(i);
+    os.resetBuffer();
+  }
+  doNotOptimize(os.buffer().data());
+}
+
+MUDUO_BENCHMARK(LogStream_int64)(int64_t iters)
+{
+  LogStream os;
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    os << i * 1000003;
+    os.resetBuffer();
+  }
+  doNotOptimize(os.buffer().data());
+}
+
+MUDUO_BENCHMARK(LogStream_double)(int64_t iters)
+{
+  LogStream os;
+  double x = 0.001234;
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    os << x;
+    x += 0.5;
+    os.resetBuffer();
+  }
+  doNotOptimize(os.buffer().data());
+}
+
+MUDUO_BENCHMARK(LogStream_double_latency)(int64_t iters)
+{
+  LogStream os;
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    os << 0.000123 * static_cast<double>(i & 1023);
+    os.resetBuffer();
+  }
+  doNotOptimize(os.buffer().data());
+}
+
+MUDUO_BENCHMARK(Fmt_microseconds)(int64_t iters)
+{
+  int len = 0;
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    Fmt us(".%06dZ ", static_cast<int>(i % 1000000));
+    len += us.length();
+    doNotOptimize(us.data());
+  }
+  doNotOptimize(&len);
+}
+
+MUDUO_BENCHMARK(LogStream_pointer)(int64_t iters)
+{
+  LogStream os;
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    os << &os;
+    os.resetBuffer();
+  }
+  doNotOptimize(os.buffer().data());
+}
+
+MUDUO_BENCHMARK(LogStream_access_log_line)(int64_t iters)
+{
+  LogStream os;
+  string path = "/api/v1/items";
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    os << "GET " << path << " status=" << 200 << " bytes=" << i
+       << " latency=" << 0.000123 * static_cast<double>(i & 1023) << "s\n";
+    os.resetBuffer();
+  }
+  doNotOptimize(os.buffer().data());
+}
+
+MUDUO_BENCHMARK(Logger_LOG_INFO_discard)(int64_t iters)
+{
+  Logger::setOutput(discardOutput);
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    LOG_INFO << "Hello 0123456789" << " abcdefghijklmnopqrstuvwxyz " << i;
+  }
+  Logger::setOutput(stdoutOutput);
+}
+
+MUDUO_BENCHMARK(Logger_LOG_INFO_discard_coarseClock)(int64_t iters)
+{
+  Logger::setOutput(discardOutput);
+  Logger::setClock(Clock::coarseNow);
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    LOG_INFO << "Hello 0123456789" << " abcdefghijklmnopqrstuvwxyz " << i;
+  }
+  Logger::setClock(Timestamp::now);
+  Logger::setOutput(stdoutOutput);
+}
+
+MUDUO_BENCHMARK(Logger_LOG_INFO_fields_discard)(int64_t iters)
+{
+  Logger::setOutput(discardOutput);
+  string path = "/api/v1/items";
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    LOG_INFO << "request done" << LogField("path", path) << LogField("status", 200)
+             << LogField("bytes", i) << LogField("latency", 0.000123 * static_cast<double>(i & 1023));
+  }
+  Logger::setOutput(stdoutOutput);
+}
+
+MUDUO_BENCHMARK(Logger_LOG_INFO_fields_json_discard)(int64_t iters)
+{
+  Logger::setOutput(discardOutput);
+  Logger::setFormat(LogStream::kJson);
+  string path = "/api/v1/items";
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    LOG_INFO << "request done" << LogField("path", path) << LogField("status", 200)
+             << LogField("bytes", i) << LogField("latency", 0.000123 * static_cast<double>(i & 1023));
+  }
+  Logger::setFormat(LogStream::kText);
+  Logger::setOutput(stdoutOutput);
+}
+
+MUDUO_BENCHMARK(Logger_LOG_BINARY_INFO_discard)(int64_t iters)
+{
+  BinaryLogger::setOutput(discardOutput);
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    LOG_BINARY_INFO("Hello 0123456789 abcdefghijklmnopqrstuvwxyz {}", i);
+  }
+  BinaryLogger::setOutput(NULL);
+}
+
+MUDUO_BENCHMARK(Logger_LOG_BINARY_INFO_discard_coarseClock)(int64_t iters)
+{
+  BinaryLogger::setOutput(discardOutput);
+  Logger::setClock(Clock::coarseNow);
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    LOG_BINARY_INFO("Hello 0123456789 abcdefghijklmnopqrstuvwxyz {}", i);
+  }
+  Logger::setClock(Timestamp::now);
+  BinaryLogger::setOutput(NULL);
+}
+
+MUDUO_BENCHMARK(Logger_LOG_EVERY_N_1000_discard)(int64_t iters)
+{
+  Logger::setOutput(discardOutput);
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    LOG_EVERY_N(ERROR, 1000) << "Hello 0123456789" << " abcdefghijklmnopqrstuvwxyz " << i;
+  }
+  Logger::setOutput(stdoutOutput);
+}
+
+MUDUO_BENCHMARK(Logger_LOG_EVERY_T_1s_discard)(int64_t iters)
+{
+  Logger::setOutput(discardOutput);
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    LOG_EVERY_T(ERROR, 1.0) << "Hello 0123456789" << " abcdefghijklmnopqrstuvwxyz " << i;
+  }
+  Logger::setOutput(stdoutOutput);
+}
+
+MUDUO_BENCHMARK(Logger_LOG_RATE_LIMITED_100_discard)(int64_t iters)
+{
+  Logger::setOutput(discardOutput);
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    LOG_RATE_LIMITED(ERROR, 100, 100) << "Hello 0123456789" << " abcdefghijklmnopqrstuvwxyz " << i;
+  }
+  Logger::setOutput(stdoutOutput);
+}
+
+// ---------------------------------------------------------------- HttpContext
+
+MUDUO_BENCHMARK(HttpContext_parseRequest)(int64_t iters)
+{
+  const char* request =
+      "GET /static/js/application.min.js HTTP/1.1\r\n"
+      "Host: www.chenshuo.com\r\n"
+      "Connection: keep-alive\r\n"
+      "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko)\r\n"
+      "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+      "Accept-Encoding: gzip, deflate, br\r\n"
+      "Accept-Language: en-US,en;q=0.9\r\n"
+      "Cache-Control: max-age=0\r\n"
+      "Referer: http://www.chenshuo.com/index.html\r\n"
+      "If-Modified-Since: Mon, 19 Oct 2026 04:02:32 GMT\r\n"
+      "Cookie: session=0123456789abcdef0123456789abcdef\r\n"
+      "\r\n";
+  HttpContext context;
+  Buffer buf;
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    buf.append(request);
+    context.parseRequest(&buf, Timestamp());
+    doNotOptimize(&context.request());
+    context.reset();
+  }
+}
+
+// ---------------------------------------------------------------- ProtobufCodecLite
+
+#ifdef HAVE_PROTOBUF
+namespace
+{
+
+RpcMessage makeRpcMessage()
+{
+  RpcMessage message;
+  message.set_type(REQUEST);
+  message.set_id(12345);
+  message.set_service("muduo.bench.EchoService");
+  message.set_method("Echo");
+  message.set_request(string(100, 'x'));
+  return message;
+}
+
+void discardMessage(const TcpConnectionPtr&, const MessagePtr& message, Timestamp)
+{
+  doNotOptimize(message.get());
+}
+
+}  // namespace
+
+MUDUO_BENCHMARK(ProtobufCodecLite_encode)(int64_t iters)
+{
+  RpcMessage message = makeRpcMessage();
+  ProtobufCodecLite codec(&RpcMessage::default_instance(), "RPC0", discardMessage);
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    Buffer buf;
+    codec.fillEmptyBuffer(&buf, message);
+    doNotOptimize(buf.peek());
+  }
+}
+
+MUDUO_BENCHMARK(ProtobufCodecLite_decode)(int64_t iters)
+{
+  RpcMessage message = makeRpcMessage();
+  ProtobufCodecLite codec(&RpcMessage::default_instance(), "RPC0", discardMessage);
+  Buffer encoded;
+  codec.fillEmptyBuffer(&encoded, message);
+  Buffer buf;
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    buf.append(encoded.peek(), encoded.readableBytes());
+    codec.onMessage(TcpConnectionPtr(), &buf, Timestamp());
+  }
+  assert(buf.readableBytes() == 0);
+}
+
+MUDUO_BENCHMARK(ProtobufCodecLite_decode_arena)(int64_t iters)
+{
+  RpcMessage message = makeRpcMessage();
+  ProtobufCodecLite codec(&RpcMessage::default_instance(), "RPC0", discardMessage);
+  codec.setUseArena(true);
+  Buffer encoded;
+  codec.fillEmptyBuffer(&encoded, message);
+  Buffer buf;
+  for (int64_t i = 0; i < iters; ++i)
+  {
+    buf.append(encoded.peek(), encoded.readableBytes());
+    codec.onMessage(TcpConnectionPtr(), &buf, Timestamp());
+  }
+  assert(buf.readableBytes() == 0);
+}
+#endif  // HAVE_PROTOBUF
+
+int main(int argc, char* argv[])
+{
+  mainLoop();  // created in main thread
+  int ret = muduo::bench::runBenchmarks(argc, argv);
+#ifdef HAVE_PROTOBUF
+  google::protobuf::ShutdownProtobufLibrary();
+#endif
+  return ret;
+}
@@ -0,0 +1,101 @@
+#include "muduo/net/SpscLoopQueue.h"
+#include "muduo/base/Thread.h"
+#include "muduo/net/EventLoop.h"
+
+#include <memory>
+#include <vector>
+
+#include <sched.h>
+#include <stdio.h>
+
+//#define BOOST_TEST_MODULE SpscLoopQueueTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using namespace muduo;
+using namespace muduo::net;
+
+BOOST_AUTO_TEST_CASE(testStream)
+{
+  const int64_t kItems = 1000000;
+  EventLoop loop;
+  int64_t last = 0, sum = 0, errors = 0;
+  SpscLoopQueue<int64_t> queue(&loop, 1024, [&](int64_t& x) {
+    if (x != last + 1)
+      ++errors;
+    last = x;
+    sum += x;
+    if (x == kItems)
+      loop.quit();
+  });
+
+  Thread producer([&queue, kItems] {
+    for (int64_t i = 1; i <= kItems; )
+    {
+      if (queue.tryPush(i))
+        ++i;
+      else
+        sched_yield();
+    }
+  });
+  producer.start();
+  loop.loop();
+  producer.join();
+
+  printf("%lld items in %lld wakeups\n", static_cast<long long>(kItems),
+         static_cast<long long>(queue.wakeups()));
+  BOOST_CHECK_EQUAL(errors, 0);
+  BOOST_CHECK_EQUAL(sum, kItems * (kItems + 1) / 2);
+  BOOST_CHECK_LT(queue.wakeups(), kItems / 10);
+}
+
+BOOST_AUTO_TEST_CASE(testBatchFromLoop)
+{
+  EventLoop loop;
+  std::unique_ptr<SpscLoopQueue<std::unique_ptr<int>>> queue;
+  std::vector<int> received;
+  queue.reset(new SpscLoopQueue<std::unique_ptr<int>>(&loop, 16,
+      [&](std::unique_ptr<int>& x) {
+        received.push_back(*x);
+        if (received.size() == 100)
+          loop.quit();
+      }));
+
+  // producer is another loop
+  Thread producer([&queue] {
+    EventLoop producerLoop;
+    int next = 0;
+    std::function<void()> produce = [&] {
+      std::vector<std::unique_ptr<int>> batch;
+      for (int i = 0; i < 10 && next + i < 100; ++i)
+      {
+        batch.emplace_back(new int(next + i));
+      }
+      next += static_cast<int>(queue->tryPushBatch(batch.begin(), batch.size()));
+      if (next < 100)
+        producerLoop.queueInLoop(produce);
+      else
+        producerLoop.quit();
+    };
+    producerLoop.runInLoop(produce);
+    producerLoop.loop();
+  });
+  producer.start();
+  loop.loop();
+  producer.join();
+
+  BOOST_REQUIRE_EQUAL(received.size(), 100u);
+  for (int i = 0; i < 100; ++i)
+  {
+    BOOST_CHECK_EQUAL(received[i], i);
+  }
+  BOOST_CHECK_EQUAL(queue->size(), 0u);
+  queue.reset();
+
+  // nothing pushed, loop keeps running other things
+  SpscLoopQueue<int> idle(&loop, 4, [](int&) { BOOST_ERROR("no item"); });
+  loop.runAfter(0.01, [&loop] { loop.quit(); });
+  loop.loop();
+  BOOST_CHECK_EQUAL(idle.wakeups(), 0);
+}